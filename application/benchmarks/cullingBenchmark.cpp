@@ -0,0 +1,141 @@
+#include "frustumCuller.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+// Measures FrustumCuller on the CPU for one million random objects: the scalar and AVX2 tests, spheres only and
+// spheres with boxes, then the AVX2 tests on a growing number of threads. The scalar and AVX2 results must match.
+// Run with an optional repetition count.
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	constexpr size_t OBJECT_COUNT = 1000000; ///< Objects culled per run.
+	constexpr float SCENE_HALF_SIZE = 50.0f; ///< Objects are spread over a cube of twice this size around the camera.
+	constexpr float HIDDEN_SHARE = 0.01f; ///< Share of the objects disabled, like hidden entities.
+	constexpr size_t THREAD_COUNTS[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+	/**
+	 * @struct Objects
+	 * @brief Random bounds in the layout Scene keeps them in.
+	 */
+	struct Objects {
+		std::vector<float> centerX, centerY, centerZ, radius, extentX, extentY, extentZ;
+		std::vector<uint8_t> enabled;
+
+		CullInput getInput(bool withBoxes) const {
+			CullInput input;
+			input.count = radius.size();
+			input.centerX = centerX.data();
+			input.centerY = centerY.data();
+			input.centerZ = centerZ.data();
+			input.radius = radius.data();
+			if (withBoxes) {
+				input.extentX = extentX.data();
+				input.extentY = extentY.data();
+				input.extentZ = extentZ.data();
+			}
+			input.enabled = enabled.data();
+			return input;
+		}
+	};
+
+	Objects makeObjects(std::mt19937& random) {
+		std::uniform_real_distribution<float> position(-SCENE_HALF_SIZE, SCENE_HALF_SIZE);
+		std::uniform_real_distribution<float> size(0.1f, 1.0f);
+		std::uniform_real_distribution<float> share(0.0f, 1.0f);
+		Objects objects;
+		for (size_t i = 0; i < OBJECT_COUNT; i++) {
+			glm::vec3 extent(size(random), size(random) * 0.2f, size(random)); // flat boxes, where the box test pays off
+			objects.centerX.push_back(position(random));
+			objects.centerY.push_back(position(random));
+			objects.centerZ.push_back(position(random));
+			objects.radius.push_back(glm::length(extent)); // the sphere around the box, like Scene
+			objects.extentX.push_back(extent.x);
+			objects.extentY.push_back(extent.y);
+			objects.extentZ.push_back(extent.z);
+			objects.enabled.push_back(share(random) >= HIDDEN_SHARE ? 1 : 0);
+		}
+		return objects;
+	}
+
+	/**
+	 * @brief Best of a few culls, the first one also warms up the workers and the scratch arrays.
+	 */
+	double bestOf(int repetitions, FrustumCuller& culler, const Frustum& frustum, const CullInput& input, std::vector<uint32_t>& visible) {
+		double best = 1e300;
+		for (int i = 0; i < repetitions; i++) {
+			auto start = Clock::now();
+			culler.cull(frustum, input, visible);
+			best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		}
+		return best;
+	}
+
+	void printRow(const char* name, size_t threads, double ms, size_t visible) {
+		std::cout << std::left << std::setw(28) << name << std::right
+			<< std::setw(8) << threads
+			<< std::fixed << std::setprecision(3) << std::setw(10) << ms
+			<< std::setprecision(0) << std::setw(14) << OBJECT_COUNT / ms
+			<< std::setw(10) << visible << std::endl;
+	}
+}
+
+int main(int argc, char** argv) {
+	int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+	std::mt19937 random(1234);
+	Objects objects = makeObjects(random);
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, SCENE_HALF_SIZE * 2.0f);
+	Frustum frustum = Frustum::fromViewProjection(proj * view);
+
+	std::cout << "culling benchmark, " << OBJECT_COUNT << " objects, AVX2 " << (FrustumCuller::isAvx2Supported() ? "supported" : "not supported")
+		<< ", best of " << repetitions << " runs" << std::endl;
+	std::cout << std::left << std::setw(28) << "test" << std::right
+		<< std::setw(8) << "threads" << std::setw(10) << "ms" << std::setw(14) << "objects/ms" << std::setw(10) << "visible" << std::endl;
+
+	std::vector<uint32_t> reference;
+	std::vector<uint32_t> visible;
+	{
+		JobSystem jobSystem(0); // every chunk on the calling thread
+		FrustumCuller culler(jobSystem);
+		for (bool withBoxes : { false, true }) {
+			CullInput input = objects.getInput(withBoxes);
+			culler.setUseAvx2(false);
+			double ms = bestOf(repetitions, culler, frustum, input, reference);
+			printRow(withBoxes ? "scalar, spheres + boxes" : "scalar, spheres", 1, ms, reference.size());
+			if (!FrustumCuller::isAvx2Supported()) {
+				continue;
+			}
+			culler.setUseAvx2(true);
+			ms = bestOf(repetitions, culler, frustum, input, visible);
+			printRow(withBoxes ? "avx2, spheres + boxes" : "avx2, spheres", 1, ms, visible.size());
+			if (visible != reference) {
+				std::cerr << "AVX2 and scalar culling disagree!" << std::endl;
+				return 1;
+			}
+		}
+	}
+
+	size_t hardwareThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+	for (size_t threads : THREAD_COUNTS) {
+		if (threads == 1 || threads > hardwareThreads) {
+			continue;
+		}
+		JobSystem jobSystem(threads - 1); // the calling thread helps while it waits
+		FrustumCuller culler(jobSystem);
+		double ms = bestOf(repetitions, culler, frustum, objects.getInput(true), visible);
+		printRow(culler.usesAvx2() ? "avx2, spheres + boxes" : "scalar, spheres + boxes", threads, ms, visible.size());
+		if (visible != reference) {
+			std::cerr << "parallel culling changed the visible list!" << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,205 @@
+#include "descriptorManager.hpp"
+#include "descriptorAllocator.hpp"
+#include "deletionQueue.hpp"
+#include "gpuTimeline.hpp"
+#include "bufferUtils.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <cstdlib>
+
+// Measures the per-frame descriptor path on the CPU: DescriptorManager::resetFrameDescriptors() recycles a frame's
+// transient pools with vkResetDescriptorPool, then allocateFrameSet() allocates thousands of sets and writes each
+// through the update template, like a frame giving every object its own set. The same sets allocated from a plain
+// DescriptorAllocator and written with vkUpdateDescriptorSets are timed for comparison. Unlike the other benchmarks
+// it needs a Vulkan driver, any device does (a software one like lavapipe too), nothing is submitted.
+// Run with an optional repetition count.
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	constexpr uint32_t SET_COUNTS[] = { 100, 1000, 10000, 50000 }; ///< Sets allocated per frame.
+	constexpr uint32_t TARGET_SETS = 1000; ///< Sets per frame that should take microseconds.
+	constexpr VkDeviceSize INSTANCE_BUFFER_SIZE = 1 << 16; ///< Size of each frame's instance buffer, the content is never read.
+
+	double elapsedUs(Clock::time_point start) {
+		return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	}
+
+	/**
+	 * @struct Result
+	 * @brief Best times of a set count.
+	 */
+	struct Result {
+		double resetUs = 1e300; ///< resetFrameDescriptors().
+		double templateUs = 1e300; ///< allocateFrameSet() for every set.
+		double writesUs = 1e300; ///< DescriptorAllocator::allocate() and vkUpdateDescriptorSets for every set.
+	};
+
+	/**
+	 * @brief Creates an instance and a device on the first physical device, with the timeline semaphores GpuTimeline needs.
+	 * @return False if there is no Vulkan 1.2 device.
+	 */
+	bool createDevice(VkInstance& instance, VkPhysicalDevice& physicalDevice, VkDevice& device) {
+		VkApplicationInfo appInfo{};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = "DescriptorBenchmark";
+		appInfo.apiVersion = VK_API_VERSION_1_2; // update templates and timeline semaphores are core
+		VkInstanceCreateInfo instanceInfo{};
+		instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceInfo.pApplicationInfo = &appInfo;
+		if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+			return false;
+		}
+
+		uint32_t deviceCount = 0;
+		vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+		std::vector<VkPhysicalDevice> physicalDevices(deviceCount);
+		vkEnumeratePhysicalDevices(instance, &deviceCount, physicalDevices.data());
+		physicalDevice = VK_NULL_HANDLE;
+		for (VkPhysicalDevice candidate : physicalDevices) {
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(candidate, &properties);
+			if (properties.apiVersion >= VK_API_VERSION_1_2) {
+				physicalDevice = candidate;
+				std::cout << "device: " << properties.deviceName << std::endl;
+				break;
+			}
+		}
+		if (physicalDevice == VK_NULL_HANDLE) {
+			vkDestroyInstance(instance, nullptr);
+			return false;
+		}
+
+		float priority = 1.0f;
+		VkDeviceQueueCreateInfo queueInfo{};
+		queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueInfo.queueFamilyIndex = 0; // never submitted to
+		queueInfo.queueCount = 1;
+		queueInfo.pQueuePriorities = &priority;
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12Features.timelineSemaphore = VK_TRUE;
+		VkDeviceCreateInfo deviceInfo{};
+		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.pNext = &vulkan12Features;
+		deviceInfo.queueCreateInfoCount = 1;
+		deviceInfo.pQueueCreateInfos = &queueInfo;
+		if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+			vkDestroyInstance(instance, nullptr);
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Best of a few frames of setCount sets, the first one also grows the pools to their final size.
+	 */
+	Result bestOf(int repetitions, VkDevice device, DescriptorManager& manager, DescriptorAllocator& allocator, VkDescriptorSetLayout layout,
+		VkBuffer uniformBuffer, VkBuffer instanceBuffer, uint32_t setCount) {
+		Result result;
+		VkDescriptorBufferInfo uniformInfo{ uniformBuffer, 0, sizeof(UBO) };
+		VkDescriptorBufferInfo instanceInfo{ instanceBuffer, 0, VK_WHOLE_SIZE };
+		std::array<VkWriteDescriptorSet, 2> writes{};
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].dstBinding = 0;
+		writes[0].descriptorCount = 1;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writes[0].pBufferInfo = &uniformInfo;
+		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[1].dstBinding = 1;
+		writes[1].descriptorCount = 1;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[1].pBufferInfo = &instanceInfo;
+
+		for (int i = 0; i < repetitions; i++) {
+			auto start = Clock::now();
+			manager.resetFrameDescriptors(0);
+			result.resetUs = std::min(result.resetUs, elapsedUs(start));
+
+			start = Clock::now();
+			for (uint32_t s = 0; s < setCount; s++) {
+				manager.allocateFrameSet(0);
+			}
+			result.templateUs = std::min(result.templateUs, elapsedUs(start));
+
+			allocator.reset();
+			start = Clock::now();
+			for (uint32_t s = 0; s < setCount; s++) {
+				VkDescriptorSet set = allocator.allocate(layout);
+				writes[0].dstSet = set;
+				writes[1].dstSet = set;
+				vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+			}
+			result.writesUs = std::min(result.writesUs, elapsedUs(start));
+		}
+		return result;
+	}
+}
+
+int main(int argc, char** argv) {
+	int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+	VkInstance instance;
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	if (!createDevice(instance, physicalDevice, device)) {
+		std::cerr << "no Vulkan 1.2 device, the descriptor benchmark needs a driver" << std::endl;
+		return 1;
+	}
+
+	{
+		GpuTimeline timeline(device);
+		DeletionQueue deletionQueue(device, timeline);
+		std::vector<VkBuffer> uniformBuffers(MAX_FRAMES_IN_FLIGHT);
+		std::vector<VkBuffer> instanceBuffers(MAX_FRAMES_IN_FLIGHT);
+		std::vector<VkDeviceMemory> memories;
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			VkDeviceMemory memory;
+			BufferUtils::createBuffer(device, physicalDevice, sizeof(UBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], memory);
+			memories.push_back(memory);
+			BufferUtils::createBuffer(device, physicalDevice, INSTANCE_BUFFER_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffers[i], memory);
+			memories.push_back(memory);
+		}
+
+		DescriptorManager manager(device, uniformBuffers, instanceBuffers);
+		VkDescriptorSetLayout frameLayout = manager.getDescriptorSetLayouts()[DescriptorManager::FRAME_SET];
+		const std::array<PoolSizeRatio, 2> ratios = { {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f },
+		} };
+		DescriptorAllocator allocator(device, 16, ratios); // like a frame's allocator
+
+		std::cout << "descriptor benchmark, per-frame sets of a uniform and a storage buffer, best of " << repetitions << " runs" << std::endl;
+		std::cout << std::right << std::setw(8) << "sets" << std::setw(10) << "reset us" << std::setw(13) << "template us" << std::setw(10) << "ns/set"
+			<< std::setw(11) << "writes us" << std::setw(10) << "ns/set" << std::endl;
+		for (uint32_t setCount : SET_COUNTS) {
+			Result result = bestOf(repetitions, device, manager, allocator, frameLayout, uniformBuffers[0], instanceBuffers[0], setCount);
+			std::cout << std::setw(8) << setCount << std::fixed << std::setprecision(1)
+				<< std::setw(10) << result.resetUs << std::setw(13) << result.templateUs << std::setw(10) << result.templateUs * 1000.0 / setCount
+				<< std::setw(11) << result.writesUs << std::setw(10) << result.writesUs * 1000.0 / setCount << std::endl;
+			if (setCount == TARGET_SETS) {
+				std::cout << "  " << TARGET_SETS << " sets take " << result.resetUs + result.templateUs << " us with the reset" << std::endl;
+			}
+		}
+
+		manager.destroyDescriptorManager(deletionQueue);
+		allocator.destroyDescriptorAllocator(deletionQueue);
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			deletionQueue.destroyBuffer(uniformBuffers[i]);
+			deletionQueue.destroyBuffer(instanceBuffers[i]);
+		}
+		for (VkDeviceMemory memory : memories) {
+			deletionQueue.freeMemory(memory);
+		}
+		deletionQueue.flushAll(); // nothing was submitted
+		timeline.destroyGpuTimeline();
+	}
+	vkDestroyDevice(device, nullptr);
+	vkDestroyInstance(instance, nullptr);
+	return 0;
+}
@@ -0,0 +1,146 @@
+#include "drawList.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <cstdlib>
+
+// Measures building the draw list on the CPU, what the renderer does on every frame whose scene or camera changed:
+// adding one item per sub mesh of every object, then sort() (radix sort, batching and grouping). The target is
+// 100k draws within a few milliseconds of a 60 fps frame. Recording isn't measured, it needs a device.
+// Run with an optional repetition count.
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	constexpr size_t DRAW_COUNTS[] = { 1000, 10000, 100000, 1000000 }; ///< Draws per frame, one per sub mesh of every object.
+	constexpr size_t TARGET_DRAWS = 100000; ///< Draws per frame the list should handle comfortably.
+	constexpr double FRAME_MS = 1000.0 / 60.0; ///< Budget the target is compared against.
+	constexpr uint32_t MESH_COUNT = 64; ///< Distinct meshes.
+	constexpr uint32_t SUBMESHES_PER_MESH = 4; ///< Sub meshes per mesh, so four draws per object.
+	constexpr uint32_t PIPELINE_COUNT = 8; ///< Pipeline variants, like the shader feature combinations of the materials.
+	constexpr uint32_t MATERIAL_COUNT = 256; ///< Materials, each object uses one.
+	constexpr float TRANSPARENT_SHARE = 0.05f; ///< Share of the objects drawn in the transparent pass.
+	constexpr float ALPHA_TEST_SHARE = 0.1f; ///< Share of the objects drawn in the alpha tested pass.
+
+	double elapsedMs(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	/**
+	 * @struct Object
+	 * @brief What Model::emitDraws needs of an object, picked at random once.
+	 */
+	struct Object {
+		glm::mat4 transform;
+		uint32_t meshId;
+		uint32_t pipelineId;
+		uint32_t materialIndex;
+		DrawPass pass;
+		float viewDepth;
+	};
+
+	/**
+	 * @brief Registers the meshes and variants and picks the objects of the largest run.
+	 */
+	std::vector<Object> makeObjects(DrawList& drawList, std::vector<std::unique_ptr<Mesh>>& meshes, std::mt19937& random) {
+		for (uint32_t m = 0; m < MESH_COUNT; m++) {
+			std::vector<SubMesh> subMeshes;
+			for (uint32_t s = 0; s < SUBMESHES_PER_MESH; s++) {
+				subMeshes.push_back({ s * 300, 300, 0, s }); // a hundred triangles each
+			}
+			meshes.push_back(std::make_unique<Mesh>(std::move(subMeshes), BoundingBox{ glm::vec3(-1.0f), glm::vec3(1.0f) }));
+			drawList.registerMesh(meshes.back().get());
+		}
+		for (uint32_t p = 0; p < PIPELINE_COUNT; p++) {
+			PipelineState state{};
+			state.shaderFeatures = p;
+			drawList.registerPipeline(state);
+		}
+
+		std::uniform_int_distribution<uint32_t> mesh(0, MESH_COUNT - 1);
+		std::uniform_int_distribution<uint32_t> pipeline(0, PIPELINE_COUNT - 1);
+		std::uniform_int_distribution<uint32_t> material(0, MATERIAL_COUNT - 1);
+		std::uniform_real_distribution<float> share(0.0f, 1.0f);
+		std::uniform_real_distribution<float> depth(0.5f, 500.0f);
+		std::vector<Object> objects(DRAW_COUNTS[std::size(DRAW_COUNTS) - 1] / SUBMESHES_PER_MESH);
+		for (Object& object : objects) {
+			object.transform = glm::mat4(1.0f);
+			object.meshId = mesh(random);
+			object.pipelineId = pipeline(random);
+			object.materialIndex = material(random);
+			float pass = share(random);
+			object.pass = pass < TRANSPARENT_SHARE ? DrawPass::Transparent : pass < TRANSPARENT_SHARE + ALPHA_TEST_SHARE ? DrawPass::AlphaTest : DrawPass::Opaque;
+			object.viewDepth = depth(random);
+		}
+		return objects;
+	}
+
+	/**
+	 * @struct Result
+	 * @brief Best times of a draw count and what the list was reduced to.
+	 */
+	struct Result {
+		double addMs = 1e300;
+		double sortMs = 1e300;
+		size_t batches = 0;
+		size_t groups = 0;
+	};
+
+	/**
+	 * @brief Best of a few frames, the first one also grows the list's arrays to their final size.
+	 */
+	Result bestOf(int repetitions, DrawList& drawList, const std::vector<Object>& objects, size_t drawCount) {
+		Result result;
+		size_t objectCount = drawCount / SUBMESHES_PER_MESH;
+		for (int i = 0; i < repetitions; i++) {
+			drawList.clear();
+			auto start = Clock::now();
+			for (size_t o = 0; o < objectCount; o++) {
+				const Object& object = objects[o];
+				uint32_t transformIndex = drawList.addTransform(object.transform, static_cast<uint32_t>(o));
+				for (uint32_t s = 0; s < SUBMESHES_PER_MESH; s++) {
+					drawList.add(object.pass, object.pipelineId, object.meshId, s, object.materialIndex, transformIndex, object.viewDepth);
+				}
+			}
+			result.addMs = std::min(result.addMs, elapsedMs(start));
+
+			start = Clock::now();
+			drawList.sort();
+			result.sortMs = std::min(result.sortMs, elapsedMs(start));
+		}
+		result.batches = drawList.getBatchCount();
+		result.groups = drawList.getGroupCount();
+		return result;
+	}
+}
+
+int main(int argc, char** argv) {
+	int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+	std::mt19937 random(1234);
+	DrawList drawList;
+	std::vector<std::unique_ptr<Mesh>> meshes;
+	std::vector<Object> objects = makeObjects(drawList, meshes, random);
+
+	std::cout << "draw list benchmark, " << MESH_COUNT << " meshes of " << SUBMESHES_PER_MESH << " sub meshes, " << PIPELINE_COUNT << " variants, "
+		<< MATERIAL_COUNT << " materials, best of " << repetitions << " runs" << std::endl;
+	std::cout << std::right << std::setw(10) << "draws" << std::setw(10) << "add ms" << std::setw(10) << "sort ms" << std::setw(10) << "total"
+		<< std::setw(12) << "draws/ms" << std::setw(10) << "batches" << std::setw(10) << "groups" << std::endl;
+
+	for (size_t drawCount : DRAW_COUNTS) {
+		Result result = bestOf(repetitions, drawList, objects, drawCount);
+		double total = result.addMs + result.sortMs;
+		std::cout << std::setw(10) << drawCount << std::fixed << std::setprecision(3)
+			<< std::setw(10) << result.addMs << std::setw(10) << result.sortMs << std::setw(10) << total
+			<< std::setprecision(0) << std::setw(12) << drawCount / total
+			<< std::setw(10) << result.batches << std::setw(10) << result.groups << std::endl;
+		if (drawCount == TARGET_DRAWS) {
+			std::cout << std::setprecision(1) << "  " << TARGET_DRAWS << " draws take " << total / FRAME_MS * 100.0 << "% of a 60 fps frame" << std::endl;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,133 @@
+#include "jobSystem.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+
+// Measures the job system on the CPU only: scheduling overhead per job, parallelFor scaling and dependency chains,
+// for 1 to 64 threads (workers plus the calling thread). Run with an optional repetition count.
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	constexpr size_t THREAD_COUNTS[] = { 1, 2, 4, 8, 16, 32, 64 };
+	constexpr size_t EMPTY_JOBS = 200000; ///< Jobs per overhead run.
+	constexpr size_t WORK_ITEMS = 1 << 20; ///< Indices per parallelFor run.
+	constexpr size_t WORK_GRAIN = 4096; ///< Indices per parallelFor chunk.
+	constexpr size_t CHAIN_LENGTH = 20000; ///< Jobs per dependency chain.
+
+	volatile double g_sink = 0.0; ///< Keeps the compute workload from being optimized away.
+
+	double elapsedMs(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	/**
+	 * @brief Best of a few runs, the first run also warms up the workers.
+	 */
+	template<typename F>
+	double bestOf(int repetitions, F&& run) {
+		double best = 1e300;
+		for (int i = 0; i < repetitions; i++) {
+			best = std::min(best, run());
+		}
+		return best;
+	}
+
+	/**
+	 * @brief Queues empty jobs from the calling thread and waits for them, the cost is all scheduling.
+	 */
+	double emptyJobs(JobSystem& jobSystem) {
+		JobCounter counter;
+		auto start = Clock::now();
+		for (size_t i = 0; i < EMPTY_JOBS; i++) {
+			jobSystem.run([]() {}, &counter);
+		}
+		jobSystem.wait(counter);
+		return elapsedMs(start);
+	}
+
+	/**
+	 * @brief Queues empty jobs from a job, so they go to a worker deque and the others steal them.
+	 */
+	double spawnedJobs(JobSystem& jobSystem) {
+		JobCounter counter;
+		auto start = Clock::now();
+		jobSystem.run([&jobSystem, &counter]() {
+			for (size_t i = 0; i < EMPTY_JOBS; i++) {
+				jobSystem.run([]() {}, &counter);
+			}
+		}, &counter);
+		jobSystem.wait(counter);
+		return elapsedMs(start);
+	}
+
+	/**
+	 * @brief A few hundred nanoseconds of arithmetic per index, roughly a vertex conversion or culling test.
+	 */
+	double computeFor(JobSystem& jobSystem) {
+		std::vector<double> results(WORK_ITEMS);
+		auto start = Clock::now();
+		jobSystem.parallelFor(WORK_ITEMS, WORK_GRAIN, [&results](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				double x = static_cast<double>(i);
+				for (int j = 0; j < 16; j++) {
+					x = std::sqrt(x * 1.0001 + j);
+				}
+				results[i] = x;
+			}
+		});
+		double time = elapsedMs(start);
+		g_sink = g_sink + results[WORK_ITEMS / 2];
+		return time;
+	}
+
+	/**
+	 * @brief Runs a chain of jobs where each one starts after the previous one, the cost is all dependency handling.
+	 */
+	double dependencyChain(JobSystem& jobSystem) {
+		std::vector<JobCounter> counters(CHAIN_LENGTH);
+		auto start = Clock::now();
+		jobSystem.run([]() {}, &counters[0]);
+		for (size_t i = 1; i < CHAIN_LENGTH; i++) {
+			jobSystem.runAfter(counters[i - 1], []() {}, &counters[i]);
+		}
+		jobSystem.wait(counters.back());
+		return elapsedMs(start);
+	}
+}
+
+int main(int argc, char** argv) {
+	int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+	std::cout << "job system benchmark, " << std::thread::hardware_concurrency() << " hardware threads, best of " << repetitions << " runs" << std::endl;
+	std::cout << std::setw(8) << "threads"
+		<< std::setw(16) << "queue ns/job"
+		<< std::setw(16) << "spawn ns/job"
+		<< std::setw(16) << "chain ns/job"
+		<< std::setw(14) << "for ms"
+		<< std::setw(10) << "speedup" << std::endl;
+
+	double singleThreadFor = 0.0;
+	for (size_t threads : THREAD_COUNTS) {
+		JobSystem jobSystem(threads - 1); // the calling thread helps while it waits
+		double queued = bestOf(repetitions, [&]() { return emptyJobs(jobSystem); });
+		double spawned = bestOf(repetitions, [&]() { return spawnedJobs(jobSystem); });
+		double chain = bestOf(repetitions, [&]() { return dependencyChain(jobSystem); });
+		double parallel = bestOf(repetitions, [&]() { return computeFor(jobSystem); });
+		if (threads == 1) {
+			singleThreadFor = parallel;
+		}
+
+		std::cout << std::fixed << std::setprecision(1)
+			<< std::setw(8) << threads
+			<< std::setw(16) << queued * 1e6 / EMPTY_JOBS
+			<< std::setw(16) << spawned * 1e6 / EMPTY_JOBS
+			<< std::setw(16) << chain * 1e6 / CHAIN_LENGTH
+			<< std::setprecision(2)
+			<< std::setw(14) << parallel
+			<< std::setw(10) << singleThreadFor / parallel << std::endl;
+	}
+	return 0;
+}
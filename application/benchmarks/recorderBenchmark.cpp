@@ -0,0 +1,120 @@
+#include "parallelRecorder.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <cstdlib>
+
+// Measures how ParallelRecorder's slicing scales with the thread count, on the CPU only: the items are split with
+// ParallelRecorder::planSlices() and recorded with the same parallelFor as record(), but into synthetic command
+// streams, a driver's vkCmd* cost is stood in for by a fixed amount of work per draw. Then the minimum slice size is
+// varied for a small pass, to check where MIN_ITEMS_PER_SLICE stops paying off. Run with an optional repetition count.
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	constexpr size_t THREAD_COUNTS[] = { 1, 2, 4, 8, 16, 32, 64 };
+	constexpr size_t ITEM_COUNTS[] = { 1000, 10000, 100000 }; ///< Batches per pass.
+	constexpr size_t MIN_ITEMS[] = { 64, 128, 256, 512, 1024 }; ///< Minimum slice sizes compared for SMALL_PASS.
+	constexpr size_t SMALL_PASS = 2000; ///< Batches of the pass the minimum slice sizes are compared on.
+	constexpr uint32_t DRAW_WORK = 64; ///< Hash rounds per draw, roughly what a driver spends encoding one.
+	constexpr uint32_t PIPELINES = 8; ///< Pipelines the batches cycle through, for the bind checks.
+	constexpr uint32_t MESHES = 64; ///< Meshes the batches cycle through.
+
+	volatile uint32_t g_sink = 0; ///< Keeps the recorded streams from being optimized away.
+
+	double elapsedMs(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	/**
+	 * @brief Records items [first, last) like DrawList::recordRange(), binding only what changed.
+	 */
+	void recordSlice(std::vector<uint32_t>& stream, size_t first, size_t last) {
+		stream.clear(); // like resetting the slice's pool, the memory is kept
+		uint32_t boundPipeline = UINT32_MAX;
+		uint32_t boundMesh = UINT32_MAX;
+		for (size_t i = first; i < last; i++) {
+			uint32_t pipeline = static_cast<uint32_t>(i / 4096) % PIPELINES; // sorted, so long runs share a pipeline
+			uint32_t mesh = static_cast<uint32_t>(i / 16) % MESHES;
+			if (pipeline != boundPipeline) {
+				stream.push_back(0x10000000 | pipeline);
+				boundPipeline = pipeline;
+			}
+			if (mesh != boundMesh) {
+				stream.push_back(0x20000000 | mesh);
+				boundMesh = mesh;
+			}
+			uint32_t packet = static_cast<uint32_t>(i) * 2654435761u;
+			for (uint32_t round = 0; round < DRAW_WORK; round++) {
+				packet = (packet ^ (packet >> 15)) * 2246822519u;
+			}
+			stream.insert(stream.end(), { 0x30000000u, packet, 300u, 1u, static_cast<uint32_t>(i) });
+		}
+	}
+
+	/**
+	 * @brief Best of a few recordings of a pass, the first one also warms up the workers and grows the streams.
+	 */
+	double bestOf(int repetitions, JobSystem& jobSystem, std::vector<std::vector<uint32_t>>& streams, size_t itemCount, const ParallelRecorder::SlicePlan& plan) {
+		double best = 1e300;
+		for (int i = 0; i < repetitions; i++) {
+			auto start = Clock::now();
+			jobSystem.parallelFor(plan.count, 1, [&](size_t first, size_t last) { // the calling thread records slice 0, like record()
+				for (size_t slice = first; slice < last; slice++) {
+					size_t begin = std::min(slice * plan.size, itemCount);
+					recordSlice(streams[slice], begin, std::min(begin + plan.size, itemCount));
+				}
+			});
+			best = std::min(best, elapsedMs(start));
+			for (size_t slice = 0; slice < plan.count; slice++) {
+				g_sink = g_sink + static_cast<uint32_t>(streams[slice].size());
+			}
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv) {
+	int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+	size_t hardwareThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+	std::cout << "recorder benchmark, " << DRAW_WORK << " hash rounds per draw, MIN_ITEMS_PER_SLICE " << ParallelRecorder::MIN_ITEMS_PER_SLICE
+		<< ", best of " << repetitions << " runs" << std::endl;
+	std::cout << std::right << std::setw(8) << "threads" << std::setw(10) << "items" << std::setw(8) << "slices" << std::setw(10) << "ms"
+		<< std::setw(10) << "speedup" << std::endl;
+
+	std::vector<double> singleThreadMs(std::size(ITEM_COUNTS), 0.0);
+	for (size_t threads : THREAD_COUNTS) {
+		if (threads > hardwareThreads) {
+			continue;
+		}
+		JobSystem jobSystem(threads - 1); // the calling thread records a slice too, like getMaxSlices()
+		std::vector<std::vector<uint32_t>> streams(threads);
+		for (size_t i = 0; i < std::size(ITEM_COUNTS); i++) {
+			ParallelRecorder::SlicePlan plan = ParallelRecorder::planSlices(ITEM_COUNTS[i], threads);
+			double ms = bestOf(repetitions, jobSystem, streams, ITEM_COUNTS[i], plan);
+			if (threads == 1) {
+				singleThreadMs[i] = ms;
+			}
+			std::cout << std::setw(8) << threads << std::setw(10) << ITEM_COUNTS[i] << std::setw(8) << plan.count
+				<< std::fixed << std::setprecision(3) << std::setw(10) << ms
+				<< std::setprecision(2) << std::setw(10) << singleThreadMs[i] / ms << std::endl;
+		}
+	}
+
+	std::cout << "minimum slice size, " << SMALL_PASS << " items on " << hardwareThreads << " threads" << std::endl;
+	std::cout << std::right << std::setw(10) << "min items" << std::setw(8) << "slices" << std::setw(10) << "ms" << std::endl;
+	JobSystem jobSystem(hardwareThreads - 1);
+	std::vector<std::vector<uint32_t>> streams(hardwareThreads);
+	for (size_t minItems : MIN_ITEMS) {
+		ParallelRecorder::SlicePlan plan = ParallelRecorder::planSlices(SMALL_PASS, hardwareThreads, minItems);
+		double ms = bestOf(repetitions, jobSystem, streams, SMALL_PASS, plan);
+		std::cout << std::setw(10) << minItems << std::setw(8) << plan.count << std::fixed << std::setprecision(3) << std::setw(10) << ms
+			<< (minItems == ParallelRecorder::MIN_ITEMS_PER_SLICE ? "  (current)" : "") << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include "scene.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+
+// Measures Scene::updateTransforms on the CPU for a scene of one million entities: the full update, then updates
+// of a growing number of dirty subtrees and of scattered leaves. The time per updated entity should stay flat for
+// the subtrees, the update cost depends on what moved and not on the size of the scene. Scattered leaves cost about
+// ten times more per entity, each one misses the cache in every property array (see Scene). Run with an optional
+// repetition count.
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	constexpr uint32_t ROOT_COUNT = 10000; ///< Roots of the scene.
+	constexpr uint32_t CHILDREN_PER_ROOT = 9; ///< Children of each root.
+	constexpr uint32_t LEAVES_PER_CHILD = 10; ///< Leaves of each child, a root's subtree has 100 entities.
+	constexpr uint32_t SUBTREE_SIZE = 1 + CHILDREN_PER_ROOT * (1 + LEAVES_PER_CHILD);
+	constexpr double ROOT_FRACTIONS[] = { 0.0001, 0.001, 0.01, 0.1, 1.0 }; ///< Share of the roots moved per update.
+	constexpr uint32_t SCATTERED_LEAVES = 10000; ///< Leaves moved in random order per update.
+
+	double elapsedMs(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	glm::quat randomRotation(std::mt19937& random) {
+		std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+		float half = angle(random) * 0.5f;
+		return glm::quat(std::cos(half), 0.0f, std::sin(half), 0.0f); // around y, enough to exercise every matrix term
+	}
+
+	/**
+	 * @brief Builds the scene depth first, so the arrays never need reordering.
+	 */
+	void buildScene(Scene& scene, std::vector<Entity>& roots, std::vector<Entity>& leaves, std::mt19937& random) {
+		std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+		scene.reserve(ROOT_COUNT * SUBTREE_SIZE);
+		for (uint32_t r = 0; r < ROOT_COUNT; r++) {
+			Entity root = scene.createEntity();
+			scene.setLocalTransform(root, glm::vec3(offset(random), 0.0f, offset(random)), randomRotation(random), glm::vec3(1.0f));
+			scene.setRenderable(root, 0, BoundingBox{ glm::vec3(-1.0f), glm::vec3(1.0f) });
+			roots.push_back(root);
+			for (uint32_t c = 0; c < CHILDREN_PER_ROOT; c++) {
+				Entity child = scene.createEntity(root);
+				scene.setLocalTransform(child, glm::vec3(offset(random), 1.0f, 0.0f), randomRotation(random), glm::vec3(0.5f));
+				for (uint32_t l = 0; l < LEAVES_PER_CHILD; l++) {
+					Entity leaf = scene.createEntity(child);
+					scene.setLocalTransform(leaf, glm::vec3(0.0f, offset(random), 0.0f), randomRotation(random), glm::vec3(0.25f));
+					scene.setRenderable(leaf, 0, BoundingBox{ glm::vec3(-1.0f), glm::vec3(1.0f) });
+					leaves.push_back(leaf);
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Times an update after moving some entities, best of a few runs.
+	 * @param move Called with the run number, moves the entities (must change them every run).
+	 * @param updated Receives the number of entities the update touched.
+	 */
+	template<typename F>
+	double timeUpdate(Scene& scene, int repetitions, F&& move, uint32_t& updated) {
+		double best = 1e300;
+		for (int run = 0; run < repetitions; run++) {
+			move(run);
+			auto start = Clock::now();
+			updated = scene.updateTransforms();
+			best = std::min(best, elapsedMs(start));
+		}
+		return best;
+	}
+
+	void printRow(const char* name, uint32_t updated, double ms) {
+		std::cout << std::left << std::setw(28) << name << std::right
+			<< std::setw(12) << updated
+			<< std::fixed << std::setprecision(3) << std::setw(12) << ms
+			<< std::setprecision(2) << std::setw(14) << (updated > 0 ? ms * 1e6 / updated : 0.0) << std::endl;
+	}
+}
+
+int main(int argc, char** argv) {
+	int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+	std::mt19937 random(1234);
+	Scene scene;
+	std::vector<Entity> roots;
+	std::vector<Entity> leaves;
+
+	auto buildStart = Clock::now();
+	buildScene(scene, roots, leaves, random);
+	double buildMs = elapsedMs(buildStart);
+	std::cout << "scene benchmark, " << scene.getEntityCount() << " entities (" << ROOT_COUNT << " subtrees of " << SUBTREE_SIZE
+		<< "), built in " << std::fixed << std::setprecision(1) << buildMs << " ms, best of " << repetitions << " runs" << std::endl;
+	std::cout << std::left << std::setw(28) << "update" << std::right
+		<< std::setw(12) << "entities" << std::setw(12) << "ms" << std::setw(14) << "ns/entity" << std::endl;
+
+	auto firstStart = Clock::now();
+	uint32_t updated = scene.updateTransforms(); // everything is dirty after creation
+	printRow("initial (all)", updated, elapsedMs(firstStart));
+
+	for (double fraction : ROOT_FRACTIONS) {
+		uint32_t stride = std::max(1u, static_cast<uint32_t>(1.0 / fraction));
+		double ms = timeUpdate(scene, repetitions, [&](int run) {
+			for (uint32_t r = 0; r < ROOT_COUNT; r += stride) {
+				scene.setLocalTransform(roots[r], glm::vec3(static_cast<float>(run + 1), 0.0f, static_cast<float>(r)), randomRotation(random), glm::vec3(1.0f));
+			}
+		}, updated);
+		std::ostringstream name;
+		name << "roots " << std::defaultfloat << fraction * 100.0 << "%";
+		printRow(name.str().c_str(), updated, ms);
+	}
+
+	std::uniform_int_distribution<size_t> pickLeaf(0, leaves.size() - 1);
+	double ms = timeUpdate(scene, repetitions, [&](int run) {
+		for (uint32_t i = 0; i < SCATTERED_LEAVES; i++) { // random order, the ranges have to be sorted
+			scene.setLocalTransform(leaves[pickLeaf(random)], glm::vec3(static_cast<float>(run + 1), 0.0f, 0.0f), randomRotation(random), glm::vec3(0.25f));
+		}
+	}, updated);
+	printRow("scattered leaves", updated, ms);
+
+	ms = timeUpdate(scene, repetitions, [](int) {}, updated);
+	printRow("nothing moved", updated, ms);
+	return 0;
+}
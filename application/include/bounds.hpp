@@ -0,0 +1,18 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/**
+ * @struct BoundingBox
+ * @brief Axis aligned box in the space of whatever it bounds.
+ */
+struct BoundingBox {
+	glm::vec3 min{ 0.0f }; ///< Smallest corner.
+	glm::vec3 max{ 0.0f }; ///< Largest corner.
+
+	glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+
+	/// Half the size along each axis.
+	glm::vec3 getExtent() const { return (max - min) * 0.5f; }
+};
@@ -138,35 +138,50 @@ namespace BufferUtils {
 
 
 	/**
-	* @brief Creates a GPU vertex buffer and uploads vertex data to it.
+	* @brief Creates a device local buffer and uploads data to it through a staging buffer.
 	*
 	* @param device Logical device.
 	* @param physicalDevice Physical device.
 	* @param commandPool Command pool for staging commands.
 	* @param queue Graphics queue.
-	* @param vertices Vertex data.
-	* @param buffer Output: vertex buffer.
-	* @param bufferMemory Output: memory for vertex buffer.
+	* @param srcData Data to upload.
+	* @param bufferSize Size of the data in bytes.
+	* @param usage Usage flags of the buffer (TRANSFER_DST is added automatically).
+	* @param buffer Output: device local buffer.
+	* @param bufferMemory Output: memory for the buffer.
 	*/
-	static void createVertexBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const std::vector<Vertex> vertices, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
+	static void createDeviceLocalBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const void* srcData, VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
 		VkBuffer stagingBuffer;
 		VkDeviceMemory stagingBufferMemory;
 		createBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
 		void* data;
 		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, vertices.data(), (size_t)bufferSize);
+		memcpy(data, srcData, (size_t)bufferSize);
 		vkUnmapMemory(device, stagingBufferMemory);
 
-		createBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
+		createBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
 
 		copyBuffer(device, commandPool, queue, stagingBuffer, buffer, bufferSize);
 
 		vkDestroyBuffer(device, stagingBuffer, nullptr);
 		vkFreeMemory(device, stagingBufferMemory, nullptr);
+	}
 
+	/**
+	* @brief Creates a GPU vertex buffer and uploads vertex data to it.
+	*
+	* @param device Logical device.
+	* @param physicalDevice Physical device.
+	* @param commandPool Command pool for staging commands.
+	* @param queue Graphics queue.
+	* @param vertices Vertex data.
+	* @param buffer Output: vertex buffer.
+	* @param bufferMemory Output: memory for vertex buffer.
+	*/
+	static void createVertexBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const std::vector<Vertex>& vertices, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+		createDeviceLocalBuffer(device, physicalDevice, commandPool, queue, vertices.data(), bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, buffer, bufferMemory);
 	}
 	/**
   * @brief Creates a GPU index buffer and uploads index data to it.
@@ -179,24 +194,9 @@ namespace BufferUtils {
   * @param buffer Output: index buffer.
   * @param bufferMemory Output: memory for index buffer.
   */
-	static void createIndexBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const std::vector<uint16_t> indices, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+	static void createIndexBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const std::vector<uint16_t>& indices, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
 		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, indices.data(), (size_t)bufferSize);
-		vkUnmapMemory(device, stagingBufferMemory);
-
-		createBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
-
-		copyBuffer(device, commandPool, queue, stagingBuffer, buffer, bufferSize);
-
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+		createDeviceLocalBuffer(device, physicalDevice, commandPool, queue, indices.data(), bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, buffer, bufferMemory);
 	}
 	/**
 	 * @brief Checks if a Vulkan format includes a stencil component.
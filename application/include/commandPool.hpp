@@ -1,6 +1,7 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <vector>
+#include "deletionQueue.hpp"
 
 /**
  * @class CommandPool
@@ -19,12 +20,20 @@ public:
 	void createCommandPool();
 	void createCommandBuffers();
 	/**
+ * @brief Allocates a new number of command buffers, the current ones are freed once the GPU is done with them.
+ * @param count Number of primary command buffers.
+ * @param deletionQueue Queue the current command buffers are retired to.
+ * @param retireValue Timeline value of the last submission that may use the current command buffers.
+ */
+	void resizeCommandBuffers(uint32_t count, DeletionQueue& deletionQueue, uint64_t retireValue);
+	/**
  * @brief Retrieves a specific command buffer by index.
  * @param index Index of the command buffer to retrieve.
  * @return Reference to the Vulkan command buffer.
  */
 	VkCommandBuffer& getCommandBuffer(uint32_t index);
 	VkCommandPool getCommandPool();
+	uint32_t getQueueFamilyIndex() const { return m_queueFamilyIndex; }
 
 private:
 	VkDevice m_device;                           ///< Logical Vulkan device.
@@ -33,4 +42,9 @@ private:
 	uint32_t m_queueFamilyIndex;                 ///< Graphics queue family index.
 	VkCommandPool m_commandPool;                 ///< Vulkan command pool.
 	std::vector<VkCommandBuffer> m_commandBuffers; ///< Command buffers allocated from the pool.
+
+	/**
+ * @brief Allocates one command buffer for every element of m_commandBuffers.
+ */
+	void allocateCommandBuffers();
 };
\ No newline at end of file
@@ -1,3 +1,19 @@
 #pragma once
 
-const int MAX_FRAMES_IN_FLIGHT = 2; // frames processed concurrently
\ No newline at end of file
+#include <cstdint>
+
+const int MAX_FRAMES_IN_FLIGHT = 4; // upper bound of frames processed concurrently, per-frame resources exist for each slot
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2; // frames processed concurrently unless VULKAN_APP_FRAMES_IN_FLIGHT or the number keys pick another count
+const double BACKGROUND_FRAME_RATE = 10.0; // frames per second while the window doesn't have the focus
+const double IDLE_WAIT_TIMEOUT = 0.5; // seconds render on demand sleeps before checking again for changes that didn't post an event
+const double SIMULATION_TIMESTEP = 1.0 / 120.0; // seconds simulated per fixed step, independent of the frame rate
+const uint32_t MAX_SIMULATION_STEPS = 8; // steps caught up at once after a stall, longer stalls drop the time
+const float LOOK_SENSITIVITY = 0.004f; // radians the camera turns per pixel dragged with the left mouse button
+const float MAX_LOOK_PITCH = 1.2f; // radians the camera can be tilted up or down from its animated direction
+const float MAX_LATCH_LOOK_DELTA = 0.05f; // radians the late-latched camera may turn past the one the CPU culled with, the rest shows a frame later
+const float CAMERA_NEAR_PLANE = 0.1f; // distance of the near clipping plane
+const float CAMERA_FAR_PLANE = 10.0f; // distance of the far clipping plane, objects beyond are culled
+const uint32_t INITIAL_INSTANCE_CAPACITY = 1024; // instances each per-frame instance buffer holds before it has to grow
+const uint32_t INITIAL_DRAW_BATCH_CAPACITY = 256; // batches the per-frame GPU culling buffers hold before they have to grow
+const float BARREL_GRID_SPACING = 2.5f; // distance between the extra barrels of VULKAN_APP_BARRELS, in barrel sizes
+const uint32_t MAX_MATERIAL_TEXTURES = 64; // size of the texture array indexed by the material table (must match shader.frag)
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <functional>
+#include <cstdint>
+#include "gpuTimeline.hpp"
+
+/**
+ * @class DeletionQueue
+ * @brief Destroys GPU resources once the GPU timeline passed the last submission that could use them.
+ *
+ * A resource released while frames using it may still be in flight is pushed with a timeline value, by
+ * default the value the next submission will signal, since the frame being recorded may reference it too.
+ * flush() destroys everything whose value the GPU reached, so nothing has to wait for the device to go idle
+ * and assets can be unloaded or replaced at runtime. Values are pushed in increasing order, so the queue is
+ * flushed from the front. Buffers, memory, images, views, samplers, pipelines and descriptor pools are stored
+ * as plain handles, other resources take a deleter. Not thread safe, push and flush from the render thread.
+ */
+class DeletionQueue {
+public:
+	/**
+	 * @brief Creates an empty queue.
+	 * @param device Vulkan logical device the resources belong to.
+	 * @param timeline Timeline the retire values refer to, must outlive the queue.
+	 */
+	DeletionQueue(VkDevice device, GpuTimeline& timeline);
+
+	/**
+	 * @brief Queues a deleter.
+	 * @param timelineValue Timeline value after which the resource is no longer used.
+	 * @param destroy Destroys the resource, runs on the thread calling flush().
+	 */
+	void push(uint64_t timelineValue, std::function<void()> destroy);
+
+	/**
+	 * @brief Queues a deleter that runs once the next submission completed.
+	 */
+	void push(std::function<void()> destroy);
+
+	/// Each destroyX() queues one handle to be destroyed once the next submission completed, null handles are ignored.
+	void destroyBuffer(VkBuffer buffer);
+	void freeMemory(VkDeviceMemory memory);
+	void destroyImage(VkImage image);
+	void destroyImageView(VkImageView imageView);
+	void destroySampler(VkSampler sampler);
+	void destroyPipeline(VkPipeline pipeline);
+	void destroyDescriptorPool(VkDescriptorPool descriptorPool);
+
+	/**
+	 * @brief Runs the deleters whose timeline value was reached, in the order they were pushed.
+	 * @param completedValue Value the GPU timeline has reached.
+	 */
+	void flush(uint64_t completedValue);
+
+	/**
+	 * @brief Runs the deleters whose timeline value the GPU reached, queried from the timeline.
+	 */
+	void flush();
+
+	/**
+	 * @brief Runs every deleter, the GPU must be idle.
+	 */
+	void flushAll();
+
+	/// Timeline value resources released now are tagged with: the value of the next submission.
+	uint64_t getRetireValue() const { return m_timeline.getLastSubmittedValue() + 1; }
+	size_t size() const { return m_entries.size(); }
+private:
+	/**
+	 * @brief Kind of handle an entry holds.
+	 */
+	enum class ResourceType : uint8_t {
+		Deleter, ///< Destroyed by Entry::destroy.
+		Buffer,
+		Memory,
+		Image,
+		ImageView,
+		Sampler,
+		Pipeline,
+		DescriptorPool,
+	};
+
+	/**
+	 * @struct Entry
+	 * @brief A resource and the timeline value it waits for.
+	 */
+	struct Entry {
+		uint64_t timelineValue; ///< Last submission that may use the resource.
+		ResourceType type; ///< Which member of handle is set.
+		union {
+			VkBuffer buffer;
+			VkDeviceMemory memory;
+			VkImage image;
+			VkImageView imageView;
+			VkSampler sampler;
+			VkPipeline pipeline;
+			VkDescriptorPool descriptorPool;
+		} handle; ///< Handle destroyed by the typed entries, no allocation per resource.
+		std::function<void()> destroy; ///< Destroys the resource of Deleter entries.
+	};
+
+	VkDevice m_device; ///< Vulkan logical device.
+	GpuTimeline& m_timeline; ///< Source of the retire and completed values.
+	std::deque<Entry> m_entries; ///< Resources in push order.
+
+	/**
+	 * @brief Queues a typed entry tagged with getRetireValue().
+	 */
+	void pushHandle(ResourceType type, const Entry& entry);
+
+	/**
+	 * @brief Destroys the resource of an entry.
+	 */
+	void destroyEntry(Entry& entry);
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "deletionQueue.hpp"
+#include "descriptorAllocator.hpp"
+#include "pipelineLibrary.hpp"
+
+/**
+ * @class DepthPyramid
+ * @brief Hierarchical depth buffer reduced from the frame's depth by a compute shader, what occlusion culling tests boxes against.
+ *
+ * Level 0 is half the depth buffer's size and the levels are the image's full mip chain, each rounded down like
+ * Vulkan sizes mips, so the last texel of a row or column also covers the odd texel an odd source size leaves over.
+ * Every texel holds the farthest depth of the depth texels it covers. A box whose nearest depth is farther than
+ * the texels under its screen rectangle is hidden. The image stays in the general layout, so the same commands
+ * write it with storage image stores and the culling shader samples it at any level.
+ *
+ * One pyramid serves every frame in flight: record() waits for the previous frame's reads before overwriting it.
+ */
+class DepthPyramid {
+public:
+	static constexpr uint32_t WORKGROUP_SIZE = 8; ///< local_size_x and local_size_y of depthPyramid.comp.
+
+	/**
+	 * @brief Whether the device can sample the depth format in a compute shader, the pyramid needs it.
+	 */
+	static bool isSupported(VkPhysicalDevice physicalDevice, VkFormat depthFormat);
+
+	/**
+	 * @brief Creates the sampler, layouts and compute pipeline, resize() creates the image.
+	 * @param device Vulkan logical device.
+	 * @param physicalDevice Vulkan physical device.
+	 * @param pipelineLibrary Creates and owns the compute pipeline.
+	 */
+	DepthPyramid(VkDevice device, VkPhysicalDevice physicalDevice, PipelineLibrary& pipelineLibrary);
+
+	/**
+	 * @brief Queues the image, views, sampler and descriptor pools for destruction.
+	 */
+	void destroyDepthPyramid(DeletionQueue& deletionQueue);
+
+	/**
+	 * @brief Recreates the pyramid for a new depth buffer, the current one is queued for destruction.
+	 * @param extent Size of the depth buffer.
+	 * @param depthView Depth aspect view of the depth buffer, read in the shader read only layout.
+	 * @param deletionQueue Receives the resources frames in flight may still use.
+	 */
+	void resize(VkExtent2D extent, VkImageView depthView, DeletionQueue& deletionQueue);
+
+	/**
+	 * @brief Records the reduction of every level and a barrier making the pyramid visible to compute shaders.
+	 *
+	 * Must be recorded outside rendering, after the depth buffer was transitioned for sampling.
+	 * @param commandBuffer Command buffer in the recording state.
+	 */
+	void record(VkCommandBuffer commandBuffer) const;
+
+	VkImageView getView() const { return m_view; } ///< View of every level, sampled in the general layout.
+	VkSampler getSampler() const { return m_sampler; } ///< Nearest sampler, the culling shader fetches texels.
+	uint32_t getLevelCount() const { return static_cast<uint32_t>(m_levels.size()); }
+private:
+	/**
+	 * @struct Level
+	 * @brief One mip level with the view and descriptor set that reduce it.
+	 */
+	struct Level {
+		VkExtent2D extent{ 0, 0 }; ///< Size of the level.
+		VkImageView view = VK_NULL_HANDLE; ///< Written as a storage image, read by the next level.
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE; ///< The level below as source, this level as destination.
+	};
+
+	VkDevice m_device; ///< Vulkan logical device handle.
+	VkPhysicalDevice m_physicalDevice; ///< Vulkan physical device handle.
+	VkSampler m_sampler; ///< Nearest, clamped, every level.
+	VkDescriptorSetLayout m_descriptorSetLayout; ///< Source sampler and destination storage image.
+	VkPipelineLayout m_pipelineLayout; ///< Layout of the reduction pipeline.
+	std::shared_ptr<Pipeline> m_pipeline; ///< depthPyramid.comp, owned by the pipeline library.
+	std::shared_ptr<DescriptorAllocator> m_setAllocator; ///< Sets of the current levels, replaced with them by resize().
+	VkImage m_image = VK_NULL_HANDLE; ///< R32 float image with the whole mip chain.
+	VkDeviceMemory m_memory = VK_NULL_HANDLE; ///< Memory of m_image.
+	VkImageView m_view = VK_NULL_HANDLE; ///< View of every level.
+	std::vector<Level> m_levels; ///< Levels from the largest.
+
+	void createSampler();
+	void createDescriptorSetLayout();
+	void createPipelineLayout();
+
+	/**
+	 * @brief Queues the image, its views and the descriptor sets for destruction.
+	 */
+	void retireImage(DeletionQueue& deletionQueue);
+};
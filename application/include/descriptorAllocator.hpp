@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <span>
+#include <stdexcept>
+#include "deletionQueue.hpp"
+
+/**
+ * @struct PoolSizeRatio
+ * @brief Number of descriptors of one type reserved per set when a pool is created.
+ */
+struct PoolSizeRatio {
+	VkDescriptorType type; ///< Descriptor type.
+	float ratio; ///< Descriptors of that type per set.
+};
+
+/**
+ * @class DescriptorAllocator
+ * @brief Allocates descriptor sets from a chain of pools that grows as pools fill up.
+ *
+ * Sets are never freed one by one: reset() recycles every pool at once with vkResetDescriptorPool,
+ * which makes the allocator suitable both for long-lived sets (never reset) and for per-frame
+ * transient sets (reset when the frame that used them has retired).
+ */
+class DescriptorAllocator {
+public:
+	/**
+	 * @brief Creates the first pool.
+	 * @param device The Vulkan logical device.
+	 * @param initialSets Number of sets the first pool holds, later pools grow by 50% up to MAX_SETS_PER_POOL.
+	 * @param ratios Descriptors per set for each descriptor type the pools provide.
+	 */
+	DescriptorAllocator(VkDevice device, uint32_t initialSets, std::span<const PoolSizeRatio> ratios);
+
+	/**
+	 * @brief Allocates a set, chaining a new pool if the current one is exhausted.
+	 * @param layout Layout of the set.
+	 * @return The allocated set, valid until reset() or destroyDescriptorAllocator().
+	 * @throws std::runtime_error if the set can't be allocated even from a fresh pool.
+	 */
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+	/**
+	 * @brief Returns every set to its pool. The sets must no longer be in use by the GPU.
+	 */
+	void reset();
+
+	/**
+	 * @brief Queues every pool for destruction once the GPU no longer uses the sets allocated from them.
+	 */
+	void destroyDescriptorAllocator(DeletionQueue& deletionQueue);
+private:
+	static constexpr uint32_t MAX_SETS_PER_POOL = 4096; ///< Caps the growth of the pools.
+
+	VkDevice m_device; ///< Vulkan logical device.
+	std::vector<PoolSizeRatio> m_ratios; ///< Descriptors per set for each type.
+	std::vector<VkDescriptorPool> m_readyPools; ///< Pools that still have room, the last one is allocated from.
+	std::vector<VkDescriptorPool> m_fullPools; ///< Pools that ran out, recycled by reset().
+	uint32_t m_setsPerPool; ///< Size of the next pool to create.
+
+	/**
+	 * @brief Returns a pool with room, creating a bigger one if none is left.
+	 */
+	VkDescriptorPool getPool();
+
+	/**
+	 * @brief Creates a pool holding setCount sets.
+	 */
+	VkDescriptorPool createPool(uint32_t setCount);
+};
@@ -5,56 +5,135 @@
 #include <array>
 #include <stdexcept>
 #include "uniformBuffers.hpp"
+#include <memory>
+#include "config.hpp"
+#include "descriptorAllocator.hpp"
 /**
  * @class DescriptorManager
- * @brief Manages Vulkan descriptor sets, layouts, and descriptor pool creation for uniform buffers and sampled images.
+ * @brief Manages Vulkan descriptor sets and layouts for the uniform buffers, the material table, its textures and the instance buffers.
+ *
+ * Set 0 holds the material table and its textures, it comes from a growable DescriptorAllocator and lives as long
+ * as the manager. Set 1 holds a frame's uniform buffer and instance buffer, it is allocated from one transient
+ * allocator per frame in flight, which is reset as a whole with vkResetDescriptorPool once nothing the GPU may
+ * still run binds the frame's sets. Sets are written through a VkDescriptorUpdateTemplate.
  */
 class DescriptorManager {
 public:
+    static constexpr uint32_t GLOBAL_SET = 0; ///< Set index of the material table and textures.
+    static constexpr uint32_t FRAME_SET = 1; ///< Set index of the frame's uniform and instance buffers.
+
     /**
- * @brief Constructs the DescriptorManager with the given device and uniform buffers.
+ * @brief Constructs the DescriptorManager with the given device, uniform and instance buffers.
  *
  * @param device The Vulkan logical device.
  * @param buffers A list of uniform buffers, one for each frame/image.
+ * @param instanceBuffers A list of instance storage buffers, one for each frame/image.
  */
-    DescriptorManager(VkDevice device, std::vector<VkBuffer> buffers);
+    DescriptorManager(VkDevice device, std::vector<VkBuffer> buffers, std::vector<VkBuffer> instanceBuffers);
     ~DescriptorManager() = default;
 
-    void destroyDescriptorManager();
+    /**
+     * @brief Destroys the layouts and update templates, the pools are queued until the GPU no longer uses their sets.
+     */
+    void destroyDescriptorManager(DeletionQueue& deletionQueue);
 
-    VkDescriptorSetLayout getDescriptorSetLayout() const;
+    /**
+     * @brief Layouts of the global and the per-frame set, in set order, for the pipeline layout.
+     */
+    std::vector<VkDescriptorSetLayout> getDescriptorSetLayouts() const;
 
     /**
-  * @brief Gets a specific descriptor set by index.
+  * @brief Gets the sets a frame binds from set 0 on.
   *
-  * @param index The index of the descriptor set to retrieve.
-  * @return A const reference to the VkDescriptorSet.
+  * @param frame Index of the frame in flight, allocateFrameSet() must have been called for it.
+  * @return The global set and the frame's current per-frame set.
   */
-    const VkDescriptorSet& getDescriptorSet(uint32_t index) const;
+    std::array<VkDescriptorSet, 2> getDescriptorSets(uint32_t frame) const;
+
+    /**
+ * @brief Creates the global set for the material table and its textures.
+ *
+ * @param imageViews MAX_MATERIAL_TEXTURES image views, bound to the texture array.
+ * @param sampler MAX_MATERIAL_TEXTURES samplers to be associated with the image views.
+ * @param materialBuffer Storage buffer holding the material table.
+ * @param materialBufferSize Size of the material table in bytes.
+ */
+    void createDescriptorSets(const std::vector<VkImageView>& imageViews,
+        const std::vector<VkSampler>& sampler,
+        VkBuffer materialBuffer,
+        VkDeviceSize materialBufferSize);
+
+    /**
+ * @brief Points a frame at a new instance buffer, after InstanceBuffers grew it or the GPU culler replaced it.
+ *
+ * The set already allocated isn't touched, the buffer is written into the next set allocateFrameSet() allocates.
+ * @param frame Index of the frame in flight.
+ * @param instanceBuffer The frame's new instance buffer.
+ */
+    void updateInstanceBuffer(uint32_t frame, VkBuffer instanceBuffer);
+
+    /**
+ * @brief Recycles every per-frame set of a frame at once.
+ *
+ * @param frame Index of the frame in flight, its last submission must have retired and no command buffer that
+ * will be submitted again may bind its sets.
+ */
+    void resetFrameDescriptors(uint32_t frame);
 
     /**
- * @brief Creates descriptor sets for the given image views and samplers.
+ * @brief Allocates a per-frame set from the frame's transient allocator and writes its buffers through the template.
  *
- * @param imageViews An array of 4 image views to be used in the descriptor set.
- * @param sampler An array of 4 samplers to be associated with the image views.
+ * The set becomes the one getDescriptorSets() returns and lives until resetFrameDescriptors().
+ * @param frame Index of the frame in flight.
+ * @return The allocated set.
  */
-    void createDescriptorSets(const std::array<VkImageView, 4>& imageViews,
-        const std::array<VkSampler, 4>& sampler);
+    VkDescriptorSet allocateFrameSet(uint32_t frame);
 
 private:
+    static constexpr uint32_t INITIAL_FRAME_SETS = 16; ///< Sets of a frame's first pool, the pools grow if a frame needs more.
+
+    /**
+    * @struct GlobalSetData
+    * @brief Descriptor data of set 0, laid out for m_globalTemplate.
+    */
+    struct GlobalSetData {
+        VkDescriptorBufferInfo materialBuffer; ///< binding 0
+        std::array<VkDescriptorImageInfo, MAX_MATERIAL_TEXTURES> textures; ///< binding 1
+    };
+
+    /**
+    * @struct FrameSetData
+    * @brief Descriptor data of set 1, laid out for m_frameTemplate.
+    */
+    struct FrameSetData {
+        VkDescriptorBufferInfo uniformBuffer; ///< binding 0
+        VkDescriptorBufferInfo instanceBuffer; ///< binding 1
+    };
+
 	VkDevice m_device; 					 ///< Vulkan logical device.
-	VkDescriptorPool m_descriptorPool; ///< Descriptor pool for managing descriptor sets.
-	VkDescriptorSetLayout m_descriptorSetLayout; ///< Layout for the descriptor sets.
-	std::vector<VkDescriptorSet> m_descriptorSets; ///< Vector of descriptor sets, one for each frame/image.
+	VkDescriptorSetLayout m_globalSetLayout; ///< Layout of set 0.
+	VkDescriptorSetLayout m_frameSetLayout; ///< Layout of set 1.
+	VkDescriptorUpdateTemplate m_globalTemplate; ///< Writes a whole GlobalSetData into a set in one call.
+	VkDescriptorUpdateTemplate m_frameTemplate; ///< Writes a whole FrameSetData into a set in one call.
+	std::shared_ptr<DescriptorAllocator> m_setAllocator; ///< Allocator of the global set.
+	std::vector<DescriptorAllocator> m_frameAllocators; ///< Allocators of the per-frame sets, one per frame in flight.
+	VkDescriptorSet m_globalSet = VK_NULL_HANDLE; ///< Material table and textures, shared by every frame.
+	std::vector<VkDescriptorSet> m_frameSets; ///< Current per-frame set of each frame, null until allocated.
 	std::vector<VkBuffer> m_uniformBuffers; ///< List of uniform buffers, one for each frame/image.
+	std::vector<VkBuffer> m_instanceBuffers; ///< List of instance buffers, one for each frame/image.
+
+    /**
+    * @brief Creates the layouts of the global and the per-frame set.
+    */
+    void createDescriptorSetLayouts();
 
     /**
-    * @brief Creates the descriptor set layout used for all descriptor sets.
+    * @brief Creates the descriptor allocators used to allocate descriptor sets.
     */
-    void createDescriptorSetLayout();
+    void createDescriptorAllocators();
 
     /**
-    * @brief Creates the Vulkan descriptor pool used to allocate descriptor sets.
+    * @brief Creates the update templates matching GlobalSetData and FrameSetData.
     */
-    void createDescriptorPool();
+    void createUpdateTemplates();
 };
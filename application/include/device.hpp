@@ -31,6 +31,22 @@ public:
 	VkPhysicalDevice getPhysicalDevice();
 	VkQueue getGraphicsQueue();
 	VkQueue getPresentQueue();
+
+	/**
+	 * @brief Whether VK_EXT_graphics_pipeline_library was found and enabled, pipelines are compiled monolithically otherwise.
+	 */
+	bool supportsGraphicsPipelineLibrary() const { return m_graphicsPipelineLibrarySupported; }
+
+	/**
+	 * @brief Whether VK_KHR_present_id and VK_KHR_present_wait were found and enabled, frames are paced on the CPU clock only otherwise.
+	 */
+	bool supportsPresentWait() const { return m_presentWaitSupported; }
+
+	/**
+	 * @brief Whether the drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance features were found and enabled,
+	 * culling stays on the CPU otherwise.
+	 */
+	bool supportsDrawIndirectCount() const { return m_drawIndirectCountSupported; }
 private:
 	void pickPhysicalDevice();
 	void createLogicalDevice();
@@ -42,6 +58,43 @@ private:
 	 * @return true if the device is suitable, false otherwise.
 	 */
 	bool isDeviceSuitable(VkPhysicalDevice device); ///< This can be used to only allow certain devices based on capabilities
+
+	/**
+	 * @brief Checks for Vulkan 1.3 with the dynamicRendering and synchronization2 features the render graph relies on,
+	 * and the timelineSemaphore feature the frame loop synchronizes with.
+	 *
+	 * @param device The physical device to check.
+	 * @return true if the device supports all three features.
+	 */
+	bool checkVulkan13Support(VkPhysicalDevice device);
+
+	/**
+	 * @brief Checks the optional VK_EXT_graphics_pipeline_library extension and feature.
+	 *
+	 * The feature and its properties are only queried once the device reports Vulkan 1.1 and both extensions.
+	 * A device that supports the feature but not graphicsPipelineLibraryFastLinking is treated as unsupported,
+	 * linking its parts wouldn't be faster than a monolithic compile.
+	 * @param device The physical device to check.
+	 * @return true if pipelines can be built from separately compiled library parts and linked quickly.
+	 */
+	bool checkGraphicsPipelineLibrarySupport(VkPhysicalDevice device);
+
+	/**
+	 * @brief Checks the optional VK_KHR_present_id and VK_KHR_present_wait extensions and features.
+	 *
+	 * @param device The physical device to check.
+	 * @return true if the CPU can wait for a present to reach the display.
+	 */
+	bool checkPresentWaitSupport(VkPhysicalDevice device);
+
+	/**
+	 * @brief Checks the optional features GPU culling draws with: vkCmdDrawIndexedIndirectCount, more than one
+	 * draw per indirect call and a firstInstance other than 0 in the indirect commands.
+	 *
+	 * @param device The physical device to check.
+	 * @return true if the GPU can generate the draws.
+	 */
+	bool checkDrawIndirectCountSupport(VkPhysicalDevice device);
 	
 
 	VkSurfaceKHR m_surface; ///< The rendering surface used to evaluate device compatibility.
@@ -51,4 +104,9 @@ private:
 	VkQueue graphicsQueue; ///< The graphics queue used for rendering operations.
 	VkQueue presentQueue; ///< The present queue used for presenting images to the surface.
 	const std::vector<const char*> m_deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };  ///< List of required device extensions.
+	const std::vector<const char*> m_pipelineLibraryExtensions = { VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME }; ///< Optional extensions for fast-linked pipelines.
+	bool m_graphicsPipelineLibrarySupported = false; ///< Whether the selected device has the pipeline library extensions enabled.
+	const std::vector<const char*> m_presentWaitExtensions = { VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME }; ///< Optional extensions for display timing.
+	bool m_presentWaitSupported = false; ///< Whether the selected device has the present wait extensions enabled.
+	bool m_drawIndirectCountSupported = false; ///< Whether the selected device has the indirect draw features GPU culling needs enabled.
 };
\ No newline at end of file
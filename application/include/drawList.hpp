@@ -0,0 +1,267 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <glm/glm.hpp>
+#include "mesh.hpp"
+#include "pipelineLibrary.hpp"
+#include "instanceBuffers.hpp"
+#include "gpuCuller.hpp"
+
+/**
+ * @brief Ordered buckets of a draw list, the most significant bits of the sort key.
+ */
+enum class DrawPass : uint8_t {
+	Opaque, ///< Sorted by state, then front to back.
+	AlphaTest, ///< After opaque draws so they profit from the depth they wrote.
+	Transparent, ///< Sorted back to front, state only breaks ties.
+};
+
+/**
+ * @struct DrawStats
+ * @brief What walking a sorted draw list emitted.
+ */
+struct DrawStats {
+	uint32_t draws = 0; ///< Draw calls recorded.
+	uint32_t instances = 0; ///< Instances drawn by those calls, one per draw item.
+	uint32_t pipelineBinds = 0; ///< vkCmdBindPipeline calls.
+	uint32_t meshBinds = 0; ///< Vertex and index buffer binds.
+	uint32_t redundantBinds = 0; ///< Binds skipped because the state was already set.
+	uint32_t indirectDraws = 0; ///< vkCmdDrawIndexedIndirectCount calls, each draws a group of batches.
+	uint32_t skippedDraws = 0; ///< Batches not drawn because their pipeline variant was still compiling.
+	double sortMs = 0.0; ///< Time spent sorting the keys and batching the items.
+	double recordMs = 0.0; ///< Time spent recording the draws, across every recording thread.
+
+	/**
+	 * @brief Adds the counts of a range recorded separately, the timings are kept.
+	 */
+	DrawStats& operator+=(const DrawStats& other) {
+		draws += other.draws;
+		instances += other.instances;
+		pipelineBinds += other.pipelineBinds;
+		meshBinds += other.meshBinds;
+		redundantBinds += other.redundantBinds;
+		indirectDraws += other.indirectDraws;
+		skippedDraws += other.skippedDraws;
+		return *this;
+	}
+};
+
+/**
+ * @class DrawList
+ * @brief Per-frame list of draw items ordered by a 64-bit sort key to minimize state changes.
+ *
+ * The scene adds one item per draw with its pass, pipeline, material, mesh, sub mesh and view depth packed into
+ * a key. sort() radix sorts the keys and merges consecutive items drawing the same sub mesh with the same
+ * pipeline and material into one instanced draw, writing each item's transform and material into an instance array in
+ * sorted order. record() walks the batches, binding a pipeline or buffers only when they differ from the
+ * previous draw. The shaders fetch the instance data with gl_InstanceIndex, so recording doesn't depend on
+ * the transforms. Pipeline and mesh ids stay valid across frames, clear() only drops the items.
+ *
+ * For GPU culling, sort() also groups consecutive batches sharing a pipeline and mesh and describes the batches
+ * and groups to GpuCuller. recordIndirectRange() then records one indirect draw per group, whose draws and
+ * instance counts the culling shaders write. Transparent batches get no group: the shaders append survivors in
+ * any order, which would break back to front blending, so they are recorded with recordRange() from
+ * getFirstTransparentBatch() on and the shaders keep their instances in place.
+ */
+class DrawList {
+public:
+	/**
+	 * @brief Returns the id of a pipeline variant, registering it on first use.
+	 * @throws std::runtime_error if more variants than the key can hold are registered.
+	 */
+	uint32_t registerPipeline(const PipelineState& state);
+
+	/**
+	 * @brief Returns the id of a mesh, registering it on first use.
+	 * @throws std::runtime_error if more meshes than the key can hold are registered.
+	 */
+	uint32_t registerMesh(Mesh* mesh);
+
+	/**
+	 * @brief Stores a transform for this frame, draws of the same object share it.
+	 * @param transform Object to world transform.
+	 * @param objectIndex Index of the object in the scene, stable across frames, written into its instances.
+	 * @return Index passed to add().
+	 */
+	uint32_t addTransform(const glm::mat4& transform, uint32_t objectIndex = 0);
+
+	/**
+	 * @brief Adds a draw of a sub mesh.
+	 * @param pass Bucket of the draw.
+	 * @param pipelineId Id from registerPipeline().
+	 * @param meshId Id from registerMesh().
+	 * @param subMeshIndex Index of the sub mesh in the mesh.
+	 * @param materialIndex Index into the material table.
+	 * @param transformIndex Index from addTransform().
+	 * @param viewDepth Distance from the camera along the view direction, negative values count as 0.
+	 * @throws std::runtime_error if the material index doesn't fit the key.
+	 */
+	void add(DrawPass pass, uint32_t pipelineId, uint32_t meshId, uint32_t subMeshIndex, uint32_t materialIndex, uint32_t transformIndex, float viewDepth);
+
+	/**
+	 * @brief Orders the items by their keys, then batches them and fills the instance array.
+	 */
+	void sort();
+
+	/**
+	 * @brief Records the batches, binding only state that changed since the previous draw.
+	 *
+	 * The descriptor set must already be bound with the layout shared by every variant.
+	 * @param commandBuffer Command buffer inside a rendering scope.
+	 * @param pipelineLibrary Resolves the pipeline ids to pipelines.
+	 * @return What was recorded.
+	 */
+	DrawStats record(VkCommandBuffer commandBuffer, PipelineLibrary& pipelineLibrary);
+
+	/**
+	 * @brief Resolves the pipeline of every registered variant for this frame, called once before recordRange().
+	 */
+	void resolvePipelines(PipelineLibrary& pipelineLibrary);
+
+	/**
+	 * @brief Records a range of the batches, the state of earlier batches is not assumed.
+	 *
+	 * Doesn't modify the list, so disjoint ranges can be recorded on several threads into separate command buffers.
+	 * @param commandBuffer Command buffer with the descriptor set bound, inside (or inheriting) a rendering scope.
+	 * @param first Position of the first batch to record.
+	 * @param last Position one past the last batch to record.
+	 * @return What was recorded.
+	 */
+	DrawStats recordRange(VkCommandBuffer commandBuffer, size_t first, size_t last) const;
+
+	/**
+	 * @brief Records a range of the groups as indirect draws, the state of earlier groups is not assumed.
+	 *
+	 * Like recordRange(), disjoint ranges can be recorded on several threads. The draw stats count the batches
+	 * the groups may draw, the culling shaders decide how many they do.
+	 * @param commandBuffer Command buffer with the descriptor set bound, inside (or inheriting) a rendering scope.
+	 * @param first Position of the first group to record.
+	 * @param last Position one past the last group to record.
+	 * @param drawCommands Draw commands written by the culling shaders, at the position of each group's first batch.
+	 * @param commandOffset Byte offset of the draw commands of the recorded phase.
+	 * @param drawCounts Number of draws of each group, written by the culling shaders.
+	 * @param countOffset Byte offset of the draw counts of the recorded phase.
+	 * @return What was recorded.
+	 */
+	DrawStats recordIndirectRange(VkCommandBuffer commandBuffer, size_t first, size_t last, VkBuffer drawCommands, VkDeviceSize commandOffset,
+		VkBuffer drawCounts, VkDeviceSize countOffset) const;
+
+	/**
+	 * @brief Stores the combined stats of ranges recorded with recordRange(), the sort time is kept.
+	 */
+	void setRecordStats(const DrawStats& stats);
+
+	/**
+	 * @brief Drops the items and transforms of the last frame.
+	 */
+	void clear();
+
+	size_t size() const { return m_items.size(); }
+	size_t getBatchCount() const { return m_batches.size(); }
+	size_t getGroupCount() const { return m_groups.size(); } ///< Groups of the opaque and alpha tested batches.
+	size_t getFirstTransparentBatch() const { return m_firstTransparentBatch; } ///< Batches from here on are transparent, getBatchCount() if none is.
+	uint32_t getFirstTransparentInstance() const; ///< Instance of the first transparent batch, the instance count if none is.
+	const std::vector<GPUDrawBatch>& getGPUBatches() const { return m_gpuBatches; } ///< Batches as the culling shaders read them, indexed by GPUInstance::batchIndex.
+	const std::vector<GPUDrawGroup>& getGPUGroups() const { return m_gpuGroups; } ///< Groups as the culling shaders read them.
+	const std::vector<GPUInstance>& getInstances() const { return m_instances; } ///< Instance data of the sorted items, what firstInstance indexes.
+	const DrawStats& getStats() const { return m_stats; }
+
+	/**
+	 * @brief Packs the fields into a sort key.
+	 *
+	 * Opaque and alpha tested keys are pass | pipeline | material | mesh | sub mesh | depth, so state changes
+	 * are minimized, the draws of one sub mesh are adjacent and can be instanced, and equal state draws front to
+	 * back. Transparent keys are pass | inverted depth | pipeline | material | mesh | sub mesh to keep them back
+	 * to front. Only the low bits of the sub mesh index are kept, sub meshes sharing them batch less well.
+	 */
+	static uint64_t makeKey(DrawPass pass, uint32_t pipelineId, uint32_t materialIndex, uint32_t meshId, uint32_t subMeshIndex, float viewDepth);
+private:
+	static constexpr uint32_t PASS_BITS = 2;
+	static constexpr uint32_t PIPELINE_BITS = 14;
+	static constexpr uint32_t MATERIAL_BITS = 16;
+	static constexpr uint32_t MESH_BITS = 12;
+	static constexpr uint32_t SUBMESH_BITS = 4;
+	static constexpr uint32_t DEPTH_BITS = 16;
+	static_assert(PASS_BITS + PIPELINE_BITS + MATERIAL_BITS + MESH_BITS + SUBMESH_BITS + DEPTH_BITS == 64, "sort key fields must fill 64 bits");
+
+	/**
+	 * @struct DrawItem
+	 * @brief One draw of a sub mesh as added, before batching.
+	 */
+	struct DrawItem {
+		uint32_t materialIndex; ///< Written into the item's instance.
+		uint32_t transformIndex; ///< Index into m_transforms.
+		uint32_t subMeshIndex; ///< Index into the mesh's sub meshes.
+		uint16_t pipelineId; ///< Index into m_pipelineStates.
+		uint16_t meshId; ///< Index into m_meshes.
+	};
+
+	/**
+	 * @struct DrawBatch
+	 * @brief Consecutive sorted items drawing the same sub mesh with the same pipeline and material, one instanced draw.
+	 */
+	struct DrawBatch {
+		uint32_t firstIndex; ///< First index of the sub mesh.
+		uint32_t indexCount; ///< Number of indices of the sub mesh.
+		int32_t vertexOffset; ///< Vertex offset of the sub mesh.
+		uint32_t firstInstance; ///< Position of the first item in m_instances.
+		uint32_t instanceCount; ///< Number of items merged.
+		uint32_t subMeshIndex; ///< Index into the mesh's sub meshes.
+		uint32_t materialIndex; ///< Material of every instance.
+		uint16_t pipelineId; ///< Index into m_pipelineStates.
+		uint16_t meshId; ///< Index into m_meshes.
+	};
+
+	/**
+	 * @struct DrawGroup
+	 * @brief Consecutive batches drawn with the same pipeline and mesh, one indirect draw.
+	 */
+	struct DrawGroup {
+		uint32_t firstBatch; ///< Position of the first batch in m_batches.
+		uint32_t batchCount; ///< Number of batches.
+		uint16_t pipelineId; ///< Index into m_pipelineStates.
+		uint16_t meshId; ///< Index into m_meshes.
+	};
+
+	/**
+	 * @struct SortEntry
+	 * @brief A key and the item it belongs to, what the radix sort moves around.
+	 */
+	struct SortEntry {
+		uint64_t key; ///< Sort key from makeKey().
+		uint32_t item; ///< Index into m_items.
+	};
+
+	std::vector<DrawItem> m_items; ///< Items in submission order.
+	std::vector<SortEntry> m_entries; ///< Keys, sorted by sort().
+	std::vector<SortEntry> m_scratch; ///< Ping-pong buffer of the radix sort.
+	std::vector<glm::mat4> m_transforms; ///< Transforms of this frame.
+	std::vector<uint32_t> m_objectIndices; ///< Object index of each transform.
+	std::vector<DrawBatch> m_batches; ///< Instanced draws in recording order, built by sort().
+	std::vector<GPUInstance> m_instances; ///< Transform and material of each sorted item, built by sort().
+	std::vector<DrawGroup> m_groups; ///< Indirect draws in recording order, built by sort().
+	std::vector<GPUDrawBatch> m_gpuBatches; ///< m_batches for the culling shaders, built by sort().
+	std::vector<GPUDrawGroup> m_gpuGroups; ///< m_groups for the culling shaders, built by sort().
+	size_t m_firstTransparentBatch = 0; ///< Position of the first transparent batch in m_batches, built by sort().
+
+	std::vector<PipelineState> m_pipelineStates; ///< Registered variants, indexed by pipeline id.
+	std::unordered_map<PipelineState, uint32_t, PipelineStateHash> m_pipelineIds; ///< Variant to pipeline id.
+	uint32_t m_lastPipelineId = UINT32_MAX; ///< Id returned by the last registerPipeline(), most calls repeat it.
+	std::vector<Mesh*> m_meshes; ///< Registered meshes, indexed by mesh id.
+	std::vector<VkPipeline> m_resolvedPipelines; ///< Pipelines of the registered variants for the frame being recorded.
+
+	DrawStats m_stats; ///< Stats of the last sort() and record().
+
+	/**
+	 * @brief Merges the sorted items into batches and writes their instances.
+	 */
+	void buildBatches();
+
+	/**
+	 * @brief Merges the opaque and alpha tested batches into groups and describes every batch to the culling shaders.
+	 */
+	void buildGroups();
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+
+/**
+ * @struct FrameTimeHistogram
+ * @brief Frame times bucketed in 0.1 ms steps, percentiles are read from the buckets without storing samples.
+ */
+struct FrameTimeHistogram {
+	static constexpr double BUCKET_MS = 0.1; ///< Width of a bucket, the resolution of the percentiles.
+	static constexpr size_t BUCKET_COUNT = 1000; ///< Covers 0 to 100 ms, longer frames land in the last bucket.
+
+	std::array<uint32_t, BUCKET_COUNT> buckets{}; ///< Number of samples per bucket.
+	uint32_t count = 0; ///< Number of samples.
+
+	void add(double ms);
+
+	/**
+	 * @brief Upper bound of the bucket containing a percentile, 0 without samples.
+	 * @param percentile Percentile between 0 and 100.
+	 */
+	double percentile(double percentile) const;
+
+	void reset();
+};
+
+/**
+ * @class FramePacer
+ * @brief Spaces frames evenly instead of rendering them as fast as possible.
+ *
+ * waitForNextFrame() runs before each frame. With a frame rate limit it sleeps until shortly before the
+ * frame's deadline and spins the rest of the way, since a sleep alone overshoots by the scheduler granularity.
+ * Deadlines advance by the target frame time rather than from when the wait returned, so they don't drift,
+ * and a frame that missed its deadline starts the schedule over instead of bursting to catch up.
+ *
+ * With VK_KHR_present_wait and a FIFO present mode it also blocks until the frame presented before the last
+ * one reached the display, which keeps at most one frame queued for presentation and times the interval
+ * between displayed frames and the time from submitting a frame until it was displayed (as seen by the wait,
+ * so a present that was displayed before the wait started counts late). The CPU frame times, display
+ * intervals and submit to display times are kept as histograms.
+ */
+class FramePacer {
+public:
+	using Clock = std::chrono::steady_clock; ///< sleep_until needs a clock that doesn't jump.
+
+	/**
+	 * @brief Creates a pacer without a frame rate limit.
+	 * @param device Vulkan logical device.
+	 * @param presentWaitSupported Whether VK_KHR_present_id and VK_KHR_present_wait are enabled on the device.
+	 */
+	FramePacer(VkDevice device, bool presentWaitSupported);
+
+	/**
+	 * @brief Sets the frame rate limit, 0 renders as fast as the present mode allows.
+	 */
+	void setTargetFrameRate(double framesPerSecond);
+
+	/**
+	 * @brief Blocks until the next frame may start.
+	 * @param swapChain Swap chain the frames are presented to.
+	 * @param presentMode Its present mode, display waits are only done for FIFO modes.
+	 */
+	void waitForNextFrame(VkSwapchainKHR swapChain, VkPresentModeKHR presentMode);
+
+	/**
+	 * @brief Gives the next present an id to wait for, the present info must be submitted before the next call.
+	 * @param submitTime When the frame's command buffer was submitted, its submit to display time is recorded.
+	 */
+	void attachPresentId(VkPresentInfoKHR& presentInfo, Clock::time_point submitTime);
+
+	/**
+	 * @brief Records the CPU frame time, call after each present.
+	 */
+	void framePresented();
+
+	/**
+	 * @brief Forgets the ids presented to the previous swap chain, call after recreating it.
+	 */
+	void swapChainRecreated();
+
+	/**
+	 * @brief Call after the loop slept without rendering, the gap isn't counted as a frame time and the schedule restarts.
+	 */
+	void idled();
+
+	/**
+	 * @brief Prints the frame time percentiles since the last reset.
+	 */
+	void print(std::ostream& out, VkPresentModeKHR presentMode) const;
+
+	/**
+	 * @brief Starts a new measurement interval.
+	 */
+	void reset();
+
+	double getTargetFrameRate() const { return m_targetFrameRate; }
+	bool usesPresentWait() const { return m_vkWaitForPresentKHR != nullptr; }
+private:
+	static constexpr std::chrono::microseconds SPIN_THRESHOLD{ 2000 }; ///< Part of the wait spent spinning, covers the sleep overshoot.
+	static constexpr uint64_t PRESENT_WAIT_TIMEOUT_NS = 100'000'000; ///< Gives up on a present that doesn't show up, e.g. while minimized.
+	static constexpr size_t TRACKED_PRESENTS = 4; ///< Submit times kept, more than the presents that can be queued when waited for.
+
+	VkDevice m_device; ///< Vulkan logical device.
+	PFN_vkWaitForPresentKHR m_vkWaitForPresentKHR = nullptr; ///< Loaded if present wait is supported.
+
+	double m_targetFrameRate = 0.0; ///< Frame rate limit, 0 if unlimited.
+	Clock::duration m_targetFrameTime{}; ///< Time between frame starts, zero if unlimited.
+	Clock::time_point m_nextDeadline{}; ///< Earliest start of the next frame.
+
+	uint64_t m_presentId = 0; ///< Id of the last present.
+	uint64_t m_firstSwapChainPresentId = 1; ///< First id presented to the current swap chain.
+	VkPresentIdKHR m_presentIdInfo{}; ///< Chained to the present info by attachPresentId().
+	std::array<Clock::time_point, TRACKED_PRESENTS> m_submitTimes{}; ///< Submit time of the recent presents, indexed by id modulo the size.
+	Clock::time_point m_lastDisplayed{}; ///< When the last waited for present reached the display.
+	bool m_hasLastDisplayed = false; ///< Whether m_lastDisplayed belongs to the previous present.
+
+	Clock::time_point m_lastPresent{}; ///< When the last frame was presented.
+	bool m_hasLastPresent = false; ///< Whether a frame was presented since the last swap chain recreation.
+
+	FrameTimeHistogram m_frameTimes; ///< Present to present times on the CPU.
+	FrameTimeHistogram m_displayIntervals; ///< Time between displayed frames, measured with present wait.
+	FrameTimeHistogram m_submitToDisplay; ///< Time from submitting a frame to it being displayed, measured with present wait.
+
+	/**
+	 * @brief Waits for a present to reach the display and records the display interval.
+	 */
+	void waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId);
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+#include "config.hpp"
+
+/**
+ * @struct TimingStat
+ * @brief Average and maximum of a timing sampled once per frame.
+ */
+struct TimingStat {
+	double totalMs = 0.0; ///< Sum of the samples.
+	double maxMs = 0.0; ///< Largest sample.
+	uint32_t count = 0; ///< Number of samples.
+
+	void add(double ms);
+	double average() const { return count > 0 ? totalMs / count : 0.0; }
+};
+
+/**
+ * @class FrameStats
+ * @brief Measures how the number of frames in flight trades CPU stalls for latency.
+ *
+ * Three timings are kept per frame: how long the CPU blocked on the frame's timeline value, the time from acquiring
+ * the swap chain image to queuing its present, and the time from acquiring the image until the GPU is seen
+ * to have finished the frame (checked once per frame, so it is accurate to one frame interval).
+ *
+ * For the camera latency it also times how old the scene and camera samples are when the frame is submitted,
+ * and the submit to GPU done time. The scene is sampled before the frame is recorded, the late-latched camera
+ * right before the submit, so the difference between the two is the latency the late latch removes.
+ */
+class FrameStats {
+public:
+	using Clock = std::chrono::high_resolution_clock;
+
+	/**
+	 * @brief Records how long the CPU waited for a frame slot to retire.
+	 */
+	void recordFrameWait(Clock::time_point start);
+
+	/**
+	 * @brief Marks the start of a frame in a slot, right before the swap chain image is acquired.
+	 */
+	void frameAcquired(uint32_t frame);
+
+	/**
+	 * @brief Records how old the samples of the frame in a slot are, call right after submitting it.
+	 * @param sceneSample When the scene the draws were recorded from was sampled.
+	 * @param cameraSample When the camera written to the uniform buffer was sampled.
+	 */
+	void frameSubmitted(uint32_t frame, Clock::time_point sceneSample, Clock::time_point cameraSample);
+
+	/**
+	 * @brief Records the acquire to present time of the frame in a slot.
+	 */
+	void framePresented(uint32_t frame);
+
+	/**
+	 * @brief Records the acquire and submit to GPU completion times of the frame in a slot, once per frame.
+	 */
+	void frameRetired(uint32_t frame);
+
+	/**
+	 * @brief Counts a frame whose command buffer was recorded, or replayed from an earlier recording.
+	 */
+	void frameRecorded(bool replayed);
+
+	/**
+	 * @brief Records the CPU time of a frame's scene update, culling and draw list.
+	 * @param start When the update started.
+	 * @param rebuilt Whether the draw list was built again, or the frame reused the previous one.
+	 */
+	void recordUpdate(Clock::time_point start, bool rebuilt);
+
+	/**
+	 * @brief Whether the frame in a slot was submitted and its completion not recorded yet.
+	 */
+	bool isPending(uint32_t frame) const { return m_pending[frame]; }
+
+	/**
+	 * @brief Prints the averages and maxima since the last reset.
+	 */
+	void print(std::ostream& out, uint32_t framesInFlight) const;
+
+	/**
+	 * @brief Starts a new measurement interval, pending frames are kept.
+	 */
+	void reset();
+private:
+	TimingStat m_frameWait; ///< CPU time blocked waiting for the slot's timeline value.
+	TimingStat m_acquireToPresent; ///< Acquire to vkQueuePresentKHR.
+	TimingStat m_acquireToRetire; ///< Acquire to the timeline being seen past the frame's value.
+	TimingStat m_sceneSampleToSubmit; ///< Scene sampled for recording to vkQueueSubmit.
+	TimingStat m_cameraSampleToSubmit; ///< Camera sampled for the uniform buffer to vkQueueSubmit.
+	TimingStat m_submitToRetire; ///< vkQueueSubmit to the timeline being seen past the frame's value.
+	TimingStat m_update; ///< Scene update, culling and draw list building on the CPU.
+	uint32_t m_rebuiltFrames = 0; ///< Frames that built the draw list again.
+	uint32_t m_recordedFrames = 0; ///< Frames whose command buffer was recorded.
+	uint32_t m_replayedFrames = 0; ///< Frames that resubmitted a cached command buffer.
+	std::array<Clock::time_point, MAX_FRAMES_IN_FLIGHT> m_acquireTimes{}; ///< Acquire time of the frame in each slot.
+	std::array<Clock::time_point, MAX_FRAMES_IN_FLIGHT> m_submitTimes{}; ///< Submit time of the frame in each slot.
+	std::array<bool, MAX_FRAMES_IN_FLIGHT> m_pending{}; ///< Frames whose completion hasn't been recorded.
+};
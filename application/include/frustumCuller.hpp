@@ -0,0 +1,100 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "jobSystem.hpp"
+
+/**
+ * @struct Frustum
+ * @brief The six planes bounding what a camera sees, normals pointing inwards.
+ */
+struct Frustum {
+	std::array<glm::vec4, 6> planes{}; ///< Left, right, bottom, top, near, far: xyz is the unit normal, w the offset.
+
+	/**
+	 * @brief Extracts the planes from a projection * view matrix.
+	 *
+	 * Uses the -1 to 1 depth range glm projects to, which keeps slightly more than the 0 to 1 range Vulkan clips
+	 * to near the camera, so the test stays conservative.
+	 */
+	static Frustum fromViewProjection(const glm::mat4& viewProjection);
+};
+
+/**
+ * @struct CullInput
+ * @brief Bounds of the objects to cull as separate arrays, the layout Scene keeps them in.
+ */
+struct CullInput {
+	size_t count = 0; ///< Number of objects.
+	const float* centerX = nullptr; ///< World bounding sphere centers, also the box centers.
+	const float* centerY = nullptr;
+	const float* centerZ = nullptr;
+	const float* radius = nullptr; ///< World bounding sphere radii.
+	const float* extentX = nullptr; ///< Half sizes of the world bounding boxes, null to test the spheres only.
+	const float* extentY = nullptr;
+	const float* extentZ = nullptr;
+	const uint8_t* enabled = nullptr; ///< Objects with 0 are skipped, null tests every object.
+};
+
+/**
+ * @struct CullStats
+ * @brief What the last cull() did.
+ */
+struct CullStats {
+	size_t tested = 0; ///< Objects tested.
+	size_t visible = 0; ///< Objects in the visible list.
+	size_t chunks = 0; ///< Chunks the objects were split into, each a job.
+	double cullMs = 0.0; ///< Time spent culling, including the compaction of the list.
+};
+
+/**
+ * @class FrustumCuller
+ * @brief Tests bounding spheres and boxes against a frustum eight at a time and outputs the visible ones.
+ *
+ * The objects are split into chunks culled in parallel on the job system. Within a chunk, eight spheres are
+ * loaded from the arrays with AVX2 and tested against the six planes. Groups with a survivor are then tested
+ * with their boxes, which are tighter for long or flat objects but cost more per plane. The indices of the
+ * survivors are written to the chunk's part of a scratch array and the parts are concatenated, so the visible
+ * list is in increasing order whatever the number of threads. AVX2 is picked at runtime, CPUs without it
+ * (and builds for other architectures) use the scalar version of the same tests.
+ */
+class FrustumCuller {
+public:
+	static constexpr size_t CHUNK_SIZE = 16384; ///< Objects per job, a few microseconds of work.
+
+	/**
+	 * @param jobSystem Runs the chunks, must outlive the culler.
+	 */
+	explicit FrustumCuller(JobSystem& jobSystem);
+
+	/**
+	 * @brief Writes the indices of the enabled objects intersecting the frustum, in increasing order.
+	 * @param frustum Planes to test against.
+	 * @param input Bounds of the objects, the arrays must hold input.count values.
+	 * @param visible Receives the indices, previous contents are dropped.
+	 */
+	void cull(const Frustum& frustum, const CullInput& input, std::vector<uint32_t>& visible);
+
+	/**
+	 * @brief Switches between the AVX2 and the scalar tests, AVX2 can't be enabled where it isn't supported.
+	 */
+	void setUseAvx2(bool useAvx2);
+
+	bool usesAvx2() const { return m_useAvx2; }
+	const CullStats& getStats() const { return m_stats; }
+
+	/**
+	 * @brief Whether this build has the AVX2 tests and the CPU and OS support them.
+	 */
+	static bool isAvx2Supported();
+private:
+	JobSystem& m_jobSystem; ///< Runs the chunks.
+	bool m_useAvx2; ///< Whether the chunks use the AVX2 tests.
+	std::vector<uint32_t> m_scratch; ///< Survivors of each chunk, starting at the chunk's first index.
+	std::vector<uint32_t> m_chunkCounts; ///< Number of survivors of each chunk.
+	CullStats m_stats; ///< Stats of the last cull().
+};
@@ -0,0 +1,272 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "config.hpp"
+#include "bufferUtils.hpp"
+#include "deletionQueue.hpp"
+#include "descriptorAllocator.hpp"
+#include "pipelineLibrary.hpp"
+#include "frustumCuller.hpp"
+#include "uniformBuffers.hpp"
+
+/**
+ * @struct GPUDrawBatch
+ * @brief An instanced draw of the draw list as the culling shaders read it (std430).
+ *
+ * Must be kept in sync with the Batch struct in cullInstances.comp and compactDraws.comp.
+ */
+struct GPUDrawBatch {
+	glm::vec4 boundsCenter{ 0.0f }; ///< xyz: center of the mesh's bounding box in object space.
+	glm::vec4 boundsExtent{ 0.0f }; ///< xyz: half size of the mesh's bounding box in object space.
+	uint32_t indexCount = 0; ///< Number of indices of the sub mesh.
+	uint32_t firstIndex = 0; ///< First index of the sub mesh.
+	int32_t vertexOffset = 0; ///< Vertex offset of the sub mesh.
+	uint32_t firstInstance = 0; ///< Where the batch's candidates start in the instance buffer, and its survivors in the visible instance buffer.
+};
+static_assert(sizeof(GPUDrawBatch) == 48, "GPUDrawBatch must match the std430 layout used in the culling shaders");
+
+/**
+ * @struct GPUDrawGroup
+ * @brief Consecutive batches drawn with the same pipeline and mesh, one vkCmdDrawIndexedIndirectCount (std430).
+ *
+ * Must be kept in sync with the Group struct in compactDraws.comp.
+ */
+struct GPUDrawGroup {
+	uint32_t firstBatch = 0; ///< First batch of the group, its draw commands start at the same position.
+	uint32_t batchCount = 0; ///< Number of batches, the most draws the group can emit.
+};
+
+/**
+ * @struct GPUCullParams
+ * @brief Per-frame inputs of the culling shaders, also the arguments of their indirect dispatches (std430).
+ *
+ * Must be kept in sync with the Params block of the culling shaders.
+ */
+struct GPUCullParams {
+	VkDispatchIndirectCommand cullDispatch{}; ///< One invocation per candidate instance.
+	VkDispatchIndirectCommand compactDispatch{}; ///< One invocation per group.
+	uint32_t instanceCount = 0; ///< Number of candidate instances.
+	uint32_t groupCount = 0; ///< Number of groups.
+	uint32_t frameNumber = 0; ///< Increases every frame, what the visibility buffer stores for visible objects.
+	uint32_t occlusion = 0; ///< Whether the late phase runs, otherwise the early phase draws everything in the frustum.
+	uint32_t batchCapacity = 0; ///< Batches the buffers hold, where the late draw commands and the early batch counts start.
+	uint32_t groupCapacity = 0; ///< Groups the buffers hold, where the late draw counts start.
+	uint32_t viewportWidth = 0; ///< Size of the depth buffer the pyramid was reduced from.
+	uint32_t viewportHeight = 0;
+	uint32_t orderedInstanceStart = 0; ///< First candidate of the transparent batches, kept in place instead of appended so they draw back to front.
+	uint32_t padding = 0; ///< Aligns the planes to 16 bytes.
+	std::array<glm::vec4, 6> planes{}; ///< Frustum planes, see Frustum.
+};
+static_assert(offsetof(GPUCullParams, planes) == 64 && sizeof(GPUCullParams) == 160, "GPUCullParams must match the std430 layout used in the culling shaders");
+
+/**
+ * @struct GpuCullStats
+ * @brief What the culling shaders kept in an earlier frame, read back once that frame retired.
+ */
+struct GpuCullStats {
+	uint32_t visibleInstances = 0; ///< Instances drawn by both phases.
+	uint32_t draws = 0; ///< Indirect draws emitted for them.
+	uint32_t occludedInstances = 0; ///< Instances in the frustum the late phase found behind the depth pyramid.
+	uint32_t lateInstances = 0; ///< Instances the early phase missed, visible now but not in the previous frame.
+};
+
+/**
+ * @class GpuCuller
+ * @brief Culls the draw list's instances on the GPU and writes the indirect draws that render the survivors.
+ *
+ * The draw list is still sorted and batched on the CPU, but every batch becomes a range of candidates instead of
+ * a draw. Each frame, cullInstances.comp tests every candidate's box against the frustum and appends the
+ * survivors to their batch's range of a visible instance buffer, which the vertex shader reads in place of the
+ * instance buffer. compactDraws.comp then writes one VkDrawIndexedIndirectCommand per batch with survivors and
+ * the number of draws of each group, consumed by vkCmdDrawIndexedIndirectCount.
+ *
+ * The counts, planes and dispatch sizes live in buffers written every frame, so the recorded commands only depend
+ * on the groups: a command buffer stays valid while objects move, enter or leave the view, and records one
+ * indirect draw per pipeline and mesh whatever the size of the scene. Buffers are per frame in flight and grow
+ * like InstanceBuffers, update() reports when descriptors referencing them changed.
+ *
+ * With occlusion culling, culling and compaction run twice. The early phase only keeps the instances in the frustum whose
+ * object was visible in the previous frame, they are drawn and the DepthPyramid is reduced from their depth. The
+ * late phase tests every instance in the frustum against the pyramid, marks the objects that pass as visible for
+ * the next frame and draws the ones the early phase skipped. Each phase writes its own draw commands and counts,
+ * the late survivors follow the early ones in their batch's range. Objects that were hidden and come into view are
+ * drawn the same frame, so nothing pops in, and the visibility buffer is shared by every frame in flight so the
+ * early phase always sees the frame submitted just before.
+ */
+class GpuCuller {
+public:
+	static constexpr uint32_t WORKGROUP_SIZE = 64; ///< local_size_x of the culling shaders.
+
+	/**
+	 * @brief Creates the descriptor sets, pipeline layout, compute pipelines and initial buffers.
+	 * @param device Vulkan logical device.
+	 * @param physicalDevice Vulkan physical device.
+	 * @param pipelineLibrary Creates and owns the compute pipelines.
+	 * @param uniformBuffers Camera uniform buffer of each frame in flight, the late phase projects the boxes with the latched camera.
+	 * @param occlusion Whether the late phase runs, setDepthPyramid() must then be called before the first update().
+	 */
+	GpuCuller(VkDevice device, VkPhysicalDevice physicalDevice, PipelineLibrary& pipelineLibrary, const std::vector<VkBuffer>& uniformBuffers, bool occlusion);
+
+	/**
+	 * @brief Queues every buffer, the descriptor pools and the layouts for destruction, the pipelines go with the library.
+	 */
+	void destroyGpuCuller(DeletionQueue& deletionQueue);
+
+	/**
+	 * @brief Writes the inputs of a frame, growing its buffers first if needed.
+	 * @param frame Index of the frame in flight, its last submission must have retired.
+	 * @param instanceBuffer The frame's instance buffer holding the candidates, with their batch indices.
+	 * @param instanceCount Number of candidates.
+	 * @param orderedInstanceStart First candidate of the batches the CPU records directly (the transparent ones), these
+	 * keep their position so the draws stay in sorted order, culled ones are collapsed to a point.
+	 * @param batches One entry per batch of the draw list.
+	 * @param groups Batches grouped by pipeline and mesh, in recording order.
+	 * @param drawListVersion Changes whenever the batches or groups do, they are only copied to slots holding an older version.
+	 * @param objectCount One more than the largest GPUInstance::objectIndex, sizes the visibility buffer.
+	 * @param viewport Size of the depth buffer the pyramid is reduced from.
+	 * @param deletionQueue Receives replaced buffers.
+	 * @return Whether a buffer referenced by the recorded commands or a descriptor set was replaced, the frame's
+	 * command buffers must be recorded again and its graphics set pointed at getVisibleInstanceBuffer().
+	 */
+	bool update(uint32_t frame, VkBuffer instanceBuffer, uint32_t instanceCount, uint32_t orderedInstanceStart, const std::vector<GPUDrawBatch>& batches,
+		const std::vector<GPUDrawGroup>& groups, uint64_t drawListVersion, uint32_t objectCount, VkExtent2D viewport, DeletionQueue& deletionQueue);
+
+	/**
+	 * @brief Writes the planes the candidates are tested against, after update() and before the frame's submit.
+	 *
+	 * Called with the late-latched camera, so the frustum matches the camera the frame is drawn with.
+	 * @param frame Index of the frame in flight, its last submission must have retired.
+	 * @param frustum Planes of the camera written to the frame's uniform buffer.
+	 */
+	void setFrustum(uint32_t frame, const Frustum& frustum);
+
+	/**
+	 * @brief Points the late phase at a new depth pyramid, each frame's set is rewritten by its next update().
+	 */
+	void setDepthPyramid(VkImageView view, VkSampler sampler);
+
+	/**
+	 * @brief Records the early phase and the barriers making its output visible to indirect draws and vertex shaders.
+	 *
+	 * Without occlusion culling this is the only phase. Must be recorded outside rendering, before the draws that use the output.
+	 * @param commandBuffer Command buffer in the recording state.
+	 * @param frame Index of the frame in flight.
+	 */
+	void recordEarly(VkCommandBuffer commandBuffer, uint32_t frame) const;
+
+	/**
+	 * @brief Records the late phase, after the depth pyramid was reduced from the early draws.
+	 * @param commandBuffer Command buffer in the recording state, outside rendering.
+	 * @param frame Index of the frame in flight.
+	 */
+	void recordLate(VkCommandBuffer commandBuffer, uint32_t frame) const;
+
+	bool usesOcclusion() const { return m_occlusion; }
+	VkBuffer getVisibleInstanceBuffer(uint32_t frame) const { return m_frames.at(frame).visibleInstances.buffer; }
+	VkBuffer getDrawCommandBuffer(uint32_t frame) const { return m_frames.at(frame).drawCommands.buffer; }
+	VkBuffer getDrawCountBuffer(uint32_t frame) const { return m_frames.at(frame).drawCounts.buffer; }
+
+	/**
+	 * @brief Byte offset of a phase's draw commands in getDrawCommandBuffer(), 0 early and 1 late.
+	 */
+	VkDeviceSize getDrawCommandOffset(uint32_t frame, uint32_t phase) const { return phase * m_frames.at(frame).batchCapacity * sizeof(VkDrawIndexedIndirectCommand); }
+
+	/**
+	 * @brief Byte offset of a phase's draw counts in getDrawCountBuffer(), 0 early and 1 late.
+	 */
+	VkDeviceSize getDrawCountOffset(uint32_t frame, uint32_t phase) const { return phase * m_frames.at(frame).groupCapacity * sizeof(uint32_t); }
+
+	/**
+	 * @brief Stats read back by the last update(), from the previous submission of that frame slot.
+	 */
+	const GpuCullStats& getStats() const { return m_stats; }
+private:
+	/**
+	 * @struct Buffer
+	 * @brief A buffer, its memory and, if host visible, its mapping.
+	 */
+	struct Buffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr; ///< Null for device local buffers.
+		VkDeviceSize size = 0; ///< Size in bytes.
+	};
+
+	/**
+	 * @struct FrameResources
+	 * @brief Buffers and descriptor set of one frame in flight.
+	 */
+	struct FrameResources {
+		Buffer params; ///< GPUCullParams, host visible, also read by the indirect dispatches.
+		Buffer batches; ///< GPUDrawBatch per batch, host visible.
+		Buffer groups; ///< GPUDrawGroup per group, host visible.
+		Buffer visibleInstances; ///< Survivors in their batch's range, device local.
+		Buffer counters; ///< GpuCullStats, the survivors of each batch, then its early survivors, device local.
+		Buffer drawCommands; ///< VkDrawIndexedIndirectCommand per batch and phase, compacted per group, device local.
+		Buffer drawCounts; ///< Draws of each group and phase, device local.
+		Buffer earlyDrawn; ///< Whether the early phase drew each candidate, device local.
+		Buffer readback; ///< Copy of the stats counters, host visible.
+		uint32_t batchCapacity = 0; ///< Batches drawCommands holds per phase.
+		uint32_t groupCapacity = 0; ///< Groups drawCounts holds per phase.
+		uint64_t drawListVersion = UINT64_MAX; ///< Draw list version the batches and groups buffers hold.
+		VkBuffer instanceBuffer = VK_NULL_HANDLE; ///< Candidate buffer the descriptor set references.
+		VkBuffer visibility = VK_NULL_HANDLE; ///< Visibility buffer the descriptor set references.
+		VkImageView depthPyramid = VK_NULL_HANDLE; ///< Depth pyramid view the descriptor set references.
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE; ///< Binds the buffers above to both shaders.
+	};
+
+	VkDevice m_device; ///< Vulkan logical device handle.
+	VkPhysicalDevice m_physicalDevice; ///< Vulkan physical device handle.
+	VkDescriptorSetLayout m_descriptorSetLayout; ///< Layout shared by both shaders.
+	VkPipelineLayout m_pipelineLayout; ///< Layout shared by both shaders.
+	std::shared_ptr<DescriptorAllocator> m_setAllocator; ///< Allocates one set per frame in flight, never reset.
+	std::shared_ptr<Pipeline> m_cullPipeline; ///< cullInstances.comp, owned by the pipeline library.
+	std::shared_ptr<Pipeline> m_compactPipeline; ///< compactDraws.comp, owned by the pipeline library.
+	std::shared_ptr<Pipeline> m_occlusionPipeline; ///< cullOccluded.comp, only created with occlusion culling.
+	std::vector<FrameResources> m_frames; ///< Resources of each frame in flight.
+	std::vector<VkBuffer> m_uniformBuffers; ///< Camera uniform buffer of each frame in flight.
+	Buffer m_visibility; ///< Frame number each object was last visible in, shared by every frame in flight, device local.
+	VkImageView m_depthPyramidView = VK_NULL_HANDLE; ///< Sampled by the late phase.
+	VkSampler m_depthPyramidSampler = VK_NULL_HANDLE; ///< Nearest sampler of the pyramid.
+	bool m_occlusion; ///< Whether the late phase runs.
+	uint32_t m_frameNumber = 0; ///< Incremented by every update().
+	GpuCullStats m_stats; ///< Read back by the last update().
+
+	void createDescriptorSetLayout();
+	void createPipelineLayout();
+
+	/**
+	 * @brief Makes a buffer hold at least size bytes, replacing it by one twice as large as needed if it's smaller.
+	 * @return Whether the buffer was replaced.
+	 */
+	bool reserve(Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible, DeletionQueue* deletionQueue);
+
+	/**
+	 * @brief Queues a buffer and its memory for destruction.
+	 */
+	static void retire(Buffer& buffer, DeletionQueue& deletionQueue);
+
+	/**
+	 * @brief Points the frame's descriptor set at its current buffers and the depth pyramid.
+	 */
+	void writeDescriptorSet(FrameResources& frame, uint32_t frameIndex);
+
+	/**
+	 * @brief Records one phase: the cull and compact dispatches, and the barriers making their output visible to the draws.
+	 * @param cullPipeline cullInstances.comp for the early phase, cullOccluded.comp for the late one.
+	 * @param phase 0 early, 1 late, selects where compactDraws.comp writes.
+	 */
+	void recordPhase(VkCommandBuffer commandBuffer, const FrameResources& resources, const Pipeline& cullPipeline, uint32_t phase) const;
+
+	/**
+	 * @brief Copies the stats counters to the readback buffer after the last phase.
+	 */
+	void recordStatsCopy(VkCommandBuffer commandBuffer, const FrameResources& resources) const;
+};
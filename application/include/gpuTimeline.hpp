@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @class GpuTimeline
+ * @brief One monotonically increasing timeline semaphore shared by every queue submission.
+ *
+ * Each submit() signals the next value of the timeline, so "the GPU finished this work" is a single
+ * 64-bit number. The CPU waits for a value instead of a fence per frame slot, nothing is reset between
+ * frames, and resources released at some point can be destroyed once the completed value passes the value
+ * that was last submitted at that point. Submissions on other queues can wait on the same semaphore.
+ */
+class GpuTimeline {
+public:
+	/**
+	 * @brief Creates the timeline semaphore with an initial value of 0.
+	 * @param device Vulkan logical device with the timelineSemaphore feature enabled.
+	 * @throws std::runtime_error if the semaphore can't be created.
+	 */
+	GpuTimeline(VkDevice device);
+
+	/**
+	 * @brief Submits a command buffer that signals the next timeline value when it completes.
+	 * @param queue Queue to submit to.
+	 * @param commandBuffer Command buffer to execute.
+	 * @param waits Semaphores the submission waits on, binary or timeline.
+	 * @param signals Additional semaphores to signal, e.g. the binary semaphore a present waits on.
+	 * @return The timeline value signaled by this submission.
+	 * @throws std::runtime_error if the submission fails.
+	 */
+	uint64_t submit(VkQueue queue, VkCommandBuffer commandBuffer, const std::vector<VkSemaphoreSubmitInfo>& waits = {}, const std::vector<VkSemaphoreSubmitInfo>& signals = {});
+
+	/**
+	 * @brief Blocks until the GPU reached a timeline value, returns at once if it already did.
+	 * @param value Value returned by submit(), 0 never blocks.
+	 */
+	void wait(uint64_t value);
+
+	/**
+	 * @brief Whether the GPU reached a timeline value, without blocking.
+	 */
+	bool isComplete(uint64_t value);
+
+	/**
+	 * @brief Queries the value the GPU has reached.
+	 */
+	uint64_t getCompletedValue();
+
+	/**
+	 * @brief Destroys the semaphore, the GPU must be idle.
+	 */
+	void destroyGpuTimeline();
+
+	/// Value signaled by the most recent submit(), waiting for it drains everything submitted so far.
+	uint64_t getLastSubmittedValue() const { return m_lastSubmitted; }
+	VkSemaphore getSemaphore() const { return m_semaphore; }
+
+	/**
+	 * @brief Describes a binary or timeline semaphore for the waits and signals of submit().
+	 * @param semaphore Semaphore to wait on or signal.
+	 * @param stages Stages that wait for it, or that must complete before it is signaled.
+	 * @param value Timeline value, ignored for binary semaphores.
+	 */
+	static VkSemaphoreSubmitInfo semaphoreInfo(VkSemaphore semaphore, VkPipelineStageFlags2 stages, uint64_t value = 0);
+private:
+	VkDevice m_device; ///< Vulkan logical device.
+	VkSemaphore m_semaphore = VK_NULL_HANDLE; ///< Timeline semaphore.
+	uint64_t m_lastSubmitted = 0; ///< Value signaled by the last submission.
+	uint64_t m_completed = 0; ///< Last value seen reached, saves querying the semaphore for older values.
+};
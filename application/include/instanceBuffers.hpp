@@ -0,0 +1,79 @@
+#pragma once
+#define GLM_FORCE_RADIANS
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "config.hpp"
+#include "bufferUtils.hpp"
+#include "deletionQueue.hpp"
+
+/**
+ * @struct GPUInstance
+ * @brief Per-instance data of a draw as it is laid out in the instance storage buffer (std430).
+ *
+ * Must be kept in sync with the Instance struct in shader.vert and cullInstances.comp.
+ */
+struct GPUInstance {
+	glm::mat4 model{ 1.0f }; ///< Object to world transform.
+	uint32_t materialIndex = 0; ///< Index into the material table, passed on to the fragment shader.
+	uint32_t batchIndex = 0; ///< Draw list batch the instance belongs to, where GPU culling finds its bounds and output range.
+	uint32_t objectIndex = 0; ///< Scene entity the instance draws, indexes the visibility GPU occlusion culling keeps across frames.
+	uint32_t padding = 0; ///< Keeps the stride a multiple of 16 bytes.
+};
+static_assert(sizeof(GPUInstance) == 80, "GPUInstance must match the std430 layout used in shader.vert");
+
+/**
+ * @class InstanceBuffers
+ * @brief Storage buffers holding the per-instance data of the draw list, one per frame in flight.
+ *
+ * The buffers stay mapped and are host coherent, the draw list's instances are copied in every frame once the
+ * slot retired. An instanced draw reads its instances starting at firstInstance, so the recorded commands don't
+ * depend on the transforms and stay valid while objects move. A buffer too small for the frame is replaced by
+ * one twice its size, the old one is queued for deletion.
+ */
+class InstanceBuffers {
+public:
+	/**
+	 * @brief Creates and maps a buffer of INITIAL_INSTANCE_CAPACITY instances per frame in flight.
+	 * @param device Vulkan logical device.
+	 * @param physicalDevice Vulkan physical device.
+	 */
+	InstanceBuffers(VkDevice device, VkPhysicalDevice physicalDevice);
+
+	/**
+	 * @brief Queues all instance buffers and their memory for destruction once the GPU no longer uses them.
+	 */
+	void destroyInstanceBuffers(DeletionQueue& deletionQueue);
+
+	/**
+	 * @brief Copies the instances of a frame into its buffer, growing it first if needed.
+	 * @param frame Index of the frame in flight, its last submission must have retired.
+	 * @param instances Instances in the order the draws index them.
+	 * @param deletionQueue Receives the replaced buffer.
+	 * @return Whether the buffer was replaced, descriptor sets referencing it must be updated.
+	 */
+	bool updateInstanceBuffer(uint32_t frame, const std::vector<GPUInstance>& instances, DeletionQueue& deletionQueue);
+
+	/**
+	 * @brief Retrieves the instance buffer of a frame in flight.
+	 * @throws std::out_of_range if the index is invalid.
+	 */
+	VkBuffer getInstanceBuffer(uint32_t frame) const;
+
+	std::vector<VkBuffer> getInstanceBuffers() const {
+		return m_instanceBuffers;
+	}
+private:
+	std::vector<VkBuffer> m_instanceBuffers; ///< Storage buffer of each frame in flight.
+	std::vector<VkDeviceMemory> m_instanceBuffersMemory; ///< Memory of each buffer.
+	std::vector<void*> m_instanceBuffersMapped; ///< Mapped pointer of each buffer.
+	std::vector<uint32_t> m_capacities; ///< Number of instances each buffer holds.
+	VkDevice m_device; ///< Vulkan logical device handle.
+	VkPhysicalDevice m_physicalDevice; ///< Vulkan physical device handle.
+
+	/**
+	 * @brief Allocates and maps the buffer of a frame in flight.
+	 */
+	void createInstanceBuffer(uint32_t frame, uint32_t capacity);
+};
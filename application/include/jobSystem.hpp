@@ -0,0 +1,242 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <exception>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @brief Which queue a job goes to.
+ */
+enum class JobPriority : uint8_t {
+	Normal, ///< Short jobs somebody waits for: recording, culling, decoding. Waiting threads help run them.
+	Background, ///< Long jobs nobody waits for soon, e.g. pipeline compiles. Only run by idle workers.
+};
+
+/**
+ * @class JobCounter
+ * @brief Counts the unfinished jobs of a group, so they can be waited for or have jobs depend on them.
+ *
+ * The first exception thrown by a job of the group is kept and rethrown by JobSystem::wait().
+ * A counter must outlive its jobs, and can be reused once it reached zero. The last job reaches zero with
+ * m_mutex held and doesn't touch the counter after releasing it, so once isDone() or JobSystem::wait()
+ * returned, the counter may be destroyed.
+ */
+class JobCounter {
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	/// Whether every job added to the counter finished and released it.
+	bool isDone() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pending.load(std::memory_order_acquire) == 0;
+	}
+private:
+	friend class JobSystem;
+
+	/**
+	 * @struct Continuation
+	 * @brief Job queued by JobSystem::runAfter() once the counter reaches zero.
+	 */
+	struct Continuation {
+		std::function<void()> function; ///< The job.
+		JobCounter* counter; ///< Counter of the job, may be null.
+	};
+
+	std::atomic<uint32_t> m_pending{ 0 }; ///< Jobs added and not finished yet, only decremented with m_mutex held.
+	mutable std::mutex m_mutex; ///< Guards m_continuations and m_error, the last decrement of m_pending and the wake up of waiting threads.
+	std::condition_variable m_done; ///< Notified when m_pending reaches zero.
+	std::vector<Continuation> m_continuations; ///< Jobs that depend on this counter.
+	std::exception_ptr m_error; ///< First exception thrown by a job.
+};
+
+/**
+ * @class JobSystem
+ * @brief Worker threads with a job deque each that steal from each other when they run out of work.
+ *
+ * A job queued from a worker goes to the back of that worker's deque and the worker pops from the back, so
+ * the jobs a job spawns run next on the same core while their data is still in its cache. Idle workers
+ * steal from the front of other deques, which takes the oldest, usually largest, pieces of work. Jobs
+ * queued from other threads go to a shared queue. Every deque has its own lock, held only to push or pop,
+ * so workers rarely contend.
+ *
+ * Jobs are grouped with a JobCounter. wait() runs other normal priority jobs instead of blocking, so the
+ * waiting thread works on the jobs it waits for, and runAfter() queues a job once a counter reaches zero.
+ * parallelFor() splits an index range into chunks and runs the first chunk on the calling thread.
+ */
+class JobSystem {
+public:
+	static constexpr size_t DEFAULT_WORKER_COUNT = SIZE_MAX; ///< One worker per core, minus the core of the main thread.
+
+	/**
+	 * @brief Starts the worker threads.
+	 * @param workerCount Number of workers, 0 runs every job on the threads that wait for them.
+	 */
+	explicit JobSystem(size_t workerCount = DEFAULT_WORKER_COUNT);
+
+	/**
+	 * @brief Finishes the queued jobs and joins the workers.
+	 */
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	/**
+	 * @brief Queues a job.
+	 * @param job Callable taking no arguments. Exceptions are stored in the counter, or printed if there is none.
+	 * @param counter Counter the job is added to, may be null.
+	 * @param priority Queue of the job.
+	 */
+	void run(std::function<void()> job, JobCounter* counter = nullptr, JobPriority priority = JobPriority::Normal);
+
+	/**
+	 * @brief Queues a job once every job of another counter finished.
+	 * @param dependency Counter to wait for, the job runs at once if it's already done.
+	 * @param job Callable taking no arguments.
+	 * @param counter Counter the job is added to right away, so waiting for it also waits for the dependency.
+	 */
+	void runAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter = nullptr);
+
+	/**
+	 * @brief Queues a job and returns its result.
+	 * @param task Callable taking no arguments.
+	 * @param counter Counter the job is added to, may be null.
+	 * @param priority Queue of the job.
+	 * @return Future holding the result (or the exception) of the task.
+	 */
+	template<typename F>
+	auto submit(F&& task, JobCounter* counter = nullptr, JobPriority priority = JobPriority::Normal) -> std::future<decltype(task())> {
+		using Result = decltype(task());
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> future = packaged->get_future();
+		run([packaged]() { (*packaged)(); }, counter, priority);
+		return future;
+	}
+
+	/**
+	 * @brief Calls body(first, last) for consecutive chunks of [0, count) in parallel and waits for them.
+	 * @param count Number of indices.
+	 * @param grain Indices per chunk, sized so a chunk takes at least a few microseconds.
+	 * @param body Callable taking the first and one past the last index of a chunk, called concurrently.
+	 * @throws Rethrows the first exception thrown by body, after every chunk finished.
+	 */
+	template<typename F>
+	void parallelFor(size_t count, size_t grain, F&& body) {
+		grain = std::max<size_t>(grain, 1);
+		size_t chunkCount = (count + grain - 1) / grain;
+		if (chunkCount <= 1) {
+			if (count > 0) {
+				body(size_t(0), count); // not worth a job
+			}
+			return;
+		}
+		JobCounter counter;
+		for (size_t chunk = chunkCount - 1; chunk > 0; chunk--) { // the owner pops the last pushed chunk, thieves the first
+			size_t first = chunk * grain;
+			size_t last = std::min(first + grain, count);
+			run([&body, first, last]() { body(first, last); }, &counter);
+		}
+		std::exception_ptr error;
+		try {
+			body(size_t(0), grain);
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		try {
+			wait(counter); // the chunks reference body, they must finish before it goes out of scope
+		}
+		catch (...) {
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	/**
+	 * @brief Runs normal priority jobs until every job of a counter finished.
+	 * @throws Rethrows the first exception thrown by a job of the counter, and clears it.
+	 */
+	void wait(JobCounter& counter);
+
+	/**
+	 * @brief Blocks until no job is queued or running, including background jobs.
+	 */
+	void waitIdle();
+
+	size_t getThreadCount() const { return m_threads.size(); }
+private:
+	/**
+	 * @struct Job
+	 * @brief A queued job and the counter it decrements when it finishes.
+	 */
+	struct Job {
+		std::function<void()> function; ///< The job.
+		JobCounter* counter = nullptr; ///< Counter of the job, may be null.
+	};
+
+	/**
+	 * @struct WorkerQueue
+	 * @brief Job deque of one worker, the owner uses the back and thieves the front.
+	 */
+	struct WorkerQueue {
+		std::mutex mutex; ///< Guards jobs.
+		std::deque<Job> jobs; ///< Queued jobs.
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> m_queues; ///< One per worker, indexed by worker.
+	std::mutex m_sharedMutex; ///< Guards m_sharedJobs and m_backgroundJobs.
+	std::deque<Job> m_sharedJobs; ///< Normal jobs queued from threads that aren't workers.
+	std::deque<Job> m_backgroundJobs; ///< Background jobs, in submission order.
+
+	std::mutex m_sleepMutex; ///< Guards m_stopping, makes sleeping and waking up atomic.
+	std::condition_variable m_wake; ///< Wakes workers when jobs are queued or the system stops.
+	std::condition_variable m_idle; ///< Wakes waitIdle() when the last job finished.
+	std::atomic<size_t> m_queuedJobs{ 0 }; ///< Jobs in any queue.
+	std::atomic<size_t> m_activeJobs{ 0 }; ///< Jobs running.
+	bool m_stopping = false; ///< Set by the destructor to let the workers exit.
+
+	std::vector<std::thread> m_threads; ///< Worker threads, declared last so the queues exist while they run.
+
+	/**
+	 * @brief Queues a job whose counter was already incremented.
+	 */
+	void push(Job job, JobPriority priority);
+
+	/**
+	 * @brief Takes a job: the back of the own deque, then the shared queue, then the front of another deque.
+	 * @param self Index of the calling worker, SIZE_MAX for other threads.
+	 * @param includeBackground Whether background jobs may be taken, once no normal job is left.
+	 * @return Whether a job was taken.
+	 */
+	bool pop(Job& job, size_t self, bool includeBackground);
+
+	/**
+	 * @brief Runs a job and completes its counter, queueing the jobs that depended on it.
+	 */
+	void execute(Job& job);
+
+	/**
+	 * @brief Index of the calling thread if it's a worker of this system, SIZE_MAX otherwise.
+	 */
+	size_t currentWorker() const;
+
+	/**
+	 * @brief Runs jobs until the system is stopped and no job is left.
+	 */
+	void workerLoop(size_t index);
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <iostream>
+#include <cstdlib>
+
+/**
+ * @namespace Log
+ * @brief Informational output: device capabilities, pipeline and swap chain timings, the per second stats.
+ *
+ * Everything written to info() is dropped unless VERBOSE_VARIABLE is set to a non-zero value, so a default run prints
+ * nothing but errors. Errors and validation messages still go to std::cerr unconditionally.
+ */
+namespace Log {
+	/// Environment variable turning the informational output on.
+	inline const char* const VERBOSE_VARIABLE = "VULKAN_APP_VERBOSE";
+
+	/**
+	 * @brief Whether informational output is printed, read from the environment once.
+	 */
+	inline bool isVerbose() {
+		static const bool verbose = []() {
+			const char* value = std::getenv(VERBOSE_VARIABLE);
+			return value != nullptr && std::atoi(value) != 0;
+		}();
+		return verbose;
+	}
+
+	/**
+	 * @brief The stream informational output is written to.
+	 * @return std::cout when verbose, otherwise a stream without a buffer that discards every write.
+	 */
+	inline std::ostream& info() {
+		static std::ostream discard(nullptr);
+		return isVerbose() ? std::cout : discard;
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * The mapping starts on a page boundary, so its contents can be reinterpreted as uint32_t words
+ * (e.g. SPIR-V) without copying them into an aligned buffer first.
+ */
+class MappedFile {
+public:
+	/**
+	 * @brief Maps the file into memory.
+	 * @param path Path to the file.
+	 * @throws std::runtime_error if the file can't be opened or mapped.
+	 */
+	explicit MappedFile(const std::string& path);
+
+	/**
+	 * @brief Unmaps the file.
+	 */
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const void* getData() const { return m_data; }
+	size_t getSize() const { return m_size; }
+private:
+	const void* m_data = nullptr; ///< Start of the mapping.
+	size_t m_size = 0; ///< Size of the file in bytes.
+#ifdef _WIN32
+	void* m_file = nullptr; ///< File handle (HANDLE).
+	void* m_mapping = nullptr; ///< File mapping handle (HANDLE).
+#else
+	int m_file = -1; ///< File descriptor.
+#endif
+};
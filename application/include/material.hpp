@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Bit flags stored in GPUMaterial::flags telling the shader which texture slots are bound.
+ */
+enum MaterialFlags : uint32_t {
+	MATERIAL_ALBEDO_TEXTURE = 1u << 0, ///< textureIndices.x holds a base color texture.
+	MATERIAL_METAL_TEXTURE = 1u << 1, ///< textureIndices.y holds a metallic texture.
+	MATERIAL_NORMAL_TEXTURE = 1u << 2, ///< textureIndices.z holds a tangent space normal map.
+	MATERIAL_ROUGH_TEXTURE = 1u << 3, ///< textureIndices.w holds a roughness texture.
+	MATERIAL_ALPHA_TEST = 1u << 4, ///< Fragments with an albedo alpha below the cutoff are discarded.
+};
+
+/**
+ * @struct GPUMaterial
+ * @brief A single entry of the material table as it is laid out in the storage buffer (std430).
+ *
+ * Must be kept in sync with the Material struct in shader.frag.
+ */
+struct GPUMaterial {
+	glm::vec4 baseColorFactor{ 1.0f }; ///< Multiplied with the albedo texture (or used alone if there is none).
+	float metallicFactor = 0.0f; ///< Multiplied with the metallic texture.
+	float roughnessFactor = 1.0f; ///< Multiplied with the roughness texture.
+	uint32_t flags = 0; ///< Combination of MaterialFlags.
+	uint32_t padding = 0; ///< Keeps textureIndices 16 byte aligned.
+	glm::uvec4 textureIndices{ 0 }; ///< Indices into the texture array: albedo, metal, normal, rough.
+};
+static_assert(sizeof(GPUMaterial) == 48, "GPUMaterial must match the std430 layout used in shader.frag");
+
+/**
+ * @struct MaterialTexturePaths
+ * @brief File paths for the texture slots of a material, an empty path leaves the slot unbound.
+ */
+struct MaterialTexturePaths {
+	std::string albedo; ///< Base color texture (sRGB).
+	std::string metal; ///< Metallic texture (linear).
+	std::string normal; ///< Normal map (linear).
+	std::string rough; ///< Roughness texture (linear).
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "material.hpp"
+#include "texture.hpp"
+#include "config.hpp"
+#include "jobSystem.hpp"
+
+/**
+ * @struct TextureRequest
+ * @brief A texture file and the format it's loaded with.
+ */
+struct TextureRequest {
+	std::string path; ///< Path to the image file.
+	VkFormat format; ///< Format of the image (sRGB for colour data, UNORM for everything else).
+};
+
+/**
+ * @class MaterialTable
+ * @brief Owns every material and texture used by the loaded models.
+ *
+ * Materials are stored in a single storage buffer and textures in a single sampler array,
+ * so a draw only has to push the index of its material and no per-material descriptor work is needed.
+ */
+class MaterialTable {
+public:
+	/**
+	 * @brief Constructs the material table and creates the default texture at index 0.
+	 * @param device Vulkan logical device.
+	 * @param physicalDevice Vulkan physical device.
+	 * @param commandPool Command pool for upload commands.
+	 * @param queue Queue for upload commands.
+	 * @param jobSystem Decodes texture files in parallel, must outlive the table.
+	 */
+	MaterialTable(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, JobSystem& jobSystem);
+
+	/**
+	 * @brief Loads a texture once and returns its index in the texture array.
+	 * @param path Path to the image file.
+	 * @param format Format of the image (sRGB for colour data, UNORM for everything else).
+	 * @return Index of the texture in the texture array.
+	 * @throws std::runtime_error if the texture array is full.
+	 */
+	uint32_t addTexture(const std::string& path, VkFormat format);
+
+	/**
+	 * @brief Loads the textures that aren't loaded yet, decoding the files in parallel.
+	 *
+	 * Decoding dominates texture loading, the uploads stay on the calling thread since they share its
+	 * command pool and queue. addTexture() then finds the textures already loaded.
+	 * @param requests Textures to load, duplicates and empty paths are skipped.
+	 * @throws std::runtime_error if a file can't be decoded or the texture array is full.
+	 */
+	void preloadTextures(const std::vector<TextureRequest>& requests);
+
+	/**
+	 * @brief Appends a material to the table.
+	 * @param material The material to add.
+	 * @return Index of the material in the table.
+	 */
+	uint32_t addMaterial(const GPUMaterial& material);
+
+	/**
+	 * @brief Loads the textures for each non-empty path (in parallel) and binds them to the material.
+	 * @param materialIndex Index of the material to update.
+	 * @param paths Texture paths for the material slots.
+	 */
+	void setMaterialTextures(uint32_t materialIndex, const MaterialTexturePaths& paths);
+
+	GPUMaterial& getMaterial(uint32_t index);
+
+	/// Number of materials in the table, any of them can be used as a Scene material override.
+	uint32_t getMaterialCount() const { return static_cast<uint32_t>(m_materials.size()); }
+
+	/**
+	 * @brief Uploads the material table into a device local storage buffer.
+	 *
+	 * Must be called after all materials have been added and before the descriptor sets are written.
+	 * A buffer uploaded earlier is queued for destruction, frames in flight keep reading it.
+	 * @param deletionQueue Queue that destroys the previous buffer.
+	 */
+	void upload(DeletionQueue& deletionQueue);
+
+	/**
+	 * @brief Queues the storage buffer and all textures for destruction once the GPU no longer uses them.
+	 */
+	void destroyMaterialTable(DeletionQueue& deletionQueue);
+
+	VkBuffer getMaterialBuffer() const { return m_materialBuffer; }
+	VkDeviceSize getMaterialBufferSize() const { return sizeof(GPUMaterial) * m_materials.size(); }
+
+	/// Returns MAX_MATERIAL_TEXTURES image views, unused slots point at the default texture.
+	std::vector<VkImageView> getImageViews() const;
+
+	/// Returns MAX_MATERIAL_TEXTURES samplers, unused slots point at the default texture.
+	std::vector<VkSampler> getSamplers() const;
+private:
+	VkDevice m_device; ///< Vulkan logical device.
+	VkPhysicalDevice m_physicalDevice; ///< Vulkan physical device.
+	VkCommandPool m_commandPool; ///< Command pool for upload commands.
+	VkQueue m_queue; ///< Queue for upload commands.
+	JobSystem& m_jobSystem; ///< Decodes texture files.
+
+	std::vector<Texture> m_textures; ///< Texture array, index 0 is a 1x1 white texture.
+	std::unordered_map<std::string, uint32_t> m_textureLookup; ///< Path to texture index, avoids loading a file twice.
+	std::vector<GPUMaterial> m_materials; ///< CPU copy of the material table.
+
+	VkBuffer m_materialBuffer = VK_NULL_HANDLE; ///< Storage buffer holding the material table.
+	VkDeviceMemory m_materialBufferMemory = VK_NULL_HANDLE; ///< Memory backing the material buffer.
+};
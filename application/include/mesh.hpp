@@ -4,9 +4,24 @@
 #include <vector>
 #include <stdexcept>
 #include "bufferUtils.hpp"
+#include "deletionQueue.hpp"
+#include "jobSystem.hpp"
+#include "bounds.hpp"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+
+/**
+ * @struct SubMesh
+ * @brief A range of the mesh index buffer drawn with a single material.
+ */
+struct SubMesh {
+	uint32_t firstIndex; ///< First index of the range in the index buffer.
+	uint32_t indexCount; ///< Number of indices in the range.
+	int32_t vertexOffset; ///< Added to each index before fetching the vertex.
+	uint32_t materialIndex; ///< Material index of the source aiMesh (local to the scene).
+};
+
 /**
  * @class Mesh
  * @brief Handles loading, buffering, and rendering of 3D mesh data.
@@ -14,17 +29,35 @@
 class Mesh {
 public:
 	Mesh() = default;
+
+	/**
+	 * @brief Describes a mesh without vertices or buffers, enough to build a draw list on the CPU.
+	 *
+	 * Used by the draw list benchmark, such a mesh must never be bound or drawn.
+	 * @param subMeshes Index ranges of the mesh.
+	 * @param bounds Bounds of the mesh in its object space.
+	 */
+	Mesh(std::vector<SubMesh> subMeshes, const BoundingBox& bounds) :
+		m_device(VK_NULL_HANDLE), m_physicalDevice(VK_NULL_HANDLE), m_commandPool(VK_NULL_HANDLE), m_graphicsQueue(VK_NULL_HANDLE),
+		m_subMeshes(std::move(subMeshes)), m_bounds(bounds), m_vertexBuffer(VK_NULL_HANDLE), m_indexBuffer(VK_NULL_HANDLE),
+		m_vertexBufferMemory(VK_NULL_HANDLE), m_indexBufferMemory(VK_NULL_HANDLE) {}
 	/**
-	 * @brief Constructs a mesh by loading a model from file and setting up Vulkan buffers.
+	 * @brief Constructs a mesh from an imported scene and sets up Vulkan buffers.
+	 *
+	 * All meshes of the scene share one vertex and index buffer, each becomes a SubMesh.
 	 * @param device Vulkan logical device.
 	 * @param physicalDevice Vulkan physical device.
 	 * @param commandPool Command pool for buffer command submissions.
 	 * @param graphicsQueue Graphics queue to submit buffer commands.
-	 * @param path File path to the model.
+	 * @param scene Scene imported by Assimp.
+	 * @param jobSystem Converts the vertices and indices of large meshes in parallel.
 	 */
-	Mesh(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue, const std::string& path);
+	Mesh(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue, const aiScene* scene, JobSystem& jobSystem);
 	
-	void freeMemory();
+	/**
+	 * @brief Queues the vertex and index buffers for destruction once the GPU no longer uses them.
+	 */
+	void freeMemory(DeletionQueue& deletionQueue);
 	/**
    * @brief Binds vertex and index buffers to a command buffer for rendering.
    * @param commandBuffer Command buffer to record binding commands.
@@ -32,10 +65,18 @@ public:
 	void bindBuffers(VkCommandBuffer commandBuffer);
 
 	/**
-	 * @brief Issues draw call for the mesh.
+	 * @brief Issues draw call for instances of a sub mesh.
 	 * @param commandBuffer Command buffer to record draw commands.
+	 * @param subMesh The index range to draw.
+	 * @param instanceCount Number of instances to draw.
+	 * @param firstInstance Index of the first instance in the instance buffer.
 	 */
-	void draw(VkCommandBuffer commandBuffer);
+	void draw(VkCommandBuffer commandBuffer, const SubMesh& subMesh, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+	const std::vector<SubMesh>& getSubMeshes() const { return m_subMeshes; }
+
+	/// Bounds of every vertex in the mesh's object space.
+	const BoundingBox& getBounds() const { return m_bounds; }
 
 
 private:
@@ -46,6 +87,8 @@ private:
 
 	std::vector<Vertex> m_vertices;
 	std::vector<uint16_t> m_indices;
+	std::vector<SubMesh> m_subMeshes; ///< One entry per aiMesh in the scene.
+	BoundingBox m_bounds; ///< Bounds of the vertices.
 
 	VkBuffer m_vertexBuffer;
 	VkBuffer m_indexBuffer;
@@ -54,22 +97,19 @@ private:
 	VkDeviceMemory m_indexBufferMemory;
 
 	/**
-   * @brief Loads model data from file.
-   * @param path Path to the model file.
-   */
-	void loadModel(const std::string& path);
-	/**
 	 * @brief Processes nodes in the model scene graph.
 	 * @param node Node to process.
 	 * @param scene Pointer to the full scene data.
+	 * @param jobSystem Passed on to processMesh().
 	 */
-	void processNode(aiNode* node, const aiScene* scene);
+	void processNode(aiNode* node, const aiScene* scene, JobSystem& jobSystem);
 
 	/**
 	 * @brief Processes a mesh object from the scene, extracting vertices and indices.
 	 * @param mesh Pointer to the mesh data.
 	 * @param scene Pointer to the full scene data.
+	 * @param jobSystem Converts chunks of the vertices and indices in parallel.
 	 */
-	void processMesh(aiMesh* mesh, const aiScene* scene);
+	void processMesh(aiMesh* mesh, const aiScene* scene, JobSystem& jobSystem);
 
 };
@@ -1,53 +1,71 @@
 #pragma once
 
+#include <memory>
 #include "Mesh.hpp"
-#include "Texture.hpp"
+#include "materialTable.hpp"
+#include "drawList.hpp"
+#include "scene.hpp"
 
 /**
  * @class Model
- * @brief Represents a 3D model composed of a mesh and multiple textures.
+ * @brief Represents a 3D model composed of a mesh and the materials of its sub meshes.
  */
 class Model {
 public:
     /**
-     * @brief Constructs a Model with mesh and a single texture.
+     * @brief Imports a model, uploads its mesh and adds its materials to the material table.
      * @param device Vulkan logical device.
      * @param physicalDevice Vulkan physical device.
      * @param commandPool Command pool for buffer/texture operations.
      * @param graphicsQueue Queue for command submissions.
      * @param modelPath Path to the model file.
-     * @param texturePath Path to the initial texture file.
+     * @param materialTable Table receiving the materials of the model.
+     * @param jobSystem Converts the mesh data in parallel.
+     * @throws std::runtime_error if the model can't be imported.
      */
     Model(VkDevice device,
         VkPhysicalDevice physicalDevice,
         VkCommandPool commandPool,
         VkQueue graphicsQueue,
-        const std::string& modelPath);
-    
+        const std::string& modelPath,
+        std::shared_ptr<MaterialTable> materialTable,
+        JobSystem& jobSystem);
+
     /**
-     * @brief Loads up to 4 textures from given file paths.
-     * @param texturePaths Array of 4 texture file paths.
+     * @brief Binds textures to one of the model's materials, used when the model file doesn't reference them.
+     * @param materialIndex Index of the material in the model file.
+     * @param texturePaths Texture paths for the material slots.
      */
-    void loadTextures(const std::array<const char*, 4>& texturePaths);
-    void destroyModel();
+    void setMaterialTextures(uint32_t materialIndex, const MaterialTexturePaths& texturePaths);
 
     /**
-     * @brief Binds the mesh buffers to the given command buffer for rendering.
-     * @param commandBuffer Command buffer to record commands.
+     * @brief Queues the mesh buffers for destruction once the GPU no longer uses them, textures are owned by the material table.
      */
-    void bind(VkCommandBuffer commandBuffer);
+    void destroyModel(DeletionQueue& deletionQueue);
 
     /**
-    * @brief Issues a draw call for the model's mesh.
-    * @param commandBuffer Command buffer to record draw commands.
+    * @brief Adds one draw item per sub mesh to the draw list, keyed by the pipeline variant its material needs.
+    * @param drawList List receiving the draws of this frame.
+    * @param baseState State the per-material shader features are added to.
+    * @param transform Object to world transform of the model.
+    * @param view Camera view matrix, gives the depth the draws are sorted by.
+    * @param materialOverride Material table index used for every sub mesh, NO_MATERIAL_OVERRIDE keeps the model's materials.
+    * @param objectIndex Index of the drawing object in the scene, see DrawList::addTransform().
     */
-    void draw(VkCommandBuffer commandBuffer);
+    void emitDraws(DrawList& drawList, const PipelineState& baseState, const glm::mat4& transform, const glm::mat4& view, uint32_t materialOverride = NO_MATERIAL_OVERRIDE, uint32_t objectIndex = 0);
+
+    /// Bounds of the model in its object space.
+    const BoundingBox& getBounds() const { return m_mesh.getBounds(); }
 
-    /// Returns image views for the additional 4 textures.
-    std::array<VkImageView, 4> getImageViews() const;
+    /**
+     * @brief Returns every pipeline variant the model can be drawn with, used to warm up the pipeline library.
+     *
+     * Those of its own materials and, since a Scene material override may replace them with any material of the
+     * table, those of every table material. Variants missing from the warm-up aren't drawn until they're compiled.
+     * @param baseState State the per-material shader features are added to.
+     */
+    std::vector<PipelineState> getPipelineStates(const PipelineState& baseState) const;
 
-    /// Returns samplers for the additional 4 textures.
-    std::array<VkSampler, 4> getSamplers() const;
 private:
 	VkDevice m_device; ///< Vulkan logical device.
 	VkPhysicalDevice m_physicalDevice; ///< Vulkan physical device.
@@ -55,5 +73,23 @@ private:
 	VkQueue m_graphicsQueue; ///< Queue for command submissions.
 
 	Mesh m_mesh; ///< Mesh representing the model.
-	std::array<Texture, 4> m_textures; ///< Array of textures associated with the model.
-};
\ No newline at end of file
+	std::shared_ptr<MaterialTable> m_materialTable; ///< Table holding the model's materials.
+	std::vector<uint32_t> m_materialIndices; ///< Material index in the file to index in the material table.
+
+    /**
+     * @brief Adds every aiMaterial of the scene to the material table, decoding all their textures in parallel.
+     * @param scene Scene imported by Assimp.
+     * @param directory Directory of the model file, texture paths are relative to it.
+     */
+    void loadMaterials(const aiScene* scene, const std::string& directory);
+
+    /**
+     * @brief Returns the material table index of a sub mesh, 0 if its material is unknown.
+     */
+    uint32_t getMaterialIndex(const SubMesh& subMesh) const;
+
+    /**
+     * @brief Returns the pipeline state for a material: the base state plus the shader features its flags need.
+     */
+    PipelineState getPipelineState(uint32_t materialIndex, const PipelineState& baseState) const;
+};
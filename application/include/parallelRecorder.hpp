@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include "jobSystem.hpp"
+#include "deletionQueue.hpp"
+
+/**
+ * @class ParallelRecorder
+ * @brief Records slices of a pass into secondary command buffers as jobs of the job system.
+ *
+ * Command pools are externally synchronized, so every slice has its own pool per target and no two threads
+ * ever allocate from the same pool. A target is a primary command buffer the slices are executed from, its
+ * secondary command buffers stay valid for as long as the primary is replayed. A target's pools are reset as
+ * a whole with vkResetCommandPool before it is recorded again, which is cheaper than resetting each command
+ * buffer. The calling thread records the
+ * first slice itself while the workers record the others, and helps with them once it's done, then the primary command buffer executes the
+ * secondary command buffers in slice order so the result matches recording everything on one thread.
+ */
+class ParallelRecorder {
+public:
+	/**
+	 * @brief Records the items [first, last) into a secondary command buffer, called concurrently for different slices.
+	 */
+	using SliceCallback = std::function<void(VkCommandBuffer commandBuffer, size_t first, size_t last, uint32_t slice)>;
+
+	static constexpr size_t MIN_ITEMS_PER_SLICE = 256; ///< Below this a slice costs more to hand off than to record.
+
+	/**
+	 * @struct SlicePlan
+	 * @brief How record() splits the items of a pass.
+	 */
+	struct SlicePlan {
+		size_t count; ///< Number of slices, at least one.
+		size_t size; ///< Items per slice, the last one may have fewer.
+	};
+
+	/**
+	 * @brief Splits the items into as few slices of at least minItemsPerSlice items as possible, at most maxSlices.
+	 *
+	 * Doesn't touch Vulkan, so the recorder benchmark plans its synthetic slices the same way.
+	 */
+	static SlicePlan planSlices(size_t itemCount, size_t maxSlices, size_t minItemsPerSlice = MIN_ITEMS_PER_SLICE) {
+		size_t count = std::clamp<size_t>((itemCount + minItemsPerSlice - 1) / minItemsPerSlice, 1, std::max<size_t>(maxSlices, 1));
+		return { count, (itemCount + count - 1) / count };
+	}
+
+	/**
+	 * @brief Stores the pool creation info, resize() creates the command pools.
+	 * @param device The Vulkan logical device.
+	 * @param queueFamilyIndex Queue family the primary command buffers are submitted to.
+	 * @param jobSystem Runs the slices, must outlive the recorder.
+	 */
+	ParallelRecorder(VkDevice device, uint32_t queueFamilyIndex, JobSystem& jobSystem);
+
+	/**
+	 * @brief Creates the command pools for a new number of targets.
+	 *
+	 * The current pools are destroyed once the GPU is done with their command buffers.
+	 * @param targetCount Number of primary command buffers recorded with this recorder.
+	 * @param deletionQueue Queue the current pools are retired to.
+	 * @param retireValue Timeline value of the last submission that may execute the current command buffers.
+	 * @throws std::runtime_error if a command pool can't be created.
+	 */
+	void resize(uint32_t targetCount, DeletionQueue& deletionQueue, uint64_t retireValue);
+
+	/**
+	 * @brief Resets the command pools of a target before it is recorded again, the GPU must be done with it.
+	 */
+	void resetTarget(uint32_t target);
+
+	/**
+	 * @brief Splits the items into slices, records them in parallel and executes them from the primary command buffer.
+	 *
+	 * The primary command buffer must be inside a rendering scope begun with
+	 * VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT. Secondary command buffers inherit no state,
+	 * so the callback binds everything its draws need.
+	 * @param primary Command buffer the slices are executed from.
+	 * @param target Index of the primary command buffer, selects the command pools.
+	 * @param rendering Attachment formats of the rendering scope.
+	 * @param itemCount Number of items to split.
+	 * @param recordSlice Records one slice.
+	 * @throws std::runtime_error if a command buffer can't be allocated or recorded, rethrows exceptions of the callback.
+	 */
+	void record(VkCommandBuffer primary, uint32_t target, const VkCommandBufferInheritanceRenderingInfo& rendering, size_t itemCount, const SliceCallback& recordSlice);
+
+	/**
+	 * @brief Destroys the command pools, the GPU must be idle.
+	 */
+	void destroyParallelRecorder();
+
+	/// Largest number of slices record() splits into, one per worker plus the calling thread.
+	uint32_t getMaxSlices() const { return static_cast<uint32_t>(m_jobSystem.getThreadCount() + 1); }
+	uint32_t getLastSliceCount() const { return m_lastSliceCount; }
+private:
+	/**
+	 * @struct SlicePool
+	 * @brief Command pool of one slice of one target, with the secondary command buffers allocated from it.
+	 */
+	struct SlicePool {
+		VkCommandPool pool = VK_NULL_HANDLE; ///< Reset whenever its target is recorded again.
+		std::vector<VkCommandBuffer> commandBuffers; ///< Allocated so far, reused after the pool is reset.
+		uint32_t used = 0; ///< Command buffers handed out since the last reset.
+	};
+
+	VkDevice m_device; ///< Vulkan logical device.
+	VkCommandPoolCreateInfo m_poolInfo{}; ///< Creation info of every slice pool.
+	std::vector<std::vector<SlicePool>> m_slicePools; ///< Indexed by target, then by slice.
+	std::vector<VkCommandBuffer> m_secondaries; ///< Secondary command buffers of the pass being recorded, in slice order.
+	uint32_t m_lastSliceCount = 0; ///< Slices used by the last record().
+	JobSystem& m_jobSystem; ///< Runs the slices.
+
+	/**
+	 * @brief Allocates (or reuses) a secondary command buffer of a slice and begins it inheriting the rendering scope.
+	 */
+	VkCommandBuffer beginSecondary(SlicePool& slicePool, const VkCommandBufferInheritanceRenderingInfo& rendering);
+};
@@ -2,54 +2,145 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <array>
 #include "shaderManager.hpp"
 #include "vertex.hpp"
+#include "pipelineState.hpp"
+
+/**
+ * @brief The four parts of a graphics pipeline that VK_EXT_graphics_pipeline_library compiles separately.
+ */
+enum class PipelinePart : uint8_t {
+	VertexInput, ///< Vertex input and input assembly.
+	PreRasterization, ///< Vertex shader, viewport and rasterization state.
+	FragmentShader, ///< Fragment shader (with its specialization constants) and depth state.
+	FragmentOutput, ///< Colour blending, multisampling and attachment formats.
+};
+const uint32_t PIPELINE_PART_COUNT = 4; ///< Number of values in PipelinePart.
+
 /**
  * @class Pipeline
- * @brief Encapsulates Vulkan graphics pipeline creation and management.
+ * @brief Encapsulates Vulkan graphics and compute pipeline creation and management.
  *
- * Constructs a graphics pipeline with shaders, fixed-function stages,
- * and pipeline layout using a render pass and swapchain details.
+ * Constructs one graphics pipeline variant from a PipelineState: shader features become
+ * specialization constants, the rest selects the fixed-function state.
+ * Pipelines are used with dynamic rendering, so the attachment formats of the state replace a render pass.
+ * The pipeline is either compiled in one go (monolithic), or is one part of a graphics pipeline library,
+ * or is linked from four such parts.
+ * A compute pipeline only has a compute shader, its state is unused.
+ * The pipeline layout and shader modules are shared and owned by the PipelineLibrary.
  */
 class Pipeline {
 public:
 	/**
- * @brief Constructs a Pipeline object and creates the graphics pipeline.
- * @param renderPass The render pass this pipeline will be used with.
+ * @brief Constructs a Pipeline object and creates a monolithic graphics pipeline.
+ * @param device The Vulkan logical device.
+ * @param pipelineLayout Layout shared by all pipeline variants.
+ * @param pipelineCache Pipeline cache used when compiling the pipeline.
+ * @param vertShaderModule Vertex shader module.
+ * @param fragShaderModule Fragment shader module.
+ * @param state The variant to build.
+ */
+	Pipeline(VkDevice device, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineState& state);
+
+	/**
+ * @brief Constructs a Pipeline object holding one part of a graphics pipeline library.
+ *
+ * The part keeps its link time optimization info so it can later be linked into an optimized pipeline.
+ * @param part The part to compile, only the fields of state that part depends on are used.
+ */
+	Pipeline(VkDevice device, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineState& state, PipelinePart part);
+
+	/**
+ * @brief Constructs a Pipeline object by linking the four parts of a graphics pipeline library.
  * @param device The Vulkan logical device.
- * @param swapChainExtent The extent (width, height) of the swapchain images.
- * @param swapChainImageViews Image views associated with the swapchain.
- * @param descriptorSetLayout Descriptor set layout for resource binding.
+ * @param pipelineLayout Layout shared by all pipeline variants.
+ * @param pipelineCache Pipeline cache used when linking.
+ * @param parts One compiled library per PipelinePart, in enum order.
+ * @param state The variant the parts were built for.
+ * @param optimize false for a fast link, true for a link time optimized pipeline (as slow as a monolithic compile).
  */
-	Pipeline(VkRenderPass renderPass, VkDevice device, VkExtent2D swapChainExtent, std::vector<VkImageView> swapChainImageViews, VkDescriptorSetLayout descriptorSetLayout);
+	Pipeline(VkDevice device, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache, const std::array<VkPipeline, PIPELINE_PART_COUNT>& parts, const PipelineState& state, bool optimize);
+
+	/**
+ * @brief Constructs a Pipeline object and creates a compute pipeline.
+ * @param device The Vulkan logical device.
+ * @param pipelineLayout Layout of the compute shader's resources.
+ * @param pipelineCache Pipeline cache used when compiling the pipeline.
+ * @param compShaderModule Compute shader module, only needed until the constructor returns.
+ */
+	Pipeline(VkDevice device, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache, VkShaderModule compShaderModule);
 
 	/**
  * @brief Creates the Vulkan graphics pipeline, including shader stages,
- * vertex input, input assembly, viewport/scissor, rasterizer,
- * multisampling, color blending, depth/stencil testing, and pipeline layout.
+ * specialization constants, vertex input, input assembly, viewport/scissor, rasterizer,
+ * multisampling, color blending and depth/stencil testing.
  * Throws std::runtime_error on failure.
  */
 	void createGraphicsPipeline();
 
 	/**
- * @brief Destroys the graphics pipeline and its layout.
+ * @brief Creates the Vulkan compute pipeline from the compute shader module.
+ * Throws std::runtime_error on failure.
  */
-	const void destroyPipeline();
+	void createComputePipeline();
 
 	/**
- * @brief Updates the stored swap chain extent (e.g. on window resize).
- * @param extent New swap chain extent.
+ * @brief Destroys the graphics pipeline.
  */
-	void getUpdatedSwapChainExtent(VkExtent2D extent);
+	const void destroyPipeline();
 
 	VkPipeline getPipeline() const { return m_pipeline; }
-	VkPipelineLayout getPipelineLayout() const { return m_pipelineLayout; }
+	VkPipelineBindPoint getBindPoint() const { return m_bindPoint; }
+	const PipelineState& getState() const { return m_state; }
 private:
 	VkPipeline m_pipeline; ///< Vulkan graphics pipeline handle.
-	VkPipelineLayout m_pipelineLayout; ///< Vulkan pipeline layout handle.
-	VkRenderPass m_renderPass; ///< Render pass this pipeline is associated with.
+	VkPipelineLayout m_pipelineLayout; ///< Vulkan pipeline layout handle (not owned).
 	VkDevice m_device; ///< Vulkan logical device.
-	VkExtent2D m_swapChainExtent; ///< Extent of the swapchain images.
-	std::vector<VkImageView> m_swapChainImageViews; ///< Image views for the swapchain.
-	VkDescriptorSetLayout m_descriptorSetLayout; ///< Descriptor set layout for resource binding.
-};
\ No newline at end of file
+	VkPipelineCache m_pipelineCache; ///< Pipeline cache used when compiling the pipeline.
+	VkShaderModule m_vertShaderModule; ///< Vertex shader module (not owned).
+	VkShaderModule m_fragShaderModule; ///< Fragment shader module (not owned).
+	VkShaderModule m_compShaderModule = VK_NULL_HANDLE; ///< Compute shader module of a compute pipeline (not owned).
+	VkPipelineBindPoint m_bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS; ///< Where the pipeline is bound, graphics or compute.
+	PipelineState m_state; ///< The variant this pipeline implements.
+
+	/**
+	 * @brief Create info structs for every part of the pipeline, filled from m_state.
+	 *
+	 * Kept together so the pointers between them stay valid while a pipeline is created.
+	 */
+	struct CreateInfos {
+		std::array<VkBool32, SHADER_FEATURE_COUNT> featureValues{};
+		std::array<VkSpecializationMapEntry, SHADER_FEATURE_COUNT> featureEntries{};
+		VkSpecializationInfo specializationInfo{};
+		std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{}; ///< vertex, fragment
+		VkVertexInputBindingDescription bindingDescription{};
+		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+		VkPipelineVertexInputStateCreateInfo vertexInput{};
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+		std::array<VkDynamicState, 2> dynamicStates{};
+		VkPipelineDynamicStateCreateInfo dynamicState{};
+		VkPipelineViewportStateCreateInfo viewportState{};
+		VkPipelineRasterizationStateCreateInfo rasterizer{};
+		VkPipelineMultisampleStateCreateInfo multisampling{};
+		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+		VkPipelineColorBlendStateCreateInfo colorBlending{};
+		VkPipelineDepthStencilStateCreateInfo depthStencil{};
+		VkPipelineRenderingCreateInfo rendering{}; ///< attachment formats for dynamic rendering
+	};
+
+	/**
+	 * @brief Fills the create info structs for m_state.
+	 */
+	void fillCreateInfos(CreateInfos& infos) const;
+
+	/**
+	 * @brief Creates one graphics pipeline library part.
+	 */
+	void createLibraryPart(PipelinePart part);
+
+	/**
+	 * @brief Links four library parts into a complete pipeline.
+	 */
+	void linkLibraryParts(const std::array<VkPipeline, PIPELINE_PART_COUNT>& parts, bool optimize);
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+/**
+ * @class PipelineCache
+ * @brief Owns a VkPipelineCache that is loaded from and saved to disk between runs.
+ *
+ * The file starts with a PipelineCacheFileHeader keyed on the vendor, device, driver version
+ * and pipeline cache UUID of the physical device. A file written by another GPU or driver is
+ * ignored, and the file is written to a temporary file, flushed to the disk and only then renamed,
+ * so neither a crash mid-write nor a power loss can leave a truncated cache behind.
+ */
+class PipelineCache {
+public:
+	/**
+	 * @brief Creates the pipeline cache, seeded with the file contents if they match the device.
+	 * @param device Vulkan logical device.
+	 * @param physicalDevice Physical device the cache is keyed on.
+	 * @param directory Directory the cache file is stored in.
+	 * @throws std::runtime_error if the pipeline cache can't be created.
+	 */
+	PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& directory);
+
+	/**
+	 * @brief Returns the directory the cache file is kept in when the caller has no preference.
+	 *
+	 * VULKAN_APP_CACHE_DIR if set, otherwise the user's cache directory (%LOCALAPPDATA%\\VulkanApp on Windows,
+	 * $XDG_CACHE_HOME/VulkanApp or ~/.cache/VulkanApp elsewhere), so the cache doesn't depend on the working
+	 * directory the application was started from. Falls back to the temporary directory.
+	 */
+	static std::string getDefaultDirectory();
+
+	/**
+	 * @brief Writes the current cache contents to disk.
+	 *
+	 * Failures are reported but not thrown, a missing cache only costs startup time.
+	 */
+	void savePipelineCache();
+
+	/**
+	 * @brief Destroys the Vulkan pipeline cache.
+	 */
+	void destroyPipelineCache();
+
+	VkPipelineCache getPipelineCache() const { return m_pipelineCache; }
+
+	/// True if valid data was loaded from disk (warm start).
+	bool wasLoaded() const { return m_loaded; }
+private:
+	/**
+	 * @struct PipelineCacheFileHeader
+	 * @brief Prefix written in front of the data returned by vkGetPipelineCacheData.
+	 */
+	struct PipelineCacheFileHeader {
+		uint32_t magic; ///< Identifies the file as a pipeline cache of this application.
+		uint32_t version; ///< Version of this header layout.
+		uint32_t vendorID; ///< VkPhysicalDeviceProperties::vendorID.
+		uint32_t deviceID; ///< VkPhysicalDeviceProperties::deviceID.
+		uint32_t driverVersion; ///< VkPhysicalDeviceProperties::driverVersion.
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE]; ///< VkPhysicalDeviceProperties::pipelineCacheUUID.
+		uint64_t dataSize; ///< Size of the cache data following the header, after 4 bytes of padding that are written as zeros.
+	};
+
+	VkDevice m_device; ///< Vulkan logical device.
+	VkPhysicalDeviceProperties m_properties{}; ///< Properties of the physical device the cache is keyed on.
+	VkPipelineCache m_pipelineCache = VK_NULL_HANDLE; ///< Vulkan pipeline cache handle.
+	std::string m_path; ///< Path of the cache file.
+	bool m_loaded = false; ///< True if the cache was seeded from disk.
+
+	/**
+	 * @brief Reads the cache file and returns its data if the header matches the device.
+	 * @return The cache data, empty if the file is missing or stale.
+	 */
+	std::vector<char> loadCacheData();
+
+	/**
+	 * @brief Checks the header the driver puts at the start of its cache data.
+	 * @param data Cache data as returned by vkGetPipelineCacheData.
+	 * @return true if the data was produced by this device and driver.
+	 */
+	bool isCacheDataCompatible(const std::vector<char>& data) const;
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <span>
+#include <string>
+#include "pipeline.hpp"
+#include "pipelineState.hpp"
+#include "jobSystem.hpp"
+#include "deletionQueue.hpp"
+
+/**
+ * @class PipelineLibrary
+ * @brief Owns every graphics pipeline variant, keyed by a hashed PipelineState.
+ *
+ * Variants are compiled as background jobs of the job system. warmUp() precompiles a list of variants during loading,
+ * and getPipeline() never blocks on a missing variant: it queues the compile and returns VK_NULL_HANDLE until
+ * the requested one is ready. Variants differ in fixed function state, so no other variant is drawn in its place.
+ *
+ * When the device supports VK_EXT_graphics_pipeline_library, variants are fast-linked from four separately
+ * compiled parts that are shared between variants, then relinked with link time optimization in the
+ * background; the optimized pipeline replaces the fast-linked one once it's ready. Otherwise every variant
+ * is compiled monolithically.
+ *
+ * Compute pipelines have no variants, they are created on the calling thread with their own layout and are
+ * owned by the library so they go through the same cache and are destroyed with the graphics pipelines.
+ */
+class PipelineLibrary {
+public:
+	/**
+	 * @brief Creates the shared pipeline layout and loads the shader modules.
+	 * @param device The Vulkan logical device.
+	 * @param descriptorSetLayouts Descriptor set layouts for resource binding, in set order.
+	 * @param pipelineCache Pipeline cache used by every compile.
+	 * @param useGraphicsPipelineLibrary Build variants from pipeline library parts (requires VK_EXT_graphics_pipeline_library).
+	 * @param jobSystem Runs the compiles, must outlive the library.
+	 */
+	PipelineLibrary(VkDevice device, std::vector<VkDescriptorSetLayout> descriptorSetLayouts, VkPipelineCache pipelineCache, bool useGraphicsPipelineLibrary, JobSystem& jobSystem);
+
+	/**
+	 * @brief Compiles the given variants in parallel and waits for them.
+	 * @param states Variants to precompile.
+	 * @throws std::runtime_error if a variant fails to compile.
+	 */
+	void warmUp(const std::vector<PipelineState>& states);
+
+	/**
+	 * @brief Returns the pipeline for a variant without blocking.
+	 *
+	 * A missing variant is queued as a background job, callers skip its draws in the meantime. getVersion() is bumped
+	 * once it's ready.
+	 * @param state Variant to look up.
+	 * @return The requested pipeline if compiled, VK_NULL_HANDLE otherwise.
+	 */
+	VkPipeline getPipeline(const PipelineState& state);
+
+	/**
+	 * @brief Times building the given variants monolithically against building them from library parts.
+	 *
+	 * Every variant is created on the calling thread and destroyed again: a monolithic compile without the pipeline
+	 * cache, the same compile from the pipeline cache the warm-up filled (what a warm start pays), then without the
+	 * cache its four parts, the fast link of those parts and the link time optimized link when the device supports
+	 * VK_EXT_graphics_pipeline_library. Prints the averages to std::cout. Drivers with their own
+	 * shader cache (Mesa's on disk cache for example) may still shorten the repetitions after the first.
+	 * @param states Variants to build.
+	 * @param repetitions Number of times every variant is built.
+	 * @throws std::runtime_error if a pipeline can't be created.
+	 */
+	void benchmark(const std::vector<PipelineState>& states, int repetitions);
+
+	/**
+	 * @brief Creates a compute pipeline and keeps it until destroyPipelineLibrary().
+	 * @param shaderName Source file name of the compute shader, for ShaderManager overrides (e.g. "cullInstances.comp").
+	 * @param embedded The SPIR-V embedded for that shader.
+	 * @param pipelineLayout Layout of the shader's resources, owned by the caller and outliving the pipeline.
+	 * @return The compute pipeline.
+	 * @throws std::runtime_error if the pipeline can't be created.
+	 */
+	std::shared_ptr<Pipeline> createComputePipeline(const std::string& shaderName, std::span<const uint32_t> embedded, VkPipelineLayout pipelineLayout);
+
+	/**
+	 * @brief Hands the fast-linked pipelines replaced by optimized ones to the deletion queue.
+	 *
+	 * Optimized links finish on worker threads, call this from the render thread once per frame. The
+	 * pipelines are destroyed once every frame that may have recorded them completed.
+	 */
+	void retirePipelines(DeletionQueue& deletionQueue);
+
+	/**
+	 * @brief Bumped whenever getPipeline() may return a different pipeline for some variant.
+	 *
+	 * That is when a requested variant finished compiling or an optimized link replaced a fast-linked one. The bump
+	 * follows the change, so pipelines resolved after reading a version are at least that recent.
+	 */
+	uint64_t getVersion() const { return m_version.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Waits for pending compiles and destroys every pipeline, the layout and the shader modules.
+	 *
+	 * Also prints the average creation times, comparing fast links against full compiles.
+	 */
+	void destroyPipelineLibrary();
+
+	VkPipelineLayout getPipelineLayout() const { return m_pipelineLayout; }
+private:
+	using PipelineFuture = std::shared_future<std::shared_ptr<Pipeline>>;
+
+	/**
+	 * @struct PartEntry
+	 * @brief A pipeline library part, compiled once by whichever variant needs it first.
+	 */
+	struct PartEntry {
+		std::once_flag compiled; ///< Makes concurrent variants wait for the same compile instead of duplicating it.
+		std::shared_ptr<Pipeline> pipeline; ///< The compiled part.
+	};
+
+	/**
+	 * @struct Timing
+	 * @brief Accumulated creation time of one kind of pipeline.
+	 */
+	struct Timing {
+		double totalMs = 0.0; ///< Sum of the creation times.
+		uint32_t count = 0; ///< Number of pipelines created.
+	};
+
+	VkDevice m_device; ///< Vulkan logical device.
+	std::vector<VkDescriptorSetLayout> m_descriptorSetLayouts; ///< Descriptor set layouts for resource binding, in set order.
+	VkPipelineCache m_pipelineCache; ///< Pipeline cache used by every compile.
+	VkPipelineLayout m_pipelineLayout; ///< Layout shared by all variants.
+	VkShaderModule m_vertShaderModule; ///< Vertex shader shared by all variants.
+	VkShaderModule m_fragShaderModule; ///< Fragment shader shared by all variants, specialized per variant.
+
+	std::unordered_map<PipelineState, PipelineFuture, PipelineStateHash> m_pipelines; ///< Compiled and in-flight variants.
+	std::mutex m_mutex; ///< Guards m_pipelines.
+
+	bool m_useGraphicsPipelineLibrary; ///< Link variants from library parts instead of compiling them whole.
+	std::array<std::unordered_map<PipelineState, std::shared_ptr<PartEntry>, PipelineStateHash>, PIPELINE_PART_COUNT> m_parts; ///< Library parts per PipelinePart, keyed by the fields that part uses. Guarded by m_mutex.
+	std::vector<std::shared_ptr<Pipeline>> m_computePipelines; ///< Pipelines from createComputePipeline(). Guarded by m_mutex.
+	std::vector<std::shared_ptr<Pipeline>> m_retiredPipelines; ///< Fast-linked pipelines replaced by optimized ones, recorded command buffers may still use them. Guarded by m_mutex.
+
+	Timing m_monolithicTiming; ///< Full compiles without pipeline libraries. Guarded by m_mutex.
+	Timing m_fastLinkTiming; ///< Fast links of library parts. Guarded by m_mutex.
+	Timing m_optimizedLinkTiming; ///< Link time optimized links of library parts. Guarded by m_mutex.
+
+	JobSystem& m_jobSystem; ///< Runs compiles and optimized links.
+	JobCounter m_jobs; ///< Compiles and optimized links still running, waited for before the members they use are destroyed.
+	std::atomic<uint64_t> m_version{ 0 }; ///< Returned by getVersion().
+
+	/**
+	 * @brief Returns the future for a variant, queueing its compile if it's not known yet.
+	 * @param state Variant to look up. Must be called with m_mutex held.
+	 */
+	PipelineFuture requestPipeline(const PipelineState& state);
+
+	/**
+	 * @brief Creates the pipeline layout shared by all variants.
+	 */
+	void createPipelineLayout();
+
+	/**
+	 * @brief Builds a variant on a worker thread, either monolithically or by fast-linking its library parts.
+	 */
+	std::shared_ptr<Pipeline> compilePipeline(const PipelineState& state);
+
+	/**
+	 * @brief Returns a library part, compiling it if no earlier variant needed it.
+	 */
+	VkPipeline getPart(const PipelineState& state, PipelinePart part);
+
+	/**
+	 * @brief Clears the fields of a state that the given part doesn't depend on, so variants can share the part.
+	 */
+	static PipelineState partKey(const PipelineState& state, PipelinePart part);
+
+	/**
+	 * @brief Relinks a fast-linked variant with link time optimization and swaps it in once done.
+	 */
+	void optimizePipeline(const PipelineState& state, std::array<VkPipeline, PIPELINE_PART_COUNT> parts, std::shared_ptr<Pipeline> fastLinked);
+
+	/**
+	 * @brief Adds a creation time to a timing.
+	 */
+	void recordTiming(Timing& timing, std::chrono::high_resolution_clock::time_point start);
+};
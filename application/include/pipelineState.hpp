@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Shader features toggled through specialization constants (constant_id = bit index in shader.frag).
+ */
+enum ShaderFeatures : uint32_t {
+	SHADER_FEATURE_NORMAL_MAP = 1u << 0, ///< Perturb the normal with the material's normal map.
+	SHADER_FEATURE_ALPHA_TEST = 1u << 1, ///< Discard fragments whose albedo alpha is below the cutoff.
+};
+const uint32_t SHADER_FEATURE_COUNT = 2; ///< Number of bits in ShaderFeatures.
+
+/**
+ * @brief Vertex input layouts a pipeline can be built for.
+ */
+enum class VertexLayout : uint8_t {
+	Standard, ///< Vertex: position, normal, texCoord, tangent.
+};
+
+/**
+ * @brief Colour blend configurations a pipeline can be built for.
+ */
+enum class BlendMode : uint8_t {
+	Opaque, ///< No blending.
+	AlphaBlend, ///< Standard premultiplied-less alpha blending.
+	Additive, ///< Source added to destination.
+};
+
+/**
+ * @struct PipelineState
+ * @brief Everything that distinguishes one graphics pipeline variant from another.
+ *
+ * Used as the key of the PipelineLibrary. Viewport and scissor are dynamic and not part of the key.
+ */
+struct PipelineState {
+	uint32_t shaderFeatures = 0; ///< Combination of ShaderFeatures.
+	VertexLayout vertexLayout = VertexLayout::Standard; ///< Vertex input layout.
+	BlendMode blendMode = BlendMode::Opaque; ///< Colour blend configuration.
+	VkBool32 depthTest = VK_TRUE; ///< Enable depth testing.
+	VkBool32 depthWrite = VK_TRUE; ///< Enable depth writes.
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS; ///< Depth comparison.
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT; ///< Face culling.
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED; ///< Format of the colour attachment.
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED; ///< Format of the depth attachment.
+
+	bool operator==(const PipelineState& other) const = default;
+
+	/**
+	 * @brief FNV-1a hash over the fields (not the raw bytes, so padding doesn't leak into the hash).
+	 */
+	size_t hash() const {
+		uint64_t hash = 14695981039346656037ull;
+		auto combine = [&hash](uint64_t value) {
+			for (int i = 0; i < 8; i++) {
+				hash ^= (value >> (i * 8)) & 0xff;
+				hash *= 1099511628211ull;
+			}
+		};
+		combine(shaderFeatures);
+		combine(static_cast<uint64_t>(vertexLayout));
+		combine(static_cast<uint64_t>(blendMode));
+		combine(depthTest);
+		combine(depthWrite);
+		combine(depthCompareOp);
+		combine(cullMode);
+		combine(colorFormat);
+		combine(depthFormat);
+		return static_cast<size_t>(hash);
+	}
+};
+
+/**
+ * @struct PipelineStateHash
+ * @brief Hash functor so PipelineState can key unordered containers.
+ */
+struct PipelineStateHash {
+	size_t operator()(const PipelineState& state) const { return state.hash(); }
+};
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include <stdexcept>
+#include "imageUtils.hpp"
+#include "deletionQueue.hpp"
+
+/**
+ * @brief Handle of an image declared in a RenderGraph (index into its image list).
+ */
+using RenderGraphImage = uint32_t;
+
+/**
+ * @brief How a pass accesses an image, selects the layout, pipeline stages and access flags it needs.
+ */
+enum class ImageAccess : uint8_t {
+	ColorAttachment, ///< Written as a colour attachment.
+	DepthAttachment, ///< Depth tested and written.
+	DepthRead, ///< Depth tested without writing (read-only depth attachment).
+	FragmentSampled, ///< Sampled in a fragment shader.
+	ComputeSampled, ///< Sampled in a compute shader, the pass runs outside rendering.
+};
+
+/**
+ * @struct TransientImageDesc
+ * @brief Describes an image owned by the graph.
+ *
+ * Transient images only live within a frame, so images whose lifetimes don't overlap share memory.
+ * Usage flags are derived from the accesses the passes declare.
+ */
+struct TransientImageDesc {
+	VkFormat format = VK_FORMAT_UNDEFINED; ///< Format of the image.
+	VkExtent2D extent{ 0, 0 }; ///< Size of the image, 0 follows the extent the graph is compiled for.
+};
+
+/**
+ * @class RenderGraph
+ * @brief Orders the passes of a frame and derives their synchronization from declared image accesses.
+ *
+ * Passes declare which images they read and write in a setup callback and record their commands in an
+ * execute callback. compile() culls passes that contribute nothing to an imported image, then places
+ * transient images with disjoint lifetimes in the same memory. execute() records each live pass inside
+ * dynamic rendering, preceded by one batched vkCmdPipelineBarrier2 holding only the barriers its
+ * accesses need (layout changes, write after write, write after read and read after write).
+ */
+class RenderGraph {
+private:
+	struct Pass;
+public:
+	/**
+	 * @class PassBuilder
+	 * @brief Collects the image accesses of one pass during its setup callback.
+	 */
+	class PassBuilder {
+	public:
+		/**
+		 * @brief Renders into the image as a colour attachment, in declaration order.
+		 * @param image Image to write.
+		 * @param loadOp CLEAR or DONT_CARE overwrite the image, LOAD keeps what earlier passes wrote.
+		 * @param clearColor Colour used with VK_ATTACHMENT_LOAD_OP_CLEAR.
+		 */
+		void writeColor(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor = {});
+
+		/**
+		 * @brief Uses the image as the depth attachment with depth writes.
+		 * @param image Image to write.
+		 * @param loadOp CLEAR or DONT_CARE overwrite the image, LOAD keeps what earlier passes wrote.
+		 * @param clearDepth Depth used with VK_ATTACHMENT_LOAD_OP_CLEAR.
+		 */
+		void writeDepth(RenderGraphImage image, VkAttachmentLoadOp loadOp, float clearDepth = 1.0f);
+
+		/**
+		 * @brief Uses the image as a read-only depth attachment, e.g. after a depth prepass.
+		 */
+		void readDepth(RenderGraphImage image);
+
+		/**
+		 * @brief Samples the image in the fragment shader of the pass.
+		 */
+		void sample(RenderGraphImage image);
+
+		/**
+		 * @brief Samples the image in a compute shader dispatched by the pass, e.g. to reduce depth.
+		 */
+		void sampleCompute(RenderGraphImage image);
+
+		/**
+		 * @brief Keeps the pass even if nothing reads what it writes.
+		 */
+		void setSideEffects();
+
+		/**
+		 * @brief The execute callback only executes secondary command buffers.
+		 *
+		 * Rendering begins with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT, the secondary command buffers
+		 * inherit getRenderingInheritance().
+		 */
+		void useSecondaryCommandBuffers();
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, Pass& pass) : m_graph(graph), m_pass(pass) {}
+
+		void addUse(RenderGraphImage image, ImageAccess access, VkAttachmentLoadOp loadOp, VkClearValue clearValue);
+
+		RenderGraph& m_graph; ///< Graph the pass belongs to.
+		Pass& m_pass; ///< Pass being declared.
+	};
+
+	using SetupCallback = std::function<void(PassBuilder&)>;
+	using ExecuteCallback = std::function<void(VkCommandBuffer)>;
+
+	/**
+	 * @brief Creates an empty graph.
+	 * @param device The Vulkan logical device.
+	 * @param physicalDevice The physical device used to pick memory types for transient images.
+	 */
+	RenderGraph(VkDevice device, VkPhysicalDevice physicalDevice);
+
+	/**
+	 * @brief Declares an image owned outside the graph, such as a swap chain image.
+	 *
+	 * Imported images are the outputs of the graph: passes writing them are never culled.
+	 * The VkImage is set each frame with setImportedImage().
+	 * @param name Name used in error messages.
+	 * @param format Format of the image.
+	 * @param initialLayout Layout the image is in when the frame starts, UNDEFINED discards its contents.
+	 * @param finalLayout Layout the image is left in at the end of the frame (e.g. PRESENT_SRC_KHR).
+	 * @param waitStage Stage the submission waits at before the image may be accessed (the acquire semaphore wait stage).
+	 * @return Handle of the image.
+	 */
+	RenderGraphImage importImage(const std::string& name, VkFormat format, VkImageLayout initialLayout, VkImageLayout finalLayout, VkPipelineStageFlags2 waitStage);
+
+	/**
+	 * @brief Declares an image owned by the graph, created by compile().
+	 * @param name Name used in error messages.
+	 * @param desc Format and size of the image.
+	 * @return Handle of the image.
+	 */
+	RenderGraphImage createImage(const std::string& name, const TransientImageDesc& desc);
+
+	/**
+	 * @brief Adds a pass, passes execute in the order they were added.
+	 * @param name Name used in error messages.
+	 * @param setup Declares the image accesses of the pass, called once here.
+	 * @param execute Records the commands of the pass, called by every execute(), inside dynamic rendering if the pass has attachments.
+	 */
+	void addPass(const std::string& name, const SetupCallback& setup, ExecuteCallback execute);
+
+	/**
+	 * @brief Culls unused passes and (re)creates the transient images for the given extent.
+	 *
+	 * Must be called after every pass is added and again when the extent changes. The current transient
+	 * images are destroyed right away, call retireTransientImages() first if frames in flight still use them.
+	 * @param extent Size of imported images and of transient images without an explicit extent.
+	 * @throws std::runtime_error if a pass reads a transient image no earlier pass writes.
+	 */
+	void compile(VkExtent2D extent);
+
+	/**
+	 * @brief Sets the VkImage and view an imported image refers to this frame.
+	 */
+	void setImportedImage(RenderGraphImage image, VkImage vkImage, VkImageView view);
+
+	/**
+	 * @brief Records every live pass with its barriers into the command buffer.
+	 *
+	 * Between two compile() calls every frame records the same barriers, so a recorded command buffer can be
+	 * submitted again as long as the passes record the same commands.
+	 * @param commandBuffer Command buffer in the recording state.
+	 * @throws std::runtime_error if the graph wasn't compiled.
+	 */
+	void execute(VkCommandBuffer commandBuffer);
+
+	/**
+	 * @brief Hands the transient images and their memory to a deletion queue, the next compile() creates new ones.
+	 * @param deletionQueue Queue the images are retired to.
+	 * @param retireValue Timeline value of the last submission that may use the images.
+	 */
+	void retireTransientImages(DeletionQueue& deletionQueue, uint64_t retireValue);
+
+	/**
+	 * @brief Destroys the transient images and their memory.
+	 */
+	void destroyRenderGraph();
+
+	/**
+	 * @brief Returns the view of an image, used by passes to write descriptors for sampled images.
+	 * @throws std::out_of_range if the handle is invalid.
+	 */
+	VkImageView getImageView(RenderGraphImage image) const;
+
+	VkExtent2D getExtent() const { return m_extent; }
+
+	/**
+	 * @brief Attachment formats of the pass being executed, chained into the inheritance info of its secondary command buffers.
+	 *
+	 * Only valid inside the execute callback of a pass.
+	 */
+	const VkCommandBufferInheritanceRenderingInfo& getRenderingInheritance() const { return m_renderingInheritance; }
+private:
+	/**
+	 * @struct ImageUse
+	 * @brief One image access declared by a pass.
+	 */
+	struct ImageUse {
+		RenderGraphImage image; ///< Accessed image.
+		ImageAccess access; ///< Kind of access.
+		VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_LOAD; ///< For attachments, how the previous contents are treated.
+		VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE; ///< For attachments, decided by compile() from later reads.
+		VkClearValue clearValue{}; ///< Used with VK_ATTACHMENT_LOAD_OP_CLEAR.
+	};
+
+	/**
+	 * @struct Pass
+	 * @brief A declared pass.
+	 */
+	struct Pass {
+		std::string name; ///< Name used in error messages.
+		std::vector<ImageUse> uses; ///< Declared accesses.
+		ExecuteCallback execute; ///< Records the commands of the pass.
+		bool sideEffects = false; ///< Never culled.
+		bool secondaryCommandBuffers = false; ///< Records its contents in secondary command buffers.
+		bool culled = false; ///< Set by compile() when nothing needs the output of the pass.
+	};
+
+	/**
+	 * @struct ImageState
+	 * @brief Last synchronization state of an image while the frame is recorded.
+	 */
+	struct ImageState {
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED; ///< Current layout.
+		VkPipelineStageFlags2 writeStages = 0; ///< Stages of the last write (or layout transition).
+		VkAccessFlags2 writeAccess = 0; ///< Accesses of the last write still to be made visible.
+		VkPipelineStageFlags2 readStages = 0; ///< Stages that already wait for the last write.
+	};
+
+	/**
+	 * @struct Image
+	 * @brief An imported or transient image.
+	 */
+	struct Image {
+		std::string name; ///< Name used in error messages.
+		VkFormat format; ///< Format of the image.
+		VkExtent2D extent{ 0, 0 }; ///< Requested size, 0 follows the graph extent.
+		bool imported = false; ///< Owned outside the graph.
+		VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; ///< Imported only, layout at the start of the frame.
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED; ///< Imported only, layout at the end of the frame.
+		VkPipelineStageFlags2 waitStage = VK_PIPELINE_STAGE_2_NONE; ///< Imported only, stage the submission waits at.
+		VkImageUsageFlags usage = 0; ///< Transient only, derived from the declared accesses.
+		VkImage image = VK_NULL_HANDLE; ///< Vulkan image.
+		VkImageView view = VK_NULL_HANDLE; ///< View over the whole image.
+		int32_t memoryBlock = -1; ///< Transient only, index into m_memoryBlocks (-1 if no live pass uses it).
+		uint32_t firstUse = 0; ///< Position of the first live pass using the image.
+		uint32_t lastUse = 0; ///< Position of the last live pass using the image.
+		bool usedThisFrame = false; ///< Whether execute() already touched the image this frame.
+		ImageState state; ///< Synchronization state while recording.
+	};
+
+	/**
+	 * @struct MemoryBlock
+	 * @brief Memory shared by transient images whose lifetimes don't overlap.
+	 */
+	struct MemoryBlock {
+		VkDeviceMemory memory = VK_NULL_HANDLE; ///< Allocation, every image is bound at offset 0.
+		VkDeviceSize size = 0; ///< Largest requirement of the images placed in the block.
+		uint32_t memoryTypeBits = 0; ///< Memory types every image placed in the block accepts.
+		std::vector<RenderGraphImage> images; ///< Images placed in the block.
+		VkPipelineStageFlags2 stages = 0; ///< Stages of every access to the current occupant, the next occupant waits for them.
+		VkAccessFlags2 writeAccess = 0; ///< Writes to the current occupant, made available before the next occupant uses the memory.
+	};
+
+	/**
+	 * @struct AccessInfo
+	 * @brief Layout, stages and access flags an ImageUse needs.
+	 */
+	struct AccessInfo {
+		VkImageLayout layout; ///< Required layout.
+		VkPipelineStageFlags2 stages; ///< Stages the access happens in.
+		VkAccessFlags2 access; ///< Access flags of the access.
+		bool write; ///< Whether the access writes the image.
+	};
+
+	VkDevice m_device; ///< Vulkan logical device.
+	VkPhysicalDevice m_physicalDevice; ///< Used to pick memory types.
+	VkExtent2D m_extent{ 0, 0 }; ///< Extent of the last compile.
+	bool m_compiled = false; ///< Whether compile() ran since the last change to the graph.
+
+	std::vector<Image> m_images; ///< Imported and transient images, indexed by RenderGraphImage.
+	std::vector<Pass> m_passes; ///< Passes in declaration order.
+	std::vector<uint32_t> m_livePasses; ///< Indices of the passes that survived culling, in execution order.
+	std::vector<MemoryBlock> m_memoryBlocks; ///< Memory backing the transient images.
+	std::vector<VkImageMemoryBarrier2> m_barriers; ///< Barriers of the pass being recorded, reused between passes.
+	std::vector<VkFormat> m_inheritanceColorFormats; ///< Colour formats pointed to by m_renderingInheritance.
+	VkCommandBufferInheritanceRenderingInfo m_renderingInheritance{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO }; ///< Formats of the pass being recorded.
+
+	static AccessInfo getAccessInfo(const ImageUse& use);
+	static bool readsContents(const ImageUse& use); ///< Whether the use depends on what earlier passes wrote.
+	static VkImageAspectFlags getAspectMask(VkFormat format);
+
+	/**
+	 * @brief Marks passes that contribute nothing to an imported image or side effect as culled.
+	 */
+	void cullPasses();
+
+	/**
+	 * @brief Computes image lifetimes over the live passes and picks the store op of every attachment.
+	 * @throws std::runtime_error if a transient image is read before it is written.
+	 */
+	void computeLifetimes();
+
+	/**
+	 * @brief Creates the used transient images and packs them into as few memory blocks as their lifetimes allow.
+	 */
+	void createTransientImages();
+
+	/**
+	 * @brief Adds the barrier an image use needs (if any) to m_barriers and updates the state of the image.
+	 */
+	void addBarrier(const ImageUse& use);
+
+	/**
+	 * @brief Adds the transitions of the imported images to their final layouts to m_barriers.
+	 */
+	void addFinalBarriers();
+
+	/**
+	 * @brief Runs the barrier logic of one frame without recording, so the first frame starts from the same state as the others.
+	 */
+	void primeBarrierState();
+
+	/**
+	 * @brief Records m_barriers with a single vkCmdPipelineBarrier2 and clears it.
+	 */
+	void flushBarriers(VkCommandBuffer commandBuffer);
+
+	/**
+	 * @brief Begins dynamic rendering with the attachments of the pass.
+	 * @return false if the pass has no attachments (nothing was begun).
+	 */
+	bool beginRendering(VkCommandBuffer commandBuffer, const Pass& pass);
+
+	void destroyTransientImages();
+};
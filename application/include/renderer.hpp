@@ -3,19 +3,47 @@
 #include <vulkan/vulkan.h>
 #include "window.hpp"
 #include <memory>
+#include <chrono>
+#include <array>
+#include <iostream>
+#include "log.hpp"
 #include "instance.hpp"
 #include "device.hpp"
 #include "swapChain.hpp"
-#include "renderPass.hpp"
-#include "pipeline.hpp"
+#include "renderGraph.hpp"
+#include "pipelineLibrary.hpp"
+#include "pipelineCache.hpp"
 #include "commandPool.hpp"
 #include "descriptorManager.hpp"
 #include "uniformBuffers.hpp"
+#include "instanceBuffers.hpp"
 #include "model.hpp"
+#include "drawList.hpp"
+#include "parallelRecorder.hpp"
+#include "frameStats.hpp"
+#include "framePacer.hpp"
+#include "gpuTimeline.hpp"
+#include "deletionQueue.hpp"
+#include "materialTable.hpp"
+#include "jobSystem.hpp"
+#include "simulation.hpp"
+#include "scene.hpp"
+#include "frustumCuller.hpp"
+#include "gpuCuller.hpp"
+#include "depthPyramid.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
 
 /**
  * @class Renderer
  * @brief Manages and holds all the resources for the Vulkan rendering process.
+ *
+ * The main thread polls window events and runs the simulation at a fixed timestep, the render thread
+ * draws frames. They share the scene only through the simulation's triple-buffered snapshot, so the
+ * simulation never waits for the GPU or present and rendering never waits for the simulation.
  */
 class Renderer {
 public:
@@ -26,24 +54,79 @@ public:
 		cleanup();
 	}
 private:
+	std::shared_ptr<JobSystem> m_jobSystem; ///< Pointer to the job system shared by asset loading, pipeline compiles and command recording, declared first so it outlives everything that queues jobs.
 	std::shared_ptr<Window> m_window; ///< Pointer to the window object used for rendering.
 	std::shared_ptr<VKInstance> m_instance; ///< Pointer to the Vulkan instance object used for managing Vulkan resources.
 	std::shared_ptr<Device> m_device; ///< Pointer to the Vulkan device object used for interacting with the GPU.
 	std::shared_ptr<VKSwapChain> m_swapChain; ///< Pointer to the Vulkan swapchain object used for managing image presentation.
-	std::shared_ptr<RenderPass> m_renderPass; ///< Pointer to the Vulkan render pass object used for defining how rendering is done.
-	std::shared_ptr<Pipeline> m_pipeline; ///< Pointer to the Vulkan pipeline object used for managing the graphics pipeline state and shaders.
+	std::shared_ptr<RenderGraph> m_renderGraph; ///< Pointer to the render graph ordering the passes of a frame and deriving their barriers.
+	RenderGraphImage m_backbuffer = 0; ///< Swap chain image of the current frame, imported into the render graph.
+	RenderGraphImage m_depthBuffer = 0; ///< Transient depth buffer of the forward pass.
+	std::shared_ptr<PipelineCache> m_pipelineCache; ///< Pointer to the pipeline cache persisted to disk so pipelines aren't recompiled on every startup.
+	std::shared_ptr<PipelineLibrary> m_pipelineLibrary; ///< Pointer to the pipeline library owning every pipeline variant and their shared layout.
+	PipelineState m_basePipelineState; ///< State every draw starts from, materials add their shader features to it.
 	std::shared_ptr<CommandPool> m_commandPool; ///< Pointer to the Vulkan command pool object used for managing command buffers and command execution.
 	std::shared_ptr<DescriptorManager> m_descriptorManager; ///< Pointer to the descriptor manager object used for managing descriptor sets and layouts for shader resources.
 	std::shared_ptr<UniformBuffers> m_uniformBuffers; ///< Pointer to the uniform buffers object used for managing uniform buffer objects that store shader data.
-	std::shared_ptr<Model> m_modelPBR; ///< Pointer to the model object used for loading and rendering 3D models with PBR materials.
+	std::shared_ptr<InstanceBuffers> m_instanceBuffers; ///< Pointer to the per-frame storage buffers holding the transform and material of every instance the draw list draws.
+	std::shared_ptr<MaterialTable> m_materialTable; ///< Pointer to the material table holding every material and texture in a single storage buffer and texture array.
+	std::vector<std::shared_ptr<Model>> m_models; ///< Models loaded with PBR materials, scene entities reference them by index.
+	std::shared_ptr<Scene> m_scene; ///< Pointer to the scene holding the transforms, bounds and models of the entities, render thread only.
+	std::vector<Entity> m_objectEntities; ///< Scene entity of each simulation object, created when the object first shows up.
+	std::shared_ptr<FrustumCuller> m_frustumCuller; ///< Pointer to the culler testing the scene's bounds against the camera frustum on the job system.
+	std::vector<uint32_t> m_visibleEntities; ///< Dense scene indices of the entities that passed culling this frame, in increasing order.
+	bool m_frustumCulling = true; ///< Whether entities outside the frustum are skipped, VULKAN_APP_CULLING=0 draws every visible entity for comparison.
+	std::shared_ptr<GpuCuller> m_gpuCuller; ///< Pointer to the compute culling writing the indirect draws, null without draw indirect count support.
+	bool m_gpuCulling = false; ///< Whether instances are culled on the GPU and drawn indirectly, on where supported unless VULKAN_APP_GPU_CULLING=0.
+	std::shared_ptr<DepthPyramid> m_depthPyramid; ///< Pointer to the depth pyramid the late culling phase tests against, null without occlusion culling.
+	bool m_occlusionCulling = false; ///< Whether GPU culling also skips instances hidden behind the previous frame's visible set, on with GPU culling unless VULKAN_APP_OCCLUSION_CULLING=0.
+	std::shared_ptr<Simulation> m_simulation; ///< Pointer to the fixed timestep simulation advanced by the main thread and read by the render thread.
+	SceneState m_renderState; ///< Scene state interpolated for the frame being rendered, render thread only.
+	bool m_lateLatchCamera = true; ///< Whether the camera is sampled right before the submit instead of with the scene, VULKAN_APP_LATE_LATCH=0 turns it off for comparison.
+	FrameStats::Clock::time_point m_sceneSampleTime; ///< When update() sampled the scene of the current frame.
+	FrameStats::Clock::time_point m_cameraSampleTime; ///< When latchCamera() sampled the camera of the current frame.
+	std::shared_ptr<DrawList> m_drawList; ///< Pointer to the draw list the scene fills each frame, sorted to minimize state changes.
+	DrawStats m_drawStats; ///< Draws and binds of the last recorded frame.
+	std::shared_ptr<ParallelRecorder> m_parallelRecorder; ///< Pointer to the recorder splitting the draw list over worker threads and secondary command buffers.
+	std::vector<DrawStats> m_sliceStats; ///< Stats of each slice of the last recorded frame, one element per recording thread.
+	uint64_t m_sceneVersion = 1; ///< Bumped whenever the recorded commands would differ (draw list rebuilt, pipelines resolved again, buffers replaced), cached command buffers of older versions are re-recorded.
+	uint64_t m_drawListVersion = 0; ///< Bumped whenever update() rebuilds the draw list.
+	uint64_t m_drawListSceneVersion = UINT64_MAX; ///< Scene::getVersion() the draw list was built from, the first frame always builds it.
+	uint64_t m_drawListStructureVersion = UINT64_MAX; ///< Scene::getStructureVersion() the draw list was built from.
+	glm::mat4 m_drawListViewProjection{ 0.0f }; ///< Camera the draw list was culled and depth sorted with.
+	CameraState m_culledCamera; ///< Simulation camera the draw list was culled with, what latchCamera() turns when culling on the CPU.
+	LookAngles m_culledLook; ///< Mouse look the draw list was culled with, the latched look stays within MAX_LATCH_LOOK_DELTA of it.
+	uint64_t m_resolvedPipelineVersion = 0; ///< PipelineLibrary::getVersion() the draw list's pipelines were resolved at.
+	std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> m_instanceVersions{}; ///< Draw list version whose instances each frame slot's instance buffer holds.
+	std::vector<uint64_t> m_recordedVersions; ///< Scene version each cached command buffer was recorded at (0 if never), indexed by getCommandTarget().
+	std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> m_frameSetVersions{}; ///< Scene version each slot's per-frame descriptor set was allocated at (0 if never), its cached command buffers bind it.
+	uint32_t m_recordingTarget = 0; ///< Cached command buffer being recorded, selects the secondary command pools.
+	bool m_renderOnDemand = false; ///< Toggled with O, frames are only drawn after input, a redraw request, an animation step or a pipeline variant becoming ready.
+	uint64_t m_drawnSimulationVersion = UINT64_MAX; ///< SimulationSnapshot::version of the last frame update() built.
+	std::chrono::high_resolution_clock::time_point m_lastFrameStart; ///< When the main loop last started a frame, spaces the background frames.
+	std::chrono::high_resolution_clock::time_point m_lastStatsPrint; ///< When the draw stats were last printed.
 
 	//synchronisation
 	std::vector<VkSemaphore> imageAvailableSemaphores; ///< Semaphores used to signal when an image is available for rendering.
 	std::vector<VkSemaphore> renderFinishedSemaphores; ///< Semaphores used to signal when rendering is finished and the image can be presented.
-	std::vector<VkFence> inFlightFences; ///< Fences used to synchronize CPU and GPU operations, ensuring that the CPU waits for the GPU to finish rendering before proceeding.
+	std::shared_ptr<GpuTimeline> m_gpuTimeline; ///< Pointer to the timeline semaphore every submission signals, the CPU waits on its values instead of per frame fences.
+	std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> m_frameTimelineValues{}; ///< Timeline value signaled by the last frame submitted from each slot.
+	std::shared_ptr<DeletionQueue> m_deletionQueue; ///< Pointer to the queue destroying replaced resources once the timeline passed their last use.
 	uint32_t currentFrame = 0; ///< Index of the current frame being rendered, used to manage synchronization and resource updates.
+	uint32_t m_framesInFlight = DEFAULT_FRAMES_IN_FLIGHT; ///< Number of frame slots in use (1 to MAX_FRAMES_IN_FLIGHT), trades CPU stalls for latency.
+	FrameStats m_frameStats; ///< Frame slot waits and acquire to present/GPU done timings, printed once a second.
+	std::shared_ptr<FramePacer> m_framePacer; ///< Pointer to the frame pacer limiting the frame rate and keeping the frame time percentiles.
+
+	bool framebufferResized = false; ///< Set while a swapchain recreation is deferred because the window is minimized.
 
-	bool framebufferResized = false; ///< Flag indicating whether the framebuffer has been resized, used to trigger swapchain recreation.
+	//threads
+	std::thread m_renderThread; ///< Runs renderLoop() while the main thread runs the simulation.
+	std::atomic<bool> m_stopRendering{ false }; ///< Set by the main thread to end renderLoop().
+	std::atomic<bool> m_renderThreadExited{ false }; ///< Set by the render thread when renderLoop() returns, ends the main loop.
+	std::exception_ptr m_renderError; ///< Exception that ended renderLoop(), rethrown by mainLoop() after the join.
+	std::mutex m_renderWakeMutex; ///< Guards m_renderWakeups.
+	std::condition_variable m_renderWake; ///< Wakes a render thread sleeping in waitForFrame().
+	uint64_t m_renderWakeups = 0; ///< Bumped by the main thread after handling events, a change ends the sleeps of waitForFrame().
 
 	/**
  * @brief Initialize the window by creating a Window object.
@@ -53,20 +136,52 @@ private:
 	/**
 	 * @brief Initialize Vulkan objects and setup rendering pipeline.
 	 *
-	 * Creates Vulkan instance, device, swapchain, render pass,
-	 * uniform buffers, descriptor sets, pipeline, command pool,
-	 * depth resources, framebuffers, synchronization objects,
-	 * and loads a PBR model with textures.
+	 * Creates Vulkan instance, device, swapchain, uniform buffers,
+	 * descriptor sets, pipeline, command pool, render graph,
+	 * synchronization objects, and loads a PBR model with textures.
 	 */
 	void initVulkan();
 
 	/**
 	 * @brief Run the main application loop.
 	 *
-	 * Polls window events and draws frames continuously until the window is closed.
-	 * Waits for the device to finish before exiting.
+	 * Starts the render thread, then handles window events and advances the simulation on the main thread until
+	 * the window is closed, sleeping in glfwWaitEventsTimeout until input arrives or the next step is due.
+	 * Joins the render thread and waits for the device to finish before exiting.
+	 * @throws Rethrows the exception that ended the render thread.
 	 */
 	void mainLoop();
+
+	/**
+	 * @brief Draw frames until the main thread stops the render thread, runs on the render thread.
+	 *
+	 * Handles the render settings picked with the keyboard and prints the stats once a second.
+	 */
+	void renderLoop();
+
+	/**
+	 * @brief Blocks the render thread until a frame should be drawn.
+	 *
+	 * Sleeps while the window is minimized, draws at most BACKGROUND_FRAME_RATE frames per second while it doesn't
+	 * have the focus (GLFW reports no occlusion, a covered window is throttled once it lost the focus), and in render
+	 * on demand mode sleeps until something changed: input, a window event or Window::requestRedraw(), a simulation
+	 * step that moved something, or a pipeline variant finishing its compile. That applies whether the animation is
+	 * paused or not, a running animation is drawn once per step instead of once per display refresh. The sleeps end
+	 * when the main thread handled new events or published a step, changes without an event (compiles) are noticed
+	 * within IDLE_WAIT_TIMEOUT.
+	 * @return false if the render thread was stopped while waiting.
+	 */
+	bool waitForFrame();
+
+	/**
+	 * @brief Wakes the render thread if it sleeps in waitForFrame(), called by the main thread after handling events.
+	 */
+	void wakeRenderThread();
+
+	/**
+	 * @brief Stops and joins the render thread.
+	 */
+	void stopRenderThread();
 	/**
  * @brief Render a single frame.
  *
@@ -78,9 +193,49 @@ private:
 	void drawFrame();
 
 	/**
-	 * @brief Update uniform buffers for the current frame.
+	 * @brief Interpolate the latest simulation snapshot for this frame, copy it into the scene, fill the sorted draw list and write its instances.
+	 *
+	 * The draw list is only rebuilt when the scene version changed, or the camera did while culling on the CPU, and
+	 * the instances are only written to slots holding an older list. Every change that alters the recorded commands
+	 * bumps m_sceneVersion explicitly, unchanged frames replay their command buffers.
+	 *
+	 * With GPU culling the AVX2 culling is skipped and every visible entity is a candidate, so the list doesn't
+	 * depend on the camera: moving the camera over a static scene builds nothing and uploads nothing, the culling
+	 * shaders only get the new frustum. The stats print the update time and how many frames built a list, to
+	 * compare against VULKAN_APP_GPU_CULLING=0.
+	 * @return Whether the draw list was built again.
+	 */
+	bool update();
+
+	/**
+	 * @brief Fills m_visibleEntities with the enabled entities whose bounds intersect the frustum.
+	 *
+	 * Uses the camera update() samples with a frustum widened for the turns latchCamera() still allows, so objects
+	 * the late-latched camera sees aren't culled. Unused with GPU culling, which tests the latched frustum itself.
+	 * @param viewProjection Projection * view matrix of the widened camera.
 	 */
-	void update();
+	void cullScene(const glm::mat4& viewProjection);
+
+	/**
+	 * @brief Adds static barrels in a grid in front of the animated one, for VULKAN_APP_BARRELS.
+	 * @param count Number of barrels added.
+	 */
+	void addBarrelGrid(uint32_t count);
+
+	/**
+	 * @brief Samples the camera and writes it to the current frame's uniform buffer.
+	 *
+	 * With the late latch this runs right before the submit, after the command buffer was recorded or picked for
+	 * replay: the commands only reference the persistently mapped uniform buffer, so the camera can change up to
+	 * the submit without re-recording. The mouse look is sampled again, so the frame shows the newest pose instead
+	 * of the one from before recording.
+	 *
+	 * With GPU culling the simulation snapshot is re-read too, and the frustum the culling shaders test is written
+	 * from the same camera. Culled on the CPU, the recorded draws only hold what the widened frustum of cullScene()
+	 * saw: the simulation camera of the culling is kept and the look only turns up to MAX_LATCH_LOOK_DELTA past it,
+	 * larger turns show in the next frame.
+	 */
+	void latchCamera();
 	/**
  * @brief Cleanup Vulkan and window resources.
  *
@@ -89,19 +244,56 @@ private:
  */
 	void cleanup();
 	/**
- * @brief Create synchronization objects (semaphores and fences) used for rendering frames.
+ * @brief Create synchronization objects (semaphores and the GPU timeline) used for rendering frames.
  *
- * Creates MAX_FRAMES_IN_FLIGHT semaphores for image availability and render completion,
- * and fences to ensure CPU-GPU synchronization.
+ * Creates MAX_FRAMES_IN_FLIGHT binary semaphores for image availability and render completion,
+ * so the frames in flight can change at runtime, and the timeline the CPU waits on for each slot.
  * Throws runtime_error if creation fails.
  */
 	void createSyncObjects();
 	/**
+ * @brief Change the number of frames in flight.
+ *
+ * Waits for every frame slot to retire, after that any slot can come next.
+ * @param count New number of frames in flight, clamped to 1..MAX_FRAMES_IN_FLIGHT.
+ */
+	void setFramesInFlight(uint32_t count);
+	/**
+ * @brief Switch to another present mode, recreating the swapchain.
+ *
+ * @param presentMode Preferred present mode, FIFO is used if the surface doesn't support it.
+ */
+	void setPresentMode(VkPresentModeKHR presentMode);
+	/**
+ * @brief Switch to the next present mode the surface supports (FIFO, FIFO relaxed, mailbox, immediate).
+ */
+	void cyclePresentMode();
+	/**
+ * @brief Switch to the next frame rate limit (unlimited, 144, 60, 30 fps).
+ */
+	void cycleFrameLimit();
+	/**
+ * @brief Declare the passes of a frame and compile the render graph for the swapchain extent.
+ *
+ * The forward pass clears and draws into the swapchain image and a transient depth buffer,
+ * the graph derives the layout transitions and barriers between them. With occlusion culling,
+ * the depth pyramid is reduced from its depth and a second forward pass draws what the late
+ * culling phase found, then the transparent batches, which blend over the opaque draws of both phases.
+ */
+	void buildRenderGraph();
+	/**
+ * @brief Point the depth pyramid and the late culling phase at the compiled depth buffer.
+ */
+	void resizeDepthPyramid();
+	/**
+ * @brief Set the viewport, scissor and descriptor set the forward passes draw with.
+ */
+	void bindForwardState(VkCommandBuffer commandBuffer);
+	/**
  * @brief Record commands into a command buffer for rendering a frame.
  *
- * Records commands to begin render pass, bind pipeline,
- * set viewport and scissor, bind buffers and descriptor sets,
- * draw the model, and end the render pass.
+ * Imports the swapchain image into the render graph and records its passes,
+ * each preceded by the barriers the graph computed for it.
  *
  * @param commandBuffer The Vulkan command buffer to record commands into.
  * @param imageIndex The index of the swapchain image to render to.
@@ -111,8 +303,23 @@ private:
 	/**
  * @brief Handle window resize events.
  *
- * Waits for the window framebuffer to be non-zero size,
- * then recreates the swapchain and related resources.
+ * Recreates the swapchain and related resources without waiting for the device,
+ * the old ones are retired to the deletion queue. While the framebuffer is empty (minimized)
+ * the recreation is deferred to the next frame instead of blocking here.
  */
 	void windowResize();
+
+	/**
+	 * @brief Allocates one cached command buffer per frame slot and swap chain image, all of them need recording.
+	 *
+	 * Command buffers are only reallocated when the image count changed, the old ones go through the deletion queue.
+	 *
+	 * A command buffer records the swap chain image and the slot's descriptor set, and only the slot can have it pending.
+	 */
+	void resizeCommandCache();
+
+	/**
+	 * @brief Index of the cached command buffer of a frame slot and swap chain image.
+	 */
+	uint32_t getCommandTarget(uint32_t frame, uint32_t imageIndex) const;
 };
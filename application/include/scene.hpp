@@ -0,0 +1,184 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <cstdint>
+#include "bounds.hpp"
+
+using Entity = uint32_t; ///< Stable handle of a scene entity, unlike its index in the arrays it survives reordering.
+
+constexpr Entity INVALID_ENTITY = UINT32_MAX; ///< Parent of root entities.
+constexpr uint32_t NO_MODEL = UINT32_MAX; ///< Model index of entities that draw nothing.
+constexpr uint32_t NO_MATERIAL_OVERRIDE = UINT32_MAX; ///< Material index of entities drawn with their model's own materials.
+
+/**
+ * @class Scene
+ * @brief Entities stored as structure of arrays, with world transforms updated only where something moved.
+ *
+ * Every property is its own array indexed by the entity's dense index, so a pass over one property streams
+ * through memory instead of striding over whole entities. The arrays are kept in depth-first order: a parent
+ * comes before its children and every subtree is one contiguous range, whose end is stored per entity.
+ * Changing a local transform queues the entity's subtree range. updateTransforms() merges the queued ranges and
+ * walks only them, so its cost is linear in the number of dirty entities whatever the size of the scene.
+ * The constant depends on how the edits are spread: a whole subtree streams through the arrays (about 40 ns per
+ * entity in SceneBenchmark), while isolated entities scattered over a large scene touch some twenty cache lines
+ * each, one per property array, and cost about ten times that (about 450 ns for 10k random leaves of a million
+ * entities). The ranges are sorted and merged before the walk, sorting is a tenth of that time and prefetching
+ * the next ranges didn't help, the misses themselves dominate. Scenes that move many unrelated entities every
+ * frame should keep them close together, e.g. by creating them under a common parent.
+ * Local matrices are composed four entities at a time with SSE (scalar where it isn't available) and multiplied
+ * by their parent's world matrix, which the order guarantees to be up to date already.
+ *
+ * Entity handles stay valid when the arrays are reordered, which happens when a child is added to a parent
+ * whose subtree isn't at the end of the arrays (adding roots, or children in depth-first order, never reorders).
+ */
+class Scene {
+public:
+	/**
+	 * @brief Reserves room for a number of entities, avoids reallocations while building large scenes.
+	 */
+	void reserve(size_t entityCount);
+
+	/**
+	 * @brief Adds an entity with an identity transform, drawing nothing.
+	 * @param parent Entity the new one is attached to, INVALID_ENTITY for a root.
+	 * @throws std::runtime_error if the parent doesn't exist.
+	 */
+	Entity createEntity(Entity parent = INVALID_ENTITY);
+
+	/**
+	 * @brief Sets the transform of an entity relative to its parent, does nothing if it didn't change.
+	 */
+	void setLocalTransform(Entity entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+	/**
+	 * @brief Makes an entity draw a model.
+	 * @param model Index of the model in the renderer's model list, NO_MODEL to draw nothing.
+	 * @param localBounds Bounds of the model in its object space, the world bounds follow the entity's transform.
+	 * @param material Material table index replacing the model's materials, NO_MATERIAL_OVERRIDE to keep them.
+	 */
+	void setRenderable(Entity entity, uint32_t model, const BoundingBox& localBounds, uint32_t material = NO_MATERIAL_OVERRIDE);
+
+	/**
+	 * @brief Shows or hides an entity, hidden entities emit no draws but keep updating their transforms.
+	 */
+	void setVisible(Entity entity, bool visible);
+
+	/**
+	 * @brief Recomputes the world matrices and bounds of every queued subtree.
+	 * @return Number of entities updated.
+	 */
+	uint32_t updateTransforms();
+
+	size_t getEntityCount() const { return m_entities.size(); }
+
+	/// Bumped by every call that changes what the scene draws: new entities, moves, models and visibility. Equal versions mean nothing changed.
+	uint64_t getVersion() const { return m_version; }
+
+	/// Like getVersion() but not bumped by moves, equal versions mean the same entities draw the same models.
+	uint64_t getStructureVersion() const { return m_structureVersion; }
+
+	/// Dense index of an entity, the index into the arrays below. Changes when the arrays are reordered.
+	uint32_t getIndex(Entity entity) const { return m_indices[entity]; }
+
+	const glm::mat4& getWorldMatrix(Entity entity) const { return m_worldMatrices[m_indices[entity]]; }
+
+	// Arrays indexed by the dense index, valid after updateTransforms().
+	const std::vector<Entity>& getEntities() const { return m_entities; }
+	const std::vector<uint32_t>& getParents() const { return m_parents; } ///< Dense index of each parent, UINT32_MAX for roots.
+	const std::vector<glm::mat4>& getWorldMatrices() const { return m_worldMatrices; }
+	const std::vector<uint32_t>& getModels() const { return m_models; }
+	const std::vector<uint32_t>& getMaterials() const { return m_materials; }
+	const std::vector<uint8_t>& getVisibility() const { return m_visible; }
+	const std::vector<float>& getBoundsCenterX() const { return m_boundsCenterX; } ///< World bounding sphere centers.
+	const std::vector<float>& getBoundsCenterY() const { return m_boundsCenterY; }
+	const std::vector<float>& getBoundsCenterZ() const { return m_boundsCenterZ; }
+	const std::vector<float>& getBoundsRadius() const { return m_boundsRadius; } ///< World bounding sphere radii.
+	const std::vector<float>& getBoundsExtentX() const { return m_boundsExtentX; } ///< Half sizes of the world bounding boxes, centered on the spheres.
+	const std::vector<float>& getBoundsExtentY() const { return m_boundsExtentY; }
+	const std::vector<float>& getBoundsExtentZ() const { return m_boundsExtentZ; }
+private:
+	static constexpr uint32_t NO_PARENT = UINT32_MAX; ///< Dense parent index of roots.
+
+	/**
+	 * @struct DirtyRange
+	 * @brief Dense index range of a subtree whose world transforms are stale.
+	 */
+	struct DirtyRange {
+		uint32_t first; ///< Root of the subtree.
+		uint32_t last; ///< One past the last entity of the subtree.
+	};
+
+	// local transform, written by setLocalTransform()
+	std::vector<float> m_positionX; ///< Position relative to the parent.
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	std::vector<float> m_rotationX; ///< Rotation relative to the parent, a unit quaternion.
+	std::vector<float> m_rotationY;
+	std::vector<float> m_rotationZ;
+	std::vector<float> m_rotationW;
+	std::vector<float> m_scaleX; ///< Scale along the local axes.
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+
+	// hierarchy
+	std::vector<uint32_t> m_parents; ///< Dense index of the parent, always lower than the entity's, NO_PARENT for roots.
+	std::vector<uint32_t> m_subtreeEnds; ///< One past the dense index of the entity's last descendant.
+	std::vector<Entity> m_entities; ///< Handle of the entity at each dense index.
+	std::vector<uint32_t> m_indices; ///< Dense index of each handle.
+
+	// results of updateTransforms()
+	std::vector<glm::mat4> m_worldMatrices; ///< Object to world transform.
+	std::vector<float> m_boundsCenterX; ///< World bounding sphere center, separate arrays so culling can test several at once.
+	std::vector<float> m_boundsCenterY;
+	std::vector<float> m_boundsCenterZ;
+	std::vector<float> m_boundsRadius; ///< World bounding sphere radius.
+	std::vector<float> m_boundsExtentX; ///< Half size of the world axis aligned bounding box, tighter than the sphere for long objects.
+	std::vector<float> m_boundsExtentY;
+	std::vector<float> m_boundsExtentZ;
+
+	// rendering
+	std::vector<uint32_t> m_models; ///< Model drawn by the entity, NO_MODEL if none.
+	std::vector<uint32_t> m_materials; ///< Material override, NO_MATERIAL_OVERRIDE if none.
+	std::vector<uint8_t> m_visible; ///< Whether the entity emits draws.
+	std::vector<glm::vec4> m_localBounds; ///< Bounding sphere in object space, center in xyz and radius in w.
+	std::vector<glm::vec3> m_localExtents; ///< Half size of the bounding box in object space, centered on the sphere.
+
+	std::vector<DirtyRange> m_dirtyRanges; ///< Subtrees queued since the last update, unsorted and possibly nested.
+	std::vector<uint8_t> m_queued; ///< Whether the entity's subtree is in m_dirtyRanges, so setting it again doesn't queue it twice.
+	bool m_reorderPending = false; ///< Set when an added child broke the depth-first order, the next update sorts and updates everything.
+	uint64_t m_version = 0; ///< Returned by getVersion().
+	uint64_t m_structureVersion = 0; ///< Returned by getStructureVersion().
+
+	/**
+	 * @brief Queues the subtree of an entity for the next update.
+	 */
+	void markDirty(uint32_t index);
+
+	/**
+	 * @brief Restores the depth-first order of the arrays and recomputes the subtree ends.
+	 */
+	void sortHierarchy();
+
+	/**
+	 * @brief Recomputes the world matrices and bounds of a dense index range, parents of the range must be up to date.
+	 */
+	void updateRange(uint32_t first, uint32_t last);
+
+	/**
+	 * @brief Writes the local matrix of one entity into its world matrix slot.
+	 */
+	void composeLocal(uint32_t index);
+
+	/**
+	 * @brief Writes the local matrices of four consecutive entities into their world matrix slots.
+	 */
+	void composeLocal4(uint32_t first);
+
+	/**
+	 * @brief Multiplies the local matrix in the world matrix slot by the parent's world matrix and updates the bounds.
+	 */
+	void finishWorld(uint32_t index);
+};
@@ -3,27 +3,37 @@
 #include <vulkan/vulkan.h>
 #include <stdexcept>
 #include <vector>
-#include <fstream>
+#include <span>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include "mappedFile.hpp"
+#include "log.hpp"
 /**
  * @namespace ShaderManager
  * @brief Utility functions for Vulkan shader module management.
  */
 namespace ShaderManager {
+	/// Environment variable naming a directory of <shader>.spv files that replace the embedded SPIR-V.
+	static const char* const OVERRIDE_DIRECTORY_VARIABLE = "VULKAN_APP_SHADER_DIR";
+
 	/**
-	* @brief Creates a Vulkan shader module from SPIR-V bytecode.
+	* @brief Creates a Vulkan shader module from SPIR-V words.
 	*
-	* @param code A vector containing the SPIR-V bytecode.
+	* @param code The SPIR-V code, used in place (no copy).
 	* @param device The Vulkan logical device handle.
 	* @return VkShaderModule The created Vulkan shader module.
 	*
 	* @throws std::runtime_error if shader module creation fails.
 	*/
-	static VkShaderModule createShaderModule(const std::vector<char>& code, const VkDevice& device) {
+	static VkShaderModule createShaderModule(std::span<const uint32_t> code, const VkDevice& device) {
 
 		VkShaderModuleCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+		createInfo.codeSize = code.size_bytes();
+		createInfo.pCode = code.data();
 
 		VkShaderModule shaderModule;
 		if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -41,26 +51,31 @@ namespace ShaderManager {
 		vkDestroyShaderModule(logicalDevice, shaderModule, nullptr);
 	}
 	/**
-	 * @brief Reads a binary file into a vector of bytes.
+	 * @brief Creates a shader module from the SPIR-V embedded at build time, or from an override file.
+	 *
+	 * If OVERRIDE_DIRECTORY_VARIABLE is set and <directory>/<name>.spv exists, that file is memory-mapped
+	 * and used instead, which allows iterating on shaders without rebuilding.
 	 *
-	 * @param filename The path to the file to read.
-	 * @return std::vector<char> Vector containing the file's byte data.
+	 * @param name Source file name of the shader (e.g. "shader.frag").
+	 * @param embedded The SPIR-V embedded for that shader (EmbeddedShaders::shaderFrag).
+	 * @param device The Vulkan logical device handle.
+	 * @return VkShaderModule The created Vulkan shader module.
 	 *
-	 * @throws std::runtime_error if the file cannot be opened.
+	 * @throws std::runtime_error if the override file isn't valid SPIR-V or shader module creation fails.
 	 */
-	static std::vector<char> readFile(const std::string& filename) {
-		std::ifstream file(filename, std::ios::ate | std::ios::binary); // open the file in binary mode at end of file
-
-		if (!file.is_open()) {
-			throw std::runtime_error("failed to open file!");
+	static VkShaderModule loadShaderModule(const std::string& name, std::span<const uint32_t> embedded, const VkDevice& device) {
+		const char* overrideDirectory = std::getenv(OVERRIDE_DIRECTORY_VARIABLE);
+		if (overrideDirectory != nullptr) {
+			std::filesystem::path overridePath = std::filesystem::path(overrideDirectory) / (name + ".spv");
+			if (std::filesystem::exists(overridePath)) {
+				MappedFile file(overridePath.string()); // page aligned, so the words can be used in place
+				if (file.getSize() % sizeof(uint32_t) != 0) {
+					throw std::runtime_error("failed to load " + overridePath.string() + ", not a SPIR-V binary!");
+				}
+				Log::info() << "shader override: " << overridePath.string() << std::endl;
+				return createShaderModule({ static_cast<const uint32_t*>(file.getData()), file.getSize() / sizeof(uint32_t) }, device); // the driver copies the code
+			}
 		}
-		size_t fileSize = (size_t)file.tellg(); // get the size of the file
-		std::vector<char> buffer(fileSize); // create a buffer of the size of the file
-
-		file.seekg(0); // go back to the beginning of the file
-		file.read(buffer.data(), fileSize); // read the file into the buffer
-
-		file.close();
-		return buffer;
+		return createShaderModule(embedded, device);
 	}
 }
\ No newline at end of file
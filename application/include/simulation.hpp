@@ -0,0 +1,172 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "tripleBuffer.hpp"
+
+/**
+ * @struct ObjectState
+ * @brief Placement and visibility of a scene object at one simulation step.
+ */
+struct ObjectState {
+	glm::vec3 position{ 0.0f }; ///< Position in world space.
+	glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f }; ///< Orientation in world space.
+	glm::vec3 scale{ 1.0f }; ///< Scale along the object axes.
+	bool visible = true; ///< Hidden objects emit no draws.
+};
+
+/**
+ * @struct CameraState
+ * @brief Camera of the scene at one simulation step.
+ */
+struct CameraState {
+	glm::vec3 eye{ 0.0f }; ///< Camera position in world space.
+	glm::vec3 target{ 0.0f, 0.0f, 1.0f }; ///< Point the camera looks at.
+	glm::vec3 up{ 0.0f, 1.0f, 0.0f }; ///< Up direction of the camera.
+	float fovY = glm::radians(45.0f); ///< Vertical field of view in radians.
+
+	/// World to view transform.
+	glm::mat4 getView() const;
+
+	/**
+	 * @brief View to clip transform, with y flipped for Vulkan.
+	 * @param aspect Width divided by height of the image.
+	 */
+	glm::mat4 getProjection(float aspect) const;
+
+	/**
+	 * @brief Like getProjection() with both fields of view widened, for culling views that may still turn.
+	 * @param aspect Width divided by height of the image.
+	 * @param margin Radians added to each half angle, capped below 90 degrees.
+	 */
+	glm::mat4 getWidenedProjection(float aspect, float margin) const;
+
+	/**
+	 * @brief Turns the view direction around the eye, the eye stays in place.
+	 * @param yaw Radians to the right, around the up direction.
+	 * @param pitch Radians upwards, applied before the yaw.
+	 */
+	void look(float yaw, float pitch);
+
+	/**
+	 * @brief Blends two cameras linearly.
+	 */
+	static void interpolate(const CameraState& from, const CameraState& to, float alpha, CameraState& result);
+};
+
+/**
+ * @struct SceneState
+ * @brief Everything the render thread needs from one simulation step.
+ */
+struct SceneState {
+	std::vector<ObjectState> objects; ///< Indexed like the scene objects of the renderer.
+	CameraState camera; ///< Camera of the step.
+
+	/**
+	 * @brief Blends two steps, positions and scales linearly and rotations spherically.
+	 * @param alpha 0 gives from, 1 gives to. Visibility switches at the end of the step.
+	 */
+	static void interpolate(const SceneState& from, const SceneState& to, float alpha, SceneState& result);
+};
+
+/**
+ * @struct SimulationSnapshot
+ * @brief The two latest simulation steps, published to the render thread through a TripleBuffer.
+ */
+struct SimulationSnapshot {
+	SceneState previous; ///< State of the step before current.
+	SceneState current; ///< State of the latest step.
+	std::chrono::steady_clock::time_point currentTime; ///< Time the latest step belongs to, interpolation blends towards it.
+	uint64_t step = 0; ///< Number of steps simulated so far.
+	uint64_t version = 0; ///< Bumped by every step that moved something and by pausing, equal versions interpolate to the same scene.
+	bool paused = false; ///< Whether the animation is paused, previous and current are then equal.
+};
+
+/**
+ * @class Simulation
+ * @brief Advances the scene at a fixed timestep on the main thread and publishes it to the render thread.
+ *
+ * advance() runs the steps that are due, so the simulation runs at the same rate whatever the frame rate, and
+ * publishes the last two steps without ever waiting for the render thread. The render thread blends them
+ * with interpolate() at the time it renders, which shows the scene one step late but moving smoothly even
+ * when frames and steps don't line up.
+ */
+class Simulation {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Creates the initial state and publishes it.
+	 * @param timestep Simulated seconds per step.
+	 * @param start Time of the initial state.
+	 */
+	Simulation(double timestep, Clock::time_point start);
+
+	/**
+	 * @brief Runs the steps due by now and publishes the result, main thread only.
+	 *
+	 * After a stall longer than MAX_SIMULATION_STEPS steps the missing time is dropped instead of caught up.
+	 * @return Time the next step is due.
+	 */
+	Clock::time_point advance(Clock::time_point now);
+
+	/**
+	 * @brief Pauses or resumes the animation, main thread only.
+	 */
+	void togglePause();
+
+	bool isPaused() const { return m_paused; }
+
+	/**
+	 * @brief Latest published snapshot, render thread only.
+	 *
+	 * Never blocks. The reference stays valid until the next call.
+	 */
+	const SimulationSnapshot& acquireSnapshot();
+
+	/**
+	 * @brief Blends the two steps of a snapshot for the given time.
+	 * @param snapshot Snapshot from acquireSnapshot().
+	 * @param now Time the frame is rendered.
+	 * @param result Interpolated state, reuses its storage across frames.
+	 */
+	void interpolate(const SimulationSnapshot& snapshot, Clock::time_point now, SceneState& result) const;
+
+	/**
+	 * @brief Blends only the camera of a snapshot, for sampling it again late in the frame.
+	 */
+	void interpolateCamera(const SimulationSnapshot& snapshot, Clock::time_point now, CameraState& result) const;
+
+	double getTimestep() const { return m_timestep.count(); }
+private:
+	std::chrono::duration<double> m_timestep; ///< Simulated time per step.
+	Clock::time_point m_nextStep; ///< When the next step is due.
+	Clock::time_point m_currentTime; ///< Time the latest step belongs to.
+	SceneState m_previous; ///< State before the latest step.
+	SceneState m_current; ///< State after the latest step.
+	uint64_t m_step = 0; ///< Steps simulated so far.
+	uint64_t m_version = 0; ///< Published as SimulationSnapshot::version.
+	float m_animationTime = 0.0f; ///< Seconds of animation, doesn't advance while paused.
+	bool m_paused = false; ///< Toggled with P.
+
+	TripleBuffer<SimulationSnapshot> m_snapshots; ///< Written by the main thread, read by the render thread.
+
+	/**
+	 * @brief How far the render time is from the snapshot's previous step towards its current one, between 0 and 1.
+	 */
+	float getBlendFactor(const SimulationSnapshot& snapshot, Clock::time_point now) const;
+
+	/**
+	 * @brief Advances the state by one timestep.
+	 */
+	void step();
+
+	/**
+	 * @brief Copies the last two steps into the write buffer and publishes it.
+	 */
+	void publish();
+};
@@ -3,6 +3,7 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include "imageUtils.hpp"
+#include "deletionQueue.hpp"
 #include <GLFW/glfw3.h>
 #include <algorithm>
 
@@ -49,12 +50,25 @@ namespace SwapChain{
 
 		return details;
 	}
+
+	/**
+	 * @brief Short name of a present mode, for the stats output and the VULKAN_APP_PRESENT_MODE environment variable.
+	 */
+	static const char* presentModeName(VkPresentModeKHR presentMode) {
+		switch (presentMode) {
+		case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+		case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+		case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo_relaxed";
+		default: return "other";
+		}
+	}
 }
 
 
 /**
  * @class VKSwapChain
- * @brief Encapsulates Vulkan swap chain creation, image views, framebuffers, and depth resources management.
+ * @brief Encapsulates Vulkan swap chain creation and image views management.
  */
 class VKSwapChain { 
 public:
@@ -63,26 +77,42 @@ public:
  * @param surface Reference to the Vulkan surface.
  * @param physicalDevice Vulkan physical device handle.
  * @param device Vulkan logical device handle.
- * @param window Pointer to the GLFW window.
+ * @param window Pointer to the GLFW window, its framebuffer size is queried once here (on the main thread).
+ * @param presentMode Preferred present mode, FIFO is used if the surface doesn't support it.
  */
-	VKSwapChain(VkSurfaceKHR& surface, VkPhysicalDevice physicalDevice, VkDevice device, GLFWwindow* window);
+	VKSwapChain(VkSurfaceKHR& surface, VkPhysicalDevice physicalDevice, VkDevice device, GLFWwindow* window, VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR);
 	
 	/**
-	 * @brief Cleans up swap chain resources such as image views, framebuffers, depth buffer and the swap chain itself.
+	 * @brief Cleans up swap chain resources such as image views and the swap chain itself.
 	 */
 	void cleanupSwapChain();
 
 	/**
-	 * @brief Creates framebuffers for each swap chain image view with the given render pass and depth image view.
-	 * @param renderPass The Vulkan render pass to use.
-	 * @param depthImageView The depth image view to attach.
+	 * @brief Creates the Vulkan swap chain based on the surface and physical device capabilities.
+	 * @param surface The Vulkan surface for presentation.
+	 * @param oldSwapChain Swap chain being replaced, lets the driver reuse its resources and keep presenting.
 	 */
-	void createFrameBuffers(VkRenderPass renderPass, VkImageView depthImageView);
+	void createSwapChain(VkSurfaceKHR surface, VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+
 	/**
-	 * @brief Creates the Vulkan swap chain based on the surface and physical device capabilities.
+	 * @brief Replaces the swap chain without waiting for the device, e.g. after a resize.
+	 *
+	 * The new swap chain is created with the current one as oldSwapchain. The old swap chain and its image
+	 * views are destroyed through the deletion queue once the frames that may still use them completed.
 	 * @param surface The Vulkan surface for presentation.
+	 * @param framebufferExtent Framebuffer size of the window, used when the surface leaves the extent to the swap chain.
+	 * @param deletionQueue Queue the old swap chain and image views are retired to.
+	 * @param retireValue Timeline value of the last submission rendering to the old images.
+	 */
+	void recreateSwapChain(VkSurfaceKHR surface, VkExtent2D framebufferExtent, DeletionQueue& deletionQueue, uint64_t retireValue);
+
+	/**
+	 * @brief Sets the preferred present mode, used from the next recreateSwapChain().
 	 */
-	void createSwapChain(VkSurfaceKHR surface);
+	void setPresentMode(VkPresentModeKHR presentMode) { m_requestedPresentMode = presentMode; }
+
+	/// Present mode of the current swap chain, differs from the preferred one if the surface doesn't support it.
+	VkPresentModeKHR getPresentMode() const { return m_presentMode; }
 	/**
 	 * @brief Creates image views for each image in the swap chain.
 	 */
@@ -100,22 +130,10 @@ public:
 	std::vector<VkImageView> getSwapChainImageViews() {
 		return m_swapChainImageViews;
 	}
-	std::vector<VkFramebuffer> getSwapChainFramebuffers() {
-		return m_swapChainFramebuffers;
-	}
-
-	VkImageView getDepthImageView() {
-		return m_depthImageView;
+	const std::vector<VkImage>& getSwapChainImages() const {
+		return m_swapChainImages;
 	}
 
-	/**
-	* @brief Creates depth buffer resources including the image, memory, and image view.
-	* @param commandPool Command pool used for layout transitions.
-	* @param queue Queue used for submitting commands.
-	*/
-	void createDepthResources(VkCommandPool commandPool, VkQueue queue);
-
-
 	/**
 	 * @brief Finds a suitable depth format supported by the physical device.
 	 * @return The chosen VkFormat for depth buffering.
@@ -125,8 +143,7 @@ private:
 	// api members
 	VkDevice m_device; ///< Vulkan logical device handle.
 	VkPhysicalDevice m_physicalDevice; ///< Vulkan physical device handle.
-	VkRenderPass m_renderPass; ///< Vulkan render pass handle.
-	GLFWwindow* m_window; ///< Pointer to the GLFW window for rendering context.
+	VkExtent2D m_framebufferExtent; ///< Framebuffer size of the window, passed in so the render thread never calls GLFW.
 
 	// swapchain members
 	VkSwapchainKHR m_swapChain; ///< Vulkan swap chain handle.
@@ -134,12 +151,8 @@ private:
 	VkFormat m_swapChainImageFormat; ///< Format of the swap chain images. 
 	VkExtent2D m_swapChainExtent; ///< Extent (resolution) of the swap chain images.
 	std::vector<VkImageView> m_swapChainImageViews; ///< Vector of image views for each swap chain image.
-	std::vector<VkFramebuffer> m_swapChainFramebuffers; ///< Vector of framebuffers for each swap chain image view.
-
-	// depth buffering
-	VkImage m_depthImage;
-	VkDeviceMemory m_depthImageMemory;
-	VkImageView m_depthImageView;
+	VkPresentModeKHR m_requestedPresentMode; ///< Preferred present mode.
+	VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR; ///< Present mode of the current swap chain.
 	/**
 	* @brief Chooses the best surface format from available formats.
 	* @param availableFormats Vector of available VkSurfaceFormatKHR.
@@ -147,18 +160,17 @@ private:
 	*/
 	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
 	/**
-	 * @brief Chooses the best present mode from available modes.
+	 * @brief Chooses the preferred present mode if available, FIFO (always supported) otherwise.
 	 * @param availablePresentModes Vector of available VkPresentModeKHR.
 	 * @return The chosen VkPresentModeKHR.
 	 */
 	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
 	/**
 	 * @brief Chooses the swap extent (resolution) for the swap chain images.
-	 * @param capabilities Surface capabilities to respect.
-	 * @param window GLFW window to query framebuffer size if needed.
+	 * @param capabilities Surface capabilities to respect, the framebuffer size is used if they leave it open.
 	 * @return VkExtent2D chosen extent.
 	 */
-	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window);
+	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
 	/**
 	 * @brief Finds a supported format from a list of candidates with desired tiling and features.
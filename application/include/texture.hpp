@@ -3,7 +3,20 @@
 #include <vulkan/vulkan.h>
 #include "bufferUtils.hpp"
 #include "imageUtils.hpp"
+#include "deletionQueue.hpp"
 #include <stb_image.h>
+#include <string>
+#include <memory>
+
+/**
+ * @struct DecodedImage
+ * @brief RGBA8 pixels decoded from an image file, freed with stb_image.
+ */
+struct DecodedImage {
+	std::unique_ptr<stbi_uc, void(*)(void*)> pixels{ nullptr, stbi_image_free }; ///< Tightly packed RGBA8 pixel data.
+	uint32_t width = 0; ///< Width of the image in pixels.
+	uint32_t height = 0; ///< Height of the image in pixels.
+};
 
 /**
  * @class Texture
@@ -21,12 +34,32 @@ class Texture {
 	 * @param commandPool Command pool for submitting copy/transition commands.
 	 * @param queue Vulkan queue for executing commands.
 	 * @param path Path to the image file to load.
+	 * @param format Format of the texture image (sRGB for colour data, UNORM for normals, roughness, etc.).
+	 */
+		Texture(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const std::string& path, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+		/**
+	 * @brief Constructs a Texture object from RGBA8 pixels already in memory.
+	 * @param device Vulkan logical device.
+	 * @param physicalDevice Vulkan physical device.
+	 * @param commandPool Command pool for submitting copy/transition commands.
+	 * @param queue Vulkan queue for executing commands.
+	 * @param pixels Tightly packed RGBA8 pixel data.
+	 * @param width Width of the image in pixels.
+	 * @param height Height of the image in pixels.
+	 * @param format Format of the texture image.
+	 */
+		Texture(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const unsigned char* pixels, uint32_t width, uint32_t height, VkFormat format);
+		/**
+	 * @brief Queues the image, memory, image view and sampler for destruction once the GPU no longer uses them.
 	 */
-		Texture(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const char* path);
+		void destroyTexture(DeletionQueue& deletionQueue);
+
 		/**
-	 * @brief Frees texture-related Vulkan resources including image, memory, image view, and sampler.
+	 * @brief Decodes an image file to RGBA8 without touching Vulkan, so several files can be decoded on worker threads.
+	 * @param path Path to the image file.
+	 * @throws std::runtime_error If the file can't be decoded.
 	 */
-		void destroyTexture();
+		static DecodedImage decode(const std::string& path);
 
 		VkImageView getTextureImageView() const {
 			return m_textureImageView; // getter for the texture image view
@@ -41,7 +74,8 @@ class Texture {
 		VkCommandPool m_commandPool; ///< Command pool for submitting commands.
 		VkQueue m_queue; ///< Vulkan queue for executing commands.
 
-		const char* m_texturePath; ///< Path to the texture image file.
+		std::string m_texturePath; ///< Path to the texture image file.
+		VkFormat m_format = VK_FORMAT_R8G8B8A8_SRGB; ///< Format of the texture image.
 
 		VkImage m_textureImage; // Vulkan image handle for the texture.
 		VkDeviceMemory m_textureImageMemory; // Memory allocated for the texture image.
@@ -51,10 +85,17 @@ class Texture {
 
 		/**
 		* @brief Loads the image from disk and creates a Vulkan image from it.
-		*        This includes staging buffer creation and memory transfers.
 		* @throws std::runtime_error If image loading or Vulkan resource creation fails.
 		*/
 		void createTextureImage();
+		/**
+		* @brief Creates a Vulkan image from RGBA8 pixels.
+		*        This includes staging buffer creation and memory transfers.
+		* @param pixels Tightly packed RGBA8 pixel data.
+		* @param width Width of the image in pixels.
+		* @param height Height of the image in pixels.
+		*/
+		void createTextureImage(const unsigned char* pixels, uint32_t width, uint32_t height);
 		
 		/**
  * @brief Creates an image view for the texture image.
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class TripleBuffer
+ * @brief Hands the latest value from one writer thread to one reader thread without locks or waiting.
+ *
+ * The writer fills the back buffer and publish() swaps it with the middle buffer, the reader's update()
+ * swaps the middle buffer with the front buffer if something was published since. The middle index and a
+ * "fresh" bit share one atomic, so both sides only ever exchange it: neither side waits for the other, and
+ * values published faster than they're read are simply overwritten. Each side owns its buffer exclusively
+ * between swaps.
+ */
+template<typename T>
+class TripleBuffer {
+public:
+	/**
+	 * @brief Buffer the writer fills before publish(), writer thread only.
+	 *
+	 * Holds whatever was published two swaps ago, so a writer that only changes a few fields must rewrite all of them.
+	 */
+	T& write() { return m_buffers[m_back].value; }
+
+	/**
+	 * @brief Makes the write buffer the latest value, writer thread only.
+	 */
+	void publish() {
+		uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_back | FRESH_BIT), std::memory_order_acq_rel); // release the writes, acquire the buffer the reader let go of
+		m_back = previous & INDEX_MASK;
+	}
+
+	/**
+	 * @brief Switches the read buffer to the latest published value, reader thread only.
+	 * @return Whether a value was published since the last update().
+	 */
+	bool update() {
+		if (!(m_middle.load(std::memory_order_relaxed) & FRESH_BIT)) {
+			return false;
+		}
+		uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel); // clears the fresh bit
+		m_front = previous & INDEX_MASK;
+		return true;
+	}
+
+	/**
+	 * @brief Value read by the last update(), reader thread only.
+	 */
+	const T& read() const { return m_buffers[m_front].value; }
+private:
+	static constexpr uint8_t INDEX_MASK = 0x3;
+	static constexpr uint8_t FRESH_BIT = 0x4;
+
+	/**
+	 * @struct Slot
+	 * @brief A buffer on its own cache line, so the writer and the reader don't invalidate each other's.
+	 */
+	struct alignas(64) Slot {
+		T value{}; ///< The buffered value.
+	};
+
+	std::array<Slot, 3> m_buffers; ///< Back, middle and front buffer, their roles rotate.
+	uint8_t m_back = 0; ///< Buffer owned by the writer.
+	alignas(64) std::atomic<uint8_t> m_middle{ 1 }; ///< Buffer between the two sides, with FRESH_BIT set while it holds an unread value.
+	alignas(64) uint8_t m_front = 2; ///< Buffer owned by the reader.
+};
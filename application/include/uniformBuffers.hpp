@@ -5,26 +5,30 @@
 #include <glm/glm.hpp>
 #include "config.hpp"
 #include "bufferUtils.hpp"
+#include "deletionQueue.hpp"
+#include "simulation.hpp"
 #include <chrono>
 #include <glm/gtc/matrix_transform.hpp>
 
 /**
  * @struct UBO
- * @brief Represents a Uniform Buffer Object containing transformation matrices.
+ * @brief Represents a Uniform Buffer Object containing the per-frame camera and lighting data.
  *
- * This struct is used to pass transformation data to shaders.
+ * Per-object data (the model matrix and material) is read per instance, see InstanceBuffers.
  */
 struct UBO {
-	glm::mat4 model; ///< Model transformation matrix.
 	glm::mat4 view; ///< View transformation matrix.
 	glm::mat4 proj; ///< Projection transformation matrix.
+	glm::vec4 viewPos; ///< Camera position in world space (w unused).
+	glm::vec4 lightDirection; ///< Direction of the directional light in world space (w unused).
 };
 
 /**
  * @class UniformBuffers
  * @brief Manages Vulkan uniform buffers for each frame in flight.
  *
- * This class handles creation, destruction, and updating of per-frame uniform buffers used to store transformation matrices.
+ * This class handles creation, destruction, and updating of per-frame uniform buffers used to store the camera data.
+ * The buffers stay mapped and are host coherent, so the camera can be written right before the frame is submitted.
  */
 class UniformBuffers {
 public:
@@ -37,16 +41,17 @@ public:
 
 
 	/**
-	 * @brief Destroys all allocated uniform buffers and associated memory.
+	 * @brief Queues all uniform buffers and their memory for destruction once the GPU no longer uses them.
 	 */
-	void destroyUniformBuffers();
+	void destroyUniformBuffers(DeletionQueue& deletionQueue);
 
 	/**
- * @brief Updates the uniform buffer for the given frame index with transformation matrices.
+ * @brief Updates the uniform buffer for the given frame index with the camera matrices.
  * @param currentImage Index of the current swapchain image (frame in flight).
  * @param swapChainExtent Current swapchain extent (used to compute aspect ratio).
+ * @param camera Camera interpolated for the frame.
  */
-	void updateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExtent);
+	void updateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExtent, const CameraState& camera);
 
 	/**
 	 * @brief Retrieves the Vulkan buffer for a given frame index.
@@ -59,13 +64,18 @@ public:
 	std::vector<VkBuffer> getUniformBuffers() const {
 		return m_uniformBuffers;
 	}
+
+	/// Camera data written by the last updateUniformBuffer().
+	const UBO& getUBO() const {
+		return ubo;
+	}
 private:
 	std::vector<VkBuffer> m_uniformBuffers; ///< Vector of Vulkan uniform buffers for each frame in flight.
 	std::vector<VkDeviceMemory> m_uniformBuffersMemory; ///< Vector of memory allocated for each uniform buffer.
 	std::vector<void*> m_uniformBuffersMapped; ///< Vector of mapped pointers to each uniform buffer's memory.
 	VkDevice m_device; ///< Vulkan logical device handle.
 	VkPhysicalDevice m_physicalDevice; ///< Vulkan physical device handle.
-	UBO ubo; ///< Uniform Buffer Object containing transformation matrices.
+	UBO ubo; ///< Uniform Buffer Object containing the camera data.
 
 	/**
  * @brief Allocates and maps uniform buffers for all frames in flight.
@@ -2,10 +2,27 @@
 
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+#include "config.hpp"
+
+/**
+ * @struct LookAngles
+ * @brief Camera rotation dragged with the left mouse button, accumulated since startup.
+ */
+struct LookAngles {
+    float yaw = 0.0f; ///< Radians to the right.
+    float pitch = 0.0f; ///< Radians upwards, clamped to MAX_LOOK_PITCH.
+};
 
 /**
  * @class Window
  * @brief Manages GLFW window creation and Vulkan surface integration.
+ *
+ * GLFW calls the callbacks on the main thread while it polls events. Everything the render thread reads
+ * (the take functions other than takePauseToggle(), focus, minimized state, framebuffer size and the look
+ * angles) is atomic, so it never has to call into GLFW.
  */
 class Window {
 public:
@@ -24,7 +41,158 @@ public:
 
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
         auto appWindow = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
+        appWindow->framebufferWidth = width;
+        appWindow->framebufferHeight = height;
         appWindow->framebufferResized = true;
+        appWindow->redrawRequested = true;
+    }
+
+    static void focusCallback(GLFWwindow* window, int focused) {
+        auto appWindow = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
+        appWindow->focused = focused == GLFW_TRUE;
+        appWindow->redrawRequested = true;
+    }
+
+    static void iconifyCallback(GLFWwindow* window, int iconified) {
+        auto appWindow = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
+        appWindow->iconified = iconified == GLFW_TRUE;
+        appWindow->redrawRequested = true;
+    }
+
+    static void refreshCallback(GLFWwindow* window) { // the window contents were damaged, e.g. uncovered
+        reinterpret_cast<Window*>(glfwGetWindowUserPointer(window))->redrawRequested = true;
+    }
+
+    static void cursorPosCallback(GLFWwindow* window, double x, double y) {
+        auto appWindow = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
+        appWindow->redrawRequested = true;
+        if (appWindow->looking) { // dragging with the left button turns the camera
+            LookAngles angles = appWindow->lookAngles.load(std::memory_order_relaxed); // only this thread writes them
+            angles.yaw += static_cast<float>(x - appWindow->lastCursorX) * LOOK_SENSITIVITY;
+            angles.pitch = std::clamp(angles.pitch - static_cast<float>(y - appWindow->lastCursorY) * LOOK_SENSITIVITY, -MAX_LOOK_PITCH, MAX_LOOK_PITCH);
+            appWindow->lookAngles.store(angles, std::memory_order_relaxed);
+        }
+        appWindow->lastCursorX = x;
+        appWindow->lastCursorY = y;
+    }
+
+    static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+        auto appWindow = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
+        appWindow->redrawRequested = true;
+        if (button == GLFW_MOUSE_BUTTON_LEFT) {
+            appWindow->looking = action == GLFW_PRESS;
+            glfwGetCursorPos(window, &appWindow->lastCursorX, &appWindow->lastCursorY); // the drag starts here, not where the cursor last moved
+        }
+    }
+
+    static void scrollCallback(GLFWwindow* window, double x, double y) {
+        reinterpret_cast<Window*>(glfwGetWindowUserPointer(window))->redrawRequested = true;
+    }
+
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+        auto appWindow = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
+        appWindow->redrawRequested = true; // any input may change what is shown
+        if (action == GLFW_PRESS && key >= GLFW_KEY_1 && key < GLFW_KEY_1 + MAX_FRAMES_IN_FLIGHT) {
+            appWindow->framesInFlightRequest = static_cast<uint32_t>(key - GLFW_KEY_0); // number keys pick the frames in flight
+        }
+        if (action == GLFW_PRESS && key == GLFW_KEY_P) {
+            appWindow->pauseToggled = !appWindow->pauseToggled; // P pauses the animation
+        }
+        if (action == GLFW_PRESS && key == GLFW_KEY_M) {
+            appWindow->presentModeCycles++; // M switches to the next supported present mode
+        }
+        if (action == GLFW_PRESS && key == GLFW_KEY_L) {
+            appWindow->frameLimitCycles++; // L switches to the next frame rate limit
+        }
+        if (action == GLFW_PRESS && key == GLFW_KEY_O) {
+            appWindow->renderOnDemandToggles++; // O toggles render on demand
+        }
+    }
+
+    /**
+     * @brief Returns the frames in flight picked with the number keys since the last call, 0 if none was picked.
+     */
+    uint32_t takeFramesInFlightRequest() {
+        return framesInFlightRequest.exchange(0);
+    }
+
+    /**
+     * @brief Returns whether P was pressed an odd number of times since the last call, main thread only.
+     */
+    bool takePauseToggle() {
+        bool toggled = pauseToggled;
+        pauseToggled = false;
+        return toggled;
+    }
+
+    /**
+     * @brief Returns how often M was pressed since the last call.
+     */
+    uint32_t takePresentModeCycles() {
+        return presentModeCycles.exchange(0);
+    }
+
+    /**
+     * @brief Returns how often L was pressed since the last call.
+     */
+    uint32_t takeFrameLimitCycles() {
+        return frameLimitCycles.exchange(0);
+    }
+
+    /**
+     * @brief Returns whether O was pressed an odd number of times since the last call.
+     */
+    bool takeRenderOnDemandToggle() {
+        return renderOnDemandToggles.exchange(0) % 2 == 1;
+    }
+
+    /**
+     * @brief Returns the framebuffer resize reported since the last call.
+     */
+    bool takeFramebufferResized() {
+        return framebufferResized.exchange(false);
+    }
+
+    /**
+     * @brief Asks for a frame to be drawn and wakes the event loop, can be called from any thread (e.g. when an asset finished loading).
+     */
+    void requestRedraw() {
+        redrawRequested = true;
+        glfwPostEmptyEvent();
+    }
+
+    /**
+     * @brief Returns whether input, a window event or requestRedraw() asked for a frame since the last call.
+     */
+    bool takeRedrawRequest() {
+        return redrawRequested.exchange(false);
+    }
+
+    bool isFocused() const {
+        return focused;
+    }
+
+    /**
+     * @brief Whether nothing of the window can be seen: iconified or with an empty framebuffer.
+     */
+    bool isMinimized() const {
+        return iconified || framebufferWidth == 0 || framebufferHeight == 0;
+    }
+
+    /**
+     * @brief Latest camera rotation dragged with the mouse, can be read from any thread at any time.
+     *
+     * Both angles are stored in one atomic, so a reader never sees the yaw of one event with the pitch of another.
+     */
+    LookAngles getLookAngles() const {
+        return lookAngles.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Framebuffer size reported by the last resize event, 0 while minimized.
+     */
+    VkExtent2D getFramebufferExtent() const {
+        return { static_cast<uint32_t>(framebufferWidth.load()), static_cast<uint32_t>(framebufferHeight.load()) };
     }
 
     /**
@@ -46,6 +214,20 @@ private:
 	VkSurfaceKHR m_surface = nullptr;
     const uint32_t width = 1280;
     const uint32_t height = 720;
-    bool framebufferResized = false;
+    std::atomic<bool> framebufferResized{ false };
+    std::atomic<int> framebufferWidth{ 0 };
+    std::atomic<int> framebufferHeight{ 0 };
+    std::atomic<uint32_t> framesInFlightRequest{ 0 };
+    bool pauseToggled = false; // read by the simulation on the main thread
+    std::atomic<uint32_t> presentModeCycles{ 0 };
+    std::atomic<uint32_t> frameLimitCycles{ 0 };
+    std::atomic<uint32_t> renderOnDemandToggles{ 0 };
+    std::atomic<bool> focused{ true };
+    std::atomic<bool> iconified{ false };
+    std::atomic<bool> redrawRequested{ true }; // the first frame is always drawn
+    std::atomic<LookAngles> lookAngles{}; // sampled by the render thread right before submitting a frame
+    bool looking = false; // whether the left button is held, main thread only
+    double lastCursorX = 0.0; // cursor position of the last event, main thread only
+    double lastCursorY = 0.0;
 
 };
@@ -18,6 +18,7 @@ void CommandPool::createCommandPool() {
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // allows individual command reset
 	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+	m_queueFamilyIndex = poolInfo.queueFamilyIndex; // secondary command buffer pools use the same family
 
 	if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create command pool!");
@@ -25,6 +26,21 @@ void CommandPool::createCommandPool() {
 }
 void CommandPool::createCommandBuffers() {
 	m_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	allocateCommandBuffers();
+}
+
+void CommandPool::resizeCommandBuffers(uint32_t count, DeletionQueue& deletionQueue, uint64_t retireValue) {
+	VkDevice device = m_device;
+	VkCommandPool commandPool = m_commandPool;
+	std::vector<VkCommandBuffer> retired = m_commandBuffers;
+	deletionQueue.push(retireValue, [device, commandPool, retired]() {
+		vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(retired.size()), retired.data());
+	});
+	m_commandBuffers.assign(count, VK_NULL_HANDLE);
+	allocateCommandBuffers();
+}
+
+void CommandPool::allocateCommandBuffers() {
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.commandPool = m_commandPool;
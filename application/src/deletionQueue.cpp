@@ -0,0 +1,109 @@
+#include "deletionQueue.hpp"
+#include <utility>
+
+DeletionQueue::DeletionQueue(VkDevice device, GpuTimeline& timeline) : m_device(device), m_timeline(timeline) {}
+
+void DeletionQueue::push(uint64_t timelineValue, std::function<void()> destroy) {
+	Entry entry{};
+	entry.timelineValue = timelineValue;
+	entry.type = ResourceType::Deleter;
+	entry.destroy = std::move(destroy);
+	m_entries.push_back(std::move(entry));
+}
+
+void DeletionQueue::push(std::function<void()> destroy) {
+	push(getRetireValue(), std::move(destroy));
+}
+
+void DeletionQueue::pushHandle(ResourceType type, const Entry& entry) {
+	m_entries.push_back(entry);
+	m_entries.back().timelineValue = getRetireValue();
+	m_entries.back().type = type;
+}
+
+void DeletionQueue::destroyBuffer(VkBuffer buffer) {
+	if (buffer != VK_NULL_HANDLE) {
+		Entry entry{};
+		entry.handle.buffer = buffer;
+		pushHandle(ResourceType::Buffer, entry);
+	}
+}
+
+void DeletionQueue::freeMemory(VkDeviceMemory memory) {
+	if (memory != VK_NULL_HANDLE) {
+		Entry entry{};
+		entry.handle.memory = memory;
+		pushHandle(ResourceType::Memory, entry);
+	}
+}
+
+void DeletionQueue::destroyImage(VkImage image) {
+	if (image != VK_NULL_HANDLE) {
+		Entry entry{};
+		entry.handle.image = image;
+		pushHandle(ResourceType::Image, entry);
+	}
+}
+
+void DeletionQueue::destroyImageView(VkImageView imageView) {
+	if (imageView != VK_NULL_HANDLE) {
+		Entry entry{};
+		entry.handle.imageView = imageView;
+		pushHandle(ResourceType::ImageView, entry);
+	}
+}
+
+void DeletionQueue::destroySampler(VkSampler sampler) {
+	if (sampler != VK_NULL_HANDLE) {
+		Entry entry{};
+		entry.handle.sampler = sampler;
+		pushHandle(ResourceType::Sampler, entry);
+	}
+}
+
+void DeletionQueue::destroyPipeline(VkPipeline pipeline) {
+	if (pipeline != VK_NULL_HANDLE) {
+		Entry entry{};
+		entry.handle.pipeline = pipeline;
+		pushHandle(ResourceType::Pipeline, entry);
+	}
+}
+
+void DeletionQueue::destroyDescriptorPool(VkDescriptorPool descriptorPool) {
+	if (descriptorPool != VK_NULL_HANDLE) {
+		Entry entry{};
+		entry.handle.descriptorPool = descriptorPool;
+		pushHandle(ResourceType::DescriptorPool, entry);
+	}
+}
+
+void DeletionQueue::destroyEntry(Entry& entry) {
+	switch (entry.type) {
+	case ResourceType::Deleter: entry.destroy(); break;
+	case ResourceType::Buffer: vkDestroyBuffer(m_device, entry.handle.buffer, nullptr); break;
+	case ResourceType::Memory: vkFreeMemory(m_device, entry.handle.memory, nullptr); break;
+	case ResourceType::Image: vkDestroyImage(m_device, entry.handle.image, nullptr); break;
+	case ResourceType::ImageView: vkDestroyImageView(m_device, entry.handle.imageView, nullptr); break;
+	case ResourceType::Sampler: vkDestroySampler(m_device, entry.handle.sampler, nullptr); break;
+	case ResourceType::Pipeline: vkDestroyPipeline(m_device, entry.handle.pipeline, nullptr); break;
+	case ResourceType::DescriptorPool: vkDestroyDescriptorPool(m_device, entry.handle.descriptorPool, nullptr); break;
+	}
+}
+
+void DeletionQueue::flush(uint64_t completedValue) {
+	while (!m_entries.empty() && m_entries.front().timelineValue <= completedValue) {
+		Entry entry = std::move(m_entries.front());
+		m_entries.pop_front(); // before running it, a deleter may push more entries
+		destroyEntry(entry);
+	}
+}
+
+void DeletionQueue::flush() {
+	if (!m_entries.empty()) { // skips the semaphore query on most frames
+		flush(m_timeline.getCompletedValue());
+	}
+}
+
+void DeletionQueue::flushAll() {
+	flush(UINT64_MAX);
+}
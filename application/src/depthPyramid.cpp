@@ -0,0 +1,222 @@
+#include "depthPyramid.hpp"
+#include "embeddedShaders/depthPyramidComp.hpp"
+#include "bufferUtils.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <stdexcept>
+
+bool DepthPyramid::isSupported(VkPhysicalDevice physicalDevice, VkFormat depthFormat) {
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, depthFormat, &properties);
+	return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0; // R32 float storage images are required by the spec
+}
+
+DepthPyramid::DepthPyramid(VkDevice device, VkPhysicalDevice physicalDevice, PipelineLibrary& pipelineLibrary)
+	: m_device(device), m_physicalDevice(physicalDevice) {
+	createSampler();
+	createDescriptorSetLayout();
+	createPipelineLayout();
+	m_pipeline = pipelineLibrary.createComputePipeline("depthPyramid.comp", EmbeddedShaders::depthPyramidComp, m_pipelineLayout);
+}
+
+void DepthPyramid::destroyDepthPyramid(DeletionQueue& deletionQueue) {
+	retireImage(deletionQueue);
+	deletionQueue.destroySampler(m_sampler);
+	vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr); // only used while recording
+	vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+}
+
+void DepthPyramid::resize(VkExtent2D extent, VkImageView depthView, DeletionQueue& deletionQueue) {
+	retireImage(deletionQueue); // frames in flight keep using the old pyramid
+
+	// sizes as Vulkan computes the mip chain, rounded down; the reduction folds the odd texels into the last row and column
+	VkExtent2D baseExtent = { std::max(1u, extent.width / 2), std::max(1u, extent.height / 2) };
+	uint32_t levelCount = static_cast<uint32_t>(std::bit_width(std::max(baseExtent.width, baseExtent.height))); // floor(log2(size)) + 1
+	m_levels.assign(levelCount, Level{});
+	for (uint32_t i = 0; i < levelCount; i++) {
+		m_levels[i].extent = { std::max(1u, baseExtent.width >> i), std::max(1u, baseExtent.height >> i) };
+	}
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent = { m_levels[0].extent.width, m_levels[0].extent.height, 1 };
+	imageInfo.mipLevels = getLevelCount();
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	if (vkCreateImage(m_device, &imageInfo, nullptr, &m_image) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(m_device, m_image, &memRequirements);
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = BufferUtils::findMemoryType(m_physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate depth pyramid memory!");
+	}
+	vkBindImageMemory(m_device, m_image, m_memory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = m_image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, getLevelCount(), 0, 1 };
+	if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_view) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid view!");
+	}
+	for (uint32_t i = 0; i < m_levels.size(); i++) {
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1 }; // storage image views have a single level
+		if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_levels[i].view) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create depth pyramid level view!");
+		}
+	}
+
+	const std::array<PoolSizeRatio, 2> ratios = { {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+	} };
+	m_setAllocator = std::make_shared<DescriptorAllocator>(m_device, getLevelCount(), ratios); // sets in use by frames in flight are never updated
+	for (uint32_t i = 0; i < m_levels.size(); i++) {
+		Level& level = m_levels[i];
+		level.descriptorSet = m_setAllocator->allocate(m_descriptorSetLayout);
+
+		VkDescriptorImageInfo sourceInfo{};
+		sourceInfo.sampler = m_sampler;
+		sourceInfo.imageView = i == 0 ? depthView : m_levels[i - 1].view;
+		sourceInfo.imageLayout = i == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL; // the render graph transitions the depth buffer
+
+		VkDescriptorImageInfo destinationInfo{};
+		destinationInfo.imageView = level.view;
+		destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 2> writes{};
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].dstSet = level.descriptorSet;
+		writes[0].dstBinding = 0;
+		writes[0].descriptorCount = 1;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[0].pImageInfo = &sourceInfo;
+		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[1].dstSet = level.descriptorSet;
+		writes[1].dstBinding = 1;
+		writes[1].descriptorCount = 1;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		writes[1].pImageInfo = &destinationInfo;
+		vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
+
+void DepthPyramid::record(VkCommandBuffer commandBuffer) const {
+	// every level is rewritten, so the previous contents are dropped; waits for the previous frame's culling reads
+	VkImageMemoryBarrier2 imageBarrier{};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	imageBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+	imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = m_image;
+	imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, getLevelCount(), 0, 1 };
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = 1;
+	dependencyInfo.pImageMemoryBarriers = &imageBarrier;
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	VkMemoryBarrier2 levelBarrier{};
+	levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	levelBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	levelBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	levelBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	levelBarrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT; // the next level, or the culling shader after the last one
+	dependencyInfo.imageMemoryBarrierCount = 0;
+	dependencyInfo.pImageMemoryBarriers = nullptr;
+	dependencyInfo.memoryBarrierCount = 1;
+	dependencyInfo.pMemoryBarriers = &levelBarrier;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline->getPipeline());
+	for (const Level& level : m_levels) {
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &level.descriptorSet, 0, nullptr);
+		vkCmdDispatch(commandBuffer, (level.extent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (level.extent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo); // each level reads the one before
+	}
+}
+
+void DepthPyramid::createSampler() {
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	if (vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid sampler!");
+	}
+}
+
+void DepthPyramid::createDescriptorSetLayout() {
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid descriptor set layout!");
+	}
+}
+
+void DepthPyramid::createPipelineLayout() {
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 0; // the sizes come from the bound images
+
+	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth pyramid pipeline layout!");
+	}
+}
+
+void DepthPyramid::retireImage(DeletionQueue& deletionQueue) {
+	for (Level& level : m_levels) {
+		deletionQueue.destroyImageView(level.view);
+	}
+	m_levels.clear();
+	deletionQueue.destroyImageView(m_view);
+	deletionQueue.destroyImage(m_image);
+	deletionQueue.freeMemory(m_memory);
+	m_view = VK_NULL_HANDLE;
+	m_image = VK_NULL_HANDLE;
+	m_memory = VK_NULL_HANDLE;
+	if (m_setAllocator) {
+		m_setAllocator->destroyDescriptorAllocator(deletionQueue);
+		m_setAllocator.reset();
+	}
+}
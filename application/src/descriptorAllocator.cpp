@@ -0,0 +1,84 @@
+#include "descriptorAllocator.hpp"
+#include <algorithm>
+#include <cmath>
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device, uint32_t initialSets, std::span<const PoolSizeRatio> ratios)
+	: m_device(device),
+	m_ratios(ratios.begin(), ratios.end()),
+	m_setsPerPool(initialSets)
+{
+	m_readyPools.push_back(createPool(m_setsPerPool));
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount) {
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	poolSizes.reserve(m_ratios.size());
+	for (const PoolSizeRatio& ratio : m_ratios) {
+		poolSizes.push_back({ ratio.type, static_cast<uint32_t>(std::ceil(ratio.ratio * setCount)) });
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = 0; // sets are never freed individually, pools are reset as a whole
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = setCount;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+	return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::getPool() {
+	if (!m_readyPools.empty()) {
+		return m_readyPools.back();
+	}
+	m_setsPerPool = std::min(m_setsPerPool + m_setsPerPool / 2, MAX_SETS_PER_POOL); // grow so a busy frame needs few pools
+	m_readyPools.push_back(createPool(m_setsPerPool));
+	return m_readyPools.back();
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = getPool();
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set;
+	VkResult result = vkAllocateDescriptorSets(m_device, &allocInfo, &set);
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) { // pool is full, chain the next one
+		m_fullPools.push_back(m_readyPools.back());
+		m_readyPools.pop_back();
+		allocInfo.descriptorPool = getPool();
+		result = vkAllocateDescriptorSets(m_device, &allocInfo, &set);
+	}
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate descriptor set!");
+	}
+	return set;
+}
+
+void DescriptorAllocator::reset() {
+	for (VkDescriptorPool pool : m_readyPools) {
+		vkResetDescriptorPool(m_device, pool, 0);
+	}
+	for (VkDescriptorPool pool : m_fullPools) {
+		vkResetDescriptorPool(m_device, pool, 0);
+		m_readyPools.push_back(pool);
+	}
+	m_fullPools.clear();
+}
+
+void DescriptorAllocator::destroyDescriptorAllocator(DeletionQueue& deletionQueue) {
+	for (VkDescriptorPool pool : m_readyPools) {
+		deletionQueue.destroyDescriptorPool(pool);
+	}
+	for (VkDescriptorPool pool : m_fullPools) {
+		deletionQueue.destroyDescriptorPool(pool);
+	}
+	m_readyPools.clear();
+	m_fullPools.clear();
+}
@@ -1,126 +1,195 @@
-#include "DescriptorManager.hpp"
+#include "descriptorManager.hpp"
+#include <cstddef>
+
+DescriptorManager::DescriptorManager(VkDevice device, std::vector<VkBuffer> buffers, std::vector<VkBuffer> instanceBuffers)
+    : m_device(device), m_uniformBuffers(std::move(buffers)), m_instanceBuffers(std::move(instanceBuffers)) {
+    createDescriptorSetLayouts();
+    createUpdateTemplates();
+    createDescriptorAllocators();
+}
 
-DescriptorManager::DescriptorManager(VkDevice device, std::vector<VkBuffer> buffers)
-    : m_device(device), m_uniformBuffers(std::move(buffers)) {
-    createDescriptorSetLayout();
-    createDescriptorPool();
+void DescriptorManager::destroyDescriptorManager(DeletionQueue& deletionQueue) {
+    vkDestroyDescriptorUpdateTemplate(m_device, m_globalTemplate, nullptr); // only used on the CPU
+    vkDestroyDescriptorUpdateTemplate(m_device, m_frameTemplate, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_globalSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_frameSetLayout, nullptr);
+    m_setAllocator->destroyDescriptorAllocator(deletionQueue);
+    for (auto& allocator : m_frameAllocators) {
+        allocator.destroyDescriptorAllocator(deletionQueue);
+    }
 }
 
-void DescriptorManager::destroyDescriptorManager() {
-    vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
-    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+std::vector<VkDescriptorSetLayout> DescriptorManager::getDescriptorSetLayouts() const {
+    return { m_globalSetLayout, m_frameSetLayout }; // GLOBAL_SET, FRAME_SET
 }
 
-VkDescriptorSetLayout DescriptorManager::getDescriptorSetLayout() const {
-    return m_descriptorSetLayout;
+std::array<VkDescriptorSet, 2> DescriptorManager::getDescriptorSets(uint32_t frame) const {
+    VkDescriptorSet frameSet = m_frameSets.at(frame);
+    if (m_globalSet == VK_NULL_HANDLE || frameSet == VK_NULL_HANDLE) {
+        throw std::runtime_error("descriptor sets of the frame weren't allocated!");
+    }
+    return { m_globalSet, frameSet };
 }
 
-const VkDescriptorSet& DescriptorManager::getDescriptorSet(uint32_t index) const {
-    if (index < m_descriptorSets.size()) {
-        return m_descriptorSets[index];
+void DescriptorManager::createDescriptorSets(const std::vector<VkImageView>& imageViews,
+    const std::vector<VkSampler>& sampler,
+    VkBuffer materialBuffer,
+    VkDeviceSize materialBufferSize) {
+    GlobalSetData data{};
+    data.materialBuffer.buffer = materialBuffer;
+    data.materialBuffer.offset = 0;
+    data.materialBuffer.range = materialBufferSize;
+    for (size_t j = 0; j < MAX_MATERIAL_TEXTURES; ++j) {
+        data.textures[j].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        data.textures[j].imageView = imageViews[j];
+        data.textures[j].sampler = sampler[j];
     }
-    throw std::out_of_range("Index out of range for descriptor sets");
+
+    m_globalSet = m_setAllocator->allocate(m_globalSetLayout);
+    vkUpdateDescriptorSetWithTemplate(m_device, m_globalSet, m_globalTemplate, &data); // one call, no VkWriteDescriptorSet array
 }
 
-void DescriptorManager::createDescriptorSets(const std::array<VkImageView, 4>& imageViews,
-    const std::array<VkSampler, 4>& sampler) {
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, m_descriptorSetLayout);
+void DescriptorManager::updateInstanceBuffer(uint32_t frame, VkBuffer instanceBuffer) {
+    m_instanceBuffers.at(frame) = instanceBuffer; // command buffers replayed in the meantime keep reading the old one
+}
 
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    allocInfo.pSetLayouts = layouts.data();
+void DescriptorManager::resetFrameDescriptors(uint32_t frame) {
+    m_frameAllocators.at(frame).reset();
+    m_frameSets[frame] = VK_NULL_HANDLE;
+}
 
-    m_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-    if (vkAllocateDescriptorSets(m_device, &allocInfo, m_descriptorSets.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate descriptor sets!");
-    }
+VkDescriptorSet DescriptorManager::allocateFrameSet(uint32_t frame) {
+    VkDescriptorSet set = m_frameAllocators.at(frame).allocate(m_frameSetLayout);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = m_uniformBuffers[i];
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UBO);
-
-        std::array<VkWriteDescriptorSet, 5> descriptorWrites{};
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = m_descriptorSets[i];
-        descriptorWrites[0].dstBinding = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-        std::array<VkDescriptorImageInfo, 4> imageInfos{};
-        for (size_t j = 0; j < 4; ++j) {
-            imageInfos[j].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfos[j].imageView = imageViews[j];
-            imageInfos[j].sampler = sampler[j];
-
-            descriptorWrites[j + 1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[j + 1].dstSet = m_descriptorSets[i];
-            descriptorWrites[j + 1].dstBinding = static_cast<uint32_t>(j + 1);
-            descriptorWrites[j + 1].dstArrayElement = 0;
-            descriptorWrites[j + 1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[j + 1].descriptorCount = 1;
-            descriptorWrites[j + 1].pImageInfo = &imageInfos[j];
-        }
-
-        vkUpdateDescriptorSets(m_device,
-            static_cast<uint32_t>(descriptorWrites.size()),
-            descriptorWrites.data(),
-            0, nullptr);
-    }
+    FrameSetData data{};
+    data.uniformBuffer.buffer = m_uniformBuffers[frame];
+    data.uniformBuffer.offset = 0;
+    data.uniformBuffer.range = sizeof(UBO);
+    data.instanceBuffer.buffer = m_instanceBuffers[frame];
+    data.instanceBuffer.offset = 0;
+    data.instanceBuffer.range = VK_WHOLE_SIZE; // the buffers grow with the scene
+    vkUpdateDescriptorSetWithTemplate(m_device, set, m_frameTemplate, &data);
+
+    m_frameSets[frame] = set;
+    return set;
 }
 
-void DescriptorManager::createDescriptorSetLayout() {
+void DescriptorManager::createDescriptorSetLayouts() {
+    VkDescriptorSetLayoutBinding materialLayoutBinding{};
+    materialLayoutBinding.binding = 0;
+    materialLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    materialLayoutBinding.descriptorCount = 1;
+    materialLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    materialLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding samplerBinding{};
+    samplerBinding.binding = 1;
+    samplerBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    samplerBinding.descriptorCount = MAX_MATERIAL_TEXTURES; // texture array indexed by the material table
+    samplerBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    samplerBinding.pImmutableSamplers = nullptr;
+
+    std::array<VkDescriptorSetLayoutBinding, 2> globalBindings = { materialLayoutBinding, samplerBinding };
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(globalBindings.size());
+    layoutInfo.pBindings = globalBindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_globalSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+
     VkDescriptorSetLayoutBinding uboLayoutBinding{};
     uboLayoutBinding.binding = 0;
     uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT; // fragment shader reads the view position and light
     uboLayoutBinding.pImmutableSamplers = nullptr;
 
-    std::array<VkDescriptorSetLayoutBinding, 5> bindings;
-    bindings[0] = uboLayoutBinding;
-
-    for (uint32_t i = 0; i < 4; ++i) {
-        VkDescriptorSetLayoutBinding samplerBinding{};
-        samplerBinding.binding = i + 1;
-        samplerBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        samplerBinding.descriptorCount = 1;
-        samplerBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-        samplerBinding.pImmutableSamplers = nullptr;
-        bindings[i + 1] = samplerBinding;
-    }
+    VkDescriptorSetLayoutBinding instanceLayoutBinding{};
+    instanceLayoutBinding.binding = 1;
+    instanceLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    instanceLayoutBinding.descriptorCount = 1;
+    instanceLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // indexed with gl_InstanceIndex
+    instanceLayoutBinding.pImmutableSamplers = nullptr;
 
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
+    std::array<VkDescriptorSetLayoutBinding, 2> frameBindings = { uboLayoutBinding, instanceLayoutBinding };
+    layoutInfo.bindingCount = static_cast<uint32_t>(frameBindings.size());
+    layoutInfo.pBindings = frameBindings.data();
 
-    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_frameSetLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor set layout!");
     }
 }
 
-void DescriptorManager::createDescriptorPool() {
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * 4);
-
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create descriptor pool!");
+void DescriptorManager::createUpdateTemplates() {
+    std::array<VkDescriptorUpdateTemplateEntry, 2> globalEntries{};
+    globalEntries[0].dstBinding = 0;
+    globalEntries[0].dstArrayElement = 0;
+    globalEntries[0].descriptorCount = 1;
+    globalEntries[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    globalEntries[0].offset = offsetof(GlobalSetData, materialBuffer);
+    globalEntries[0].stride = sizeof(VkDescriptorBufferInfo);
+
+    globalEntries[1].dstBinding = 1;
+    globalEntries[1].dstArrayElement = 0;
+    globalEntries[1].descriptorCount = MAX_MATERIAL_TEXTURES;
+    globalEntries[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    globalEntries[1].offset = offsetof(GlobalSetData, textures);
+    globalEntries[1].stride = sizeof(VkDescriptorImageInfo);
+
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(globalEntries.size());
+    templateInfo.pDescriptorUpdateEntries = globalEntries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    templateInfo.descriptorSetLayout = m_globalSetLayout;
+
+    if (vkCreateDescriptorUpdateTemplate(m_device, &templateInfo, nullptr, &m_globalTemplate) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor update template!");
+    }
+
+    std::array<VkDescriptorUpdateTemplateEntry, 2> frameEntries{};
+    frameEntries[0].dstBinding = 0;
+    frameEntries[0].dstArrayElement = 0;
+    frameEntries[0].descriptorCount = 1;
+    frameEntries[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    frameEntries[0].offset = offsetof(FrameSetData, uniformBuffer);
+    frameEntries[0].stride = sizeof(VkDescriptorBufferInfo);
+
+    frameEntries[1].dstBinding = 1;
+    frameEntries[1].dstArrayElement = 0;
+    frameEntries[1].descriptorCount = 1;
+    frameEntries[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    frameEntries[1].offset = offsetof(FrameSetData, instanceBuffer);
+    frameEntries[1].stride = sizeof(VkDescriptorBufferInfo);
+
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(frameEntries.size());
+    templateInfo.pDescriptorUpdateEntries = frameEntries.data();
+    templateInfo.descriptorSetLayout = m_frameSetLayout;
+
+    if (vkCreateDescriptorUpdateTemplate(m_device, &templateInfo, nullptr, &m_frameTemplate) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor update template!");
     }
 }
-#pragma once
 
+void DescriptorManager::createDescriptorAllocators() {
+    // the global set: the material table and the texture array
+    const std::array<PoolSizeRatio, 2> ratios = { {
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<float>(MAX_MATERIAL_TEXTURES) },
+    } };
+    m_setAllocator = std::make_shared<DescriptorAllocator>(m_device, 1, ratios);
+
+    // per-frame sets: the UBO and the instance buffer
+    const std::array<PoolSizeRatio, 2> frameRatios = { {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f },
+    } };
+    m_frameAllocators.reserve(MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        m_frameAllocators.emplace_back(m_device, INITIAL_FRAME_SETS, frameRatios);
+    }
+    m_frameSets.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "device.hpp"
+#include "log.hpp"
 
 
 Device::Device(const VkInstance& instance, VkSurfaceKHR& surface) {
@@ -62,15 +63,54 @@ void Device::createLogicalDevice() {
 
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE; // enable anisotropy 
+	deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE; // material table indexes the texture array
+	deviceFeatures.multiDrawIndirect = m_drawIndirectCountSupported; // GPU culling emits several draws per indirect call
+	deviceFeatures.drawIndirectFirstInstance = m_drawIndirectCountSupported; // and points each at its instances
+
+	std::vector<const char*> enabledExtensions = m_deviceExtensions;
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+	pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.dynamicRendering = VK_TRUE; // the render graph renders without render pass objects
+	vulkan13Features.synchronization2 = VK_TRUE; // the render graph batches its barriers with vkCmdPipelineBarrier2
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE; // frames and uploads signal one GPU timeline
+	vulkan12Features.drawIndirectCount = m_drawIndirectCountSupported; // the GPU writes how many draws it kept
+	vulkan12Features.pNext = &vulkan13Features;
+
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+	presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	presentIdFeatures.presentId = VK_TRUE;
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+	presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	presentWaitFeatures.presentWait = VK_TRUE;
+	presentIdFeatures.pNext = &presentWaitFeatures;
 
 	VkDeviceCreateInfo createInfo{};
 
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = &vulkan12Features;
+	void** featureChainEnd = &vulkan13Features.pNext; // optional feature structs are appended here
+	if (m_graphicsPipelineLibrarySupported) { // optional, pipelines fall back to monolithic compiles
+		enabledExtensions.insert(enabledExtensions.end(), m_pipelineLibraryExtensions.begin(), m_pipelineLibraryExtensions.end());
+		*featureChainEnd = &pipelineLibraryFeatures;
+		featureChainEnd = &pipelineLibraryFeatures.pNext;
+	}
+	if (m_presentWaitSupported) { // optional, frames are paced on the CPU clock only
+		enabledExtensions.insert(enabledExtensions.end(), m_presentWaitExtensions.begin(), m_presentWaitExtensions.end());
+		*featureChainEnd = &presentIdFeatures;
+		featureChainEnd = &presentWaitFeatures.pNext;
+	}
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(m_deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+	createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 	if (ValidationLayersConfig::enableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(ValidationLayersConfig::validationLayers.size());
@@ -101,5 +141,91 @@ bool Device::isDeviceSuitable(VkPhysicalDevice device) // can be used to only al
 	VkPhysicalDeviceFeatures supportedFeatures;
 	vkGetPhysicalDeviceFeatures(device, &supportedFeatures); // get the supported features
 
-	return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+	bool suitable = indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy && supportedFeatures.shaderSampledImageArrayDynamicIndexing
+		&& checkVulkan13Support(device);
+	if (suitable) {
+		m_graphicsPipelineLibrarySupported = checkGraphicsPipelineLibrarySupport(device); // not required, only changes how pipelines are built
+		m_presentWaitSupported = checkPresentWaitSupport(device); // not required, only adds display timing to the frame pacing
+		m_drawIndirectCountSupported = checkDrawIndirectCountSupport(device); // not required, culling stays on the CPU
+	}
+	return suitable;
+}
+
+bool Device::checkVulkan13Support(VkPhysicalDevice device) {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_3) {
+		return false;
+	}
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.pNext = &vulkan13Features;
+	VkPhysicalDeviceFeatures2 features2{};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(device, &features2);
+	return vulkan13Features.dynamicRendering && vulkan13Features.synchronization2 && vulkan12Features.timelineSemaphore;
+}
+
+bool Device::checkGraphicsPipelineLibrarySupport(VkPhysicalDevice device) {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_1 || !Extensions::checkDeviceExtensionSupport(device, m_pipelineLibraryExtensions)) {
+		Log::info() << "graphics pipeline library: not supported" << std::endl;
+		return false; // the feature and property structs are only defined with the extension, queried through 1.1 entry points
+	}
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+	pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features2{};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &pipelineLibraryFeatures;
+	vkGetPhysicalDeviceFeatures2(device, &features2);
+	if (!pipelineLibraryFeatures.graphicsPipelineLibrary) {
+		Log::info() << "graphics pipeline library: not supported" << std::endl;
+		return false;
+	}
+
+	VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT pipelineLibraryProperties{};
+	pipelineLibraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &pipelineLibraryProperties;
+	vkGetPhysicalDeviceProperties2(device, &properties2);
+
+	Log::info() << "graphics pipeline library: supported, fast linking: " << (pipelineLibraryProperties.graphicsPipelineLibraryFastLinking ? "yes" : "no") << std::endl;
+	return pipelineLibraryProperties.graphicsPipelineLibraryFastLinking == VK_TRUE; // without it a link costs about a full compile, monolithic pipelines are simpler
+}
+
+bool Device::checkPresentWaitSupport(VkPhysicalDevice device) {
+	if (!Extensions::checkDeviceExtensionSupport(device, m_presentWaitExtensions)) {
+		return false;
+	}
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+	presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+	presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	presentIdFeatures.pNext = &presentWaitFeatures;
+	VkPhysicalDeviceFeatures2 features2{};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &presentIdFeatures;
+	vkGetPhysicalDeviceFeatures2(device, &features2);
+
+	bool supported = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+	Log::info() << "present wait: " << (supported ? "supported" : "not supported") << std::endl;
+	return supported;
+}
+
+bool Device::checkDrawIndirectCountSupport(VkPhysicalDevice device) {
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 features2{};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(device, &features2);
+
+	bool supported = vulkan12Features.drawIndirectCount && features2.features.multiDrawIndirect && features2.features.drawIndirectFirstInstance;
+	Log::info() << "draw indirect count: " << (supported ? "supported" : "not supported") << std::endl;
+	return supported;
 }
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "drawList.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+uint32_t DrawList::registerPipeline(const PipelineState& state) {
+	if (m_lastPipelineId != UINT32_MAX && m_pipelineStates[m_lastPipelineId] == state) {
+		return m_lastPipelineId; // consecutive draws usually share a variant, skip the hash
+	}
+	auto found = m_pipelineIds.find(state);
+	if (found == m_pipelineIds.end()) {
+		if (m_pipelineStates.size() >= (1u << PIPELINE_BITS)) {
+			throw std::runtime_error("too many pipeline variants for the draw list sort key!");
+		}
+		found = m_pipelineIds.emplace(state, static_cast<uint32_t>(m_pipelineStates.size())).first;
+		m_pipelineStates.push_back(state);
+	}
+	m_lastPipelineId = found->second;
+	return m_lastPipelineId;
+}
+
+uint32_t DrawList::registerMesh(Mesh* mesh) {
+	auto found = std::find(m_meshes.begin(), m_meshes.end(), mesh);
+	if (found != m_meshes.end()) {
+		return static_cast<uint32_t>(found - m_meshes.begin());
+	}
+	if (m_meshes.size() >= (1u << MESH_BITS)) {
+		throw std::runtime_error("too many meshes for the draw list sort key!");
+	}
+	m_meshes.push_back(mesh);
+	return static_cast<uint32_t>(m_meshes.size() - 1);
+}
+
+uint32_t DrawList::addTransform(const glm::mat4& transform, uint32_t objectIndex) {
+	m_transforms.push_back(transform);
+	m_objectIndices.push_back(objectIndex);
+	return static_cast<uint32_t>(m_transforms.size() - 1);
+}
+
+uint64_t DrawList::makeKey(DrawPass pass, uint32_t pipelineId, uint32_t materialIndex, uint32_t meshId, uint32_t subMeshIndex, float viewDepth) {
+	// the bits of a non-negative float sort like the float, the top DEPTH_BITS of them are a monotonic depth
+	uint32_t depthBits;
+	float depth = std::max(viewDepth, 0.0f);
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+	uint64_t quantizedDepth = depthBits >> (31 - DEPTH_BITS);
+
+	uint64_t subMesh = subMeshIndex & ((1u << SUBMESH_BITS) - 1);
+
+	uint64_t key = static_cast<uint64_t>(pass) << (64 - PASS_BITS);
+	if (pass == DrawPass::Transparent) {
+		uint64_t invertedDepth = ((1ull << DEPTH_BITS) - 1) - quantizedDepth; // back to front
+		key |= invertedDepth << (PIPELINE_BITS + MATERIAL_BITS + MESH_BITS + SUBMESH_BITS);
+		key |= static_cast<uint64_t>(pipelineId) << (MATERIAL_BITS + MESH_BITS + SUBMESH_BITS);
+		key |= static_cast<uint64_t>(materialIndex) << (MESH_BITS + SUBMESH_BITS);
+		key |= static_cast<uint64_t>(meshId) << SUBMESH_BITS;
+		key |= subMesh;
+	}
+	else {
+		key |= static_cast<uint64_t>(pipelineId) << (MATERIAL_BITS + MESH_BITS + SUBMESH_BITS + DEPTH_BITS);
+		key |= static_cast<uint64_t>(materialIndex) << (MESH_BITS + SUBMESH_BITS + DEPTH_BITS);
+		key |= static_cast<uint64_t>(meshId) << (SUBMESH_BITS + DEPTH_BITS);
+		key |= subMesh << DEPTH_BITS; // keeps the objects of a sub mesh together, they become one instanced draw
+		key |= quantizedDepth; // front to back
+	}
+	return key;
+}
+
+void DrawList::add(DrawPass pass, uint32_t pipelineId, uint32_t meshId, uint32_t subMeshIndex, uint32_t materialIndex, uint32_t transformIndex, float viewDepth) {
+	if (materialIndex >= (1u << MATERIAL_BITS)) {
+		throw std::runtime_error("material index doesn't fit the draw list sort key!");
+	}
+	DrawItem item{};
+	item.materialIndex = materialIndex;
+	item.transformIndex = transformIndex;
+	item.subMeshIndex = subMeshIndex;
+	item.pipelineId = static_cast<uint16_t>(pipelineId);
+	item.meshId = static_cast<uint16_t>(meshId);
+
+	m_entries.push_back({ makeKey(pass, pipelineId, materialIndex, meshId, subMeshIndex, viewDepth), static_cast<uint32_t>(m_items.size()) });
+	m_items.push_back(item);
+}
+
+void DrawList::sort() {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// LSD radix sort, one byte per pass. Bytes that are equal in every key (unused passes, a single
+	// pipeline...) are detected from the histogram and skipped.
+	const size_t count = m_entries.size();
+	m_scratch.resize(count);
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		uint32_t histogram[256] = {};
+		for (const SortEntry& entry : m_entries) {
+			histogram[(entry.key >> shift) & 0xFF]++;
+		}
+		if (count == 0 || histogram[(m_entries[0].key >> shift) & 0xFF] == count) {
+			continue; // every key has the same byte here
+		}
+		uint32_t offset = 0;
+		for (uint32_t& bucket : histogram) {
+			uint32_t size = bucket;
+			bucket = offset;
+			offset += size;
+		}
+		for (const SortEntry& entry : m_entries) {
+			m_scratch[histogram[(entry.key >> shift) & 0xFF]++] = entry;
+		}
+		m_entries.swap(m_scratch);
+	}
+	buildBatches();
+	buildGroups();
+
+	m_stats.sortMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void DrawList::buildBatches() {
+	m_batches.clear();
+	m_firstTransparentBatch = SIZE_MAX;
+	m_instances.resize(m_entries.size());
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		const DrawItem& item = m_items[m_entries[i].item];
+		GPUInstance& instance = m_instances[i]; // in sorted order, so the instances of a batch are contiguous
+		instance.model = m_transforms[item.transformIndex];
+		instance.materialIndex = item.materialIndex;
+		instance.objectIndex = m_objectIndices[item.transformIndex];
+
+		if (!m_batches.empty()) {
+			DrawBatch& batch = m_batches.back();
+			if (batch.pipelineId == item.pipelineId && batch.meshId == item.meshId && batch.subMeshIndex == item.subMeshIndex
+				&& batch.materialIndex == item.materialIndex) { // keeps the material dynamically uniform, the fragment shader indexes the texture array with it
+				batch.instanceCount++;
+				instance.batchIndex = static_cast<uint32_t>(m_batches.size() - 1);
+				continue;
+			}
+		}
+		instance.batchIndex = static_cast<uint32_t>(m_batches.size()); // the culling shaders append survivors to their batch
+		if (m_firstTransparentBatch == SIZE_MAX && static_cast<DrawPass>(m_entries[i].key >> (64 - PASS_BITS)) == DrawPass::Transparent) {
+			m_firstTransparentBatch = m_batches.size(); // the pass is the top of the key, every later batch is transparent too
+		}
+		const SubMesh& subMesh = m_meshes[item.meshId]->getSubMeshes()[item.subMeshIndex];
+		DrawBatch batch{};
+		batch.firstIndex = subMesh.firstIndex;
+		batch.indexCount = subMesh.indexCount;
+		batch.vertexOffset = subMesh.vertexOffset;
+		batch.firstInstance = static_cast<uint32_t>(i);
+		batch.instanceCount = 1;
+		batch.subMeshIndex = item.subMeshIndex;
+		batch.materialIndex = item.materialIndex;
+		batch.pipelineId = item.pipelineId;
+		batch.meshId = item.meshId;
+		m_batches.push_back(batch);
+	}
+	m_firstTransparentBatch = std::min(m_firstTransparentBatch, m_batches.size());
+}
+
+uint32_t DrawList::getFirstTransparentInstance() const {
+	return m_firstTransparentBatch < m_batches.size() ? m_batches[m_firstTransparentBatch].firstInstance : static_cast<uint32_t>(m_instances.size());
+}
+
+void DrawList::buildGroups() {
+	m_groups.clear();
+	m_gpuBatches.resize(m_batches.size());
+	for (size_t i = 0; i < m_batches.size(); i++) {
+		const DrawBatch& batch = m_batches[i];
+		const BoundingBox& bounds = m_meshes[batch.meshId]->getBounds(); // the whole mesh, looser than the sub mesh but always available
+		GPUDrawBatch& gpuBatch = m_gpuBatches[i];
+		gpuBatch.boundsCenter = glm::vec4(bounds.getCenter(), 0.0f);
+		gpuBatch.boundsExtent = glm::vec4(bounds.getExtent(), 0.0f);
+		gpuBatch.indexCount = batch.indexCount;
+		gpuBatch.firstIndex = batch.firstIndex;
+		gpuBatch.vertexOffset = batch.vertexOffset;
+		gpuBatch.firstInstance = batch.firstInstance;
+
+		if (i >= m_firstTransparentBatch) {
+			continue; // described for the bounds the culling shaders test, but recorded directly in sorted order
+		}
+		if (!m_groups.empty() && m_groups.back().pipelineId == batch.pipelineId && m_groups.back().meshId == batch.meshId) {
+			m_groups.back().batchCount++;
+			continue;
+		}
+		m_groups.push_back({ static_cast<uint32_t>(i), 1, batch.pipelineId, batch.meshId });
+	}
+
+	m_gpuGroups.resize(m_groups.size());
+	for (size_t i = 0; i < m_groups.size(); i++) {
+		m_gpuGroups[i].firstBatch = m_groups[i].firstBatch;
+		m_gpuGroups[i].batchCount = m_groups[i].batchCount;
+	}
+}
+
+void DrawList::setRecordStats(const DrawStats& stats) {
+	double sortMs = m_stats.sortMs;
+	m_stats = stats;
+	m_stats.sortMs = sortMs;
+}
+
+void DrawList::clear() {
+	m_items.clear();
+	m_entries.clear();
+	m_transforms.clear();
+	m_objectIndices.clear();
+	m_batches.clear();
+	m_instances.clear();
+	m_groups.clear();
+	m_gpuBatches.clear();
+	m_gpuGroups.clear();
+	m_firstTransparentBatch = 0;
+}
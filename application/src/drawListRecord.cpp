@@ -0,0 +1,102 @@
+#include "drawList.hpp"
+
+// Recording half of DrawList, kept apart from building the list so the draw list benchmark links without Vulkan
+// commands, meshes or pipelines
+
+DrawStats DrawList::record(VkCommandBuffer commandBuffer, PipelineLibrary& pipelineLibrary) {
+	auto start = std::chrono::high_resolution_clock::now();
+	resolvePipelines(pipelineLibrary);
+	DrawStats stats = recordRange(commandBuffer, 0, m_batches.size());
+	stats.recordMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	setRecordStats(stats);
+	return m_stats;
+}
+
+void DrawList::resolvePipelines(PipelineLibrary& pipelineLibrary) {
+	m_resolvedPipelines.resize(m_pipelineStates.size());
+	for (size_t i = 0; i < m_pipelineStates.size(); i++) {
+		m_resolvedPipelines[i] = pipelineLibrary.getPipeline(m_pipelineStates[i]); // once per variant instead of once per draw
+	}
+}
+
+DrawStats DrawList::recordRange(VkCommandBuffer commandBuffer, size_t first, size_t last) const {
+	DrawStats stats{};
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	uint32_t boundMesh = UINT32_MAX;
+
+	for (size_t i = first; i < last; i++) {
+		const DrawBatch& batch = m_batches[i];
+
+		VkPipeline pipeline = m_resolvedPipelines[batch.pipelineId];
+		if (pipeline == VK_NULL_HANDLE) {
+			stats.skippedDraws++; // the variant is still compiling, drawn once PipelineLibrary::getVersion() changes
+			continue;
+		}
+		if (pipeline != boundPipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundPipeline = pipeline;
+			stats.pipelineBinds++;
+		}
+		else {
+			stats.redundantBinds++;
+		}
+
+		if (batch.meshId != boundMesh) {
+			m_meshes[batch.meshId]->bindBuffers(commandBuffer);
+			boundMesh = batch.meshId;
+			stats.meshBinds++;
+		}
+		else {
+			stats.redundantBinds++;
+		}
+
+		vkCmdDrawIndexed(commandBuffer, batch.indexCount, batch.instanceCount, batch.firstIndex, batch.vertexOffset, batch.firstInstance); // gl_InstanceIndex starts at firstInstance
+		stats.draws++;
+		stats.instances += batch.instanceCount;
+	}
+	return stats;
+}
+
+DrawStats DrawList::recordIndirectRange(VkCommandBuffer commandBuffer, size_t first, size_t last, VkBuffer drawCommands, VkDeviceSize commandOffset,
+	VkBuffer drawCounts, VkDeviceSize countOffset) const {
+	DrawStats stats{};
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	uint32_t boundMesh = UINT32_MAX;
+
+	for (size_t i = first; i < last; i++) {
+		const DrawGroup& group = m_groups[i];
+
+		VkPipeline pipeline = m_resolvedPipelines[group.pipelineId];
+		if (pipeline == VK_NULL_HANDLE) {
+			stats.skippedDraws += group.batchCount; // the variant is still compiling
+			continue;
+		}
+		if (pipeline != boundPipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundPipeline = pipeline;
+			stats.pipelineBinds++;
+		}
+		else {
+			stats.redundantBinds++;
+		}
+
+		if (group.meshId != boundMesh) {
+			m_meshes[group.meshId]->bindBuffers(commandBuffer);
+			boundMesh = group.meshId;
+			stats.meshBinds++;
+		}
+		else {
+			stats.redundantBinds++;
+		}
+
+		// at most one draw per batch, the culling shaders compact the non-empty ones to the front of the group's range
+		vkCmdDrawIndexedIndirectCount(commandBuffer, drawCommands, commandOffset + group.firstBatch * sizeof(VkDrawIndexedIndirectCommand),
+			drawCounts, countOffset + i * sizeof(uint32_t), group.batchCount, sizeof(VkDrawIndexedIndirectCommand));
+		stats.indirectDraws++;
+		stats.draws += group.batchCount;
+		for (uint32_t b = group.firstBatch; b < group.firstBatch + group.batchCount; b++) {
+			stats.instances += m_batches[b].instanceCount; // candidates, the survivors are read back by GpuCuller
+		}
+	}
+	return stats;
+}
@@ -0,0 +1,146 @@
+#include "framePacer.hpp"
+#include "swapChain.hpp"
+#include <algorithm>
+#include <thread>
+
+void FrameTimeHistogram::add(double ms) {
+	size_t bucket = static_cast<size_t>(std::max(ms, 0.0) / BUCKET_MS);
+	buckets[std::min(bucket, BUCKET_COUNT - 1)]++;
+	count++;
+}
+
+double FrameTimeHistogram::percentile(double percentile) const {
+	if (count == 0) {
+		return 0.0;
+	}
+	uint32_t rank = static_cast<uint32_t>(std::clamp(percentile / 100.0 * count, 1.0, static_cast<double>(count)));
+	uint32_t seen = 0;
+	for (size_t i = 0; i < BUCKET_COUNT; i++) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			return (i + 1) * BUCKET_MS;
+		}
+	}
+	return BUCKET_COUNT * BUCKET_MS;
+}
+
+void FrameTimeHistogram::reset() {
+	buckets.fill(0);
+	count = 0;
+}
+
+static double millisecondsBetween(FramePacer::Clock::time_point start, FramePacer::Clock::time_point end) {
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+FramePacer::FramePacer(VkDevice device, bool presentWaitSupported) : m_device(device) {
+	if (presentWaitSupported) {
+		m_vkWaitForPresentKHR = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+	}
+}
+
+void FramePacer::setTargetFrameRate(double framesPerSecond) {
+	m_targetFrameRate = std::max(framesPerSecond, 0.0);
+	m_targetFrameTime = m_targetFrameRate > 0.0
+		? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_targetFrameRate))
+		: Clock::duration::zero();
+	m_nextDeadline = Clock::time_point{}; // the next frame starts the schedule
+}
+
+void FramePacer::waitForNextFrame(VkSwapchainKHR swapChain, VkPresentModeKHR presentMode) {
+	bool fifo = presentMode == VK_PRESENT_MODE_FIFO_KHR || presentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+	if (m_vkWaitForPresentKHR && fifo && m_presentId > m_firstSwapChainPresentId) {
+		waitForPresent(swapChain, m_presentId - 1); // one present may stay queued, so the GPU doesn't idle
+	}
+
+	if (m_targetFrameTime == Clock::duration::zero()) {
+		return;
+	}
+	auto now = Clock::now();
+	if (m_nextDeadline + m_targetFrameTime < now) {
+		m_nextDeadline = now; // more than a frame late, don't render a burst of frames to catch up
+	}
+	if (m_nextDeadline - now > SPIN_THRESHOLD) {
+		std::this_thread::sleep_until(m_nextDeadline - SPIN_THRESHOLD);
+	}
+	while (Clock::now() < m_nextDeadline) {
+		std::this_thread::yield();
+	}
+	m_nextDeadline += m_targetFrameTime;
+}
+
+void FramePacer::waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId) {
+	VkResult result = m_vkWaitForPresentKHR(m_device, swapChain, presentId, PRESENT_WAIT_TIMEOUT_NS);
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) { // timed out or out of date, the next acquire handles it
+		m_hasLastDisplayed = false;
+		return;
+	}
+	auto now = Clock::now();
+	m_submitToDisplay.add(millisecondsBetween(m_submitTimes[presentId % TRACKED_PRESENTS], now));
+	if (m_hasLastDisplayed) {
+		m_displayIntervals.add(millisecondsBetween(m_lastDisplayed, now));
+	}
+	m_lastDisplayed = now;
+	m_hasLastDisplayed = true;
+}
+
+void FramePacer::attachPresentId(VkPresentInfoKHR& presentInfo, Clock::time_point submitTime) {
+	if (!m_vkWaitForPresentKHR) {
+		return;
+	}
+	m_presentId++;
+	m_submitTimes[m_presentId % TRACKED_PRESENTS] = submitTime;
+	m_presentIdInfo = {};
+	m_presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+	m_presentIdInfo.pNext = presentInfo.pNext;
+	m_presentIdInfo.swapchainCount = 1;
+	m_presentIdInfo.pPresentIds = &m_presentId;
+	presentInfo.pNext = &m_presentIdInfo;
+}
+
+void FramePacer::framePresented() {
+	auto now = Clock::now();
+	if (m_hasLastPresent) {
+		m_frameTimes.add(millisecondsBetween(m_lastPresent, now));
+	}
+	m_lastPresent = now;
+	m_hasLastPresent = true;
+}
+
+void FramePacer::swapChainRecreated() {
+	m_firstSwapChainPresentId = m_presentId + 1; // ids keep increasing, but the new swap chain never displayed the older ones
+	m_hasLastDisplayed = false;
+	m_hasLastPresent = false; // the recreation isn't part of a frame time
+}
+
+void FramePacer::idled() {
+	m_hasLastDisplayed = false;
+	m_hasLastPresent = false;
+	m_nextDeadline = Clock::time_point{};
+}
+
+void FramePacer::print(std::ostream& out, VkPresentModeKHR presentMode) const {
+	out << "frame time p50 " << m_frameTimes.percentile(50) << " ms, p95 " << m_frameTimes.percentile(95)
+		<< " ms, p99 " << m_frameTimes.percentile(99) << " ms";
+	if (m_displayIntervals.count > 0) {
+		out << ", display interval p50 " << m_displayIntervals.percentile(50) << " ms, p95 " << m_displayIntervals.percentile(95)
+			<< " ms, p99 " << m_displayIntervals.percentile(99) << " ms";
+	}
+	if (m_submitToDisplay.count > 0) {
+		out << ", submit to display p50 " << m_submitToDisplay.percentile(50) << " ms, p95 " << m_submitToDisplay.percentile(95)
+			<< " ms, p99 " << m_submitToDisplay.percentile(99) << " ms";
+	}
+	out << " (" << SwapChain::presentModeName(presentMode) << ", ";
+	if (m_targetFrameRate > 0.0) {
+		out << "limited to " << m_targetFrameRate << " fps)" << std::endl;
+	}
+	else {
+		out << "unlimited)" << std::endl;
+	}
+}
+
+void FramePacer::reset() {
+	m_frameTimes.reset();
+	m_displayIntervals.reset();
+	m_submitToDisplay.reset();
+}
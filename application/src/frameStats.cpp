@@ -0,0 +1,77 @@
+#include "frameStats.hpp"
+#include <algorithm>
+
+void TimingStat::add(double ms) {
+	totalMs += ms;
+	maxMs = std::max(maxMs, ms);
+	count++;
+}
+
+static double millisecondsSince(FrameStats::Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(FrameStats::Clock::now() - start).count();
+}
+
+void FrameStats::recordFrameWait(Clock::time_point start) {
+	m_frameWait.add(millisecondsSince(start));
+}
+
+void FrameStats::frameAcquired(uint32_t frame) {
+	m_acquireTimes[frame] = Clock::now();
+	m_pending[frame] = false; // set again once the frame is submitted and presented
+}
+
+void FrameStats::frameSubmitted(uint32_t frame, Clock::time_point sceneSample, Clock::time_point cameraSample) {
+	m_submitTimes[frame] = Clock::now();
+	m_sceneSampleToSubmit.add(std::chrono::duration<double, std::milli>(m_submitTimes[frame] - sceneSample).count());
+	m_cameraSampleToSubmit.add(std::chrono::duration<double, std::milli>(m_submitTimes[frame] - cameraSample).count());
+}
+
+void FrameStats::framePresented(uint32_t frame) {
+	m_acquireToPresent.add(millisecondsSince(m_acquireTimes[frame]));
+	m_pending[frame] = true;
+}
+
+void FrameStats::frameRetired(uint32_t frame) {
+	if (!m_pending[frame]) {
+		return;
+	}
+	m_acquireToRetire.add(millisecondsSince(m_acquireTimes[frame]));
+	m_submitToRetire.add(millisecondsSince(m_submitTimes[frame]));
+	m_pending[frame] = false;
+}
+
+void FrameStats::frameRecorded(bool replayed) {
+	(replayed ? m_replayedFrames : m_recordedFrames)++;
+}
+
+void FrameStats::recordUpdate(Clock::time_point start, bool rebuilt) {
+	m_update.add(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+	if (rebuilt) {
+		m_rebuiltFrames++;
+	}
+}
+
+void FrameStats::print(std::ostream& out, uint32_t framesInFlight) const {
+	out << "frames in flight: " << framesInFlight
+		<< ", frame wait " << m_frameWait.average() << " ms (max " << m_frameWait.maxMs << ")"
+		<< ", acquire to present " << m_acquireToPresent.average() << " ms (max " << m_acquireToPresent.maxMs << ")"
+		<< ", acquire to GPU done " << m_acquireToRetire.average() << " ms (max " << m_acquireToRetire.maxMs << ")"
+		<< ", scene sample to submit " << m_sceneSampleToSubmit.average() << " ms (max " << m_sceneSampleToSubmit.maxMs << ")"
+		<< ", camera sample to submit " << m_cameraSampleToSubmit.average() << " ms (max " << m_cameraSampleToSubmit.maxMs << ")"
+		<< ", submit to GPU done " << m_submitToRetire.average() << " ms (max " << m_submitToRetire.maxMs << ")"
+		<< ", update " << m_update.average() << " ms (max " << m_update.maxMs << ") with " << m_rebuiltFrames << " draw lists built"
+		<< ", " << m_recordedFrames << " frames recorded, " << m_replayedFrames << " replayed" << std::endl;
+}
+
+void FrameStats::reset() {
+	m_frameWait = TimingStat{};
+	m_acquireToPresent = TimingStat{};
+	m_acquireToRetire = TimingStat{};
+	m_sceneSampleToSubmit = TimingStat{};
+	m_cameraSampleToSubmit = TimingStat{};
+	m_submitToRetire = TimingStat{};
+	m_update = TimingStat{};
+	m_rebuiltFrames = 0;
+	m_recordedFrames = 0;
+	m_replayedFrames = 0;
+}
@@ -0,0 +1,242 @@
+#include "frustumCuller.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_AMD64) || defined(_M_IX86)
+#include <immintrin.h>
+#define CULLING_USE_AVX2 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CULLING_AVX2_TARGET // MSVC compiles AVX2 intrinsics without a target switch
+#else
+#define CULLING_AVX2_TARGET __attribute__((target("avx2"))) // only these functions, the rest of the build keeps its baseline
+#endif
+#endif
+
+namespace {
+	/**
+	 * @struct PlaneArrays
+	 * @brief The frustum planes split by component, with the absolute normals the box test needs.
+	 */
+	struct PlaneArrays {
+		float x[6];
+		float y[6];
+		float z[6];
+		float w[6];
+		float absX[6];
+		float absY[6];
+		float absZ[6];
+	};
+
+	PlaneArrays makePlaneArrays(const Frustum& frustum) {
+		PlaneArrays planes{};
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			planes.x[p] = plane.x;
+			planes.y[p] = plane.y;
+			planes.z[p] = plane.z;
+			planes.w[p] = plane.w;
+			planes.absX[p] = std::abs(plane.x);
+			planes.absY[p] = std::abs(plane.y);
+			planes.absZ[p] = std::abs(plane.z);
+		}
+		return planes;
+	}
+
+	/**
+	 * @brief Tests one object, the sphere first and the box only if the sphere intersects the frustum.
+	 */
+	bool isVisible(const PlaneArrays& planes, const CullInput& input, size_t i) {
+		if (input.enabled && input.enabled[i] == 0) {
+			return false;
+		}
+		float cx = input.centerX[i];
+		float cy = input.centerY[i];
+		float cz = input.centerZ[i];
+		for (int p = 0; p < 6; p++) {
+			if (planes.x[p] * cx + planes.y[p] * cy + planes.z[p] * cz + planes.w[p] < -input.radius[i]) {
+				return false; // entirely behind one plane
+			}
+		}
+		if (input.extentX) {
+			for (int p = 0; p < 6; p++) {
+				float boxRadius = planes.absX[p] * input.extentX[i] + planes.absY[p] * input.extentY[i] + planes.absZ[p] * input.extentZ[i]; // extent of the box along the normal
+				if (planes.x[p] * cx + planes.y[p] * cy + planes.z[p] * cz + planes.w[p] < -boxRadius) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Culls [first, last) one object at a time.
+	 * @return Number of indices written to out.
+	 */
+	size_t cullRangeScalar(const PlaneArrays& planes, const CullInput& input, size_t first, size_t last, uint32_t* out) {
+		size_t count = 0;
+		for (size_t i = first; i < last; i++) {
+			if (isVisible(planes, input, i)) {
+				out[count++] = static_cast<uint32_t>(i);
+			}
+		}
+		return count;
+	}
+
+#ifdef CULLING_USE_AVX2
+	/**
+	 * @brief Culls [first, last) eight objects at a time, the remainder one at a time.
+	 * @return Number of indices written to out.
+	 */
+	CULLING_AVX2_TARGET size_t cullRangeAvx2(const PlaneArrays& planes, const CullInput& input, size_t first, size_t last, uint32_t* out) {
+		__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; p++) { // broadcast once per chunk
+			planeX[p] = _mm256_set1_ps(planes.x[p]);
+			planeY[p] = _mm256_set1_ps(planes.y[p]);
+			planeZ[p] = _mm256_set1_ps(planes.z[p]);
+			planeW[p] = _mm256_set1_ps(planes.w[p]);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+
+		size_t count = 0;
+		size_t i = first;
+		for (; i + 8 <= last; i += 8) {
+			int mask = 0xFF; // lanes still visible
+			if (input.enabled) {
+				__m256i flags = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(input.enabled + i)));
+				mask &= ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(flags, _mm256_setzero_si256())));
+				if (mask == 0) {
+					continue; // eight hidden objects, common in large scenes with hidden layers
+				}
+			}
+
+			__m256 cx = _mm256_loadu_ps(input.centerX + i);
+			__m256 cy = _mm256_loadu_ps(input.centerY + i);
+			__m256 cz = _mm256_loadu_ps(input.centerZ + i);
+			__m256 negativeRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(input.radius + i));
+			__m256 distances[6];
+			__m256 outside = zero;
+			for (int p = 0; p < 6; p++) {
+				distances[p] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+					_mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeW[p]));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(distances[p], negativeRadius, _CMP_LT_OQ));
+			}
+			mask &= ~_mm256_movemask_ps(outside);
+
+			if (mask != 0 && input.extentX) { // some spheres intersect, the boxes may still be outside
+				__m256 ex = _mm256_loadu_ps(input.extentX + i);
+				__m256 ey = _mm256_loadu_ps(input.extentY + i);
+				__m256 ez = _mm256_loadu_ps(input.extentZ + i);
+				outside = zero;
+				for (int p = 0; p < 6; p++) {
+					__m256 boxRadius = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.absX[p]), ex),
+						_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.absY[p]), ey), _mm256_mul_ps(_mm256_set1_ps(planes.absZ[p]), ez)));
+					outside = _mm256_or_ps(outside, _mm256_cmp_ps(distances[p], _mm256_sub_ps(zero, boxRadius), _CMP_LT_OQ)); // the centers are shared, so are the distances
+				}
+				mask &= ~_mm256_movemask_ps(outside);
+			}
+
+			while (mask != 0) {
+				out[count++] = static_cast<uint32_t>(i + std::countr_zero(static_cast<unsigned>(mask)));
+				mask &= mask - 1;
+			}
+		}
+		return count + cullRangeScalar(planes, input, i, last, out + count);
+	}
+#endif
+
+	bool detectAvx2() {
+#ifdef CULLING_USE_AVX2
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		__cpuid(info, 1);
+		bool osSavesRegisters = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0; // OSXSAVE and AVX
+		if (!osSavesRegisters || (_xgetbv(0) & 0x6) != 0x6) { // the OS must save the ymm registers on context switches
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2"); // checks the OS support too
+#endif
+#else
+		return false;
+#endif
+	}
+}
+
+Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection) {
+	// a point is inside when -w <= x, y, z <= w in clip space, each inequality is a plane on the rows of the matrix
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++) {
+		rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+	}
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0]; // left
+	frustum.planes[1] = rows[3] - rows[0]; // right
+	frustum.planes[2] = rows[3] + rows[1]; // bottom
+	frustum.planes[3] = rows[3] - rows[1]; // top
+	frustum.planes[4] = rows[3] + rows[2]; // near
+	frustum.planes[5] = rows[3] - rows[2]; // far
+	for (glm::vec4& plane : frustum.planes) {
+		plane /= glm::length(glm::vec3(plane)); // unit normals, so distances compare with radii
+	}
+	return frustum;
+}
+
+FrustumCuller::FrustumCuller(JobSystem& jobSystem) : m_jobSystem(jobSystem), m_useAvx2(isAvx2Supported()) {
+}
+
+bool FrustumCuller::isAvx2Supported() {
+	static const bool supported = detectAvx2();
+	return supported;
+}
+
+void FrustumCuller::setUseAvx2(bool useAvx2) {
+	m_useAvx2 = useAvx2 && isAvx2Supported();
+}
+
+void FrustumCuller::cull(const Frustum& frustum, const CullInput& input, std::vector<uint32_t>& visible) {
+	auto start = std::chrono::high_resolution_clock::now();
+	PlaneArrays planes = makePlaneArrays(frustum);
+	size_t chunkCount = (input.count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	m_scratch.resize(input.count);
+	m_chunkCounts.assign(chunkCount, 0);
+
+	[[maybe_unused]] bool useAvx2 = m_useAvx2;
+	m_jobSystem.parallelFor(input.count, CHUNK_SIZE, [&](size_t first, size_t last) {
+		uint32_t* out = m_scratch.data() + first; // chunks never write past their own range
+#ifdef CULLING_USE_AVX2
+		size_t count = useAvx2 ? cullRangeAvx2(planes, input, first, last, out) : cullRangeScalar(planes, input, first, last, out);
+#else
+		size_t count = cullRangeScalar(planes, input, first, last, out);
+#endif
+		m_chunkCounts[first / CHUNK_SIZE] = static_cast<uint32_t>(count);
+	});
+
+	size_t total = 0;
+	for (uint32_t count : m_chunkCounts) {
+		total += count;
+	}
+	visible.resize(total);
+	size_t offset = 0;
+	for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+		if (m_chunkCounts[chunk] > 0) {
+			std::memcpy(visible.data() + offset, m_scratch.data() + chunk * CHUNK_SIZE, m_chunkCounts[chunk] * sizeof(uint32_t));
+			offset += m_chunkCounts[chunk];
+		}
+	}
+
+	m_stats.tested = input.count;
+	m_stats.visible = total;
+	m_stats.chunks = chunkCount;
+	m_stats.cullMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
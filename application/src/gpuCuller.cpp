@@ -0,0 +1,317 @@
+#include "gpuCuller.hpp"
+#include "embeddedShaders/cullInstancesComp.hpp"
+#include "embeddedShaders/compactDrawsComp.hpp"
+#include "embeddedShaders/cullOccludedComp.hpp"
+#include "instanceBuffers.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+	const uint32_t STORAGE_BINDING_COUNT = 10; ///< Params, candidates, batches, groups, visible instances, counters, draw commands, draw counts, early drawn, visibility.
+	const uint32_t UNIFORM_BINDING = 10; ///< Camera, projects the boxes of the late phase.
+	const uint32_t DEPTH_PYRAMID_BINDING = 11; ///< Sampled by the late phase.
+	const uint32_t BINDING_COUNT = 12;
+	const VkDeviceSize COUNTER_HEADER_SIZE = sizeof(GpuCullStats); ///< Stats, before the batch counts.
+
+	/**
+	 * @brief Capacity holding count elements, doubled from the current one so a growing scene replaces the buffers rarely.
+	 */
+	uint32_t grow(uint32_t capacity, size_t count) {
+		capacity = std::max(capacity, INITIAL_DRAW_BATCH_CAPACITY);
+		while (capacity < count) {
+			capacity *= 2;
+		}
+		return capacity;
+	}
+
+	VkMemoryBarrier2 memoryBarrier(VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess) {
+		VkMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = srcStages;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstStageMask = dstStages;
+		barrier.dstAccessMask = dstAccess;
+		return barrier;
+	}
+
+	void pipelineBarrier(VkCommandBuffer commandBuffer, const VkMemoryBarrier2& barrier) {
+		VkDependencyInfo dependencyInfo{};
+		dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependencyInfo.memoryBarrierCount = 1;
+		dependencyInfo.pMemoryBarriers = &barrier;
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo); // global barriers, the buffers are only used by this frame
+	}
+}
+
+GpuCuller::GpuCuller(VkDevice device, VkPhysicalDevice physicalDevice, PipelineLibrary& pipelineLibrary, const std::vector<VkBuffer>& uniformBuffers, bool occlusion)
+	: m_device(device), m_physicalDevice(physicalDevice), m_uniformBuffers(uniformBuffers), m_occlusion(occlusion) {
+	createDescriptorSetLayout();
+	createPipelineLayout();
+
+	const std::array<PoolSizeRatio, 3> ratios = { {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<float>(STORAGE_BINDING_COUNT) },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f },
+	} };
+	m_setAllocator = std::make_shared<DescriptorAllocator>(m_device, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT), ratios);
+
+	m_cullPipeline = pipelineLibrary.createComputePipeline("cullInstances.comp", EmbeddedShaders::cullInstancesComp, m_pipelineLayout);
+	m_compactPipeline = pipelineLibrary.createComputePipeline("compactDraws.comp", EmbeddedShaders::compactDrawsComp, m_pipelineLayout);
+	if (m_occlusion) {
+		m_occlusionPipeline = pipelineLibrary.createComputePipeline("cullOccluded.comp", EmbeddedShaders::cullOccludedComp, m_pipelineLayout); // the only one using the camera and the pyramid
+	}
+
+	m_frames.resize(MAX_FRAMES_IN_FLIGHT);
+	for (FrameResources& frame : m_frames) {
+		reserve(frame.params, sizeof(GPUCullParams), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, true, nullptr);
+		reserve(frame.readback, COUNTER_HEADER_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, true, nullptr);
+		memset(frame.params.mapped, 0, sizeof(GPUCullParams)); // dispatches nothing until the first update()
+		memset(frame.readback.mapped, 0, COUNTER_HEADER_SIZE);
+		frame.descriptorSet = m_setAllocator->allocate(m_descriptorSetLayout);
+	}
+}
+
+void GpuCuller::destroyGpuCuller(DeletionQueue& deletionQueue) {
+	for (FrameResources& frame : m_frames) {
+		for (Buffer* buffer : { &frame.params, &frame.batches, &frame.groups, &frame.visibleInstances, &frame.counters, &frame.drawCommands, &frame.drawCounts, &frame.earlyDrawn, &frame.readback }) {
+			retire(*buffer, deletionQueue);
+		}
+	}
+	m_frames.clear();
+	retire(m_visibility, deletionQueue);
+	m_setAllocator->destroyDescriptorAllocator(deletionQueue);
+	vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr); // only used while recording
+	vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+}
+
+bool GpuCuller::update(uint32_t frame, VkBuffer instanceBuffer, uint32_t instanceCount, uint32_t orderedInstanceStart, const std::vector<GPUDrawBatch>& batches,
+	const std::vector<GPUDrawGroup>& groups, uint64_t drawListVersion, uint32_t objectCount, VkExtent2D viewport, DeletionQueue& deletionQueue) {
+	FrameResources& resources = m_frames.at(frame);
+	memcpy(&m_stats, resources.readback.mapped, sizeof(GpuCullStats)); // written by the slot's last submission, which retired
+	m_frameNumber++;
+
+	// sized for at least one element, so every descriptor references a buffer
+	VkDeviceSize instances = std::max<VkDeviceSize>(instanceCount, INITIAL_INSTANCE_CAPACITY);
+	uint32_t batchCapacity = grow(resources.batchCapacity, batches.size()); // the late phase's commands and counts start at the capacities
+	uint32_t groupCapacity = grow(resources.groupCapacity, groups.size());
+	bool replaced = batchCapacity != resources.batchCapacity || groupCapacity != resources.groupCapacity; // the recorded draws use the offsets
+	resources.batchCapacity = batchCapacity;
+	resources.groupCapacity = groupCapacity;
+	replaced |= reserve(resources.batches, batchCapacity * sizeof(GPUDrawBatch), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true, &deletionQueue);
+	replaced |= reserve(resources.groups, groupCapacity * sizeof(GPUDrawGroup), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true, &deletionQueue);
+	replaced |= reserve(resources.visibleInstances, instances * sizeof(GPUInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false, &deletionQueue);
+	replaced |= reserve(resources.counters, COUNTER_HEADER_SIZE + 2 * batchCapacity * sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false, &deletionQueue);
+	replaced |= reserve(resources.drawCommands, 2 * batchCapacity * sizeof(VkDrawIndexedIndirectCommand),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, false, &deletionQueue);
+	replaced |= reserve(resources.drawCounts, 2 * groupCapacity * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, false, &deletionQueue);
+	replaced |= reserve(resources.earlyDrawn, instances * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false, &deletionQueue);
+	// every frame in flight shares it, the other slots' sets are pointed at the new one by their own update(), and
+	// the lost contents only cost a frame where the early phase draws nothing and the late phase draws everything
+	reserve(m_visibility, std::max<VkDeviceSize>(objectCount, 1) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false, &deletionQueue);
+	bool pyramidChanged = m_occlusion && resources.depthPyramid != m_depthPyramidView;
+	if (replaced || pyramidChanged || resources.instanceBuffer != instanceBuffer || resources.visibility != m_visibility.buffer) {
+		resources.instanceBuffer = instanceBuffer;
+		writeDescriptorSet(resources, frame); // the slot retired, its set isn't in use
+		replaced = true;
+	}
+
+	GPUCullParams params{};
+	params.cullDispatch = { (instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1 };
+	params.compactDispatch = { (static_cast<uint32_t>(groups.size()) + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1 };
+	params.instanceCount = instanceCount;
+	params.orderedInstanceStart = orderedInstanceStart;
+	params.groupCount = static_cast<uint32_t>(groups.size());
+	params.frameNumber = m_frameNumber;
+	params.occlusion = m_occlusion ? 1 : 0;
+	params.batchCapacity = batchCapacity;
+	params.groupCapacity = groupCapacity;
+	params.viewportWidth = viewport.width;
+	params.viewportHeight = viewport.height; // the planes follow in setFrustum()
+	memcpy(resources.params.mapped, &params, sizeof(params)); // host coherent, the submit makes the writes visible
+	if (replaced || resources.drawListVersion != drawListVersion) { // a replaced buffer starts empty
+		if (!batches.empty()) {
+			memcpy(resources.batches.mapped, batches.data(), batches.size() * sizeof(GPUDrawBatch));
+		}
+		if (!groups.empty()) {
+			memcpy(resources.groups.mapped, groups.data(), groups.size() * sizeof(GPUDrawGroup));
+		}
+		resources.drawListVersion = drawListVersion;
+	}
+	return replaced;
+}
+
+void GpuCuller::setFrustum(uint32_t frame, const Frustum& frustum) {
+	const FrameResources& resources = m_frames.at(frame);
+	memcpy(static_cast<char*>(resources.params.mapped) + offsetof(GPUCullParams, planes), frustum.planes.data(), sizeof(frustum.planes));
+}
+
+void GpuCuller::setDepthPyramid(VkImageView view, VkSampler sampler) {
+	m_depthPyramidView = view;
+	m_depthPyramidSampler = sampler; // frames in flight keep the old pyramid until their slot's update()
+}
+
+void GpuCuller::recordEarly(VkCommandBuffer commandBuffer, uint32_t frame) const {
+	const FrameResources& resources = m_frames.at(frame);
+
+	// the batch counts are the append cursors of the cull shader, they start at zero every frame, and the previous
+	// frame's late phase must have written the visibility the early phase reads
+	vkCmdFillBuffer(commandBuffer, resources.counters.buffer, 0, VK_WHOLE_SIZE, 0);
+	pipelineBarrier(commandBuffer, memoryBarrier(VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT));
+
+	recordPhase(commandBuffer, resources, *m_cullPipeline, 0);
+	if (!m_occlusion) {
+		recordStatsCopy(commandBuffer, resources);
+	}
+}
+
+void GpuCuller::recordLate(VkCommandBuffer commandBuffer, uint32_t frame) const {
+	const FrameResources& resources = m_frames.at(frame);
+	recordPhase(commandBuffer, resources, *m_occlusionPipeline, 1); // the early phase's barrier covers its counts, the pyramid's covers the image
+	recordStatsCopy(commandBuffer, resources);
+}
+
+void GpuCuller::recordPhase(VkCommandBuffer commandBuffer, const FrameResources& resources, const Pipeline& cullPipeline, uint32_t phase) const {
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &resources.descriptorSet, 0, nullptr); // the pyramid reduction binds its own between the phases
+	vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(phase), &phase);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.getPipeline());
+	vkCmdDispatchIndirect(commandBuffer, resources.params.buffer, offsetof(GPUCullParams, cullDispatch)); // the size changes without recording again
+
+	pipelineBarrier(commandBuffer, memoryBarrier(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT));
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_compactPipeline->getPipeline()); // same layout, the set and phase stay bound
+	vkCmdDispatchIndirect(commandBuffer, resources.params.buffer, offsetof(GPUCullParams, compactDispatch));
+
+	VkPipelineStageFlags2 dstStages = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT;
+	VkAccessFlags2 dstAccess = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT;
+	if (m_occlusion && phase == 0) {
+		dstStages |= VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT; // the late phase appends after the early survivors
+		dstAccess |= VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	}
+	pipelineBarrier(commandBuffer, memoryBarrier(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, dstStages, dstAccess));
+}
+
+void GpuCuller::recordStatsCopy(VkCommandBuffer commandBuffer, const FrameResources& resources) const {
+	VkBufferCopy copyRegion{};
+	copyRegion.size = COUNTER_HEADER_SIZE;
+	vkCmdCopyBuffer(commandBuffer, resources.counters.buffer, resources.readback.buffer, 1, &copyRegion); // stats, read when the slot comes around again
+	pipelineBarrier(commandBuffer, memoryBarrier(VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT));
+}
+
+void GpuCuller::createDescriptorSetLayout() {
+	std::array<VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings{};
+	for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i == UNIFORM_BINDING ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+			: i == DEPTH_PYRAMID_BINDING ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT; // each shader uses a subset
+		bindings[i].pImmutableSamplers = nullptr;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling descriptor set layout!");
+	}
+}
+
+void GpuCuller::createPipelineLayout() {
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(uint32_t); // the phase, everything that changes per frame is in the params buffer
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling pipeline layout!");
+	}
+}
+
+bool GpuCuller::reserve(Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible, DeletionQueue* deletionQueue) {
+	if (buffer.buffer != VK_NULL_HANDLE && buffer.size >= size) {
+		return false;
+	}
+	if (deletionQueue) {
+		retire(buffer, *deletionQueue); // only this slot used it and its frames retired
+	}
+	VkDeviceSize capacity = std::max<VkDeviceSize>(buffer.size, size);
+	if (buffer.size != 0) {
+		capacity = buffer.size;
+		while (capacity < size) {
+			capacity *= 2; // amortizes a growing scene
+		}
+	}
+	VkMemoryPropertyFlags properties = hostVisible ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	BufferUtils::createBuffer(m_device, m_physicalDevice, capacity, usage, properties, buffer.buffer, buffer.memory);
+	buffer.size = capacity;
+	buffer.mapped = nullptr;
+	if (hostVisible && vkMapMemory(m_device, buffer.memory, 0, capacity, 0, &buffer.mapped) != VK_SUCCESS) {
+		throw std::runtime_error("failed to map culling buffer memory!");
+	}
+	return true;
+}
+
+void GpuCuller::retire(Buffer& buffer, DeletionQueue& deletionQueue) {
+	deletionQueue.destroyBuffer(buffer.buffer);
+	deletionQueue.freeMemory(buffer.memory); // unmaps it
+	buffer.buffer = VK_NULL_HANDLE;
+	buffer.memory = VK_NULL_HANDLE;
+	buffer.mapped = nullptr;
+}
+
+void GpuCuller::writeDescriptorSet(FrameResources& frame, uint32_t frameIndex) {
+	frame.visibility = m_visibility.buffer;
+	frame.depthPyramid = m_depthPyramidView;
+	const std::array<VkBuffer, STORAGE_BINDING_COUNT> buffers = { frame.params.buffer, frame.instanceBuffer, frame.batches.buffer, frame.groups.buffer,
+		frame.visibleInstances.buffer, frame.counters.buffer, frame.drawCommands.buffer, frame.drawCounts.buffer, frame.earlyDrawn.buffer, frame.visibility };
+	std::array<VkDescriptorBufferInfo, BINDING_COUNT> bufferInfos{};
+	std::array<VkWriteDescriptorSet, BINDING_COUNT> writes{};
+	for (uint32_t i = 0; i < STORAGE_BINDING_COUNT; i++) {
+		bufferInfos[i].buffer = buffers[i];
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE; // the buffers grow with the scene
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = frame.descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].dstArrayElement = 0;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	uint32_t writeCount = STORAGE_BINDING_COUNT;
+	VkDescriptorImageInfo imageInfo{};
+	if (m_occlusion) { // only cullOccluded.comp uses them, the sets stay partially written without it
+		bufferInfos[UNIFORM_BINDING].buffer = m_uniformBuffers.at(frameIndex);
+		bufferInfos[UNIFORM_BINDING].offset = 0;
+		bufferInfos[UNIFORM_BINDING].range = sizeof(UBO);
+		writes[UNIFORM_BINDING] = writes[0];
+		writes[UNIFORM_BINDING].dstBinding = UNIFORM_BINDING;
+		writes[UNIFORM_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writes[UNIFORM_BINDING].pBufferInfo = &bufferInfos[UNIFORM_BINDING];
+
+		imageInfo.sampler = m_depthPyramidSampler;
+		imageInfo.imageView = m_depthPyramidView;
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL; // the pyramid never leaves it
+		writes[DEPTH_PYRAMID_BINDING] = writes[0];
+		writes[DEPTH_PYRAMID_BINDING].dstBinding = DEPTH_PYRAMID_BINDING;
+		writes[DEPTH_PYRAMID_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[DEPTH_PYRAMID_BINDING].pBufferInfo = nullptr;
+		writes[DEPTH_PYRAMID_BINDING].pImageInfo = &imageInfo;
+		writeCount = BINDING_COUNT;
+	}
+	vkUpdateDescriptorSets(m_device, writeCount, writes.data(), 0, nullptr);
+}
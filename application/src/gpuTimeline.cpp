@@ -0,0 +1,84 @@
+#include "gpuTimeline.hpp"
+#include <stdexcept>
+
+GpuTimeline::GpuTimeline(VkDevice device) : m_device(device) {
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphore) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create timeline semaphore!");
+	}
+}
+
+VkSemaphoreSubmitInfo GpuTimeline::semaphoreInfo(VkSemaphore semaphore, VkPipelineStageFlags2 stages, uint64_t value) {
+	VkSemaphoreSubmitInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	info.semaphore = semaphore;
+	info.value = value;
+	info.stageMask = stages;
+	return info;
+}
+
+uint64_t GpuTimeline::submit(VkQueue queue, VkCommandBuffer commandBuffer, const std::vector<VkSemaphoreSubmitInfo>& waits, const std::vector<VkSemaphoreSubmitInfo>& signals) {
+	uint64_t value = m_lastSubmitted + 1;
+
+	std::vector<VkSemaphoreSubmitInfo> allSignals = signals;
+	allSignals.push_back(semaphoreInfo(m_semaphore, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, value)); // after everything the submission does
+
+	VkCommandBufferSubmitInfo commandBufferInfo{};
+	commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+	commandBufferInfo.commandBuffer = commandBuffer;
+
+	VkSubmitInfo2 submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(waits.size());
+	submitInfo.pWaitSemaphoreInfos = waits.data();
+	submitInfo.commandBufferInfoCount = 1;
+	submitInfo.pCommandBufferInfos = &commandBufferInfo;
+	submitInfo.signalSemaphoreInfoCount = static_cast<uint32_t>(allSignals.size());
+	submitInfo.pSignalSemaphoreInfos = allSignals.data();
+
+	if (vkQueueSubmit2(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit command buffer!");
+	}
+	m_lastSubmitted = value; // only advance once the signal is queued, a failed submit never signals
+	return value;
+}
+
+void GpuTimeline::wait(uint64_t value) {
+	if (value <= m_completed) {
+		return;
+	}
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_semaphore;
+	waitInfo.pValues = &value;
+	if (vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+		throw std::runtime_error("failed to wait for timeline semaphore!");
+	}
+	m_completed = value;
+}
+
+bool GpuTimeline::isComplete(uint64_t value) {
+	return value <= m_completed || value <= getCompletedValue();
+}
+
+uint64_t GpuTimeline::getCompletedValue() {
+	uint64_t value = 0;
+	if (vkGetSemaphoreCounterValue(m_device, m_semaphore, &value) == VK_SUCCESS && value > m_completed) {
+		m_completed = value;
+	}
+	return m_completed;
+}
+
+void GpuTimeline::destroyGpuTimeline() {
+	vkDestroySemaphore(m_device, m_semaphore, nullptr);
+	m_semaphore = VK_NULL_HANDLE;
+}
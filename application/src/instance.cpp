@@ -12,7 +12,7 @@ VKInstance::VKInstance() {
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = VK_API_VERSION_1_3; // dynamic rendering and synchronization2 are core in 1.3
 
 	VkInstanceCreateInfo createInfo{}; // non-optional struct
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -0,0 +1,58 @@
+#include "instanceBuffers.hpp"
+#include <cstring>
+#include <stdexcept>
+
+InstanceBuffers::InstanceBuffers(VkDevice device, VkPhysicalDevice physicalDevice) : m_device(device), m_physicalDevice(physicalDevice) {
+	m_instanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	m_instanceBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+	m_instanceBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+	m_capacities.resize(MAX_FRAMES_IN_FLIGHT);
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		createInstanceBuffer(i, INITIAL_INSTANCE_CAPACITY);
+	}
+}
+
+void InstanceBuffers::destroyInstanceBuffers(DeletionQueue& deletionQueue) {
+	for (size_t i = 0; i < m_instanceBuffers.size(); i++) {
+		deletionQueue.destroyBuffer(m_instanceBuffers[i]);
+		deletionQueue.freeMemory(m_instanceBuffersMemory[i]); // unmaps it
+	}
+	m_instanceBuffers.clear();
+	m_instanceBuffersMemory.clear();
+	m_instanceBuffersMapped.clear();
+	m_capacities.clear();
+}
+
+bool InstanceBuffers::updateInstanceBuffer(uint32_t frame, const std::vector<GPUInstance>& instances, DeletionQueue& deletionQueue) {
+	bool replaced = false;
+	if (instances.size() > m_capacities.at(frame)) {
+		uint32_t capacity = m_capacities[frame];
+		while (capacity < instances.size()) {
+			capacity *= 2; // amortizes a growing scene
+		}
+		deletionQueue.destroyBuffer(m_instanceBuffers[frame]); // only this slot used it and its frames retired, queued like every replaced resource
+		deletionQueue.freeMemory(m_instanceBuffersMemory[frame]);
+		createInstanceBuffer(frame, capacity);
+		replaced = true;
+	}
+	if (!instances.empty()) {
+		memcpy(m_instanceBuffersMapped[frame], instances.data(), instances.size() * sizeof(GPUInstance)); // host coherent, the submit makes the write visible
+	}
+	return replaced;
+}
+
+VkBuffer InstanceBuffers::getInstanceBuffer(uint32_t frame) const {
+	if (frame < m_instanceBuffers.size()) {
+		return m_instanceBuffers[frame];
+	}
+	throw std::out_of_range("Index out of range for instance buffers");
+}
+
+void InstanceBuffers::createInstanceBuffer(uint32_t frame, uint32_t capacity) {
+	VkDeviceSize bufferSize = static_cast<VkDeviceSize>(capacity) * sizeof(GPUInstance);
+	BufferUtils::createBuffer(m_device, m_physicalDevice, bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_instanceBuffers[frame], m_instanceBuffersMemory[frame]);
+	if (vkMapMemory(m_device, m_instanceBuffersMemory[frame], 0, bufferSize, 0, &m_instanceBuffersMapped[frame]) != VK_SUCCESS) {
+		throw std::runtime_error("failed to map instance buffer memory!");
+	}
+	m_capacities[frame] = capacity;
+}
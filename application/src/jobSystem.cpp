@@ -0,0 +1,232 @@
+#include "jobSystem.hpp"
+#include <iostream>
+
+namespace {
+	thread_local const JobSystem* t_owner = nullptr; ///< Job system the calling thread is a worker of.
+	thread_local size_t t_workerIndex = SIZE_MAX; ///< Index of the calling worker in its job system.
+}
+
+JobSystem::JobSystem(size_t workerCount) {
+	if (workerCount == DEFAULT_WORKER_COUNT) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1; // leave a core for the main thread
+	}
+	for (size_t i = 0; i < workerCount; i++) {
+		m_queues.push_back(std::make_unique<WorkerQueue>());
+	}
+	for (size_t i = 0; i < workerCount; i++) {
+		m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (auto& thread : m_threads) {
+		thread.join();
+	}
+	Job job;
+	while (pop(job, SIZE_MAX, true)) { // without workers the queued jobs still run
+		execute(job);
+	}
+}
+
+size_t JobSystem::currentWorker() const {
+	return t_owner == this ? t_workerIndex : SIZE_MAX;
+}
+
+void JobSystem::run(std::function<void()> job, JobCounter* counter, JobPriority priority) {
+	if (counter) {
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+	push({ std::move(job), counter }, priority);
+}
+
+void JobSystem::runAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter) {
+	if (counter) {
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+	{
+		std::lock_guard<std::mutex> lock(dependency.m_mutex);
+		if (dependency.m_pending.load(std::memory_order_acquire) != 0) { // the last job of the dependency queues it when it finishes
+			dependency.m_continuations.push_back({ std::move(job), counter });
+			return;
+		}
+	}
+	push({ std::move(job), counter }, JobPriority::Normal);
+}
+
+void JobSystem::push(Job job, JobPriority priority) {
+	size_t self = currentWorker();
+	if (priority == JobPriority::Background) {
+		std::lock_guard<std::mutex> lock(m_sharedMutex);
+		m_backgroundJobs.push_back(std::move(job));
+	}
+	else if (self != SIZE_MAX) {
+		std::lock_guard<std::mutex> lock(m_queues[self]->mutex);
+		m_queues[self]->jobs.push_back(std::move(job));
+	}
+	else {
+		std::lock_guard<std::mutex> lock(m_sharedMutex);
+		m_sharedJobs.push_back(std::move(job));
+	}
+	m_queuedJobs.fetch_add(1, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex); // a worker between checking m_queuedJobs and sleeping can't miss the notification
+	}
+	m_wake.notify_one();
+}
+
+bool JobSystem::pop(Job& job, size_t self, bool includeBackground) {
+	if (m_queuedJobs.load(std::memory_order_acquire) == 0) {
+		return false;
+	}
+	auto take = [&](std::deque<Job>& jobs, bool back) {
+		if (jobs.empty()) {
+			return false;
+		}
+		m_activeJobs.fetch_add(1, std::memory_order_relaxed); // before the queued count drops, waitIdle() never sees both at zero
+		m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		if (back) {
+			job = std::move(jobs.back());
+			jobs.pop_back();
+		}
+		else {
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		return true;
+	};
+
+	if (self != SIZE_MAX) {
+		std::lock_guard<std::mutex> lock(m_queues[self]->mutex);
+		if (take(m_queues[self]->jobs, true)) { // newest first, its data is still in the cache
+			return true;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_sharedMutex);
+		if (take(m_sharedJobs, false)) {
+			return true;
+		}
+	}
+	size_t queueCount = m_queues.size();
+	size_t start = self != SIZE_MAX ? self + 1 : 0;
+	for (size_t i = 0; i < queueCount; i++) {
+		size_t victim = (start + i) % queueCount;
+		if (victim == self) {
+			continue;
+		}
+		std::lock_guard<std::mutex> lock(m_queues[victim]->mutex);
+		if (take(m_queues[victim]->jobs, false)) { // oldest first, usually the largest piece of work
+			return true;
+		}
+	}
+	if (includeBackground) {
+		std::lock_guard<std::mutex> lock(m_sharedMutex);
+		if (take(m_backgroundJobs, false)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::execute(Job& job) {
+	try {
+		job.function();
+	}
+	catch (...) {
+		if (job.counter) {
+			std::lock_guard<std::mutex> lock(job.counter->m_mutex);
+			if (!job.counter->m_error) {
+				job.counter->m_error = std::current_exception();
+			}
+		}
+		else {
+			try {
+				throw;
+			}
+			catch (const std::exception& e) {
+				std::cerr << "job failed: " << e.what() << std::endl;
+			}
+			catch (...) {
+				std::cerr << "job failed" << std::endl;
+			}
+		}
+	}
+	job.function = nullptr; // release what the job captured before it counts as finished
+
+	if (job.counter) {
+		std::vector<JobCounter::Continuation> continuations;
+		{
+			// a waiter can only see zero once the lock is released, and may destroy the counter right after,
+			// so the decrement, the continuations and the notification all happen before
+			std::lock_guard<std::mutex> lock(job.counter->m_mutex);
+			if (job.counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				continuations.swap(job.counter->m_continuations);
+				job.counter->m_done.notify_all();
+			}
+		}
+		for (JobCounter::Continuation& continuation : continuations) {
+			push({ std::move(continuation.function), continuation.counter }, JobPriority::Normal); // their counters were incremented by runAfter()
+		}
+	}
+
+	if (m_activeJobs.fetch_sub(1, std::memory_order_acq_rel) == 1 && m_queuedJobs.load(std::memory_order_acquire) == 0) {
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_idle.notify_all();
+	}
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	size_t self = currentWorker();
+	auto pending = [&counter]() { return counter.m_pending.load(std::memory_order_acquire) != 0; };
+	while (pending()) {
+		Job job;
+		if (pop(job, self, m_threads.empty())) { // background jobs could take far longer than what we wait for, unless nobody else runs them
+			execute(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(counter.m_mutex);
+		counter.m_done.wait_for(lock, std::chrono::microseconds(100), [&pending]() { return !pending(); }); // wakes up to help with new jobs
+	}
+	// decided under the lock: the last job released it, so it no longer touches the counter
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+	if (counter.m_error) {
+		std::exception_ptr error = counter.m_error;
+		counter.m_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::waitIdle() {
+	if (m_threads.empty()) {
+		Job job;
+		while (pop(job, SIZE_MAX, true)) {
+			execute(job);
+		}
+		return;
+	}
+	std::unique_lock<std::mutex> lock(m_sleepMutex);
+	m_idle.wait(lock, [this]() { return m_queuedJobs.load() == 0 && m_activeJobs.load() == 0; });
+}
+
+void JobSystem::workerLoop(size_t index) {
+	t_owner = this;
+	t_workerIndex = index;
+	while (true) {
+		Job job;
+		if (pop(job, index, true)) {
+			execute(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [this]() { return m_stopping || m_queuedJobs.load(std::memory_order_acquire) > 0; });
+		if (m_stopping && m_queuedJobs.load() == 0) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#include "mappedFile.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) {
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("failed to open file " + path + "!");
+	}
+	m_file = file;
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		throw std::runtime_error("failed to map empty file " + path + "!");
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		throw std::runtime_error("failed to map file " + path + "!");
+	}
+	m_mapping = mapping;
+
+	m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_data == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("failed to map file " + path + "!");
+	}
+}
+
+MappedFile::~MappedFile() {
+	UnmapViewOfFile(m_data);
+	CloseHandle(static_cast<HANDLE>(m_mapping));
+	CloseHandle(static_cast<HANDLE>(m_file));
+}
+#else
+MappedFile::MappedFile(const std::string& path) {
+	m_file = open(path.c_str(), O_RDONLY);
+	if (m_file < 0) {
+		throw std::runtime_error("failed to open file " + path + "!");
+	}
+
+	struct stat info {};
+	if (fstat(m_file, &info) != 0 || info.st_size == 0) {
+		close(m_file);
+		throw std::runtime_error("failed to map empty file " + path + "!");
+	}
+	m_size = static_cast<size_t>(info.st_size);
+
+	void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+	if (data == MAP_FAILED) {
+		close(m_file);
+		throw std::runtime_error("failed to map file " + path + "!");
+	}
+	m_data = data;
+}
+
+MappedFile::~MappedFile() {
+	munmap(const_cast<void*>(m_data), m_size);
+	close(m_file);
+}
+#endif
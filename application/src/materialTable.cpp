@@ -0,0 +1,128 @@
+#include "materialTable.hpp"
+#include <unordered_set>
+
+MaterialTable::MaterialTable(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, JobSystem& jobSystem)
+	: m_device(device),
+	m_physicalDevice(physicalDevice),
+	m_commandPool(commandPool),
+	m_queue(queue),
+	m_jobSystem(jobSystem)
+{
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+	m_textures.emplace_back(m_device, m_physicalDevice, m_commandPool, m_queue, white, 1, 1, VK_FORMAT_R8G8B8A8_UNORM); // default texture for unused slots
+}
+
+uint32_t MaterialTable::addTexture(const std::string& path, VkFormat format) {
+	auto found = m_textureLookup.find(path);
+	if (found != m_textureLookup.end()) {
+		return found->second; // already loaded
+	}
+	if (m_textures.size() >= MAX_MATERIAL_TEXTURES) {
+		throw std::runtime_error("material texture array is full!");
+	}
+	uint32_t index = static_cast<uint32_t>(m_textures.size());
+	m_textures.emplace_back(m_device, m_physicalDevice, m_commandPool, m_queue, path, format);
+	m_textureLookup[path] = index;
+	return index;
+}
+
+void MaterialTable::preloadTextures(const std::vector<TextureRequest>& requests) {
+	std::vector<const TextureRequest*> missing;
+	std::unordered_set<std::string> seen;
+	for (const TextureRequest& request : requests) {
+		if (!request.path.empty() && !m_textureLookup.count(request.path) && seen.insert(request.path).second) {
+			missing.push_back(&request);
+		}
+	}
+	if (m_textures.size() + missing.size() > MAX_MATERIAL_TEXTURES) {
+		throw std::runtime_error("material texture array is full!");
+	}
+
+	std::vector<DecodedImage> images(missing.size());
+	m_jobSystem.parallelFor(missing.size(), 1, [&](size_t first, size_t last) { // one file per job, files take milliseconds each
+		for (size_t i = first; i < last; i++) {
+			images[i] = Texture::decode(missing[i]->path);
+		}
+	});
+
+	for (size_t i = 0; i < missing.size(); i++) {
+		m_textureLookup[missing[i]->path] = static_cast<uint32_t>(m_textures.size());
+		m_textures.emplace_back(m_device, m_physicalDevice, m_commandPool, m_queue, images[i].pixels.get(), images[i].width, images[i].height, missing[i]->format);
+		images[i].pixels.reset(); // keep at most one decoded copy alive while uploading
+	}
+}
+
+uint32_t MaterialTable::addMaterial(const GPUMaterial& material) {
+	m_materials.push_back(material);
+	return static_cast<uint32_t>(m_materials.size() - 1);
+}
+
+void MaterialTable::setMaterialTextures(uint32_t materialIndex, const MaterialTexturePaths& paths) {
+	GPUMaterial& material = getMaterial(materialIndex);
+	preloadTextures({
+		{ paths.albedo, VK_FORMAT_R8G8B8A8_SRGB },
+		{ paths.metal, VK_FORMAT_R8G8B8A8_UNORM },
+		{ paths.normal, VK_FORMAT_R8G8B8A8_UNORM },
+		{ paths.rough, VK_FORMAT_R8G8B8A8_UNORM },
+	});
+	if (!paths.albedo.empty()) {
+		material.textureIndices.x = addTexture(paths.albedo, VK_FORMAT_R8G8B8A8_SRGB);
+		material.flags |= MATERIAL_ALBEDO_TEXTURE;
+	}
+	if (!paths.metal.empty()) {
+		material.textureIndices.y = addTexture(paths.metal, VK_FORMAT_R8G8B8A8_UNORM);
+		material.metallicFactor = 1.0f; // the texture holds the metalness
+		material.flags |= MATERIAL_METAL_TEXTURE;
+	}
+	if (!paths.normal.empty()) {
+		material.textureIndices.z = addTexture(paths.normal, VK_FORMAT_R8G8B8A8_UNORM);
+		material.flags |= MATERIAL_NORMAL_TEXTURE;
+	}
+	if (!paths.rough.empty()) {
+		material.textureIndices.w = addTexture(paths.rough, VK_FORMAT_R8G8B8A8_UNORM);
+		material.roughnessFactor = 1.0f; // the texture holds the roughness
+		material.flags |= MATERIAL_ROUGH_TEXTURE;
+	}
+}
+
+GPUMaterial& MaterialTable::getMaterial(uint32_t index) {
+	if (index >= m_materials.size()) {
+		throw std::out_of_range("Index out of range for material table");
+	}
+	return m_materials[index];
+}
+
+void MaterialTable::upload(DeletionQueue& deletionQueue) {
+	if (m_materials.empty()) {
+		addMaterial(GPUMaterial{}); // a storage buffer can't be empty
+	}
+	deletionQueue.destroyBuffer(m_materialBuffer); // descriptor sets of frames in flight still point at it
+	deletionQueue.freeMemory(m_materialBufferMemory);
+	BufferUtils::createDeviceLocalBuffer(m_device, m_physicalDevice, m_commandPool, m_queue, m_materials.data(), getMaterialBufferSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_materialBuffer, m_materialBufferMemory);
+}
+
+void MaterialTable::destroyMaterialTable(DeletionQueue& deletionQueue) {
+	deletionQueue.destroyBuffer(m_materialBuffer);
+	deletionQueue.freeMemory(m_materialBufferMemory);
+	m_materialBuffer = VK_NULL_HANDLE;
+	m_materialBufferMemory = VK_NULL_HANDLE;
+	for (auto& texture : m_textures) {
+		texture.destroyTexture(deletionQueue);
+	}
+}
+
+std::vector<VkImageView> MaterialTable::getImageViews() const {
+	std::vector<VkImageView> views(MAX_MATERIAL_TEXTURES, m_textures[0].getTextureImageView());
+	for (size_t i = 0; i < m_textures.size(); ++i) {
+		views[i] = m_textures[i].getTextureImageView();
+	}
+	return views;
+}
+
+std::vector<VkSampler> MaterialTable::getSamplers() const {
+	std::vector<VkSampler> samplers(MAX_MATERIAL_TEXTURES, m_textures[0].getTextureSampler());
+	for (size_t i = 0; i < m_textures.size(); ++i) {
+		samplers[i] = m_textures[i].getTextureSampler();
+	}
+	return samplers;
+}
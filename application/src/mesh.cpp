@@ -2,23 +2,39 @@
 
 #include "mesh.hpp"
 
-Mesh::Mesh(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue, const std::string& path)
+namespace {
+	constexpr size_t VERTEX_GRAIN = 4096; ///< Vertices converted per job, a few microseconds of work.
+	constexpr size_t FACE_GRAIN = 8192; ///< Triangles converted per job.
+}
+
+Mesh::Mesh(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue, const aiScene* scene, JobSystem& jobSystem)
 	: m_device(device),
 	m_physicalDevice(physicalDevice),
 	m_commandPool(commandPool),
 	m_graphicsQueue(graphicsQueue)
 {
-	loadModel(path);
+	processNode(scene->mRootNode, scene, jobSystem);
+	if (!m_vertices.empty()) {
+		m_bounds = { m_vertices[0].pos, m_vertices[0].pos };
+		for (const Vertex& vertex : m_vertices) {
+			m_bounds.min = glm::min(m_bounds.min, vertex.pos);
+			m_bounds.max = glm::max(m_bounds.max, vertex.pos);
+		}
+	}
 
 	BufferUtils::createVertexBuffer(m_device, m_physicalDevice, m_commandPool, m_graphicsQueue, m_vertices, m_vertexBuffer, m_vertexBufferMemory);
 	BufferUtils::createIndexBuffer(m_device, m_physicalDevice, m_commandPool, m_graphicsQueue, m_indices, m_indexBuffer, m_indexBufferMemory);
 }
 
-void Mesh::freeMemory() {
-	vkDestroyBuffer(m_device, m_indexBuffer, nullptr);
-	vkFreeMemory(m_device, m_indexBufferMemory, nullptr);
-	vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
-	vkFreeMemory(m_device, m_vertexBufferMemory, nullptr);
+void Mesh::freeMemory(DeletionQueue& deletionQueue) {
+	deletionQueue.destroyBuffer(m_indexBuffer);
+	deletionQueue.freeMemory(m_indexBufferMemory);
+	deletionQueue.destroyBuffer(m_vertexBuffer);
+	deletionQueue.freeMemory(m_vertexBufferMemory);
+	m_indexBuffer = VK_NULL_HANDLE;
+	m_indexBufferMemory = VK_NULL_HANDLE;
+	m_vertexBuffer = VK_NULL_HANDLE;
+	m_vertexBufferMemory = VK_NULL_HANDLE;
 }
 
 void Mesh::bindBuffers(VkCommandBuffer commandBuffer) {
@@ -31,79 +47,94 @@ void Mesh::bindBuffers(VkCommandBuffer commandBuffer) {
 
 }
 
-void Mesh::draw(VkCommandBuffer commandBuffer)
+void Mesh::draw(VkCommandBuffer commandBuffer, const SubMesh& subMesh, uint32_t instanceCount, uint32_t firstInstance)
 {
-	vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_indices.size()), 1, 0, 0, 0);
+	vkCmdDrawIndexed(commandBuffer, subMesh.indexCount, instanceCount, subMesh.firstIndex, subMesh.vertexOffset, firstInstance);
 }
 
 
-void Mesh::loadModel(const std::string& path) {
-	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-		throw std::runtime_error("Failed to load model: " + std::string(importer.GetErrorString()));
-	}
-	processNode(scene->mRootNode, scene);
-}
-
-
-void Mesh::processNode(aiNode* node, const aiScene* scene) {
+void Mesh::processNode(aiNode* node, const aiScene* scene, JobSystem& jobSystem) {
 	for (unsigned int i = 0; i < node->mNumMeshes; i++) {
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		processMesh(mesh, scene);
+		processMesh(mesh, scene, jobSystem);
 	}
 
 	for (unsigned int i = 0; i < node->mNumChildren; i++) {
-		processNode(node->mChildren[i], scene);
+		processNode(node->mChildren[i], scene, jobSystem);
 	}
 }
 
-void Mesh::processMesh(aiMesh* mesh, const aiScene* scene) {
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-		Vertex vertex{};
-
-		vertex.pos = {
-			mesh->mVertices[i].x,
-			mesh->mVertices[i].y,
-			mesh->mVertices[i].z
-		};
-
-		if (mesh->HasNormals()) {
-			vertex.normal = {
-				mesh->mNormals[i].x,
-				mesh->mNormals[i].y,
-				mesh->mNormals[i].z
+void Mesh::processMesh(aiMesh* mesh, const aiScene* scene, JobSystem& jobSystem) {
+	SubMesh subMesh{};
+	subMesh.firstIndex = static_cast<uint32_t>(m_indices.size());
+	subMesh.vertexOffset = static_cast<int32_t>(m_vertices.size()); // indices stay relative to this mesh
+	subMesh.materialIndex = mesh->mMaterialIndex;
+
+	size_t firstVertex = m_vertices.size();
+	m_vertices.resize(firstVertex + mesh->mNumVertices); // every chunk writes its own range
+	jobSystem.parallelFor(mesh->mNumVertices, VERTEX_GRAIN, [this, mesh, firstVertex](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			Vertex vertex{};
+
+			vertex.pos = {
+				mesh->mVertices[i].x,
+				mesh->mVertices[i].y,
+				mesh->mVertices[i].z
 			};
-		}
 
-		if (mesh->mTextureCoords[0]) {
-			vertex.texCoord = {
-				mesh->mTextureCoords[0][i].x,
-				mesh->mTextureCoords[0][i].y
-			};
-		}
-		else {
-			vertex.texCoord = { 0.0f, 0.0f };
-		}
-
-		if (mesh->HasTangentsAndBitangents()) {
-			vertex.tangent = {
-				mesh->mTangents[i].x,
-				mesh->mTangents[i].y,
-				mesh->mTangents[i].z
-			};
-		}
-		else {
-			vertex.tangent = glm::vec3(0.0f, 0.0f, 0.0f); // fallback tangent
+			if (mesh->HasNormals()) {
+				vertex.normal = {
+					mesh->mNormals[i].x,
+					mesh->mNormals[i].y,
+					mesh->mNormals[i].z
+				};
+			}
+
+			if (mesh->mTextureCoords[0]) {
+				vertex.texCoord = {
+					mesh->mTextureCoords[0][i].x,
+					mesh->mTextureCoords[0][i].y
+				};
+			}
+			else {
+				vertex.texCoord = { 0.0f, 0.0f };
+			}
+
+			if (mesh->HasTangentsAndBitangents()) {
+				vertex.tangent = {
+					mesh->mTangents[i].x,
+					mesh->mTangents[i].y,
+					mesh->mTangents[i].z
+				};
+			}
+			else {
+				vertex.tangent = glm::vec3(0.0f, 0.0f, 0.0f); // fallback tangent
+			}
+
+			m_vertices[firstVertex + i] = vertex;
 		}
-
-		m_vertices.push_back(vertex);
+	});
+
+	if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) { // every face has three indices, so each face knows where its indices go
+		size_t firstIndex = m_indices.size();
+		m_indices.resize(firstIndex + size_t(mesh->mNumFaces) * 3);
+		jobSystem.parallelFor(mesh->mNumFaces, FACE_GRAIN, [this, mesh, firstIndex](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				const aiFace& face = mesh->mFaces[i];
+				for (unsigned int j = 0; j < 3; j++) {
+					m_indices[firstIndex + i * 3 + j] = static_cast<uint16_t>(face.mIndices[j]);
+				}
+			}
+		});
 	}
-
-	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-		aiFace face = mesh->mFaces[i];
-		for (unsigned int j = 0; j < face.mNumIndices; j++) {
-			m_indices.push_back(static_cast<uint16_t>(face.mIndices[j]));
+	else {
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+			aiFace face = mesh->mFaces[i];
+			for (unsigned int j = 0; j < face.mNumIndices; j++) {
+				m_indices.push_back(static_cast<uint16_t>(face.mIndices[j]));
+			}
 		}
 	}
+	subMesh.indexCount = static_cast<uint32_t>(m_indices.size()) - subMesh.firstIndex;
+	m_subMeshes.push_back(subMesh);
 }
\ No newline at end of file
@@ -1,54 +1,142 @@
 #pragma once
 
 #include "model.hpp"
+#include <filesystem>
+#include <algorithm>
 
 Model::Model(VkDevice device,
     VkPhysicalDevice physicalDevice,
     VkCommandPool commandPool,
     VkQueue graphicsQueue,
-    const std::string& modelPath)
+    const std::string& modelPath,
+    std::shared_ptr<MaterialTable> materialTable,
+    JobSystem& jobSystem)
     : m_device(device),
     m_physicalDevice(physicalDevice),
     m_commandPool(commandPool),
     m_graphicsQueue(graphicsQueue),
-    m_mesh(device, physicalDevice, commandPool, graphicsQueue, modelPath)
-{}
+    m_materialTable(materialTable)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(modelPath, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        throw std::runtime_error("Failed to load model: " + std::string(importer.GetErrorString()));
+    }
+    m_mesh = Mesh(device, physicalDevice, commandPool, graphicsQueue, scene, jobSystem);
+    loadMaterials(scene, std::filesystem::path(modelPath).parent_path().string());
+}
+
+void Model::loadMaterials(const aiScene* scene, const std::string& directory) {
+    // returns the path of the first texture of the given types, empty if there is none or it's embedded
+    auto texturePath = [&](const aiMaterial* material, std::initializer_list<aiTextureType> types) -> std::string {
+        for (aiTextureType type : types) {
+            aiString path;
+            if (material->GetTexture(type, 0, &path) == AI_SUCCESS && path.length > 0 && path.C_Str()[0] != '*') {
+                return (std::filesystem::path(directory) / path.C_Str()).string();
+            }
+        }
+        return {};
+    };
+
+    std::vector<MaterialTexturePaths> materialPaths(scene->mNumMaterials);
+    std::vector<TextureRequest> textures;
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+        const aiMaterial* material = scene->mMaterials[i];
+        MaterialTexturePaths& paths = materialPaths[i];
+        paths.albedo = texturePath(material, { aiTextureType_BASE_COLOR, aiTextureType_DIFFUSE });
+        paths.metal = texturePath(material, { aiTextureType_METALNESS });
+        paths.normal = texturePath(material, { aiTextureType_NORMALS, aiTextureType_NORMAL_CAMERA });
+        paths.rough = texturePath(material, { aiTextureType_DIFFUSE_ROUGHNESS });
+        textures.push_back({ paths.albedo, VK_FORMAT_R8G8B8A8_SRGB });
+        textures.push_back({ paths.metal, VK_FORMAT_R8G8B8A8_UNORM });
+        textures.push_back({ paths.normal, VK_FORMAT_R8G8B8A8_UNORM });
+        textures.push_back({ paths.rough, VK_FORMAT_R8G8B8A8_UNORM });
+    }
+    m_materialTable->preloadTextures(textures); // every texture of the model at once, not four at a time
+
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+        const aiMaterial* material = scene->mMaterials[i];
+        GPUMaterial gpuMaterial{};
+
+        aiColor4D color;
+        if (material->Get(AI_MATKEY_BASE_COLOR, color) == AI_SUCCESS || material->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS) {
+            gpuMaterial.baseColorFactor = glm::vec4(color.r, color.g, color.b, color.a);
+        }
+        material->Get(AI_MATKEY_METALLIC_FACTOR, gpuMaterial.metallicFactor);
+        material->Get(AI_MATKEY_ROUGHNESS_FACTOR, gpuMaterial.roughnessFactor);
+
+        uint32_t index = m_materialTable->addMaterial(gpuMaterial);
+        m_materialIndices.push_back(index);
 
-void Model::loadTextures(const std::array<const char*, 4>& texturePaths) {
-    for (size_t i = 0; i < 4; ++i) {
-        m_textures[i] = Texture(
-            m_device, m_physicalDevice, m_commandPool, m_graphicsQueue, texturePaths[i]
-        );
+        m_materialTable->setMaterialTextures(index, materialPaths[i]);
+
+        aiString opacityPath;
+        if (material->GetTexture(aiTextureType_OPACITY, 0, &opacityPath) == AI_SUCCESS) {
+            m_materialTable->getMaterial(index).flags |= MATERIAL_ALPHA_TEST; // cutout, the mask is expected in the albedo alpha
+        }
     }
 }
-void Model::destroyModel() {
-    m_mesh.freeMemory();
-    for (auto& tex : m_textures) {
-        tex.destroyTexture();
+
+void Model::setMaterialTextures(uint32_t materialIndex, const MaterialTexturePaths& texturePaths) {
+    if (materialIndex >= m_materialIndices.size()) {
+        throw std::out_of_range("Index out of range for model materials");
     }
+    m_materialTable->setMaterialTextures(m_materialIndices[materialIndex], texturePaths);
 }
 
-void Model::bind(VkCommandBuffer commandBuffer) {
-    m_mesh.bindBuffers(commandBuffer);
+void Model::destroyModel(DeletionQueue& deletionQueue) {
+    m_mesh.freeMemory(deletionQueue); // textures are owned by the material table
 }
 
-void Model::draw(VkCommandBuffer commandBuffer) {
-    m_mesh.draw(commandBuffer);
+uint32_t Model::getMaterialIndex(const SubMesh& subMesh) const {
+    return subMesh.materialIndex < m_materialIndices.size() ? m_materialIndices[subMesh.materialIndex] : 0;
 }
 
+PipelineState Model::getPipelineState(uint32_t materialIndex, const PipelineState& baseState) const {
+    uint32_t flags = m_materialTable->getMaterial(materialIndex).flags;
+    PipelineState state = baseState;
+    if (flags & MATERIAL_NORMAL_TEXTURE) {
+        state.shaderFeatures |= SHADER_FEATURE_NORMAL_MAP;
+    }
+    if (flags & MATERIAL_ALPHA_TEST) {
+        state.shaderFeatures |= SHADER_FEATURE_ALPHA_TEST;
+    }
+    return state;
+}
 
-std::array<VkImageView, 4> Model::getImageViews() const {
-    std::array<VkImageView, 4> views{};
-    for (size_t i = 0; i < 4; ++i) {
-        views[i] = m_textures[i].getTextureImageView();
+std::vector<PipelineState> Model::getPipelineStates(const PipelineState& baseState) const {
+    std::vector<PipelineState> states;
+    for (const SubMesh& subMesh : m_mesh.getSubMeshes()) {
+        PipelineState state = getPipelineState(getMaterialIndex(subMesh), baseState);
+        if (std::find(states.begin(), states.end(), state) == states.end()) {
+            states.push_back(state);
+        }
+    }
+    for (uint32_t materialIndex = 0; materialIndex < m_materialTable->getMaterialCount(); materialIndex++) {
+        PipelineState state = getPipelineState(materialIndex, baseState); // overrides use the sub meshes' geometry
+        if (std::find(states.begin(), states.end(), state) == states.end()) {
+            states.push_back(state);
+        }
     }
-    return views;
+    return states;
 }
 
-std::array<VkSampler, 4> Model::getSamplers() const {
-    std::array<VkSampler, 4> samplers{};
-    for (size_t i = 0; i < 4; ++i) {
-        samplers[i] = m_textures[i].getTextureSampler();
+void Model::emitDraws(DrawList& drawList, const PipelineState& baseState, const glm::mat4& transform, const glm::mat4& view, uint32_t materialOverride, uint32_t objectIndex) {
+    uint32_t meshId = drawList.registerMesh(&m_mesh);
+    uint32_t transformIndex = drawList.addTransform(transform, objectIndex); // shared by every sub mesh
+    float viewDepth = -(view * transform[3]).z; // the camera looks down -z in view space
+
+    const std::vector<SubMesh>& subMeshes = m_mesh.getSubMeshes();
+    for (uint32_t i = 0; i < subMeshes.size(); i++) {
+        uint32_t materialIndex = materialOverride != NO_MATERIAL_OVERRIDE ? materialOverride : getMaterialIndex(subMeshes[i]);
+        PipelineState state = getPipelineState(materialIndex, baseState);
+        DrawPass pass = DrawPass::Opaque;
+        if (state.blendMode == BlendMode::AlphaBlend) {
+            pass = DrawPass::Transparent;
+        }
+        else if (state.shaderFeatures & SHADER_FEATURE_ALPHA_TEST) {
+            pass = DrawPass::AlphaTest;
+        }
+        drawList.add(pass, drawList.registerPipeline(state), meshId, i, materialIndex, transformIndex, viewDepth);
     }
-    return samplers;
-}
\ No newline at end of file
+}
@@ -0,0 +1,115 @@
+#include "parallelRecorder.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+ParallelRecorder::ParallelRecorder(VkDevice device, uint32_t queueFamilyIndex, JobSystem& jobSystem) :
+	m_device(device),
+	m_jobSystem(jobSystem)
+{
+	m_poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	m_poolInfo.flags = 0; // reset as a whole, never per command buffer
+	m_poolInfo.queueFamilyIndex = queueFamilyIndex;
+}
+
+void ParallelRecorder::resize(uint32_t targetCount, DeletionQueue& deletionQueue, uint64_t retireValue) {
+	std::vector<VkCommandPool> retired;
+	for (std::vector<SlicePool>& targetPools : m_slicePools) {
+		for (SlicePool& slicePool : targetPools) {
+			retired.push_back(slicePool.pool);
+		}
+	}
+	VkDevice device = m_device;
+	deletionQueue.push(retireValue, [device, retired]() {
+		for (VkCommandPool pool : retired) {
+			vkDestroyCommandPool(device, pool, nullptr); // frees its command buffers
+		}
+	});
+
+	m_slicePools.clear();
+	m_slicePools.resize(targetCount);
+	for (std::vector<SlicePool>& targetPools : m_slicePools) {
+		targetPools.resize(getMaxSlices()); // the calling thread records a slice too
+		for (SlicePool& slicePool : targetPools) {
+			if (vkCreateCommandPool(m_device, &m_poolInfo, nullptr, &slicePool.pool) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create command pool!");
+			}
+		}
+	}
+}
+
+void ParallelRecorder::resetTarget(uint32_t target) {
+	for (SlicePool& slicePool : m_slicePools.at(target)) {
+		if (slicePool.used > 0) {
+			vkResetCommandPool(m_device, slicePool.pool, 0); // keeps the memory for the next recording
+			slicePool.used = 0;
+		}
+	}
+}
+
+VkCommandBuffer ParallelRecorder::beginSecondary(SlicePool& slicePool, const VkCommandBufferInheritanceRenderingInfo& rendering) {
+	if (slicePool.used == slicePool.commandBuffers.size()) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = slicePool.pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate command buffer!");
+		}
+		slicePool.commandBuffers.push_back(commandBuffer);
+	}
+	VkCommandBuffer commandBuffer = slicePool.commandBuffers[slicePool.used++];
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.pNext = &rendering;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT; // runs entirely inside the rendering scope, replayed with its primary
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording command buffer!");
+	}
+	return commandBuffer;
+}
+
+void ParallelRecorder::record(VkCommandBuffer primary, uint32_t target, const VkCommandBufferInheritanceRenderingInfo& rendering, size_t itemCount, const SliceCallback& recordSlice) {
+	std::vector<SlicePool>& targetPools = m_slicePools.at(target);
+	SlicePlan plan = planSlices(itemCount, targetPools.size());
+	size_t sliceCount = plan.count;
+	size_t sliceSize = plan.size;
+	m_lastSliceCount = static_cast<uint32_t>(sliceCount);
+
+	m_secondaries.assign(sliceCount, VK_NULL_HANDLE);
+	auto recordOne = [&](size_t slice) {
+		size_t first = std::min(slice * sliceSize, itemCount);
+		size_t last = std::min(first + sliceSize, itemCount);
+		VkCommandBuffer commandBuffer = beginSecondary(targetPools[slice], rendering);
+		recordSlice(commandBuffer, first, last, static_cast<uint32_t>(slice));
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record command buffer!");
+		}
+		m_secondaries[slice] = commandBuffer; // each slice writes its own element
+	};
+
+	m_jobSystem.parallelFor(sliceCount, 1, [&recordOne](size_t first, size_t last) { // the calling thread records slice 0
+		for (size_t slice = first; slice < last; slice++) {
+			recordOne(slice);
+		}
+	});
+
+	vkCmdExecuteCommands(primary, static_cast<uint32_t>(m_secondaries.size()), m_secondaries.data()); // slice order keeps the sorted draw order
+}
+
+void ParallelRecorder::destroyParallelRecorder() {
+	for (std::vector<SlicePool>& targetPools : m_slicePools) {
+		for (SlicePool& slicePool : targetPools) {
+			vkDestroyCommandPool(m_device, slicePool.pool, nullptr); // frees its command buffers
+		}
+	}
+	m_slicePools.clear();
+}
@@ -1,170 +1,266 @@
 #pragma once
 
 #include "pipeline.hpp"
+#include <array>
 
-Pipeline::Pipeline(VkRenderPass renderPass, VkDevice device, VkExtent2D swapChainExtent, std::vector<VkImageView> swapChainImageViews, VkDescriptorSetLayout descriptorSetLayout) :
-	m_renderPass(renderPass),
+Pipeline::Pipeline(VkDevice device, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineState& state) :
+	m_pipelineLayout(pipelineLayout),
 	m_device(device),
-	m_swapChainExtent(swapChainExtent),
-	m_swapChainImageViews(swapChainImageViews),
-	m_descriptorSetLayout(descriptorSetLayout)
+	m_pipelineCache(pipelineCache),
+	m_vertShaderModule(vertShaderModule),
+	m_fragShaderModule(fragShaderModule),
+	m_state(state)
 {
 	createGraphicsPipeline();
 }
-void Pipeline::createGraphicsPipeline() {
-	auto vertShaderCode = ShaderManager::readFile("./assets/shaders/vert.spv");
-	auto fragShaderCode = ShaderManager::readFile("./assets/shaders/frag.spv");
+Pipeline::Pipeline(VkDevice device, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineState& state, PipelinePart part) :
+	m_pipelineLayout(pipelineLayout),
+	m_device(device),
+	m_pipelineCache(pipelineCache),
+	m_vertShaderModule(vertShaderModule),
+	m_fragShaderModule(fragShaderModule),
+	m_state(state)
+{
+	createLibraryPart(part);
+}
 
-	VkShaderModule vertShaderModule = ShaderManager::createShaderModule(vertShaderCode, m_device);
-	VkShaderModule fragShaderModule = ShaderManager::createShaderModule(fragShaderCode, m_device);
+Pipeline::Pipeline(VkDevice device, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache, const std::array<VkPipeline, PIPELINE_PART_COUNT>& parts, const PipelineState& state, bool optimize) :
+	m_pipelineLayout(pipelineLayout),
+	m_device(device),
+	m_pipelineCache(pipelineCache),
+	m_vertShaderModule(VK_NULL_HANDLE),
+	m_fragShaderModule(VK_NULL_HANDLE),
+	m_state(state)
+{
+	linkLibraryParts(parts, optimize);
+}
+
+Pipeline::Pipeline(VkDevice device, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache, VkShaderModule compShaderModule) :
+	m_pipelineLayout(pipelineLayout),
+	m_device(device),
+	m_pipelineCache(pipelineCache),
+	m_vertShaderModule(VK_NULL_HANDLE),
+	m_fragShaderModule(VK_NULL_HANDLE),
+	m_compShaderModule(compShaderModule),
+	m_bindPoint(VK_PIPELINE_BIND_POINT_COMPUTE),
+	m_state()
+{
+	createComputePipeline();
+}
+
+void Pipeline::fillCreateInfos(CreateInfos& infos) const {
+	// one VkBool32 specialization constant per shader feature, constant_id = feature bit
+	for (uint32_t i = 0; i < SHADER_FEATURE_COUNT; i++) {
+		infos.featureValues[i] = (m_state.shaderFeatures & (1u << i)) ? VK_TRUE : VK_FALSE;
+		infos.featureEntries[i].constantID = i;
+		infos.featureEntries[i].offset = i * sizeof(VkBool32);
+		infos.featureEntries[i].size = sizeof(VkBool32);
+	}
+	infos.specializationInfo.mapEntryCount = static_cast<uint32_t>(infos.featureEntries.size());
+	infos.specializationInfo.pMapEntries = infos.featureEntries.data();
+	infos.specializationInfo.dataSize = sizeof(infos.featureValues);
+	infos.specializationInfo.pData = infos.featureValues.data();
 
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+	VkPipelineShaderStageCreateInfo& vertShaderStageInfo = infos.shaderStages[0];
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = vertShaderModule;
+	vertShaderStageInfo.module = m_vertShaderModule;
 	vertShaderStageInfo.pName = "main"; // entry point
 
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+	VkPipelineShaderStageCreateInfo& fragShaderStageInfo = infos.shaderStages[1];
 	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module = fragShaderModule;
+	fragShaderStageInfo.module = m_fragShaderModule;
 	fragShaderStageInfo.pName = "main"; // entry point
+	fragShaderStageInfo.pSpecializationInfo = &infos.specializationInfo; // shader features
 
-	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+	infos.bindingDescription = Vertex::getBindingDescription(); // VertexLayout::Standard is the only layout so far
+	infos.attributeDescriptions = Vertex::getAttributeDescriptions();
 
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	infos.vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	infos.vertexInput.vertexBindingDescriptionCount = 1;
+	infos.vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(infos.attributeDescriptions.size());
+	infos.vertexInput.pVertexBindingDescriptions = &infos.bindingDescription;
+	infos.vertexInput.pVertexAttributeDescriptions = infos.attributeDescriptions.data();
 
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	infos.inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	infos.inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; // triangle list
+	infos.inputAssembly.primitiveRestartEnable = VK_FALSE; // no primitive restart
 
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+	infos.dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	infos.dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	infos.dynamicState.dynamicStateCount = static_cast<uint32_t>(infos.dynamicStates.size());
+	infos.dynamicState.pDynamicStates = infos.dynamicStates.data();
 
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; // triangle list
-	inputAssembly.primitiveRestartEnable = VK_FALSE; // no primitive restart
+	infos.viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	infos.viewportState.viewportCount = 1; // viewport and scissor are dynamic
+	infos.viewportState.scissorCount = 1;
 
-
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)m_swapChainExtent.width;
-	viewport.height = (float)m_swapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor{}; // defines in which regions pixels will be stored
-	scissor.offset = { 0, 0 };
-	scissor.extent = m_swapChainExtent;
-
-
-	std::vector<VkDynamicState> dynamicStates = {
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR
-	};
-
-	VkPipelineDynamicStateCreateInfo dynamicState{};
-	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-	dynamicState.pDynamicStates = dynamicStates.data();
-
-	VkPipelineViewportStateCreateInfo viewportState{};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
-	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
-
-	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	VkPipelineRasterizationStateCreateInfo& rasterizer = infos.rasterizer;
 	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 	rasterizer.depthClampEnable = VK_FALSE; // discard fragments outside of the depth range
 	rasterizer.rasterizerDiscardEnable = VK_FALSE; // pass the fragments to the next stage (not if VK_TRUE)
 	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
 	rasterizer.lineWidth = 1.0f; // larger values need wideLines GPU feature
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizer.cullMode = m_state.cullMode;
 	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE; // adjusted to fit the Y flip done due to openGL standards in glm
 	rasterizer.depthBiasEnable = VK_FALSE; // useful for shadow mapping
 
-	VkPipelineMultisampleStateCreateInfo multisampling{};
+	VkPipelineMultisampleStateCreateInfo& multisampling = infos.multisampling;
 	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 	multisampling.sampleShadingEnable = VK_FALSE; // multisampling
 	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT; // 1 sample per pixel
 
-	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	VkPipelineColorBlendAttachmentState& colorBlendAttachment = infos.colorBlendAttachment;
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE; // no blending
-
-	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlendAttachment.blendEnable = m_state.blendMode == BlendMode::Opaque ? VK_FALSE : VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = m_state.blendMode == BlendMode::AlphaBlend ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor = m_state.blendMode == BlendMode::AlphaBlend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = m_state.blendMode == BlendMode::AlphaBlend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo& colorBlending = infos.colorBlending;
 	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlending.logicOpEnable = VK_FALSE;
 	colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
 	colorBlending.attachmentCount = 1;
 	colorBlending.pAttachments = &colorBlendAttachment;
-	colorBlending.blendConstants[0] = 0.0f; // Optional
-	colorBlending.blendConstants[1] = 0.0f; // Optional
-	colorBlending.blendConstants[2] = 0.0f; // Optional
-	colorBlending.blendConstants[3] = 0.0f; // Optional
-
 
-	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	VkPipelineDepthStencilStateCreateInfo& depthStencil = infos.depthStencil;
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencil.depthTestEnable = VK_TRUE; // enable depth testing
-	depthStencil.depthWriteEnable = VK_TRUE; // enable depth writing
-	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS; // less than comparison
+	depthStencil.depthTestEnable = m_state.depthTest;
+	depthStencil.depthWriteEnable = m_state.depthWrite;
+	depthStencil.depthCompareOp = m_state.depthCompareOp;
 	depthStencil.depthBoundsTestEnable = VK_FALSE; // optional
 	depthStencil.minDepthBounds = 0.0f; // optional
 	depthStencil.maxDepthBounds = 1.0f; // optional
 	depthStencil.stencilTestEnable = VK_FALSE; // optional
-	depthStencil.front = {}; // optional
-	depthStencil.back = {}; // optional
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1; // number of descriptor set layouts
-	pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout; // descriptor set layout
+	VkPipelineRenderingCreateInfo& rendering = infos.rendering; // dynamic rendering, attachment formats replace the render pass
+	rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	rendering.colorAttachmentCount = m_state.colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+	rendering.pColorAttachmentFormats = &m_state.colorFormat;
+	rendering.depthAttachmentFormat = m_state.depthFormat;
+}
 
-	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create pipeline layout!");
-	}
+void Pipeline::createGraphicsPipeline() {
+	CreateInfos infos;
+	fillCreateInfos(infos);
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
-
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &inputAssembly;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pRasterizationState = &rasterizer;
-	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pDepthStencilState = &depthStencil;
-	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.pNext = &infos.rendering;
+	pipelineInfo.stageCount = static_cast<uint32_t>(infos.shaderStages.size());
+	pipelineInfo.pStages = infos.shaderStages.data();
+
+	pipelineInfo.pVertexInputState = &infos.vertexInput;
+	pipelineInfo.pInputAssemblyState = &infos.inputAssembly;
+	pipelineInfo.pViewportState = &infos.viewportState;
+	pipelineInfo.pRasterizationState = &infos.rasterizer;
+	pipelineInfo.pMultisampleState = &infos.multisampling;
+	pipelineInfo.pDepthStencilState = &infos.depthStencil;
+	pipelineInfo.pColorBlendState = &infos.colorBlending;
+	pipelineInfo.pDynamicState = &infos.dynamicState;
 
 	pipelineInfo.layout = m_pipelineLayout;
-	pipelineInfo.renderPass = m_renderPass;
-	pipelineInfo.subpass = 0;
 
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // only used if VK_PIPELINE_CREATE_DERIVATIVE_BIT is set
 	pipelineInfo.basePipelineIndex = -1;			  // in VkGraphicsPipelineCreateInfo
 
-	if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) // can establish pipeline caching and create multiple pipelines at once
+	if (vkCreateGraphicsPipelines(m_device, m_pipelineCache, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) // the cache skips compilation for pipelines built in earlier runs
 	{
 		throw std::runtime_error("failed to create graphics pipeline!");
 	}
-	ShaderManager::destroyShaderModule(vertShaderModule, m_device);
-	ShaderManager::destroyShaderModule(fragShaderModule, m_device);
 }
 
-const void Pipeline::destroyPipeline() {
-	vkDestroyPipeline(m_device, m_pipeline, nullptr);
-	vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+void Pipeline::createComputePipeline() {
+	VkPipelineShaderStageCreateInfo compShaderStageInfo{};
+	compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	compShaderStageInfo.module = m_compShaderModule;
+	compShaderStageInfo.pName = "main"; // entry point
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = compShaderStageInfo;
+	pipelineInfo.layout = m_pipelineLayout;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(m_device, m_pipelineCache, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create compute pipeline!");
+	}
 }
 
-void Pipeline::getUpdatedSwapChainExtent(VkExtent2D extent) {
-	m_swapChainExtent = extent;
+void Pipeline::createLibraryPart(PipelinePart part) {
+	CreateInfos infos;
+	fillCreateInfos(infos);
+
+	VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+	libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+	libraryInfo.pNext = &infos.rendering; // view mask for the shader parts, formats for the output part
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &libraryInfo;
+	pipelineInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT; // keep what an optimized link needs
+	pipelineInfo.basePipelineIndex = -1;
+
+	// each part only gets the state it owns
+	switch (part) {
+	case PipelinePart::VertexInput:
+		libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+		pipelineInfo.pVertexInputState = &infos.vertexInput;
+		pipelineInfo.pInputAssemblyState = &infos.inputAssembly;
+		break;
+	case PipelinePart::PreRasterization:
+		libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+		pipelineInfo.stageCount = 1;
+		pipelineInfo.pStages = &infos.shaderStages[0];
+		pipelineInfo.pViewportState = &infos.viewportState;
+		pipelineInfo.pRasterizationState = &infos.rasterizer;
+		pipelineInfo.pDynamicState = &infos.dynamicState;
+		pipelineInfo.layout = m_pipelineLayout;
+		break;
+	case PipelinePart::FragmentShader:
+		libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+		pipelineInfo.stageCount = 1;
+		pipelineInfo.pStages = &infos.shaderStages[1];
+		pipelineInfo.pMultisampleState = &infos.multisampling;
+		pipelineInfo.pDepthStencilState = &infos.depthStencil;
+		pipelineInfo.layout = m_pipelineLayout;
+		break;
+	case PipelinePart::FragmentOutput:
+		libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+		pipelineInfo.pMultisampleState = &infos.multisampling;
+		pipelineInfo.pColorBlendState = &infos.colorBlending;
+		break;
+	}
+
+	if (vkCreateGraphicsPipelines(m_device, m_pipelineCache, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline library part!");
+	}
+}
+
+void Pipeline::linkLibraryParts(const std::array<VkPipeline, PIPELINE_PART_COUNT>& parts, bool optimize) {
+	VkPipelineLibraryCreateInfoKHR linkInfo{};
+	linkInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+	linkInfo.libraryCount = static_cast<uint32_t>(parts.size());
+	linkInfo.pLibraries = parts.data();
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &linkInfo;
+	pipelineInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0; // without it the driver only stitches the parts together
+	pipelineInfo.layout = m_pipelineLayout;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (vkCreateGraphicsPipelines(m_device, m_pipelineCache, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to link graphics pipeline!");
+	}
+}
+
+const void Pipeline::destroyPipeline() {
+	vkDestroyPipeline(m_device, m_pipeline, nullptr);
 }
@@ -0,0 +1,177 @@
+#include "pipelineCache.hpp"
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include "log.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+	const uint32_t CACHE_FILE_MAGIC = 0x43504B56; // "VKPC"
+	const uint32_t CACHE_FILE_VERSION = 1;
+
+	/**
+	 * @brief Forces the data written to a file onto the disk, so a rename after it can't reach the disk first.
+	 * @return False if the data couldn't be flushed.
+	 */
+	bool syncFile(FILE* file) {
+#ifdef _WIN32
+		return _commit(_fileno(file)) == 0; // FlushFileBuffers on the file's handle
+#else
+		return fsync(fileno(file)) == 0;
+#endif
+	}
+}
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& directory) : m_device(device) {
+	vkGetPhysicalDeviceProperties(physicalDevice, &m_properties);
+
+	char fileName[64];
+	snprintf(fileName, sizeof(fileName), "pipeline_cache_%04x_%04x.bin", m_properties.vendorID, m_properties.deviceID); // one file per GPU
+	m_path = (std::filesystem::path(directory) / fileName).string();
+
+	std::vector<char> cacheData = loadCacheData();
+	m_loaded = !cacheData.empty();
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = cacheData.size();
+	cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+	if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_pipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+}
+
+std::string PipelineCache::getDefaultDirectory() {
+	if (const char* directory = std::getenv("VULKAN_APP_CACHE_DIR")) {
+		return directory;
+	}
+#ifdef _WIN32
+	if (const char* localAppData = std::getenv("LOCALAPPDATA")) {
+		return (std::filesystem::path(localAppData) / "VulkanApp").string();
+	}
+#else
+	const char* xdgCacheHome = std::getenv("XDG_CACHE_HOME");
+	if (xdgCacheHome != nullptr && xdgCacheHome[0] == '/') { // relative values are invalid and must be ignored
+		return (std::filesystem::path(xdgCacheHome) / "VulkanApp").string();
+	}
+	if (const char* home = std::getenv("HOME")) {
+		return (std::filesystem::path(home) / ".cache" / "VulkanApp").string();
+	}
+#endif
+	std::error_code error;
+	return (std::filesystem::temp_directory_path(error) / "VulkanApp").string(); // empty on error, the working directory then
+}
+
+std::vector<char> PipelineCache::loadCacheData() {
+	std::ifstream file(m_path, std::ios::binary);
+	if (!file.is_open()) {
+		return {}; // cold start
+	}
+
+	PipelineCacheFileHeader header{};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+		return {};
+	}
+	bool headerMatches = header.magic == CACHE_FILE_MAGIC
+		&& header.version == CACHE_FILE_VERSION
+		&& header.vendorID == m_properties.vendorID
+		&& header.deviceID == m_properties.deviceID
+		&& header.driverVersion == m_properties.driverVersion
+		&& memcmp(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	if (!headerMatches) {
+		Log::info() << "pipeline cache: ignoring " << m_path << " (written by another device or driver)" << std::endl;
+		return {};
+	}
+
+	// checked before allocating, a truncated or corrupt file must not turn into a huge allocation
+	std::error_code error;
+	uintmax_t fileSize = std::filesystem::file_size(m_path, error);
+	if (error || fileSize < sizeof(header) || header.dataSize != fileSize - sizeof(header)) {
+		Log::info() << "pipeline cache: ignoring " << m_path << " (size mismatch)" << std::endl;
+		return {};
+	}
+	std::vector<char> data(static_cast<size_t>(header.dataSize));
+	if (!file.read(data.data(), data.size())) {
+		Log::info() << "pipeline cache: ignoring " << m_path << " (size mismatch)" << std::endl;
+		return {};
+	}
+	if (!isCacheDataCompatible(data)) {
+		Log::info() << "pipeline cache: ignoring " << m_path << " (invalid cache header)" << std::endl;
+		return {};
+	}
+	return data;
+}
+
+bool PipelineCache::isCacheDataCompatible(const std::vector<char>& data) const {
+	VkPipelineCacheHeaderVersionOne driverHeader{};
+	if (data.size() < sizeof(driverHeader)) {
+		return false;
+	}
+	memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+	return driverHeader.headerSize >= sizeof(driverHeader)
+		&& driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& driverHeader.vendorID == m_properties.vendorID
+		&& driverHeader.deviceID == m_properties.deviceID
+		&& memcmp(driverHeader.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::savePipelineCache() {
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+		return;
+	}
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+		std::cerr << "pipeline cache: failed to read cache data" << std::endl;
+		return;
+	}
+	data.resize(dataSize);
+
+	PipelineCacheFileHeader header;
+	memset(&header, 0, sizeof(header)); // zeroes the padding before dataSize too, value initialization may leave it as is
+	header.magic = CACHE_FILE_MAGIC;
+	header.version = CACHE_FILE_VERSION;
+	header.vendorID = m_properties.vendorID;
+	header.deviceID = m_properties.deviceID;
+	header.driverVersion = m_properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = data.size();
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(m_path).parent_path(), error);
+
+	std::string tempPath = m_path + ".tmp";
+	FILE* file = std::fopen(tempPath.c_str(), "wb");
+	bool written = file != nullptr
+		&& std::fwrite(&header, sizeof(header), 1, file) == 1
+		&& std::fwrite(data.data(), 1, data.size(), file) == data.size()
+		&& std::fflush(file) == 0
+		&& syncFile(file); // on the disk before the rename, or a power loss could leave the new name on a truncated file
+	if (file != nullptr && std::fclose(file) != 0) {
+		written = false;
+	}
+	if (!written) {
+		std::cerr << "pipeline cache: failed to write " << tempPath << std::endl;
+		std::filesystem::remove(tempPath, error);
+		return;
+	}
+	std::filesystem::rename(tempPath, m_path, error); // atomic replace, readers never see a partial file
+	if (error) {
+		std::cerr << "pipeline cache: failed to replace " << m_path << ": " << error.message() << std::endl;
+		std::filesystem::remove(tempPath, error);
+	}
+}
+
+void PipelineCache::destroyPipelineCache() {
+	vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+}
@@ -0,0 +1,301 @@
+#include "pipelineLibrary.hpp"
+#include "embeddedShaders/shaderVert.hpp"
+#include "embeddedShaders/shaderFrag.hpp"
+#include <iostream>
+#include "log.hpp"
+
+PipelineLibrary::PipelineLibrary(VkDevice device, std::vector<VkDescriptorSetLayout> descriptorSetLayouts, VkPipelineCache pipelineCache, bool useGraphicsPipelineLibrary, JobSystem& jobSystem) :
+	m_device(device),
+	m_descriptorSetLayouts(std::move(descriptorSetLayouts)),
+	m_pipelineCache(pipelineCache),
+	m_useGraphicsPipelineLibrary(useGraphicsPipelineLibrary),
+	m_jobSystem(jobSystem)
+{
+	createPipelineLayout();
+
+	m_vertShaderModule = ShaderManager::loadShaderModule("shader.vert", EmbeddedShaders::shaderVert, m_device); // compiled into the binary at build time
+	m_fragShaderModule = ShaderManager::loadShaderModule("shader.frag", EmbeddedShaders::shaderFrag, m_device);
+}
+
+void PipelineLibrary::createPipelineLayout() {
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(m_descriptorSetLayouts.size()); // number of descriptor set layouts
+	pipelineLayoutInfo.pSetLayouts = m_descriptorSetLayouts.data(); // the global set, then the per-frame set
+	pipelineLayoutInfo.pushConstantRangeCount = 0; // per-object data is read from the instance buffer
+
+	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+}
+
+PipelineLibrary::PipelineFuture PipelineLibrary::requestPipeline(const PipelineState& state) {
+	auto found = m_pipelines.find(state);
+	if (found != m_pipelines.end()) {
+		return found->second;
+	}
+	auto compiled = std::make_shared<std::promise<std::shared_ptr<Pipeline>>>();
+	PipelineFuture future = compiled->get_future().share();
+	m_jobSystem.run([this, state, compiled]() {
+		try {
+			compiled->set_value(compilePipeline(state));
+		}
+		catch (...) {
+			compiled->set_exception(std::current_exception()); // rethrown by get()
+		}
+		m_version.fetch_add(1, std::memory_order_release); // once the future is ready, a job's own future would only be after it returned
+	}, &m_jobs, JobPriority::Background); // never delays the jobs a frame waits for
+	m_pipelines.emplace(state, future);
+	return future;
+}
+
+std::shared_ptr<Pipeline> PipelineLibrary::compilePipeline(const PipelineState& state) {
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!m_useGraphicsPipelineLibrary) {
+		auto pipeline = std::make_shared<Pipeline>(m_device, m_pipelineLayout, m_pipelineCache, m_vertShaderModule, m_fragShaderModule, state);
+		recordTiming(m_monolithicTiming, start);
+		return pipeline;
+	}
+
+	std::array<VkPipeline, PIPELINE_PART_COUNT> parts{};
+	for (uint32_t i = 0; i < PIPELINE_PART_COUNT; i++) {
+		parts[i] = getPart(state, static_cast<PipelinePart>(i)); // usually already compiled for an earlier variant
+	}
+	auto linkStart = std::chrono::high_resolution_clock::now();
+	auto pipeline = std::make_shared<Pipeline>(m_device, m_pipelineLayout, m_pipelineCache, parts, state, false);
+	recordTiming(m_fastLinkTiming, linkStart);
+
+	m_jobSystem.run([this, state, parts, pipeline]() { optimizePipeline(state, parts, pipeline); }, &m_jobs, JobPriority::Background);
+	return pipeline;
+}
+
+PipelineState PipelineLibrary::partKey(const PipelineState& state, PipelinePart part) {
+	PipelineState key{};
+	switch (part) {
+	case PipelinePart::VertexInput:
+		key.vertexLayout = state.vertexLayout;
+		break;
+	case PipelinePart::PreRasterization:
+		key.cullMode = state.cullMode;
+		break;
+	case PipelinePart::FragmentShader:
+		key.shaderFeatures = state.shaderFeatures;
+		key.depthTest = state.depthTest;
+		key.depthWrite = state.depthWrite;
+		key.depthCompareOp = state.depthCompareOp;
+		key.depthFormat = state.depthFormat;
+		break;
+	case PipelinePart::FragmentOutput:
+		key.blendMode = state.blendMode;
+		key.colorFormat = state.colorFormat;
+		key.depthFormat = state.depthFormat;
+		break;
+	}
+	return key;
+}
+
+VkPipeline PipelineLibrary::getPart(const PipelineState& state, PipelinePart part) {
+	PipelineState key = partKey(state, part);
+	std::shared_ptr<PartEntry> entry;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto& slot = m_parts[static_cast<size_t>(part)][key];
+		if (!slot) {
+			slot = std::make_shared<PartEntry>();
+		}
+		entry = slot;
+	}
+	std::call_once(entry->compiled, [&]() { // compiled outside the lock so other parts compile in parallel
+		entry->pipeline = std::make_shared<Pipeline>(m_device, m_pipelineLayout, m_pipelineCache, m_vertShaderModule, m_fragShaderModule, key, part);
+	});
+	return entry->pipeline->getPipeline();
+}
+
+void PipelineLibrary::optimizePipeline(const PipelineState& state, std::array<VkPipeline, PIPELINE_PART_COUNT> parts, std::shared_ptr<Pipeline> fastLinked) {
+	try {
+		auto start = std::chrono::high_resolution_clock::now();
+		auto optimized = std::make_shared<Pipeline>(m_device, m_pipelineLayout, m_pipelineCache, parts, state, true);
+		recordTiming(m_optimizedLinkTiming, start);
+
+		std::promise<std::shared_ptr<Pipeline>> ready;
+		ready.set_value(optimized);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_retiredPipelines.push_back(fastLinked); // command buffers already recorded may still reference it
+		m_pipelines[state] = ready.get_future().share();
+		m_version.fetch_add(1, std::memory_order_release);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "optimized pipeline link failed, keeping the fast-linked one: " << e.what() << std::endl;
+	}
+}
+
+std::shared_ptr<Pipeline> PipelineLibrary::createComputePipeline(const std::string& shaderName, std::span<const uint32_t> embedded, VkPipelineLayout pipelineLayout) {
+	VkShaderModule shaderModule = ShaderManager::loadShaderModule(shaderName, embedded, m_device);
+	std::shared_ptr<Pipeline> pipeline;
+	try {
+		pipeline = std::make_shared<Pipeline>(m_device, pipelineLayout, m_pipelineCache, shaderModule);
+	}
+	catch (...) {
+		ShaderManager::destroyShaderModule(shaderModule, m_device);
+		throw;
+	}
+	ShaderManager::destroyShaderModule(shaderModule, m_device); // a single pipeline uses it, not needed once it's created
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_computePipelines.push_back(pipeline);
+	return pipeline;
+}
+
+void PipelineLibrary::recordTiming(Timing& timing, std::chrono::high_resolution_clock::time_point start) {
+	double time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	timing.totalMs += time;
+	timing.count++;
+}
+
+void PipelineLibrary::warmUp(const std::vector<PipelineState>& states) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<PipelineFuture> futures;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const auto& state : states) {
+			futures.push_back(requestPipeline(state));
+		}
+	}
+	for (auto& future : futures) {
+		future.get(); // rethrows compile errors on this thread
+	}
+
+	auto time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	Log::info() << "pipeline warm-up: " << states.size() << " variants in " << time << " ms on " << m_jobSystem.getThreadCount() << " threads"
+		<< (m_useGraphicsPipelineLibrary ? " (fast-linked, optimizing in the background)" : "") << std::endl;
+}
+
+void PipelineLibrary::benchmark(const std::vector<PipelineState>& states, int repetitions) {
+	using Clock = std::chrono::high_resolution_clock;
+	auto elapsed = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+	Timing monolithic, cached, parts, fastLink, optimizedLink;
+
+	for (int repetition = 0; repetition < repetitions; repetition++) {
+		for (const PipelineState& state : states) {
+			auto start = Clock::now();
+			Pipeline pipeline(m_device, m_pipelineLayout, VK_NULL_HANDLE, m_vertShaderModule, m_fragShaderModule, state); // no cache, a cold compile every time
+			monolithic.totalMs += elapsed(start);
+			monolithic.count++;
+			pipeline.destroyPipeline();
+
+			start = Clock::now();
+			Pipeline cachedPipeline(m_device, m_pipelineLayout, m_pipelineCache, m_vertShaderModule, m_fragShaderModule, state); // the warm-up stored it, like a warm start
+			cached.totalMs += elapsed(start);
+			cached.count++;
+			cachedPipeline.destroyPipeline();
+			if (!m_useGraphicsPipelineLibrary) {
+				continue;
+			}
+
+			std::vector<Pipeline> partPipelines;
+			partPipelines.reserve(PIPELINE_PART_COUNT);
+			std::array<VkPipeline, PIPELINE_PART_COUNT> partHandles{};
+			start = Clock::now();
+			for (uint32_t i = 0; i < PIPELINE_PART_COUNT; i++) { // all four, at runtime variants mostly share them
+				PipelinePart part = static_cast<PipelinePart>(i);
+				partPipelines.emplace_back(m_device, m_pipelineLayout, VK_NULL_HANDLE, m_vertShaderModule, m_fragShaderModule, partKey(state, part), part);
+				partHandles[i] = partPipelines.back().getPipeline();
+			}
+			parts.totalMs += elapsed(start);
+			parts.count++;
+
+			start = Clock::now();
+			Pipeline fastLinked(m_device, m_pipelineLayout, VK_NULL_HANDLE, partHandles, state, false);
+			fastLink.totalMs += elapsed(start);
+			fastLink.count++;
+
+			start = Clock::now();
+			Pipeline optimized(m_device, m_pipelineLayout, VK_NULL_HANDLE, partHandles, state, true);
+			optimizedLink.totalMs += elapsed(start);
+			optimizedLink.count++;
+
+			fastLinked.destroyPipeline();
+			optimized.destroyPipeline();
+			for (Pipeline& part : partPipelines) {
+				part.destroyPipeline();
+			}
+		}
+	}
+
+	auto average = [](const Timing& timing) { return timing.count > 0 ? timing.totalMs / timing.count : 0.0; };
+	std::cout << "pipeline benchmark, " << states.size() << " variants x " << repetitions << " repetitions, no pipeline cache" << std::endl;
+	std::cout << "  monolithic compile: " << average(monolithic) << " ms avg, from the pipeline cache (warm start): " << average(cached) << " ms avg" << std::endl;
+	if (m_useGraphicsPipelineLibrary) {
+		std::cout << "  library parts: " << average(parts) << " ms avg for all four, fast link: " << average(fastLink)
+			<< " ms avg, optimized link: " << average(optimizedLink) << " ms avg" << std::endl;
+	}
+	else {
+		std::cout << "  graphics pipeline library not supported, no fast link to compare" << std::endl;
+	}
+}
+
+VkPipeline PipelineLibrary::getPipeline(const PipelineState& state) {
+	PipelineFuture future;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		future = requestPipeline(state);
+	}
+	if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+		return VK_NULL_HANDLE; // don't hitch, and another variant's fixed function state would draw it wrong, skip it for now
+	}
+	return future.get()->getPipeline();
+}
+
+void PipelineLibrary::retirePipelines(DeletionQueue& deletionQueue) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& pipeline : m_retiredPipelines) {
+		deletionQueue.destroyPipeline(pipeline->getPipeline()); // the Pipeline object only wraps the handle
+	}
+	m_retiredPipelines.clear();
+}
+
+void PipelineLibrary::destroyPipelineLibrary() {
+	m_jobSystem.wait(m_jobs); // background compiles and optimized links still use the layout and shaders
+
+	auto average = [](const Timing& timing) { return timing.count > 0 ? timing.totalMs / timing.count : 0.0; };
+	if (m_useGraphicsPipelineLibrary) {
+		Log::info() << "pipeline fast link: " << average(m_fastLinkTiming) << " ms avg over " << m_fastLinkTiming.count
+			<< ", optimized link: " << average(m_optimizedLinkTiming) << " ms avg over " << m_optimizedLinkTiming.count << std::endl;
+	}
+	else {
+		Log::info() << "pipeline monolithic compile: " << average(m_monolithicTiming) << " ms avg over " << m_monolithicTiming.count << std::endl;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& [state, future] : m_pipelines) {
+		try {
+			future.get()->destroyPipeline();
+		}
+		catch (const std::exception& e) {
+			std::cerr << "pipeline variant failed to compile: " << e.what() << std::endl;
+		}
+	}
+	m_pipelines.clear();
+	for (auto& pipeline : m_retiredPipelines) {
+		pipeline->destroyPipeline();
+	}
+	m_retiredPipelines.clear();
+	for (auto& pipeline : m_computePipelines) {
+		pipeline->destroyPipeline();
+	}
+	m_computePipelines.clear();
+	for (auto& parts : m_parts) { // linked pipelines don't need their parts anymore, but destroy them last anyway
+		for (auto& [key, entry] : parts) {
+			if (entry->pipeline) {
+				entry->pipeline->destroyPipeline();
+			}
+		}
+		parts.clear();
+	}
+	ShaderManager::destroyShaderModule(m_vertShaderModule, m_device);
+	ShaderManager::destroyShaderModule(m_fragShaderModule, m_device);
+	vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+}
@@ -0,0 +1,589 @@
+#include "renderGraph.hpp"
+#include <algorithm>
+#include "log.hpp"
+
+void RenderGraph::PassBuilder::addUse(RenderGraphImage image, ImageAccess access, VkAttachmentLoadOp loadOp, VkClearValue clearValue) {
+	if (image >= m_graph.m_images.size()) {
+		throw std::out_of_range("Index out of range for render graph images");
+	}
+	ImageUse use{};
+	use.image = image;
+	use.access = access;
+	use.loadOp = loadOp;
+	use.clearValue = clearValue;
+	m_pass.uses.push_back(use);
+
+	Image& declared = m_graph.m_images[image];
+	switch (access) { // transient images are created with exactly the usage their passes need
+	case ImageAccess::ColorAttachment:
+		declared.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		break;
+	case ImageAccess::DepthAttachment:
+	case ImageAccess::DepthRead:
+		declared.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		break;
+	case ImageAccess::FragmentSampled:
+	case ImageAccess::ComputeSampled:
+		declared.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+		break;
+	}
+}
+
+void RenderGraph::PassBuilder::writeColor(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor) {
+	VkClearValue clearValue{};
+	clearValue.color = clearColor;
+	addUse(image, ImageAccess::ColorAttachment, loadOp, clearValue);
+}
+
+void RenderGraph::PassBuilder::writeDepth(RenderGraphImage image, VkAttachmentLoadOp loadOp, float clearDepth) {
+	VkClearValue clearValue{};
+	clearValue.depthStencil = { clearDepth, 0 };
+	addUse(image, ImageAccess::DepthAttachment, loadOp, clearValue);
+}
+
+void RenderGraph::PassBuilder::readDepth(RenderGraphImage image) {
+	addUse(image, ImageAccess::DepthRead, VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+void RenderGraph::PassBuilder::sample(RenderGraphImage image) {
+	addUse(image, ImageAccess::FragmentSampled, VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+void RenderGraph::PassBuilder::sampleCompute(RenderGraphImage image) {
+	addUse(image, ImageAccess::ComputeSampled, VK_ATTACHMENT_LOAD_OP_LOAD, {});
+}
+
+void RenderGraph::PassBuilder::setSideEffects() {
+	m_pass.sideEffects = true;
+}
+
+void RenderGraph::PassBuilder::useSecondaryCommandBuffers() {
+	m_pass.secondaryCommandBuffers = true;
+}
+
+RenderGraph::RenderGraph(VkDevice device, VkPhysicalDevice physicalDevice) :
+	m_device(device),
+	m_physicalDevice(physicalDevice)
+{
+}
+
+RenderGraphImage RenderGraph::importImage(const std::string& name, VkFormat format, VkImageLayout initialLayout, VkImageLayout finalLayout, VkPipelineStageFlags2 waitStage) {
+	Image image{};
+	image.name = name;
+	image.format = format;
+	image.imported = true;
+	image.initialLayout = initialLayout;
+	image.finalLayout = finalLayout;
+	image.waitStage = waitStage;
+	m_images.push_back(image);
+	m_compiled = false;
+	return static_cast<RenderGraphImage>(m_images.size() - 1);
+}
+
+RenderGraphImage RenderGraph::createImage(const std::string& name, const TransientImageDesc& desc) {
+	Image image{};
+	image.name = name;
+	image.format = desc.format;
+	image.extent = desc.extent;
+	m_images.push_back(image);
+	m_compiled = false;
+	return static_cast<RenderGraphImage>(m_images.size() - 1);
+}
+
+void RenderGraph::addPass(const std::string& name, const SetupCallback& setup, ExecuteCallback execute) {
+	m_passes.emplace_back();
+	Pass& pass = m_passes.back();
+	pass.name = name;
+	pass.execute = std::move(execute);
+	PassBuilder builder(*this, pass);
+	setup(builder);
+	m_compiled = false;
+}
+
+void RenderGraph::setImportedImage(RenderGraphImage image, VkImage vkImage, VkImageView view) {
+	if (image >= m_images.size() || !m_images[image].imported) {
+		throw std::out_of_range("Index out of range for imported render graph images");
+	}
+	m_images[image].image = vkImage;
+	m_images[image].view = view;
+}
+
+VkImageView RenderGraph::getImageView(RenderGraphImage image) const {
+	if (image >= m_images.size()) {
+		throw std::out_of_range("Index out of range for render graph images");
+	}
+	return m_images[image].view;
+}
+
+RenderGraph::AccessInfo RenderGraph::getAccessInfo(const ImageUse& use) {
+	bool load = use.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+	switch (use.access) {
+	case ImageAccess::ColorAttachment:
+		return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | (load ? VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT : 0), true };
+	case ImageAccess::DepthAttachment: // the depth test reads even when the attachment is cleared
+		return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, true };
+	case ImageAccess::DepthRead:
+		return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, false };
+	case ImageAccess::FragmentSampled:
+		return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, false };
+	case ImageAccess::ComputeSampled:
+		return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, false };
+	}
+	throw std::runtime_error("unknown render graph image access!");
+}
+
+bool RenderGraph::readsContents(const ImageUse& use) {
+	return use.access == ImageAccess::DepthRead || use.access == ImageAccess::FragmentSampled || use.access == ImageAccess::ComputeSampled
+		|| use.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+}
+
+VkImageAspectFlags RenderGraph::getAspectMask(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT; // both aspects change layout together
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+void RenderGraph::compile(VkExtent2D extent) {
+	destroyTransientImages();
+	m_extent = extent;
+
+	cullPasses();
+	computeLifetimes();
+	createTransientImages();
+
+	for (Image& image : m_images) {
+		image.state = ImageState{};
+	}
+	primeBarrierState();
+	m_compiled = true;
+}
+
+void RenderGraph::primeBarrierState() {
+	// the first frame would see no earlier use of the transient memory and skip waiting for it, so it would
+	// record different barriers than every later frame. Running the barrier logic once leaves the memory
+	// blocks in the state each frame ends with, after that every execute() records the same commands.
+	for (Image& image : m_images) {
+		image.usedThisFrame = false;
+	}
+	for (uint32_t passIndex : m_livePasses) {
+		for (const ImageUse& use : m_passes[passIndex].uses) {
+			addBarrier(use);
+		}
+	}
+	addFinalBarriers();
+	m_barriers.clear();
+}
+
+void RenderGraph::cullPasses() {
+	// walk backwards from the outputs: a pass is live if a later live pass (or an imported image) needs what it writes
+	std::vector<bool> needed(m_images.size(), false);
+	for (size_t i = 0; i < m_images.size(); i++) {
+		needed[i] = m_images[i].imported;
+	}
+	m_livePasses.clear();
+	for (size_t i = m_passes.size(); i-- > 0;) {
+		Pass& pass = m_passes[i];
+		bool live = pass.sideEffects;
+		for (const ImageUse& use : pass.uses) {
+			if (getAccessInfo(use).write && needed[use.image]) {
+				live = true;
+			}
+		}
+		pass.culled = !live;
+		if (!live) {
+			continue;
+		}
+		for (const ImageUse& use : pass.uses) {
+			if (getAccessInfo(use).write && !readsContents(use)) {
+				needed[use.image] = false; // fully overwritten, earlier writers don't matter
+			}
+		}
+		for (const ImageUse& use : pass.uses) {
+			if (readsContents(use)) {
+				needed[use.image] = true;
+			}
+		}
+		m_livePasses.push_back(static_cast<uint32_t>(i));
+	}
+	std::reverse(m_livePasses.begin(), m_livePasses.end());
+}
+
+void RenderGraph::computeLifetimes() {
+	std::vector<bool> used(m_images.size(), false);
+	for (uint32_t position = 0; position < m_livePasses.size(); position++) {
+		Pass& pass = m_passes[m_livePasses[position]];
+		for (ImageUse& use : pass.uses) {
+			Image& image = m_images[use.image];
+			if (!used[use.image]) {
+				if (!image.imported && readsContents(use)) {
+					throw std::runtime_error("render graph pass " + pass.name + " reads " + image.name + " before it is written!");
+				}
+				used[use.image] = true;
+				image.firstUse = position;
+			}
+			image.lastUse = position;
+
+			// store only what a later pass reads, transient contents nobody reads are dropped
+			use.storeOp = image.imported ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			for (uint32_t later = position + 1; later < m_livePasses.size(); later++) {
+				const Pass& laterPass = m_passes[m_livePasses[later]];
+				auto next = std::find_if(laterPass.uses.begin(), laterPass.uses.end(), [&](const ImageUse& u) { return u.image == use.image; });
+				if (next != laterPass.uses.end()) {
+					use.storeOp = readsContents(*next) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					break;
+				}
+			}
+			if (use.access == ImageAccess::DepthRead) {
+				use.storeOp = VK_ATTACHMENT_STORE_OP_NONE; // read-only attachment, nothing to store
+			}
+		}
+	}
+}
+
+void RenderGraph::createTransientImages() {
+	struct Placement {
+		RenderGraphImage image;
+		VkMemoryRequirements requirements;
+	};
+	std::vector<Placement> placements;
+
+	for (uint32_t i = 0; i < m_images.size(); i++) {
+		Image& image = m_images[i];
+		image.memoryBlock = -1;
+		if (image.imported) {
+			continue;
+		}
+		bool used = std::any_of(m_livePasses.begin(), m_livePasses.end(), [&](uint32_t p) {
+			return std::any_of(m_passes[p].uses.begin(), m_passes[p].uses.end(), [&](const ImageUse& u) { return u.image == i; });
+		});
+		if (!used) {
+			continue; // only culled passes use it
+		}
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = image.extent.width != 0 ? image.extent.width : m_extent.width;
+		imageInfo.extent.height = image.extent.height != 0 ? image.extent.height : m_extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = image.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = image.usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		if (vkCreateImage(m_device, &imageInfo, nullptr, &image.image) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create render graph image " + image.name + "!");
+		}
+		Placement placement{ i, {} };
+		vkGetImageMemoryRequirements(m_device, image.image, &placement.requirements);
+		placements.push_back(placement);
+	}
+
+	// largest first, each image goes into the first block whose images are all dead while it is alive
+	std::sort(placements.begin(), placements.end(), [](const Placement& a, const Placement& b) { return a.requirements.size > b.requirements.size; });
+	VkDeviceSize unaliasedSize = 0;
+	for (const Placement& placement : placements) {
+		Image& image = m_images[placement.image];
+		unaliasedSize += placement.requirements.size;
+		for (size_t b = 0; b < m_memoryBlocks.size() && image.memoryBlock < 0; b++) {
+			MemoryBlock& block = m_memoryBlocks[b];
+			if ((block.memoryTypeBits & placement.requirements.memoryTypeBits) == 0) {
+				continue;
+			}
+			bool overlaps = std::any_of(block.images.begin(), block.images.end(), [&](RenderGraphImage other) {
+				return m_images[other].firstUse <= image.lastUse && image.firstUse <= m_images[other].lastUse;
+			});
+			if (!overlaps) {
+				block.memoryTypeBits &= placement.requirements.memoryTypeBits;
+				block.size = std::max(block.size, placement.requirements.size);
+				block.images.push_back(placement.image);
+				image.memoryBlock = static_cast<int32_t>(b);
+			}
+		}
+		if (image.memoryBlock < 0) {
+			MemoryBlock block{};
+			block.size = placement.requirements.size;
+			block.memoryTypeBits = placement.requirements.memoryTypeBits;
+			block.images.push_back(placement.image);
+			m_memoryBlocks.push_back(block);
+			image.memoryBlock = static_cast<int32_t>(m_memoryBlocks.size() - 1);
+		}
+	}
+
+	VkDeviceSize aliasedSize = 0;
+	for (MemoryBlock& block : m_memoryBlocks) {
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = block.size;
+		allocInfo.memoryTypeIndex = BufferUtils::findMemoryType(m_physicalDevice, block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (vkAllocateMemory(m_device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate render graph memory!");
+		}
+		aliasedSize += block.size;
+		for (RenderGraphImage index : block.images) {
+			Image& image = m_images[index];
+			vkBindImageMemory(m_device, image.image, block.memory, 0); // offset 0 satisfies every alignment
+			VkImageAspectFlags aspect = getAspectMask(image.format);
+			image.view = ImageUtils::createImageView(m_device, image.image, image.format, aspect & VK_IMAGE_ASPECT_STENCIL_BIT ? VK_IMAGE_ASPECT_DEPTH_BIT : aspect);
+		}
+	}
+
+	Log::info() << "render graph: " << m_livePasses.size() << " of " << m_passes.size() << " passes live, "
+		<< placements.size() << " transient images in " << m_memoryBlocks.size() << " memory blocks ("
+		<< aliasedSize / 1024 << " KiB, " << unaliasedSize / 1024 << " KiB without aliasing)" << std::endl;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+	if (!m_compiled) {
+		throw std::runtime_error("render graph executed before it was compiled!");
+	}
+	for (Image& image : m_images) {
+		image.usedThisFrame = false;
+	}
+
+	for (uint32_t passIndex : m_livePasses) {
+		const Pass& pass = m_passes[passIndex];
+		for (const ImageUse& use : pass.uses) {
+			addBarrier(use);
+		}
+		flushBarriers(commandBuffer); // one barrier batch per pass
+		bool rendering = beginRendering(commandBuffer, pass);
+		pass.execute(commandBuffer);
+		if (rendering) {
+			vkCmdEndRendering(commandBuffer);
+		}
+	}
+	addFinalBarriers();
+	flushBarriers(commandBuffer);
+}
+
+void RenderGraph::addFinalBarriers() {
+	for (Image& image : m_images) { // hand imported images back in the layout their owner expects
+		if (!image.imported || !image.usedThisFrame || image.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || image.finalLayout == image.state.layout) {
+			continue;
+		}
+		VkImageMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = image.state.writeStages | image.state.readStages;
+		barrier.srcAccessMask = image.state.writeAccess;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE; // presentation is ordered by the render finished semaphore
+		barrier.dstAccessMask = VK_ACCESS_2_NONE;
+		barrier.oldLayout = image.state.layout;
+		barrier.newLayout = image.finalLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image.image;
+		barrier.subresourceRange = { getAspectMask(image.format), 0, 1, 0, 1 };
+		m_barriers.push_back(barrier);
+		image.state.layout = image.finalLayout;
+	}
+}
+
+void RenderGraph::addBarrier(const ImageUse& use) {
+	Image& image = m_images[use.image];
+	ImageState& state = image.state;
+	AccessInfo target = getAccessInfo(use);
+
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.dstStageMask = target.stages;
+	barrier.dstAccessMask = target.access;
+	barrier.oldLayout = state.layout;
+	barrier.newLayout = target.layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image.image;
+	barrier.subresourceRange = { getAspectMask(image.format), 0, 1, 0, 1 };
+
+	bool needed = true;
+	bool newWrite = true; // the barrier's layout transition (or the access itself) becomes the last write
+	if (!image.usedThisFrame) {
+		image.usedThisFrame = true;
+		if (image.imported) { // the submission waits for the owner at waitStage, chain onto that wait
+			barrier.srcStageMask = image.waitStage;
+			barrier.srcAccessMask = VK_ACCESS_2_NONE;
+			barrier.oldLayout = image.initialLayout;
+		}
+		else { // wait for whatever last used the memory, another alias or this image in the previous frame
+			MemoryBlock& block = m_memoryBlocks[image.memoryBlock];
+			barrier.srcStageMask = block.stages;
+			barrier.srcAccessMask = block.writeAccess;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED; // contents don't survive the frame (or another alias)
+			block.stages = 0;
+			block.writeAccess = 0;
+		}
+	}
+	else if (state.layout != target.layout || target.write) { // layout transition, write after write or write after read
+		barrier.srcStageMask = state.writeStages | state.readStages;
+		barrier.srcAccessMask = state.writeAccess;
+	}
+	else if ((target.stages & ~state.readStages) != 0) { // read after write from a stage that doesn't wait yet
+		barrier.srcStageMask = state.writeStages;
+		barrier.srcAccessMask = state.writeAccess;
+		newWrite = false;
+		state.readStages |= target.stages;
+	}
+	else {
+		needed = false; // read after read in the same layout
+		newWrite = false;
+	}
+	if (newWrite) {
+		state = { target.layout, target.stages, target.write ? target.access : VK_ACCESS_2_NONE, target.write ? 0 : target.stages };
+	}
+
+	if (!image.imported) {
+		MemoryBlock& block = m_memoryBlocks[image.memoryBlock];
+		block.stages |= target.stages;
+		block.writeAccess |= target.write ? target.access : VK_ACCESS_2_NONE;
+	}
+	if (needed) {
+		m_barriers.push_back(barrier);
+	}
+}
+
+void RenderGraph::flushBarriers(VkCommandBuffer commandBuffer) {
+	if (m_barriers.empty()) {
+		return;
+	}
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(m_barriers.size());
+	dependencyInfo.pImageMemoryBarriers = m_barriers.data();
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+	m_barriers.clear();
+}
+
+bool RenderGraph::beginRendering(VkCommandBuffer commandBuffer, const Pass& pass) {
+	std::vector<VkRenderingAttachmentInfo> colorAttachments;
+	VkRenderingAttachmentInfo depthAttachment{};
+	bool hasDepth = false;
+	VkExtent2D renderExtent = m_extent;
+	m_inheritanceColorFormats.clear();
+
+	for (const ImageUse& use : pass.uses) {
+		if (use.access == ImageAccess::FragmentSampled || use.access == ImageAccess::ComputeSampled) {
+			continue; // not an attachment
+		}
+		const Image& image = m_images[use.image];
+		if (!image.imported && image.extent.width != 0) {
+			renderExtent = image.extent;
+		}
+		VkRenderingAttachmentInfo attachment{};
+		attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		attachment.imageView = image.view;
+		attachment.imageLayout = getAccessInfo(use).layout;
+		attachment.loadOp = use.loadOp;
+		attachment.storeOp = use.storeOp;
+		attachment.clearValue = use.clearValue;
+		if (use.access == ImageAccess::ColorAttachment) {
+			colorAttachments.push_back(attachment);
+			m_inheritanceColorFormats.push_back(image.format);
+		}
+		else {
+			depthAttachment = attachment;
+			hasDepth = true;
+			m_renderingInheritance.depthAttachmentFormat = image.format;
+		}
+	}
+	if (colorAttachments.empty() && !hasDepth) {
+		return false;
+	}
+
+	m_renderingInheritance.colorAttachmentCount = static_cast<uint32_t>(m_inheritanceColorFormats.size());
+	m_renderingInheritance.pColorAttachmentFormats = m_inheritanceColorFormats.data();
+	if (!hasDepth) {
+		m_renderingInheritance.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+	}
+	m_renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT; // the graph has no multisampled images
+
+	VkRenderingInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.flags = pass.secondaryCommandBuffers ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+	renderingInfo.renderArea.offset = { 0, 0 };
+	renderingInfo.renderArea.extent = renderExtent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+	renderingInfo.pColorAttachments = colorAttachments.data();
+	renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+	vkCmdBeginRendering(commandBuffer, &renderingInfo);
+	return true;
+}
+
+void RenderGraph::destroyTransientImages() {
+	for (Image& image : m_images) {
+		if (image.imported) {
+			continue;
+		}
+		if (image.view != VK_NULL_HANDLE) {
+			vkDestroyImageView(m_device, image.view, nullptr);
+			image.view = VK_NULL_HANDLE;
+		}
+		if (image.image != VK_NULL_HANDLE) {
+			vkDestroyImage(m_device, image.image, nullptr);
+			image.image = VK_NULL_HANDLE;
+		}
+		image.memoryBlock = -1;
+	}
+	for (MemoryBlock& block : m_memoryBlocks) {
+		vkFreeMemory(m_device, block.memory, nullptr);
+	}
+	m_memoryBlocks.clear();
+	m_compiled = false;
+}
+
+void RenderGraph::retireTransientImages(DeletionQueue& deletionQueue, uint64_t retireValue) {
+	std::vector<VkImageView> views;
+	std::vector<VkImage> images;
+	std::vector<VkDeviceMemory> memory;
+	for (Image& image : m_images) {
+		if (image.imported) {
+			continue;
+		}
+		if (image.view != VK_NULL_HANDLE) {
+			views.push_back(image.view);
+			image.view = VK_NULL_HANDLE;
+		}
+		if (image.image != VK_NULL_HANDLE) {
+			images.push_back(image.image);
+			image.image = VK_NULL_HANDLE;
+		}
+		image.memoryBlock = -1;
+	}
+	for (MemoryBlock& block : m_memoryBlocks) {
+		memory.push_back(block.memory);
+	}
+	m_memoryBlocks.clear();
+	m_compiled = false;
+
+	VkDevice device = m_device;
+	deletionQueue.push(retireValue, [device, views, images, memory]() {
+		for (VkImageView view : views) {
+			vkDestroyImageView(device, view, nullptr);
+		}
+		for (VkImage image : images) {
+			vkDestroyImage(device, image, nullptr);
+		}
+		for (VkDeviceMemory allocation : memory) {
+			vkFreeMemory(device, allocation, nullptr);
+		}
+	});
+}
+
+void RenderGraph::destroyRenderGraph() {
+	destroyTransientImages();
+}
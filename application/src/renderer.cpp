@@ -1,6 +1,12 @@
 #pragma once
 
 #include "renderer.hpp"
+#include <cstdlib>
+#include <cmath>
+
+static constexpr std::array<VkPresentModeKHR, 4> PRESENT_MODES = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR }; // order of cyclePresentMode()
+static constexpr std::array<double, 4> FRAME_LIMITS = { 0.0, 144.0, 60.0, 30.0 }; // order of cycleFrameLimit(), 0 is unlimited
+static constexpr uint32_t BARREL_MODEL = 0; // index in m_models, drawn by every simulation object
 
 
 
@@ -8,45 +14,271 @@ void Renderer::initWindow() {
 	m_window = std::make_shared<Window>(); // create a window object
 }
 void Renderer::initVulkan() {
+	m_jobSystem = std::make_shared<JobSystem>(); // one worker per spare core
 	m_instance = std::make_shared<VKInstance>(); // create a instance object
 	m_window->createSurface(m_instance->getInstance()); // window
 	m_device = std::make_shared<Device>(m_instance->getInstance(), m_window->getSurface()); // create a device object
-	m_swapChain = std::make_shared<VKSwapChain>(m_window->getSurface(), m_device->getPhysicalDevice(), m_device->getDevice(), m_window->getWindow());
-	m_renderPass = std::make_shared<RenderPass>(m_device->getDevice(), m_swapChain->getSwapChainImageFormat(), m_swapChain->findDepthFormat()); // create a render pass object
+	if (const char* framesInFlight = std::getenv("VULKAN_APP_FRAMES_IN_FLIGHT")) { // per deployment throughput/latency tradeoff
+		m_framesInFlight = std::clamp<uint32_t>(static_cast<uint32_t>(std::atoi(framesInFlight)), 1, MAX_FRAMES_IN_FLIGHT);
+	}
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR; // lowest latency without tearing where supported
+	if (const char* presentModeName = std::getenv("VULKAN_APP_PRESENT_MODE")) { // fifo, fifo_relaxed, mailbox or immediate
+		for (VkPresentModeKHR mode : PRESENT_MODES) {
+			if (std::string(presentModeName) == SwapChain::presentModeName(mode)) {
+				presentMode = mode;
+			}
+		}
+	}
+	m_swapChain = std::make_shared<VKSwapChain>(m_window->getSurface(), m_device->getPhysicalDevice(), m_device->getDevice(), m_window->getWindow(), presentMode);
+	m_framePacer = std::make_shared<FramePacer>(m_device->getDevice(), m_device->supportsPresentWait());
+	if (const char* renderOnDemand = std::getenv("VULKAN_APP_RENDER_ON_DEMAND")) { // kiosk and viewer deployments
+		m_renderOnDemand = std::atoi(renderOnDemand) != 0;
+	}
+	if (const char* frameLimit = std::getenv("VULKAN_APP_FRAME_LIMIT")) { // frames per second, 0 is unlimited
+		m_framePacer->setTargetFrameRate(std::atof(frameLimit));
+	}
+	if (const char* culling = std::getenv("VULKAN_APP_CULLING")) { // 0 draws everything, to measure what culling saves
+		m_frustumCulling = std::atoi(culling) != 0;
+	}
+	if (const char* lateLatch = std::getenv("VULKAN_APP_LATE_LATCH")) { // 0 samples the camera with the scene, to measure what the late latch gains
+		m_lateLatchCamera = std::atoi(lateLatch) != 0;
+	}
 	m_uniformBuffers = std::make_shared<UniformBuffers>(m_device->getDevice(), m_device->getPhysicalDevice());
-	m_descriptorManager = std::make_shared<DescriptorManager>(m_device->getDevice(), m_uniformBuffers->getUniformBuffers());
-	m_pipeline = std::make_shared<Pipeline>(m_renderPass->getRenderPass(), m_device->getDevice(), m_swapChain->getSwapChainExtent(), m_swapChain->getSwapChainImageViews(), m_descriptorManager->getDescriptorSetLayout()); // create a pipeline object
+	m_instanceBuffers = std::make_shared<InstanceBuffers>(m_device->getDevice(), m_device->getPhysicalDevice());
+	m_descriptorManager = std::make_shared<DescriptorManager>(m_device->getDevice(), m_uniformBuffers->getUniformBuffers(), m_instanceBuffers->getInstanceBuffers());
+	m_pipelineCache = std::make_shared<PipelineCache>(m_device->getDevice(), m_device->getPhysicalDevice(), PipelineCache::getDefaultDirectory()); // load pipelines compiled in earlier runs
+
+	m_pipelineLibrary = std::make_shared<PipelineLibrary>(m_device->getDevice(), m_descriptorManager->getDescriptorSetLayouts(), m_pipelineCache->getPipelineCache(), m_device->supportsGraphicsPipelineLibrary(), *m_jobSystem); // shared layout and shaders, variants compiled on demand
+	if (m_device->supportsDrawIndirectCount() && m_frustumCulling) { // VULKAN_APP_CULLING=0 draws everything on both paths
+		m_gpuCulling = true;
+		if (const char* gpuCulling = std::getenv("VULKAN_APP_GPU_CULLING")) { // 0 culls on the CPU and records every batch, for comparison
+			m_gpuCulling = std::atoi(gpuCulling) != 0;
+		}
+	}
+	m_basePipelineState.colorFormat = m_swapChain->getSwapChainImageFormat();
+	m_basePipelineState.depthFormat = m_swapChain->findDepthFormat();
+	if (m_gpuCulling && DepthPyramid::isSupported(m_device->getPhysicalDevice(), m_basePipelineState.depthFormat)) {
+		m_occlusionCulling = true;
+		if (const char* occlusionCulling = std::getenv("VULKAN_APP_OCCLUSION_CULLING")) { // 0 draws everything in the frustum, to measure what occlusion culling saves
+			m_occlusionCulling = std::atoi(occlusionCulling) != 0;
+		}
+	}
+	if (m_gpuCulling) {
+		m_gpuCuller = std::make_shared<GpuCuller>(m_device->getDevice(), m_device->getPhysicalDevice(), *m_pipelineLibrary,
+			m_uniformBuffers->getUniformBuffers(), m_occlusionCulling); // compute pipelines live in the library
+	}
+	if (m_occlusionCulling) {
+		m_depthPyramid = std::make_shared<DepthPyramid>(m_device->getDevice(), m_device->getPhysicalDevice(), *m_pipelineLibrary); // the render graph creates the image it's reduced from
+	}
 	m_commandPool = std::make_shared<CommandPool>(m_device->getDevice(), m_device->getPhysicalDevice(), m_window->getSurface()); // create a command pool object
-	m_swapChain->createDepthResources(m_commandPool->getCommandPool(), m_device->getGraphicsQueue());
-	m_swapChain->createFrameBuffers(m_renderPass->getRenderPass(), m_swapChain->getDepthImageView());
 	createSyncObjects();
-	m_modelPBR = std::make_shared<Model>(m_device->getDevice(), m_device->getPhysicalDevice(), m_commandPool->getCommandPool(), m_device->getGraphicsQueue(), "./assets/models/barrel.obj");
-
-	m_modelPBR->loadTextures({
+	m_deletionQueue = std::make_shared<DeletionQueue>(m_device->getDevice(), *m_gpuTimeline); // resources released while frames are in flight
+	m_parallelRecorder = std::make_shared<ParallelRecorder>(m_device->getDevice(), m_commandPool->getQueueFamilyIndex(), *m_jobSystem); // per thread pools for the draw list slices
+	resizeCommandCache();
+	buildRenderGraph();
+	m_materialTable = std::make_shared<MaterialTable>(m_device->getDevice(), m_device->getPhysicalDevice(), m_commandPool->getCommandPool(), m_device->getGraphicsQueue(), *m_jobSystem);
+	m_models.push_back(std::make_shared<Model>(m_device->getDevice(), m_device->getPhysicalDevice(), m_commandPool->getCommandPool(), m_device->getGraphicsQueue(), "./assets/models/barrel.obj", m_materialTable, *m_jobSystem)); // BARREL_MODEL
+
+	m_models[BARREL_MODEL]->setMaterialTextures(0, { // the .mtl of the barrel doesn't reference its textures
 		"./assets/textures/barrel_BaseColor.png", // Base Color
 		"./assets/textures/barrel_Metallic.png", // Metallic
 		"./assets/textures/barrel_Normal.png", // Normal
 		"./assets/textures/barrel_Roughness.png" // Roughness
 		});
 
-	m_descriptorManager->createDescriptorSets(m_modelPBR->getImageViews(), m_modelPBR->getSamplers()); // sending texture to shaders
+	m_materialTable->upload(*m_deletionQueue); // all materials are known, create the storage buffer
+	m_drawList = std::make_shared<DrawList>();
+
+	std::vector<PipelineState> pipelineStates = { m_basePipelineState };
+	for (const std::shared_ptr<Model>& model : m_models) {
+		for (const PipelineState& state : model->getPipelineStates(m_basePipelineState)) { // including the material overrides
+			if (std::find(pipelineStates.begin(), pipelineStates.end(), state) == pipelineStates.end()) {
+				pipelineStates.push_back(state);
+			}
+		}
+	}
+	auto pipelineStart = std::chrono::high_resolution_clock::now();
+	m_pipelineLibrary->warmUp(pipelineStates); // compile every variant the scene needs before the first frame
+	auto pipelineTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - pipelineStart).count();
+	Log::info() << "pipeline creation: " << pipelineTime << " ms (" << (m_pipelineCache->wasLoaded() ? "warm" : "cold") << " cache)" << std::endl;
+	if (const char* repetitions = std::getenv("VULKAN_APP_PIPELINE_BENCHMARK")) { // fast link against monolithic compiles, needs the device so it runs in the app
+		m_pipelineLibrary->benchmark(pipelineStates, std::max(1, std::atoi(repetitions)));
+	}
+	m_descriptorManager->createDescriptorSets(m_materialTable->getImageViews(), m_materialTable->getSamplers(), m_materialTable->getMaterialBuffer(), m_materialTable->getMaterialBufferSize()); // sending materials and textures to shaders
+	m_scene = std::make_shared<Scene>(); // filled from the simulation objects by update()
+	m_frustumCuller = std::make_shared<FrustumCuller>(*m_jobSystem); // AVX2 where the CPU has it
+	if (const char* barrels = std::getenv("VULKAN_APP_BARRELS")) { // stress test of the instanced draws
+		addBarrelGrid(static_cast<uint32_t>(std::max(0, std::atoi(barrels))));
+	}
+	m_simulation = std::make_shared<Simulation>(SIMULATION_TIMESTEP, Simulation::Clock::now()); // publishes the initial state for the first frame
 }
 
 void Renderer::mainLoop() {
-	// Main loop
-	while (!glfwWindowShouldClose(m_window->getWindow())) {
-		glfwPollEvents(); // Poll for events
-		drawFrame();
+	m_renderThread = std::thread(&Renderer::renderLoop, this);
+
+	// Main loop: events and simulation, GLFW only allows event handling on the main thread
+	Simulation::Clock::time_point nextStep = Simulation::Clock::now();
+	try {
+		while (!glfwWindowShouldClose(m_window->getWindow()) && !m_renderThreadExited) {
+			if (m_window->isMinimized()) {
+				glfwWaitEvents(); // nothing can be seen, sleep until the window is restored
+			}
+			else {
+				double timeout = m_simulation->isPaused() ? IDLE_WAIT_TIMEOUT : std::chrono::duration<double>(nextStep - Simulation::Clock::now()).count();
+				if (timeout > 0.0) {
+					glfwWaitEventsTimeout(timeout); // input is handled as soon as it arrives, otherwise sleep until the next step is due
+				}
+				else {
+					glfwPollEvents();
+				}
+			}
+			if (m_window->takePauseToggle()) {
+				m_simulation->togglePause(); // a paused scene is replayed from the cached command buffers
+			}
+			nextStep = m_simulation->advance(Simulation::Clock::now()); // publishes without waiting for the render thread
+			wakeRenderThread();
+		}
 	}
+	catch (...) {
+		stopRenderThread(); // a joinable thread can't be destroyed
+		throw;
+	}
+	stopRenderThread();
 
 	vkDeviceWaitIdle(m_device->getDevice()); // wait for the device to finish
+	if (m_renderError) {
+		std::rethrow_exception(m_renderError);
+	}
+}
+
+void Renderer::renderLoop() {
+	try {
+		m_lastStatsPrint = std::chrono::high_resolution_clock::now();
+		while (waitForFrame()) {
+			if (m_window->takeRenderOnDemandToggle()) {
+				m_renderOnDemand = !m_renderOnDemand;
+				Log::info() << "render on demand " << (m_renderOnDemand ? "on" : "off") << std::endl;
+			}
+			for (uint32_t cycles = m_window->takePresentModeCycles(); cycles > 0; cycles--) {
+				cyclePresentMode();
+			}
+			for (uint32_t cycles = m_window->takeFrameLimitCycles(); cycles > 0; cycles--) {
+				cycleFrameLimit();
+			}
+			m_framePacer->waitForNextFrame(m_swapChain->getSwapChain(), m_swapChain->getPresentMode()); // frame rate limit and display pacing
+			drawFrame();
+
+			uint32_t requestedFramesInFlight = m_window->takeFramesInFlightRequest();
+			if (requestedFramesInFlight != 0 && requestedFramesInFlight != m_framesInFlight) {
+				setFramesInFlight(requestedFramesInFlight);
+			}
+
+			auto now = std::chrono::high_resolution_clock::now();
+			if (now - m_lastStatsPrint >= std::chrono::seconds(1)) { // once a second is enough to follow the trend
+				Log::info() << "draw list: " << m_drawStats.draws << " draws of " << m_drawStats.instances << " instances, " << m_drawStats.pipelineBinds << " pipeline binds, "
+					<< m_drawStats.meshBinds << " mesh binds, "
+					<< m_drawStats.redundantBinds << " redundant binds skipped, " << m_drawStats.skippedDraws << " draws waiting for a pipeline, sort " << m_drawStats.sortMs << " ms, record "
+					<< m_drawStats.recordMs << " ms in " << m_parallelRecorder->getLastSliceCount() << " slices" << std::endl;
+				const CullStats& cullStats = m_frustumCuller->getStats();
+				if (m_gpuCulling) {
+					const GpuCullStats& gpuStats = m_gpuCuller->getStats();
+					Log::info() << "gpu culling: " << gpuStats.visibleInstances << " of " << m_drawList->getInstances().size() << " instances visible, "
+						<< gpuStats.draws << " draws from " << m_drawStats.indirectDraws << " indirect draws";
+					if (m_occlusionCulling) {
+						Log::info() << ", " << gpuStats.occludedInstances << " occluded, " << gpuStats.lateInstances << " drawn late";
+					}
+					Log::info() << std::endl;
+				}
+				Log::info() << "culling: " << m_visibleEntities.size() << " of " << m_scene->getEntityCount() << " entities visible";
+				if (m_frustumCulling && !m_gpuCulling) {
+					Log::info() << ", " << cullStats.cullMs << " ms in " << cullStats.chunks << " chunks (" << (m_frustumCuller->usesAvx2() ? "AVX2" : "scalar") << ")";
+				}
+				Log::info() << std::endl;
+				m_frameStats.print(Log::info(), m_framesInFlight);
+				m_frameStats.reset();
+				m_framePacer->print(Log::info(), m_swapChain->getPresentMode());
+				m_framePacer->reset();
+				m_lastStatsPrint = now;
+			}
+		}
+	}
+	catch (...) {
+		m_renderError = std::current_exception(); // rethrown on the main thread
+	}
+	m_renderThreadExited = true;
+	glfwPostEmptyEvent(); // the main thread may be sleeping in glfwWaitEvents
+}
+
+bool Renderer::waitForFrame() {
+	bool waited = false;
+	std::unique_lock<std::mutex> lock(m_renderWakeMutex);
+	while (!m_stopRendering) {
+		uint64_t wakeups = m_renderWakeups;
+		auto woken = [&]() { return m_stopRendering || m_renderWakeups != wakeups; };
+		if (m_window->isMinimized()) {
+			m_renderWake.wait(lock, woken); // nothing can be seen, the main thread sleeps in glfwWaitEvents until the window is restored
+			waited = true;
+			continue;
+		}
+		auto now = std::chrono::high_resolution_clock::now();
+		if (!m_window->isFocused()) {
+			auto nextFrame = m_lastFrameStart + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(1.0 / BACKGROUND_FRAME_RATE));
+			if (now < nextFrame) {
+				m_renderWake.wait_until(lock, nextFrame, [&]() { return m_stopRendering || m_window->isFocused(); }); // regaining the focus ends the wait early
+				waited = true;
+				continue;
+			}
+		}
+		// on demand, a frame is drawn for input and window events, an animation step, or a pipeline variant becoming ready
+		bool changed = m_simulation->acquireSnapshot().version != m_drawnSimulationVersion || m_pipelineLibrary->getVersion() != m_resolvedPipelineVersion;
+		if (!m_renderOnDemand || m_window->takeRedrawRequest() || changed) {
+			if (waited) {
+				m_framePacer->idled(); // the sleep isn't a frame time
+			}
+			m_lastFrameStart = now;
+			return true;
+		}
+		m_renderWake.wait(lock, woken); // nothing changed, sleep until the main thread handled events or published a step
+		waited = true;
+	}
+	return false;
+}
+
+void Renderer::wakeRenderThread() {
+	{
+		std::lock_guard<std::mutex> lock(m_renderWakeMutex);
+		m_renderWakeups++;
+	}
+	m_renderWake.notify_one();
+}
+
+void Renderer::stopRenderThread() {
+	{
+		std::lock_guard<std::mutex> lock(m_renderWakeMutex);
+		m_stopRendering = true;
+	}
+	m_renderWake.notify_one();
+	if (m_renderThread.joinable()) {
+		m_renderThread.join();
+	}
 }
 
 void Renderer::drawFrame() {
-	vkWaitForFences(m_device->getDevice(), 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX); // wait for previous frame
+	for (uint32_t i = 0; i < m_framesInFlight; i++) { // note which earlier frames the GPU finished, for the latency stats
+		if (m_frameStats.isPending(i) && m_gpuTimeline->isComplete(m_frameTimelineValues[i])) {
+			m_frameStats.frameRetired(i);
+		}
+	}
+	auto waitStart = FrameStats::Clock::now();
+	m_gpuTimeline->wait(m_frameTimelineValues[currentFrame]); // wait for the last frame submitted from this slot
+	m_frameStats.recordFrameWait(waitStart);
+	m_frameStats.frameRetired(currentFrame);
+	m_pipelineLibrary->retirePipelines(*m_deletionQueue); // fast-linked pipelines replaced since the last frame
+	m_deletionQueue->flush(); // resources retired by frames the GPU finished
 
 	uint32_t imageIndex;
 
+	m_frameStats.frameAcquired(currentFrame);
 	VkResult result = vkAcquireNextImageKHR(m_device->getDevice(), m_swapChain->getSwapChain(), UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex); // acquire the next image from the swapchain  !!memory access!! 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) { // check if the swapchain is out of date
 		windowResize(); // recreate the swapchain if the window was resized
@@ -56,44 +288,54 @@ void Renderer::drawFrame() {
 		throw std::runtime_error("failed to acquire swap chain image!");
 	}
 
-	update();
-
-	vkResetFences(m_device->getDevice(), 1, &inFlightFences[currentFrame]); // only reset fence if we are submitting work !!memory access!!
-
-	vkResetCommandBuffer(m_commandPool->getCommandBuffer(currentFrame), 0);
-	recordCommandBuffer(m_commandPool->getCommandBuffer(currentFrame), imageIndex);
-
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	auto updateStart = FrameStats::Clock::now();
+	bool rebuilt = update();
+	m_frameStats.recordUpdate(updateStart, rebuilt);
+	if (!m_lateLatchCamera) {
+		latchCamera(); // sampled with the scene, before recording
+	}
 
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] }; // wait for the image to be available
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT }; // wait for the color attachment output stage
-	submitInfo.waitSemaphoreCount = 1; // number of semaphores to wait for
-	submitInfo.pWaitSemaphores = waitSemaphores; // semaphores to wait for
-	submitInfo.pWaitDstStageMask = waitStages; // stages to wait for
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_commandPool->getCommandBuffer(currentFrame);
+	uint32_t target = getCommandTarget(currentFrame, imageIndex); // only this slot submitted it, so it isn't pending anymore
+	VkCommandBuffer commandBuffer = m_commandPool->getCommandBuffer(target);
+	bool replay = m_recordedVersions[target] == m_sceneVersion;
+	if (!replay) {
+		vkResetCommandBuffer(commandBuffer, 0);
+		m_parallelRecorder->resetTarget(target); // and the secondary command buffers it executed
+		if (m_frameSetVersions[currentFrame] != m_sceneVersion) { // none of the slot's cached command buffers is current, so none is replayed with its sets
+			m_descriptorManager->resetFrameDescriptors(currentFrame); // the wait above retired the slot's last submission
+			m_descriptorManager->allocateFrameSet(currentFrame);
+			m_frameSetVersions[currentFrame] = m_sceneVersion;
+		}
+		recordCommandBuffer(commandBuffer, imageIndex);
+		m_recordedVersions[target] = m_sceneVersion;
+	}
+	m_frameStats.frameRecorded(replay);
 
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] }; // signal the render finished semaphore
-	submitInfo.signalSemaphoreCount = 1; // number of semaphores to signal
-	submitInfo.pSignalSemaphores = signalSemaphores; // semaphores to signal
-	if (vkQueueSubmit(m_device->getGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) { // submit the command buffer  !!memory access!!
-		throw std::runtime_error("failed to submit draw command buffer!");
+	if (m_lateLatchCamera) {
+		latchCamera(); // as late as possible, nothing but the submit is left between the sample and the GPU
 	}
+	m_frameTimelineValues[currentFrame] = m_gpuTimeline->submit(m_device->getGraphicsQueue(), commandBuffer,
+		{ GpuTimeline::semaphoreInfo(imageAvailableSemaphores[currentFrame], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT) }, // wait for the image to be available
+		{ GpuTimeline::semaphoreInfo(renderFinishedSemaphores[currentFrame], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT) }); // presentation can't wait on a timeline value  !!memory access!!
+	auto submitTime = FramePacer::Clock::now();
+	m_frameStats.frameSubmitted(currentFrame, m_sceneSampleTime, m_cameraSampleTime);
+
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+	presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
 
 	VkSwapchainKHR swapChains[] = { m_swapChain->getSwapChain() };
 	presentInfo.swapchainCount = 1;
 	presentInfo.pSwapchains = swapChains;
 	presentInfo.pImageIndices = &imageIndex;
 	presentInfo.pResults = nullptr; // allow to choose between multiple swapchains
+	m_framePacer->attachPresentId(presentInfo, submitTime); // lets the pacer wait for this image to reach the display
 	result = vkQueuePresentKHR(m_device->getPresentQueue(), &presentInfo); // present the image  !!memory access!!
+	m_frameStats.framePresented(currentFrame);
+	m_framePacer->framePresented();
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
-		framebufferResized = false;
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_window->takeFramebufferResized() || framebufferResized) {
 		windowResize(); // recreate the swapchain if the window was resized
 	}
 	else if (result != VK_SUCCESS) {
@@ -101,28 +343,179 @@ void Renderer::drawFrame() {
 	}
 
 
-	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT; // increment the current frame
+	currentFrame = (currentFrame + 1) % m_framesInFlight; // increment the current frame
 }
 
-void Renderer::update() {
-	// Update the uniform buffer
-	m_uniformBuffers->updateUniformBuffer(currentFrame, m_swapChain->getSwapChainExtent());
+bool Renderer::update() {
+	m_sceneSampleTime = FrameStats::Clock::now();
+	const SimulationSnapshot& snapshot = m_simulation->acquireSnapshot(); // the latest published steps, never waits for the simulation
+	m_simulation->interpolate(snapshot, Simulation::Clock::now(), m_renderState);
+	m_drawnSimulationVersion = snapshot.version;
+	for (size_t i = 0; i < m_renderState.objects.size(); i++) {
+		if (i == m_objectEntities.size()) { // spawned by the simulation
+			Entity entity = m_scene->createEntity();
+			m_scene->setRenderable(entity, BARREL_MODEL, m_models[BARREL_MODEL]->getBounds());
+			m_objectEntities.push_back(entity);
+		}
+		const ObjectState& object = m_renderState.objects[i];
+		m_scene->setLocalTransform(m_objectEntities[i], object.position, object.rotation, object.scale); // ignored unless it moved
+		m_scene->setVisible(m_objectEntities[i], object.visible);
+	}
+	for (size_t i = m_renderState.objects.size(); i < m_objectEntities.size(); i++) {
+		m_scene->setVisible(m_objectEntities[i], false); // the simulation dropped the object
+	}
+	m_scene->updateTransforms(); // only the subtrees that moved
+
+	CameraState camera = m_renderState.camera; // only culls and orders the draws by depth, latchCamera() writes the camera the frame is shaded with
+	LookAngles look = m_window->getLookAngles();
+	camera.look(look.yaw, look.pitch);
+	glm::mat4 view = camera.getView();
+	VkExtent2D extent = m_swapChain->getSwapChainExtent();
+	// the latched camera may turn by MAX_LATCH_LOOK_DELTA around both axes, turns combine and tilt the frustum's
+	// corners, three times the delta keeps whatever it can see inside
+	glm::mat4 viewProjection = camera.getWidenedProjection(extent.width / (float)extent.height, 3.0f * MAX_LATCH_LOOK_DELTA) * view;
+
+	// a static frame replays the cached command buffers without touching the draw list, the GPU culls an unchanged
+	// list against a new camera by itself, the CPU has to cull it again and transparent batches need sorting again
+	const std::vector<glm::mat4>& worldMatrices = m_scene->getWorldMatrices();
+	bool viewDependent = !m_gpuCulling || m_drawList->getFirstTransparentBatch() < m_drawList->getBatchCount();
+	bool rebuild = m_scene->getVersion() != m_drawListSceneVersion || (viewDependent && viewProjection != m_drawListViewProjection);
+	if (rebuild) {
+		m_drawListSceneVersion = m_scene->getVersion();
+		m_drawListViewProjection = viewProjection;
+		m_culledCamera = m_renderState.camera;
+		m_culledLook = look;
+		cullScene(viewProjection);
+
+		m_drawList->clear();
+		const std::vector<uint32_t>& models = m_scene->getModels();
+		const std::vector<uint32_t>& materials = m_scene->getMaterials();
+		for (uint32_t i : m_visibleEntities) {
+			if (models[i] != NO_MODEL) {
+				m_models[models[i]]->emitDraws(*m_drawList, m_basePipelineState, worldMatrices[i], view, materials[i], i); // the entity tracks the occlusion of all its instances
+			}
+		}
+		m_drawList->sort(); // by pass, pipeline, material, mesh, sub mesh, depth, then batched into instanced draws
+		m_drawListVersion++;
+	}
+	// culled on the GPU, the groups only change with the entities and their models, moves only change the instances
+	bool batchesChanged = rebuild && (viewDependent || m_scene->getStructureVersion() != m_drawListStructureVersion);
+	m_drawListStructureVersion = m_scene->getStructureVersion();
+	uint64_t pipelineVersion = m_pipelineLibrary->getVersion(); // read first, a variant finishing during the resolve bumps it again
+	if (batchesChanged || pipelineVersion != m_resolvedPipelineVersion) { // a variant finishing its compile changes what is recorded
+		m_resolvedPipelineVersion = pipelineVersion;
+		m_drawList->resolvePipelines(*m_pipelineLibrary);
+		m_sceneVersion++;
+	}
+
+	bool instancesReplaced = false;
+	if (m_instanceVersions[currentFrame] != m_drawListVersion) { // each slot keeps its copy, replayed command buffers read it
+		instancesReplaced = m_instanceBuffers->updateInstanceBuffer(currentFrame, m_drawList->getInstances(), *m_deletionQueue);
+		m_instanceVersions[currentFrame] = m_drawListVersion;
+	}
+	if (m_gpuCulling) {
+		if (m_gpuCuller->update(currentFrame, m_instanceBuffers->getInstanceBuffer(currentFrame), static_cast<uint32_t>(m_drawList->getInstances().size()), m_drawList->getFirstTransparentInstance(),
+			m_drawList->getGPUBatches(), m_drawList->getGPUGroups(), m_drawListVersion, static_cast<uint32_t>(worldMatrices.size()), extent, *m_deletionQueue)) { // latchCamera() writes the frustum
+			m_descriptorManager->updateInstanceBuffer(currentFrame, m_gpuCuller->getVisibleInstanceBuffer(currentFrame)); // the vertex shader reads the survivors
+			m_sceneVersion++;
+		}
+	}
+	else if (instancesReplaced) {
+		m_descriptorManager->updateInstanceBuffer(currentFrame, m_instanceBuffers->getInstanceBuffer(currentFrame));
+		m_sceneVersion++; // the slot's cached command buffers bound a set with the old buffer
+	}
+	return rebuild;
+}
+
+void Renderer::cullScene(const glm::mat4& viewProjection) {
+	const std::vector<uint8_t>& visibility = m_scene->getVisibility();
+	if (!m_frustumCulling || m_gpuCulling) { // the GPU tests every instance of the visible entities
+		m_visibleEntities.clear();
+		for (uint32_t i = 0; i < visibility.size(); i++) {
+			if (visibility[i]) {
+				m_visibleEntities.push_back(i);
+			}
+		}
+		return;
+	}
+	CullInput input;
+	input.count = m_scene->getEntityCount();
+	input.centerX = m_scene->getBoundsCenterX().data();
+	input.centerY = m_scene->getBoundsCenterY().data();
+	input.centerZ = m_scene->getBoundsCenterZ().data();
+	input.radius = m_scene->getBoundsRadius().data();
+	input.extentX = m_scene->getBoundsExtentX().data();
+	input.extentY = m_scene->getBoundsExtentY().data();
+	input.extentZ = m_scene->getBoundsExtentZ().data();
+	input.enabled = visibility.data(); // hidden entities are skipped eight at a time
+	m_frustumCuller->cull(Frustum::fromViewProjection(viewProjection), input, m_visibleEntities);
+}
+
+void Renderer::addBarrelGrid(uint32_t count) {
+	const BoundingBox& bounds = m_models[BARREL_MODEL]->getBounds();
+	glm::vec3 extent = bounds.getExtent();
+	float spacing = BARREL_GRID_SPACING * 2.0f * std::max({ extent.x, extent.y, extent.z });
+	uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+	m_scene->reserve(count + 1); // and the animated barrel
+	for (uint32_t i = 0; i < count; i++) {
+		float x = (static_cast<float>(i % columns) - 0.5f * static_cast<float>(columns - 1)) * spacing;
+		float z = static_cast<float>(i / columns + 1) * spacing; // rows away from the camera, starting behind the animated barrel
+		Entity entity = m_scene->createEntity();
+		m_scene->setLocalTransform(entity, glm::vec3(x, 0.0f, z), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+		m_scene->setRenderable(entity, BARREL_MODEL, bounds);
+	}
+}
+
+void Renderer::latchCamera() {
+	m_cameraSampleTime = FrameStats::Clock::now();
+	CameraState camera;
+	LookAngles look = m_window->getLookAngles(); // mouse input the main thread handled up to now
+	if (m_gpuCulling) {
+		const SimulationSnapshot& snapshot = m_simulation->acquireSnapshot(); // steps published while the frame was recorded
+		m_simulation->interpolateCamera(snapshot, Simulation::Clock::now(), camera);
+	}
+	else {
+		// the recorded draws were culled on the CPU with a frustum wider by the look margin, only turns within it stay correct
+		camera = m_culledCamera;
+		look.yaw = std::clamp(look.yaw, m_culledLook.yaw - MAX_LATCH_LOOK_DELTA, m_culledLook.yaw + MAX_LATCH_LOOK_DELTA);
+		look.pitch = std::clamp(look.pitch, m_culledLook.pitch - MAX_LATCH_LOOK_DELTA, m_culledLook.pitch + MAX_LATCH_LOOK_DELTA);
+	}
+	camera.look(look.yaw, look.pitch);
+	VkExtent2D extent = m_swapChain->getSwapChainExtent();
+	m_uniformBuffers->updateUniformBuffer(currentFrame, extent, camera); // host coherent, the submit makes the write visible
+	if (m_gpuCulling) {
+		m_gpuCuller->setFrustum(currentFrame, Frustum::fromViewProjection(camera.getProjection(extent.width / (float)extent.height) * camera.getView())); // culls with the camera it's drawn with
+	}
 }
 
 // cleanup functions
 void Renderer::cleanup() {
 	m_swapChain->cleanupSwapChain();
-	m_uniformBuffers->destroyUniformBuffers();
-	m_descriptorManager->destroyDescriptorManager();
-	m_modelPBR->destroyModel(); // destroy model
-	m_pipeline->destroyPipeline();
-	vkDestroyRenderPass(m_device->getDevice(), m_renderPass->getRenderPass(), nullptr);
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) // cleanup semaphores and fences
+	m_renderGraph->destroyRenderGraph(); // transient attachments
+	m_uniformBuffers->destroyUniformBuffers(*m_deletionQueue);
+	m_instanceBuffers->destroyInstanceBuffers(*m_deletionQueue);
+	if (m_gpuCuller) {
+		m_gpuCuller->destroyGpuCuller(*m_deletionQueue); // its pipelines go with the library
+	}
+	if (m_depthPyramid) {
+		m_depthPyramid->destroyDepthPyramid(*m_deletionQueue);
+	}
+	m_descriptorManager->destroyDescriptorManager(*m_deletionQueue);
+	for (const std::shared_ptr<Model>& model : m_models) {
+		model->destroyModel(*m_deletionQueue); // destroy model
+	}
+	m_materialTable->destroyMaterialTable(*m_deletionQueue); // destroy materials and textures
+	m_pipelineLibrary->destroyPipelineLibrary(); // waits for background compiles
+	m_deletionQueue->flushAll(); // the device is idle after the main loop, runs everything queued above and by earlier frames
+	m_pipelineCache->savePipelineCache(); // keep the compiled pipelines for the next run
+	m_pipelineCache->destroyPipelineCache();
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) // cleanup semaphores
 	{
 		vkDestroySemaphore(m_device->getDevice(), renderFinishedSemaphores[i], nullptr);
 		vkDestroySemaphore(m_device->getDevice(), imageAvailableSemaphores[i], nullptr);
-		vkDestroyFence(m_device->getDevice(), inFlightFences[i], nullptr);
 	}
+	m_gpuTimeline->destroyGpuTimeline();
+	m_parallelRecorder->destroyParallelRecorder();
 	vkDestroyCommandPool(m_device->getDevice(), m_commandPool->getCommandPool(), nullptr);
 	vkDestroyDevice(m_device->getDevice(), nullptr);
 	m_window->destroySurface(m_instance->getInstance());
@@ -132,98 +525,218 @@ void Renderer::cleanup() {
 }
 
 
+void Renderer::setFramesInFlight(uint32_t count) {
+	m_gpuTimeline->wait(m_gpuTimeline->getLastSubmittedValue()); // every slot submitted before it
+	for (uint32_t i = 0; i < m_framesInFlight; i++) {
+		m_frameStats.frameRetired(i);
+	}
+	m_framesInFlight = std::clamp<uint32_t>(count, 1, MAX_FRAMES_IN_FLIGHT);
+	currentFrame = 0; // every slot is idle now
+	Log::info() << "frames in flight set to " << m_framesInFlight << std::endl;
+}
+
+void Renderer::setPresentMode(VkPresentModeKHR presentMode) {
+	m_swapChain->setPresentMode(presentMode);
+	windowResize(); // the present mode is fixed at swap chain creation
+	Log::info() << "present mode set to " << SwapChain::presentModeName(m_swapChain->getPresentMode()) << std::endl;
+}
+
+void Renderer::cyclePresentMode() {
+	std::vector<VkPresentModeKHR> supported = SwapChain::querySwapChainSupport(m_device->getPhysicalDevice(), m_window->getSurface()).presentModes;
+	size_t current = std::find(PRESENT_MODES.begin(), PRESENT_MODES.end(), m_swapChain->getPresentMode()) - PRESENT_MODES.begin();
+	for (size_t i = 1; i <= PRESENT_MODES.size(); i++) {
+		VkPresentModeKHR mode = PRESENT_MODES[(current + i) % PRESENT_MODES.size()];
+		if (std::find(supported.begin(), supported.end(), mode) != supported.end()) {
+			setPresentMode(mode);
+			return;
+		}
+	}
+}
+
+void Renderer::cycleFrameLimit() {
+	size_t current = std::find(FRAME_LIMITS.begin(), FRAME_LIMITS.end(), m_framePacer->getTargetFrameRate()) - FRAME_LIMITS.begin();
+	double limit = FRAME_LIMITS[(current + 1) % FRAME_LIMITS.size()]; // a limit from the environment continues with the first limit
+	m_framePacer->setTargetFrameRate(limit);
+	Log::info() << "frame rate limit set to " << (limit > 0.0 ? std::to_string(static_cast<int>(limit)) + " fps" : std::string("unlimited")) << std::endl;
+}
+
 void Renderer::createSyncObjects() {
 	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 	renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+	m_gpuTimeline = std::make_shared<GpuTimeline>(m_device->getDevice()); // slots start at value 0, so the first frame doesn't wait
+	m_frameTimelineValues.fill(0);
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // signaled so it doesnt hang at the first frame
-
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 		if (vkCreateSemaphore(m_device->getDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS
-			|| vkCreateSemaphore(m_device->getDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS
-			|| vkCreateFence(m_device->getDevice(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) // create semaphores and fence
+			|| vkCreateSemaphore(m_device->getDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) // binary semaphores for acquire and present
 		{
 			throw std::runtime_error("failed to create synchronization objects for a frame!");
 		}
 	}
 }
 
-void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = 0; // optional
-	beginInfo.pInheritanceInfo = nullptr; // optional
-
-	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
-		throw std::runtime_error("failed to begin recording command buffer!");
+void Renderer::buildRenderGraph() {
+	m_renderGraph = std::make_shared<RenderGraph>(m_device->getDevice(), m_device->getPhysicalDevice());
+	m_backbuffer = m_renderGraph->importImage("backbuffer", m_swapChain->getSwapChainImageFormat(),
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT); // the acquire semaphore is waited on at colour output
+	m_depthBuffer = m_renderGraph->createImage("depth", { m_basePipelineState.depthFormat });
+
+	if (m_gpuCulling) {
+		m_renderGraph->addPass("cull", [&](RenderGraph::PassBuilder& pass) {
+			pass.setSideEffects(); // the graph only tracks images, the pass records the barriers of its buffers itself
+		}, [this](VkCommandBuffer commandBuffer) {
+			m_gpuCuller->recordEarly(commandBuffer, currentFrame); // outside rendering, before the forward pass draws what it wrote
+		});
 	}
 
-	VkExtent2D swapChainExtent = m_swapChain->getSwapChainExtent();
-	//RENDER PASS
-	VkRenderPassBeginInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = m_renderPass->getRenderPass();
-	renderPassInfo.framebuffer = m_swapChain->getSwapChainFramebuffers()[imageIndex];
-	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = swapChainExtent;
+	m_renderGraph->addPass("forward", [&](RenderGraph::PassBuilder& pass) {
+		pass.writeColor(m_backbuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, { { 0.012f, 0.018f, 0.02f, 1.0f } }); // clear color
+		pass.writeDepth(m_depthBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f); // clear depth
+		pass.useSecondaryCommandBuffers(); // the draw list is recorded on several threads
+	}, [this](VkCommandBuffer commandBuffer) {
+		auto recordStart = std::chrono::high_resolution_clock::now();
+		m_sliceStats.assign(m_parallelRecorder->getMaxSlices(), DrawStats{}); // pipelines were resolved by update()
+
+		size_t groupCount = m_drawList->getGroupCount();
+		size_t transparentBatch = m_drawList->getFirstTransparentBatch();
+		size_t transparentCount = m_occlusionCulling ? 0 : m_drawList->getBatchCount() - transparentBatch; // with occlusion culling they go after the late draws
+		size_t itemCount = m_gpuCulling ? groupCount + transparentCount : m_drawList->getBatchCount(); // one indirect draw per group, then the transparent batches
+		m_parallelRecorder->record(commandBuffer, m_recordingTarget, m_renderGraph->getRenderingInheritance(), itemCount,
+			[this, groupCount, transparentBatch](VkCommandBuffer secondary, size_t first, size_t last, uint32_t slice) {
+			bindForwardState(secondary); // secondary command buffers inherit no state
+
+			if (m_gpuCulling) {
+				m_sliceStats[slice] = m_drawList->recordIndirectRange(secondary, std::min(first, groupCount), std::min(last, groupCount), m_gpuCuller->getDrawCommandBuffer(currentFrame),
+					m_gpuCuller->getDrawCommandOffset(currentFrame, 0), m_gpuCuller->getDrawCountBuffer(currentFrame), m_gpuCuller->getDrawCountOffset(currentFrame, 0)); // the early phase, everything without occlusion culling
+				m_sliceStats[slice] += m_drawList->recordRange(secondary, transparentBatch + std::max(first, groupCount) - groupCount,
+					transparentBatch + std::max(last, groupCount) - groupCount); // back to front, the culling shaders kept their instances in place
+			}
+			else {
+				m_sliceStats[slice] = m_drawList->recordRange(secondary, first, last); // binds pipelines and buffers only when they change
+			}
+		});
+
+		DrawStats stats{};
+		for (const DrawStats& sliceStats : m_sliceStats) {
+			stats += sliceStats;
+		}
+		stats.recordMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+		m_drawList->setRecordStats(stats);
+		m_drawStats = m_drawList->getStats();
+	});
+
+	if (m_occlusionCulling) {
+		m_renderGraph->addPass("depth pyramid", [&](RenderGraph::PassBuilder& pass) {
+			pass.sampleCompute(m_depthBuffer); // the graph stores the early depth and transitions it for sampling
+			pass.setSideEffects(); // the pyramid is outside the graph
+		}, [this](VkCommandBuffer commandBuffer) {
+			m_depthPyramid->record(commandBuffer);
+		});
+
+		m_renderGraph->addPass("cull late", [&](RenderGraph::PassBuilder& pass) {
+			pass.setSideEffects();
+		}, [this](VkCommandBuffer commandBuffer) {
+			m_gpuCuller->recordLate(commandBuffer, currentFrame); // tests the rest against the pyramid of the early draws
+		});
 
-	std::array<VkClearValue, 2> clearValues{}; // clear color
-	clearValues[0].color = { 0.012f, 0.018f, 0.02f, 1.0f }; // clear color
-	clearValues[1].depthStencil = { 1.0f, 0 }; // clear depth
+		m_renderGraph->addPass("forward late", [&](RenderGraph::PassBuilder& pass) {
+			pass.writeColor(m_backbuffer, VK_ATTACHMENT_LOAD_OP_LOAD);
+			pass.writeDepth(m_depthBuffer, VK_ATTACHMENT_LOAD_OP_LOAD); // on top of the early draws
+		}, [this](VkCommandBuffer commandBuffer) {
+			// recorded inline, the parallel recorder's pools belong to the forward pass, and it's a draw per group at most
+			bindForwardState(commandBuffer);
+			DrawStats stats = m_drawList->recordIndirectRange(commandBuffer, 0, m_drawList->getGroupCount(), m_gpuCuller->getDrawCommandBuffer(currentFrame), m_gpuCuller->getDrawCommandOffset(currentFrame, 1),
+				m_gpuCuller->getDrawCountBuffer(currentFrame), m_gpuCuller->getDrawCountOffset(currentFrame, 1));
+			stats += m_drawList->recordRange(commandBuffer, m_drawList->getFirstTransparentBatch(), m_drawList->getBatchCount()); // blended over every opaque draw of both phases
+			m_drawStats += stats;
+		});
+	}
 
-	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassInfo.pClearValues = clearValues.data(); // clear color
+	m_renderGraph->compile(m_swapChain->getSwapChainExtent());
+	resizeDepthPyramid();
+}
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE); // begin render pass
+void Renderer::resizeDepthPyramid() {
+	if (!m_depthPyramid) {
+		return;
+	}
+	m_depthPyramid->resize(m_renderGraph->getExtent(), m_renderGraph->getImageView(m_depthBuffer), *m_deletionQueue); // frames in flight keep the old one
+	m_gpuCuller->setDepthPyramid(m_depthPyramid->getView(), m_depthPyramid->getSampler());
+}
 
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getPipeline()); // bind the pipeline
+void Renderer::bindForwardState(VkCommandBuffer commandBuffer) {
+	VkExtent2D extent = m_renderGraph->getExtent();
 
 	//VIEWPORT AND SCISSOR
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(swapChainExtent.width);
-	viewport.height = static_cast<float>(swapChainExtent.height);
+	viewport.width = static_cast<float>(extent.width);
+	viewport.height = static_cast<float>(extent.height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	vkCmdSetViewport(commandBuffer, 0, 1, &viewport); // set the viewport
 
 	VkRect2D scissor{};
 	scissor.offset = { 0, 0 };
-	scissor.extent = swapChainExtent;
+	scissor.extent = extent;
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor); // set the scissor
 
-	////BUFFERS
-	m_modelPBR->bind(commandBuffer); // bind the buffers
-
 	//DESCRIPTOR SETS
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getPipelineLayout(), 0, 1, &m_descriptorManager->getDescriptorSet(currentFrame), 0, nullptr); // bind the descriptor sets
+	std::array<VkDescriptorSet, 2> descriptorSets = m_descriptorManager->getDescriptorSets(currentFrame); // the material table, then the frame's buffers
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLibrary->getPipelineLayout(), 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr); // bind the descriptor sets
+}
+
+void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = 0; // optional
+	beginInfo.pInheritanceInfo = nullptr; // optional
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording command buffer!");
+	}
 
-	m_modelPBR->draw(commandBuffer); // draw the triangle
+	m_recordingTarget = getCommandTarget(currentFrame, imageIndex);
+	m_renderGraph->setImportedImage(m_backbuffer, m_swapChain->getSwapChainImages()[imageIndex], m_swapChain->getSwapChainImageViews()[imageIndex]);
+	m_renderGraph->execute(commandBuffer); // every pass with its barriers
 
-	vkCmdEndRenderPass(commandBuffer); // end render pass
 	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
 		throw std::runtime_error("failed to record command buffer!");
 	}
 }
 
 void Renderer::windowResize() {
-	int width = 0, height = 0;
-	glfwGetFramebufferSize(m_window->getWindow(), &width, &height); // get the window size
-	while (width == 0 || height == 0) { // wait for the window to be resized
-		glfwGetFramebufferSize(m_window->getWindow(), &width, &height);
-		glfwWaitEvents();
+	VkExtent2D framebufferExtent = m_window->getFramebufferExtent(); // from the last resize event, GLFW can only be queried on the main thread
+	if (framebufferExtent.width == 0 || framebufferExtent.height == 0) { // minimized, the main loop sleeps until the window is restored and the next frame recreates it
+		framebufferResized = true;
+		return;
 	}
-	vkDeviceWaitIdle(m_device->getDevice());
-	m_swapChain->cleanupSwapChain();
-	m_swapChain->createSwapChain(m_window->getSurface());
-	m_swapChain->createImageViews();
-	m_swapChain->createDepthResources(m_commandPool->getCommandPool(), m_device->getGraphicsQueue());
-	m_swapChain->createFrameBuffers(m_renderPass->getRenderPass(), m_swapChain->getDepthImageView());
+	framebufferResized = false;
+	auto start = std::chrono::high_resolution_clock::now();
+	uint64_t retireValue = m_gpuTimeline->getLastSubmittedValue(); // the last frame that may still use the old images
+	m_swapChain->recreateSwapChain(m_window->getSurface(), framebufferExtent, *m_deletionQueue, retireValue); // frames in flight keep going, no device wide wait
+	m_renderGraph->retireTransientImages(*m_deletionQueue, retireValue);
+	m_framePacer->swapChainRecreated();
+	m_renderGraph->compile(m_swapChain->getSwapChainExtent()); // recreate the transient attachments at the new size
+	resizeDepthPyramid(); // reduced from the new depth buffer
+	resizeCommandCache(); // the cached command buffers reference the old images
+	Log::info() << "swap chain recreated in " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+}
+
+void Renderer::resizeCommandCache() {
+	uint32_t targetCount = MAX_FRAMES_IN_FLIGHT * static_cast<uint32_t>(m_swapChain->getSwapChainImages().size());
+	if (targetCount != m_recordedVersions.size()) { // the swap chain image count changed, pending command buffers are freed later
+		uint64_t retireValue = m_gpuTimeline->getLastSubmittedValue();
+		m_commandPool->resizeCommandBuffers(targetCount, *m_deletionQueue, retireValue);
+		m_parallelRecorder->resize(targetCount, *m_deletionQueue, retireValue);
+	}
+	m_recordedVersions.assign(targetCount, 0); // each is re-recorded once its frame slot retired
+}
+
+uint32_t Renderer::getCommandTarget(uint32_t frame, uint32_t imageIndex) const {
+	return frame * static_cast<uint32_t>(m_swapChain->getSwapChainImages().size()) + imageIndex;
 }
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SCENE_USE_SSE 1
+#endif
+
+namespace {
+	/**
+	 * @brief result = a * b for column major 4x4 matrices, result may be b but not a.
+	 */
+	void multiplyMatrices(const float* a, const float* b, float* result) {
+#ifdef SCENE_USE_SSE
+		__m128 a0 = _mm_loadu_ps(a);
+		__m128 a1 = _mm_loadu_ps(a + 4);
+		__m128 a2 = _mm_loadu_ps(a + 8);
+		__m128 a3 = _mm_loadu_ps(a + 12);
+		for (int column = 0; column < 4; column++) { // each result column only reads the same column of b
+			__m128 bColumn = _mm_loadu_ps(b + column * 4);
+			__m128 sum = _mm_mul_ps(a0, _mm_shuffle_ps(bColumn, bColumn, _MM_SHUFFLE(0, 0, 0, 0)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_shuffle_ps(bColumn, bColumn, _MM_SHUFFLE(1, 1, 1, 1))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_shuffle_ps(bColumn, bColumn, _MM_SHUFFLE(2, 2, 2, 2))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_shuffle_ps(bColumn, bColumn, _MM_SHUFFLE(3, 3, 3, 3))));
+			_mm_storeu_ps(result + column * 4, sum);
+		}
+#else
+		for (int column = 0; column < 4; column++) {
+			float sum[4];
+			for (int row = 0; row < 4; row++) {
+				sum[row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1] + a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+			}
+			std::copy(sum, sum + 4, result + column * 4);
+		}
+#endif
+	}
+
+	/**
+	 * @brief Reorders an array so that element i is the old element order[i].
+	 */
+	template<typename T>
+	void permute(std::vector<T>& values, const std::vector<uint32_t>& order, std::vector<T>& scratch) {
+		scratch.resize(values.size());
+		for (size_t i = 0; i < order.size(); i++) {
+			scratch[i] = values[order[i]];
+		}
+		values.swap(scratch);
+	}
+}
+
+void Scene::reserve(size_t entityCount) {
+	for (std::vector<float>* column : { &m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY, &m_rotationZ, &m_rotationW,
+		&m_scaleX, &m_scaleY, &m_scaleZ, &m_boundsCenterX, &m_boundsCenterY, &m_boundsCenterZ, &m_boundsRadius,
+		&m_boundsExtentX, &m_boundsExtentY, &m_boundsExtentZ }) {
+		column->reserve(entityCount);
+	}
+	for (std::vector<uint32_t>* column : { &m_parents, &m_subtreeEnds, &m_entities, &m_indices, &m_models, &m_materials }) {
+		column->reserve(entityCount);
+	}
+	m_worldMatrices.reserve(entityCount);
+	m_visible.reserve(entityCount);
+	m_localBounds.reserve(entityCount);
+	m_localExtents.reserve(entityCount);
+	m_queued.reserve(entityCount);
+}
+
+Entity Scene::createEntity(Entity parent) {
+	uint32_t index = static_cast<uint32_t>(m_entities.size());
+	uint32_t parentIndex = NO_PARENT;
+	if (parent != INVALID_ENTITY) {
+		if (parent >= m_indices.size()) {
+			throw std::runtime_error("failed to create entity, its parent doesn't exist!");
+		}
+		parentIndex = m_indices[parent];
+		if (m_subtreeEnds[parentIndex] == index) { // the parent's subtree is at the end, the child extends it and those of its ancestors
+			for (uint32_t ancestor = parentIndex; ancestor != NO_PARENT; ancestor = m_parents[ancestor]) {
+				m_subtreeEnds[ancestor] = index + 1;
+			}
+		}
+		else {
+			m_reorderPending = true; // the child belongs in the middle of the arrays
+		}
+	}
+
+	Entity entity = static_cast<Entity>(m_indices.size());
+	m_indices.push_back(index);
+	m_entities.push_back(entity);
+	m_parents.push_back(parentIndex);
+	m_subtreeEnds.push_back(index + 1);
+	m_positionX.push_back(0.0f);
+	m_positionY.push_back(0.0f);
+	m_positionZ.push_back(0.0f);
+	m_rotationX.push_back(0.0f);
+	m_rotationY.push_back(0.0f);
+	m_rotationZ.push_back(0.0f);
+	m_rotationW.push_back(1.0f);
+	m_scaleX.push_back(1.0f);
+	m_scaleY.push_back(1.0f);
+	m_scaleZ.push_back(1.0f);
+	m_worldMatrices.push_back(glm::mat4(1.0f));
+	m_boundsCenterX.push_back(0.0f);
+	m_boundsCenterY.push_back(0.0f);
+	m_boundsCenterZ.push_back(0.0f);
+	m_boundsRadius.push_back(0.0f);
+	m_boundsExtentX.push_back(0.0f);
+	m_boundsExtentY.push_back(0.0f);
+	m_boundsExtentZ.push_back(0.0f);
+	m_models.push_back(NO_MODEL);
+	m_materials.push_back(NO_MATERIAL_OVERRIDE);
+	m_visible.push_back(1);
+	m_localBounds.push_back(glm::vec4(0.0f));
+	m_localExtents.push_back(glm::vec3(0.0f));
+	m_queued.push_back(0);
+	markDirty(index); // its world transform follows the parent's
+	m_version++;
+	m_structureVersion++;
+	return entity;
+}
+
+void Scene::setLocalTransform(Entity entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+	uint32_t index = m_indices[entity];
+	if (m_positionX[index] == position.x && m_positionY[index] == position.y && m_positionZ[index] == position.z
+		&& m_rotationX[index] == rotation.x && m_rotationY[index] == rotation.y && m_rotationZ[index] == rotation.z && m_rotationW[index] == rotation.w
+		&& m_scaleX[index] == scale.x && m_scaleY[index] == scale.y && m_scaleZ[index] == scale.z) {
+		return; // static entities are set every frame too, only real changes dirty the subtree
+	}
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_positionZ[index] = position.z;
+	m_rotationX[index] = rotation.x;
+	m_rotationY[index] = rotation.y;
+	m_rotationZ[index] = rotation.z;
+	m_rotationW[index] = rotation.w;
+	m_scaleX[index] = scale.x;
+	m_scaleY[index] = scale.y;
+	m_scaleZ[index] = scale.z;
+	markDirty(index);
+	m_version++;
+}
+
+void Scene::setRenderable(Entity entity, uint32_t model, const BoundingBox& localBounds, uint32_t material) {
+	uint32_t index = m_indices[entity];
+	m_models[index] = model;
+	m_materials[index] = material;
+	m_localBounds[index] = glm::vec4(localBounds.getCenter(), glm::length(localBounds.getExtent())); // sphere around the box
+	m_localExtents[index] = localBounds.getExtent();
+	markDirty(index); // for its world bounds
+	m_version++;
+	m_structureVersion++;
+}
+
+void Scene::setVisible(Entity entity, bool visible) {
+	uint8_t& current = m_visible[m_indices[entity]];
+	if (current != (visible ? 1 : 0)) { // set every frame like the transforms
+		current = visible ? 1 : 0;
+		m_version++;
+		m_structureVersion++;
+	}
+}
+
+void Scene::markDirty(uint32_t index) {
+	if (m_reorderPending || m_queued[index]) { // everything is updated after the reorder anyway
+		return;
+	}
+	m_queued[index] = 1;
+	m_dirtyRanges.push_back({ index, m_subtreeEnds[index] });
+}
+
+uint32_t Scene::updateTransforms() {
+	if (m_reorderPending) {
+		sortHierarchy();
+		m_reorderPending = false;
+		m_dirtyRanges.clear();
+		if (!m_entities.empty()) {
+			m_dirtyRanges.push_back({ 0, static_cast<uint32_t>(m_entities.size()) });
+		}
+	}
+	if (m_dirtyRanges.empty()) {
+		return 0;
+	}
+
+	auto byFirst = [](const DirtyRange& a, const DirtyRange& b) { return a.first < b.first; };
+	if (!std::is_sorted(m_dirtyRanges.begin(), m_dirtyRanges.end(), byFirst)) { // usually queued in order already
+		std::sort(m_dirtyRanges.begin(), m_dirtyRanges.end(), byFirst);
+	}
+	uint32_t updated = 0;
+	DirtyRange run = m_dirtyRanges[0];
+	for (size_t i = 1; i < m_dirtyRanges.size(); i++) {
+		const DirtyRange& range = m_dirtyRanges[i];
+		if (range.first <= run.last) { // subtrees are nested or disjoint, so this one is inside the run or continues it
+			run.last = std::max(run.last, range.last);
+			continue;
+		}
+		updateRange(run.first, run.last);
+		updated += run.last - run.first;
+		run = range;
+	}
+	updateRange(run.first, run.last);
+	updated += run.last - run.first;
+
+	for (const DirtyRange& range : m_dirtyRanges) {
+		m_queued[range.first] = 0;
+	}
+	m_dirtyRanges.clear();
+	return updated;
+}
+
+void Scene::updateRange(uint32_t first, uint32_t last) {
+	uint32_t index = first;
+#ifdef SCENE_USE_SSE
+	for (; index + 4 <= last; index += 4) {
+		composeLocal4(index);
+		for (uint32_t i = index; i < index + 4; i++) { // in order, a parent in the same batch is finished before its children
+			finishWorld(i);
+		}
+	}
+#endif
+	for (; index < last; index++) {
+		composeLocal(index);
+		finishWorld(index);
+	}
+}
+
+void Scene::composeLocal(uint32_t index) {
+	float x = m_rotationX[index], y = m_rotationY[index], z = m_rotationZ[index], w = m_rotationW[index];
+	float scaleX = m_scaleX[index], scaleY = m_scaleY[index], scaleZ = m_scaleZ[index];
+	float* matrix = &m_worldMatrices[index][0][0];
+	matrix[0] = (1.0f - 2.0f * (y * y + z * z)) * scaleX; // same as glm::mat4_cast, columns scaled
+	matrix[1] = 2.0f * (x * y + w * z) * scaleX;
+	matrix[2] = 2.0f * (x * z - w * y) * scaleX;
+	matrix[3] = 0.0f;
+	matrix[4] = 2.0f * (x * y - w * z) * scaleY;
+	matrix[5] = (1.0f - 2.0f * (x * x + z * z)) * scaleY;
+	matrix[6] = 2.0f * (y * z + w * x) * scaleY;
+	matrix[7] = 0.0f;
+	matrix[8] = 2.0f * (x * z + w * y) * scaleZ;
+	matrix[9] = 2.0f * (y * z - w * x) * scaleZ;
+	matrix[10] = (1.0f - 2.0f * (x * x + y * y)) * scaleZ;
+	matrix[11] = 0.0f;
+	matrix[12] = m_positionX[index];
+	matrix[13] = m_positionY[index];
+	matrix[14] = m_positionZ[index];
+	matrix[15] = 1.0f;
+}
+
+void Scene::composeLocal4(uint32_t first) {
+#ifdef SCENE_USE_SSE
+	__m128 x = _mm_loadu_ps(&m_rotationX[first]); // one entity per lane
+	__m128 y = _mm_loadu_ps(&m_rotationY[first]);
+	__m128 z = _mm_loadu_ps(&m_rotationZ[first]);
+	__m128 w = _mm_loadu_ps(&m_rotationW[first]);
+	__m128 scaleX = _mm_loadu_ps(&m_scaleX[first]);
+	__m128 scaleY = _mm_loadu_ps(&m_scaleY[first]);
+	__m128 scaleZ = _mm_loadu_ps(&m_scaleZ[first]);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+
+	__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+	__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+	__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+	__m128 column0X = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX);
+	__m128 column0Y = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX);
+	__m128 column0Z = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX);
+	__m128 column0W = _mm_setzero_ps();
+	__m128 column1X = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY);
+	__m128 column1Y = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY);
+	__m128 column1Z = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY);
+	__m128 column1W = _mm_setzero_ps();
+	__m128 column2X = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ);
+	__m128 column2Y = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ);
+	__m128 column2Z = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ);
+	__m128 column2W = _mm_setzero_ps();
+	__m128 column3X = _mm_loadu_ps(&m_positionX[first]);
+	__m128 column3Y = _mm_loadu_ps(&m_positionY[first]);
+	__m128 column3Z = _mm_loadu_ps(&m_positionZ[first]);
+	__m128 column3W = one;
+
+	// lanes hold one entity each, the transposes turn them into one column per register
+	_MM_TRANSPOSE4_PS(column0X, column0Y, column0Z, column0W);
+	_MM_TRANSPOSE4_PS(column1X, column1Y, column1Z, column1W);
+	_MM_TRANSPOSE4_PS(column2X, column2Y, column2Z, column2W);
+	_MM_TRANSPOSE4_PS(column3X, column3Y, column3Z, column3W);
+	const __m128 columns[4][4] = {
+		{ column0X, column1X, column2X, column3X },
+		{ column0Y, column1Y, column2Y, column3Y },
+		{ column0Z, column1Z, column2Z, column3Z },
+		{ column0W, column1W, column2W, column3W },
+	};
+	for (uint32_t lane = 0; lane < 4; lane++) {
+		float* matrix = &m_worldMatrices[first + lane][0][0];
+		for (int column = 0; column < 4; column++) {
+			_mm_storeu_ps(matrix + column * 4, columns[lane][column]);
+		}
+	}
+#else
+	for (uint32_t index = first; index < first + 4; index++) {
+		composeLocal(index);
+	}
+#endif
+}
+
+void Scene::finishWorld(uint32_t index) {
+	float* world = &m_worldMatrices[index][0][0];
+	uint32_t parent = m_parents[index];
+	if (parent != NO_PARENT) {
+		multiplyMatrices(&m_worldMatrices[parent][0][0], world, world);
+	}
+
+	const glm::vec4& bounds = m_localBounds[index];
+	m_boundsCenterX[index] = world[0] * bounds.x + world[4] * bounds.y + world[8] * bounds.z + world[12];
+	m_boundsCenterY[index] = world[1] * bounds.x + world[5] * bounds.y + world[9] * bounds.z + world[13];
+	m_boundsCenterZ[index] = world[2] * bounds.x + world[6] * bounds.y + world[10] * bounds.z + world[14];
+	float scale0 = world[0] * world[0] + world[1] * world[1] + world[2] * world[2];
+	float scale1 = world[4] * world[4] + world[5] * world[5] + world[6] * world[6];
+	float scale2 = world[8] * world[8] + world[9] * world[9] + world[10] * world[10];
+	m_boundsRadius[index] = bounds.w * std::sqrt(std::max({ scale0, scale1, scale2 })); // the largest scale keeps the sphere conservative
+
+	const glm::vec3& extent = m_localExtents[index]; // the rotated box projected on the world axes
+	m_boundsExtentX[index] = std::abs(world[0]) * extent.x + std::abs(world[4]) * extent.y + std::abs(world[8]) * extent.z;
+	m_boundsExtentY[index] = std::abs(world[1]) * extent.x + std::abs(world[5]) * extent.y + std::abs(world[9]) * extent.z;
+	m_boundsExtentZ[index] = std::abs(world[2]) * extent.x + std::abs(world[6]) * extent.y + std::abs(world[10]) * extent.z;
+}
+
+void Scene::sortHierarchy() {
+	uint32_t count = static_cast<uint32_t>(m_entities.size());
+
+	// children of every entity in the order they were added, as ranges of one array
+	std::vector<uint32_t> childStarts(count + 1, 0);
+	for (uint32_t i = 0; i < count; i++) {
+		if (m_parents[i] != NO_PARENT) {
+			childStarts[m_parents[i] + 1]++;
+		}
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		childStarts[i + 1] += childStarts[i];
+	}
+	std::vector<uint32_t> children(count);
+	std::vector<uint32_t> nextChild(childStarts.begin(), childStarts.end() - 1);
+	for (uint32_t i = 0; i < count; i++) {
+		if (m_parents[i] != NO_PARENT) {
+			children[nextChild[m_parents[i]]++] = i;
+		}
+	}
+
+	// depth first from the roots in the order they were added
+	std::vector<uint32_t> order;
+	order.reserve(count);
+	std::vector<uint32_t> stack;
+	for (uint32_t root = 0; root < count; root++) {
+		if (m_parents[root] != NO_PARENT) {
+			continue;
+		}
+		stack.push_back(root);
+		while (!stack.empty()) {
+			uint32_t entity = stack.back();
+			stack.pop_back();
+			order.push_back(entity);
+			for (uint32_t child = childStarts[entity + 1]; child > childStarts[entity]; child--) { // reversed, so the first child is visited first
+				stack.push_back(children[child - 1]);
+			}
+		}
+	}
+
+	std::vector<uint32_t> newIndices(count);
+	for (uint32_t i = 0; i < count; i++) {
+		newIndices[order[i]] = i;
+	}
+	std::vector<float> floatScratch;
+	for (std::vector<float>* column : { &m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY, &m_rotationZ, &m_rotationW,
+		&m_scaleX, &m_scaleY, &m_scaleZ, &m_boundsCenterX, &m_boundsCenterY, &m_boundsCenterZ, &m_boundsRadius,
+		&m_boundsExtentX, &m_boundsExtentY, &m_boundsExtentZ }) {
+		permute(*column, order, floatScratch);
+	}
+	std::vector<uint32_t> indexScratch;
+	for (std::vector<uint32_t>* column : { &m_parents, &m_entities, &m_models, &m_materials }) {
+		permute(*column, order, indexScratch);
+	}
+	std::vector<glm::mat4> matrixScratch;
+	permute(m_worldMatrices, order, matrixScratch);
+	std::vector<uint8_t> flagScratch;
+	permute(m_visible, order, flagScratch);
+	std::vector<glm::vec4> boundsScratch;
+	permute(m_localBounds, order, boundsScratch);
+	std::vector<glm::vec3> extentScratch;
+	permute(m_localExtents, order, extentScratch);
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (m_parents[i] != NO_PARENT) {
+			m_parents[i] = newIndices[m_parents[i]];
+		}
+		m_indices[m_entities[i]] = i;
+		m_subtreeEnds[i] = i + 1;
+	}
+	for (uint32_t i = count; i-- > 0;) { // descendants follow their ancestor, so the largest end of the children is the subtree's
+		if (m_parents[i] != NO_PARENT) {
+			m_subtreeEnds[m_parents[i]] = std::max(m_subtreeEnds[m_parents[i]], m_subtreeEnds[i]);
+		}
+	}
+	m_queued.assign(count, 0);
+}
@@ -0,0 +1,135 @@
+#include "simulation.hpp"
+#include "config.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+glm::mat4 CameraState::getView() const {
+	return glm::lookAt(eye, target, up);
+}
+
+glm::mat4 CameraState::getProjection(float aspect) const {
+	glm::mat4 proj = glm::perspective(fovY, aspect, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
+	proj[1][1] *= -1; // flip the y axis because openGL standards in glm
+	return proj;
+}
+
+glm::mat4 CameraState::getWidenedProjection(float aspect, float margin) const {
+	const float maxHalfAngle = 1.5f;
+	float halfY = std::min(fovY * 0.5f + margin, maxHalfAngle);
+	float halfX = std::min(std::atan(aspect * std::tan(fovY * 0.5f)) + margin, maxHalfAngle);
+	glm::mat4 proj = glm::perspective(2.0f * halfY, std::tan(halfX) / std::tan(halfY), CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
+	proj[1][1] *= -1;
+	return proj;
+}
+
+void CameraState::look(float yaw, float pitch) {
+	glm::vec3 direction = target - eye;
+	glm::vec3 right = glm::normalize(glm::cross(direction, up));
+	direction = glm::angleAxis(pitch, right) * direction; // tilt first, so the yaw turns around the unchanged up direction
+	direction = glm::angleAxis(-yaw, up) * direction; // positive angles around up turn to the left in a right handed view
+	target = eye + direction;
+}
+
+void CameraState::interpolate(const CameraState& from, const CameraState& to, float alpha, CameraState& result) {
+	result.eye = glm::mix(from.eye, to.eye, alpha);
+	result.target = glm::mix(from.target, to.target, alpha);
+	result.up = glm::normalize(glm::mix(from.up, to.up, alpha));
+	result.fovY = glm::mix(from.fovY, to.fovY, alpha);
+}
+
+void SceneState::interpolate(const SceneState& from, const SceneState& to, float alpha, SceneState& result) {
+	result.objects.resize(to.objects.size());
+	for (size_t i = 0; i < to.objects.size(); i++) {
+		const ObjectState& target = to.objects[i];
+		if (i >= from.objects.size()) { // spawned this step, nothing to blend from
+			result.objects[i] = target;
+			continue;
+		}
+		const ObjectState& source = from.objects[i];
+		ObjectState& object = result.objects[i];
+		object.position = glm::mix(source.position, target.position, alpha);
+		object.rotation = glm::slerp(source.rotation, target.rotation, alpha);
+		object.scale = glm::mix(source.scale, target.scale, alpha);
+		object.visible = alpha < 1.0f ? source.visible : target.visible;
+	}
+	CameraState::interpolate(from.camera, to.camera, alpha, result.camera);
+}
+
+Simulation::Simulation(double timestep, Clock::time_point start) :
+	m_timestep(timestep),
+	m_nextStep(start),
+	m_currentTime(start)
+{
+	ObjectState model{}; // the barrel, rotated by step()
+	m_current.objects.push_back(model);
+	m_current.camera.eye = glm::vec3(0.0f, 1.0f, -3.0f);
+	m_current.camera.target = glm::vec3(0.0f, -2.0f, 10.0f);
+	m_previous = m_current;
+	publish();
+}
+
+Simulation::Clock::time_point Simulation::advance(Clock::time_point now) {
+	auto timestep = std::chrono::duration_cast<Clock::duration>(m_timestep);
+	uint32_t steps = 0;
+	while (m_nextStep <= now && steps < MAX_SIMULATION_STEPS) {
+		step();
+		m_currentTime = m_nextStep; // the state the step computed belongs to the time it was due
+		m_nextStep += timestep;
+		steps++;
+	}
+	if (m_nextStep <= now) { // fell too far behind (debugger, window drag), drop the time instead of fast forwarding
+		m_currentTime = now;
+		m_nextStep = now + timestep;
+	}
+	if (steps > 0) {
+		publish();
+	}
+	return m_nextStep;
+}
+
+void Simulation::step() {
+	m_previous = m_current;
+	if (!m_paused) {
+		m_animationTime += static_cast<float>(m_timestep.count());
+		m_version++; // paused steps keep the state, render on demand has nothing to draw
+	}
+	m_current.objects[0].rotation = glm::angleAxis(m_animationTime * glm::radians(20.f), glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f))); // rotate the model based on time
+	m_step++;
+}
+
+void Simulation::togglePause() {
+	m_paused = !m_paused;
+	m_previous = m_current; // nothing to blend while paused
+	m_version++;
+	publish();
+}
+
+void Simulation::publish() {
+	SimulationSnapshot& snapshot = m_snapshots.write();
+	snapshot.previous = m_previous; // reuses the vectors' storage
+	snapshot.current = m_current;
+	snapshot.currentTime = m_currentTime;
+	snapshot.step = m_step;
+	snapshot.version = m_version;
+	snapshot.paused = m_paused;
+	m_snapshots.publish();
+}
+
+const SimulationSnapshot& Simulation::acquireSnapshot() {
+	m_snapshots.update();
+	return m_snapshots.read();
+}
+
+void Simulation::interpolate(const SimulationSnapshot& snapshot, Clock::time_point now, SceneState& result) const {
+	SceneState::interpolate(snapshot.previous, snapshot.current, getBlendFactor(snapshot, now), result);
+}
+
+void Simulation::interpolateCamera(const SimulationSnapshot& snapshot, Clock::time_point now, CameraState& result) const {
+	CameraState::interpolate(snapshot.previous.camera, snapshot.current.camera, getBlendFactor(snapshot, now), result);
+}
+
+float Simulation::getBlendFactor(const SimulationSnapshot& snapshot, Clock::time_point now) const {
+	double alpha = std::chrono::duration<double>(now - snapshot.currentTime).count() / m_timestep.count(); // the render time trails the simulation by one step
+	return static_cast<float>(std::clamp(alpha, 0.0, 1.0));
+}
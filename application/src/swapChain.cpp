@@ -2,27 +2,22 @@
 
 #include "swapChain.hpp"
 #include "queueFamilyIndices.hpp"
+#include "log.hpp"
 
-VKSwapChain::VKSwapChain(VkSurfaceKHR& surface, VkPhysicalDevice physicalDevice, VkDevice device, GLFWwindow* window) :
+VKSwapChain::VKSwapChain(VkSurfaceKHR& surface, VkPhysicalDevice physicalDevice, VkDevice device, GLFWwindow* window, VkPresentModeKHR presentMode) :
 	m_device(device),
 	m_physicalDevice(physicalDevice),
-	m_window(window)
+	m_requestedPresentMode(presentMode)
 {
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	m_framebufferExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
 	createSwapChain(surface);
 	createImageViews();
 }
 
 
 void VKSwapChain::cleanupSwapChain() {
-
-	// TODO destroy image view
-	vkDestroyImageView(m_device, m_depthImageView, nullptr);
-	vkDestroyImage(m_device, m_depthImage, nullptr);
-	vkFreeMemory(m_device, m_depthImageMemory, nullptr);
-
-	for (size_t i = 0; i < m_swapChainFramebuffers.size(); i++) {
-		vkDestroyFramebuffer(m_device, m_swapChainFramebuffers[i], nullptr);
-	}
 	for (size_t i = 0; i < m_swapChainImageViews.size(); i++) {
 		vkDestroyImageView(m_device, m_swapChainImageViews[i], nullptr);
 	}
@@ -30,36 +25,30 @@ void VKSwapChain::cleanupSwapChain() {
 }
 
 
-void VKSwapChain::createFrameBuffers(VkRenderPass renderPass, VkImageView depthImageView) {
-	m_swapChainFramebuffers.resize(m_swapChainImageViews.size());
-	for (size_t i = 0; i < m_swapChainImageViews.size(); i++)
-	{
-		std::array<VkImageView, 2> attachments = {
-		m_swapChainImageViews[i],
-		depthImageView
-		};
-
-		VkFramebufferCreateInfo framebufferInfo{};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = renderPass;
-		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		framebufferInfo.pAttachments = attachments.data();
-		framebufferInfo.width = m_swapChainExtent.width;
-		framebufferInfo.height = m_swapChainExtent.height;
-		framebufferInfo.layers = 1;
-
-		if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &m_swapChainFramebuffers[i]) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create framebuffer!");
+void VKSwapChain::recreateSwapChain(VkSurfaceKHR surface, VkExtent2D framebufferExtent, DeletionQueue& deletionQueue, uint64_t retireValue) {
+	m_framebufferExtent = framebufferExtent;
+	VkSwapchainKHR oldSwapChain = m_swapChain;
+	std::vector<VkImageView> oldImageViews = m_swapChainImageViews;
+
+	createSwapChain(surface, oldSwapChain); // the old swap chain is retired but frames in flight may still present from it
+	createImageViews();
+
+	VkDevice device = m_device;
+	deletionQueue.push(retireValue, [device, oldSwapChain, oldImageViews]() {
+		for (VkImageView imageView : oldImageViews) {
+			vkDestroyImageView(device, imageView, nullptr);
 		}
-	}
+		vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+	});
 }
 
-void VKSwapChain::createSwapChain(VkSurfaceKHR surface) {
+void VKSwapChain::createSwapChain(VkSurfaceKHR surface, VkSwapchainKHR oldSwapChain) {
 	SwapChain::SwapChainSupportDetails swapChainSupport = SwapChain::querySwapChainSupport(m_physicalDevice, surface);
 
 	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
 	VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
-	VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities, m_window);
+	m_presentMode = presentMode;
+	VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
 	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
 	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
@@ -92,7 +81,7 @@ void VKSwapChain::createSwapChain(VkSurfaceKHR surface) {
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE; // ignore pixels that are obscured(like if behind another window)
-	createInfo.oldSwapchain = VK_NULL_HANDLE; // resizing stuff, look up later
+	createInfo.oldSwapchain = oldSwapChain; // hands the old swap chain over instead of tearing it down first
 
 	if (vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapChain) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swap chain!");
@@ -113,31 +102,6 @@ void VKSwapChain::createImageViews() { // can use createImageView() instead
 	}
 }
 
-// depth Buffer
-void VKSwapChain::createDepthResources(VkCommandPool commandPool, VkQueue queue) {
-	VkFormat depthFormat = findDepthFormat();
-
-	ImageUtils::createImage(m_device,
-		m_physicalDevice,
-		m_swapChainExtent.width,
-		m_swapChainExtent.height,
-		depthFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		m_depthImage,
-		m_depthImageMemory
-	);
-	m_depthImageView = ImageUtils::createImageView(m_device, m_depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
-	BufferUtils::transitionImageLayout(m_device,
-		commandPool,
-		queue,
-		m_depthImage, depthFormat,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL); // optional
-
-}
-
 VkFormat VKSwapChain::findDepthFormat()
 {
 	return findSupportedFormat(
@@ -158,24 +122,22 @@ VkSurfaceFormatKHR VKSwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurf
 
 VkPresentModeKHR VKSwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
 	for (const auto& availablePresentMode : availablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) { // check for mailbox mode
+		if (availablePresentMode == m_requestedPresentMode) { // check for the preferred mode
 			return availablePresentMode; // return the mode
 		}
 	}
+	if (m_requestedPresentMode != VK_PRESENT_MODE_FIFO_KHR) {
+		Log::info() << "present mode " << SwapChain::presentModeName(m_requestedPresentMode) << " not supported, using fifo" << std::endl;
+	}
 	return VK_PRESENT_MODE_FIFO_KHR; // return FIFO mode if not found
 }
 
-VkExtent2D VKSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window) {
+VkExtent2D VKSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
 	if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
 		return capabilities.currentExtent;
 	}
 	else {
-		int width, height;
-		glfwGetFramebufferSize(window, &width, &height);
-		VkExtent2D actualExtent = {
-			static_cast<uint32_t>(width),
-			static_cast<uint32_t>(height)
-		};
+		VkExtent2D actualExtent = m_framebufferExtent;
 		actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
 		actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
 		return actualExtent;
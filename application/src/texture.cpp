@@ -2,27 +2,49 @@
 
 #include "texture.hpp"
 
-Texture::Texture(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const char* path) : m_device(device), m_physicalDevice(physicalDevice), m_commandPool(commandPool), m_queue(queue), m_texturePath(path) {
+Texture::Texture(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const std::string& path, VkFormat format) : m_device(device), m_physicalDevice(physicalDevice), m_commandPool(commandPool), m_queue(queue), m_texturePath(path), m_format(format) {
 	createTextureImage();
 	createTextureImageView();
 	createTextureSampler();
 }
 
-void Texture::destroyTexture() {
-	vkDestroySampler(m_device, m_textureSampler, nullptr); // destroy the sampler
-	vkDestroyImageView(m_device, m_textureImageView, nullptr); // destroy the image view
-	vkDestroyImage(m_device, m_textureImage, nullptr); // destroy the image
-	vkFreeMemory(m_device, m_textureImageMemory, nullptr); // free the memory
+Texture::Texture(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const unsigned char* pixels, uint32_t width, uint32_t height, VkFormat format) : m_device(device), m_physicalDevice(physicalDevice), m_commandPool(commandPool), m_queue(queue), m_format(format) {
+	createTextureImage(pixels, width, height);
+	createTextureImageView();
+	createTextureSampler();
 }
 
-void Texture::createTextureImage() {
+void Texture::destroyTexture(DeletionQueue& deletionQueue) {
+	deletionQueue.destroySampler(m_textureSampler); // destroy the sampler
+	deletionQueue.destroyImageView(m_textureImageView); // destroy the image view
+	deletionQueue.destroyImage(m_textureImage); // destroy the image
+	deletionQueue.freeMemory(m_textureImageMemory); // free the memory
+	m_textureSampler = VK_NULL_HANDLE;
+	m_textureImageView = VK_NULL_HANDLE;
+	m_textureImage = VK_NULL_HANDLE;
+	m_textureImageMemory = VK_NULL_HANDLE;
+}
+
+DecodedImage Texture::decode(const std::string& path) {
 	int texWidth, texHeight, texChannels;
-	stbi_uc* pixels = stbi_load(m_texturePath, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha); // TODO take this from constructor
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
+	DecodedImage image;
+	image.pixels.reset(stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha)); // stb_image keeps no global state with the default settings
 
-	if (!pixels) {
-		throw std::runtime_error("failed to load texture image!");
+	if (!image.pixels) {
+		throw std::runtime_error("failed to load texture image: " + path);
 	}
+	image.width = static_cast<uint32_t>(texWidth);
+	image.height = static_cast<uint32_t>(texHeight);
+	return image;
+}
+
+void Texture::createTextureImage() {
+	DecodedImage image = decode(m_texturePath);
+	createTextureImage(image.pixels.get(), image.width, image.height);
+}
+
+void Texture::createTextureImage(const unsigned char* pixels, uint32_t texWidth, uint32_t texHeight) {
+	VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth) * texHeight * 4;
 
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
@@ -33,12 +55,10 @@ void Texture::createTextureImage() {
 	memcpy(data, pixels, static_cast<size_t>(imageSize));
 	vkUnmapMemory(m_device, stagingBufferMemory);
 
-	stbi_image_free(pixels);
-
-	ImageUtils::createImage(m_device, m_physicalDevice, texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_textureImage, m_textureImageMemory);
-	BufferUtils::transitionImageLayout(m_device, m_commandPool, m_queue, m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL); // transition to transfer layout
-	BufferUtils::copyBufferToImage(m_device, m_commandPool, m_queue, stagingBuffer, m_textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-	BufferUtils::transitionImageLayout(m_device, m_commandPool, m_queue, m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL); // transition to shader layout
+	ImageUtils::createImage(m_device, m_physicalDevice, texWidth, texHeight, m_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_textureImage, m_textureImageMemory);
+	BufferUtils::transitionImageLayout(m_device, m_commandPool, m_queue, m_textureImage, m_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL); // transition to transfer layout
+	BufferUtils::copyBufferToImage(m_device, m_commandPool, m_queue, stagingBuffer, m_textureImage, texWidth, texHeight);
+	BufferUtils::transitionImageLayout(m_device, m_commandPool, m_queue, m_textureImage, m_format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL); // transition to shader layout
 
 	vkDestroyBuffer(m_device, stagingBuffer, nullptr);
 	vkFreeMemory(m_device, stagingBufferMemory, nullptr);
@@ -48,7 +68,7 @@ void Texture::createTextureImage() {
 
 
 void Texture::createTextureImageView() {
-	m_textureImageView = ImageUtils::createImageView(m_device, m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT); // create the texture image view
+	m_textureImageView = ImageUtils::createImageView(m_device, m_textureImage, m_format, VK_IMAGE_ASPECT_COLOR_BIT); // create the texture image view
 }
 
 
@@ -7,23 +7,21 @@ UniformBuffers::UniformBuffers(VkDevice device, VkPhysicalDevice physicalDevice)
 	ubo = {};
 
 }
-void UniformBuffers::destroyUniformBuffers() {
+void UniformBuffers::destroyUniformBuffers(DeletionQueue& deletionQueue) {
 	for (size_t i = 0; i < m_uniformBuffers.size(); i++) {
-		vkDestroyBuffer(m_device, m_uniformBuffers[i], nullptr); // destroy the buffer
-		vkFreeMemory(m_device, m_uniformBuffersMemory[i], nullptr); // free the memory
+		deletionQueue.destroyBuffer(m_uniformBuffers[i]); // destroy the buffer
+		deletionQueue.freeMemory(m_uniformBuffersMemory[i]); // free the memory, unmaps it
 	}
+	m_uniformBuffers.clear();
+	m_uniformBuffersMemory.clear();
+	m_uniformBuffersMapped.clear();
 }
 
-void UniformBuffers::updateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExtent) {
-	static auto startTime = std::chrono::high_resolution_clock::now(); // start time
-
-	auto currentTime = std::chrono::high_resolution_clock::now(); // current time
-	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count(); // time since start
-	ubo.model = glm::mat4(1.0f); // initialize model matrix to identity
-	ubo.model = glm::rotate(ubo.model, time * glm::radians(20.f), glm::vec3(1.0f, 1.0f, 1.0f)); // rotate the model based on timeu		
-	ubo.view = glm::lookAt(glm::vec3(0.0f, 1.0f, -3.f), glm::vec3(0.0f, -2.0f, 10.0f), glm::vec3(0.0f, 1.f, 0.0f));
-	ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
-	ubo.proj[1][1] *= -1; // flip the y axis because openGL standards in glm
+void UniformBuffers::updateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExtent, const CameraState& camera) {
+	ubo.view = camera.getView();
+	ubo.proj = camera.getProjection(swapChainExtent.width / (float)swapChainExtent.height);
+	ubo.viewPos = glm::vec4(camera.eye, 1.0f);
+	ubo.lightDirection = glm::vec4(glm::normalize(glm::vec3(1.0f, -10.0f, 13.0f)), 0.0f);
 	memcpy(m_uniformBuffersMapped[currentImage], &ubo, sizeof(ubo)); // copy the data to the buffer
 }
 
@@ -13,6 +13,18 @@ Window::Window() {
     m_window = glfwCreateWindow(width, height, "Vulkan App", nullptr, nullptr);
     glfwSetWindowUserPointer(m_window, this);
     glfwSetFramebufferSizeCallback(m_window, framebufferResizeCallback);
+    glfwSetKeyCallback(m_window, keyCallback);
+    glfwSetWindowFocusCallback(m_window, focusCallback);
+    glfwSetWindowIconifyCallback(m_window, iconifyCallback);
+    glfwSetWindowRefreshCallback(m_window, refreshCallback);
+    glfwSetCursorPosCallback(m_window, cursorPosCallback);
+    glfwSetMouseButtonCallback(m_window, mouseButtonCallback);
+    glfwSetScrollCallback(m_window, scrollCallback);
+    focused = glfwGetWindowAttrib(m_window, GLFW_FOCUSED) == GLFW_TRUE;
+    int fbWidth = 0, fbHeight = 0;
+    glfwGetFramebufferSize(m_window, &fbWidth, &fbHeight); // kept up to date by the resize callback
+    framebufferWidth = fbWidth;
+    framebufferHeight = fbHeight;
 }
 
 
@@ -1,15 +1,46 @@
 #version 450
 layout(location = 0) out vec4 FragColour;
 
-layout(binding = 1) uniform sampler2D albedoTexture;
-layout(binding = 2) uniform sampler2D metalTexture;
-layout(binding = 3) uniform sampler2D normalTexture;
-layout(binding = 4) uniform sampler2D roughTexture;
+#define MAX_MATERIAL_TEXTURES 64 // must match config.hpp
+
+// must match GPUMaterial in material.hpp
+struct Material {
+    vec4 baseColorFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    uint flags;
+    uint padding;
+    uvec4 textureIndices; // albedo, metal, normal, rough
+};
+
+const uint MATERIAL_ALBEDO_TEXTURE = 1u;
+const uint MATERIAL_METAL_TEXTURE = 2u;
+const uint MATERIAL_NORMAL_TEXTURE = 4u;
+const uint MATERIAL_ROUGH_TEXTURE = 8u;
+
+// pipeline variant features, constant_id = bit index of ShaderFeatures in pipelineState.hpp
+layout(constant_id = 0) const bool USE_NORMAL_MAP = false;
+layout(constant_id = 1) const bool ALPHA_TEST = false;
+const float ALPHA_CUTOFF = 0.5;
+
+layout(set = 1, binding = 0) uniform UBO { // per-frame set
+    mat4 view;
+    mat4 proj;
+    vec4 viewPos;
+    vec4 lightDirection;
+} ubo;
+
+layout(std430, set = 0, binding = 0) readonly buffer MaterialTable {
+    Material materials[];
+};
+
+layout(set = 0, binding = 1) uniform sampler2D textures[MAX_MATERIAL_TEXTURES];
 
 layout(location = 0) in vec2 UV;
 layout(location = 1) in vec3 norm;
 layout(location = 2) in vec3 posInWS;
 layout(location = 3) in mat3 TBN;
+layout(location = 6) flat in uint materialIndex; // of the instance
 
 const float PI = 3.14159265;
 
@@ -23,17 +54,35 @@ vec3 aces(vec3 x);
 
 
 void main() {
-    // Setup uniforms (replace hardcoded with uniforms if possible)
-    vec3 lightDirection = normalize(vec3(1.0, -10.0, 13));
-    vec3 viewPos = vec3(0.0, 1.5, -3.0);
+    vec3 lightDirection = ubo.lightDirection.xyz;
+    vec3 viewPos = ubo.viewPos.xyz;
 
-    vec2 uv = UV;
-    vec3 N_sample = texture(normalTexture, uv).rgb;
-    vec3 N = normalize(TBN * (N_sample * 2.0 - 1.0));
+    // materialIndex is dynamically uniform so it can index the texture array
+    Material material = materials[materialIndex];
 
-    vec3 alb = texture(albedoTexture, uv).rgb;
-    float roughness = texture(roughTexture, uv).r;
-    float metal = texture(metalTexture, uv).r;
+    vec2 uv = UV;
+    vec3 N = normalize(norm);
+    if (USE_NORMAL_MAP && (material.flags & MATERIAL_NORMAL_TEXTURE) != 0u) { // compiled out of variants without normal mapping
+        vec3 N_sample = texture(textures[material.textureIndices.z], uv).rgb;
+        N = normalize(TBN * (N_sample * 2.0 - 1.0));
+    }
+
+    vec4 albedo = material.baseColorFactor;
+    if ((material.flags & MATERIAL_ALBEDO_TEXTURE) != 0u) {
+        albedo *= texture(textures[material.textureIndices.x], uv);
+    }
+    if (ALPHA_TEST && albedo.a < ALPHA_CUTOFF) {
+        discard;
+    }
+    vec3 alb = albedo.rgb;
+    float roughness = material.roughnessFactor;
+    if ((material.flags & MATERIAL_ROUGH_TEXTURE) != 0u) {
+        roughness *= texture(textures[material.textureIndices.w], uv).r;
+    }
+    float metal = material.metallicFactor;
+    if ((material.flags & MATERIAL_METAL_TEXTURE) != 0u) {
+        metal *= texture(textures[material.textureIndices.y], uv).r;
+    }
 
     vec3 F0 = mix(vec3(0.04), alb, metal);
 
@@ -9,21 +9,37 @@ layout(location = 0) out vec2 UV;
 layout(location = 1) out vec3 norm;
 layout(location = 2) out vec3 posInWS;
 layout(location = 3) out mat3 TBN;
+layout(location = 6) flat out uint materialIndex;
 
-layout(binding = 0) uniform UBO {
-    mat4 model;
+layout(set = 1, binding = 0) uniform UBO { // per-frame set
     mat4 view;
     mat4 proj;
+    vec4 viewPos;
+    vec4 lightDirection;
 } ubo;
 
+// must match GPUInstance in instanceBuffers.hpp
+struct Instance {
+    mat4 model;
+    uint materialIndex;
+    uint batchIndex;
+    uint objectIndex;
+    uint padding;
+};
+
+layout(std430, set = 1, binding = 1) readonly buffer InstanceTable {
+    Instance instances[];
+};
+
 void main() {
+    Instance instance = instances[gl_InstanceIndex]; // includes the draw's firstInstance
 
-    posInWS = (ubo.model * vec4(pos, 1.0)).xyz;
+    posInWS = (instance.model * vec4(pos, 1.0)).xyz;
     gl_Position = ubo.proj * ubo.view * vec4(posInWS, 1.0);
 
     // Transform normal and tangent with normalMatrix
-    vec3 T = normalize(vec3(ubo.model * vec4(tangent, 0.0)));
-    vec3 N = normalize(vec3(ubo.model * vec4(normal, 0.0)));
+    vec3 T = normalize(vec3(instance.model * vec4(tangent, 0.0)));
+    vec3 N = normalize(vec3(instance.model * vec4(normal, 0.0)));
 
     T = normalize(T - dot(T, N) * N); // Ensure T is orthogonal to N
     vec3 B = normalize(cross(N, T));
@@ -31,5 +47,6 @@ void main() {
     norm = N;
     UV = texCoord;
     TBN = mat3(T, B, N);
+    materialIndex = instance.materialIndex;
 
 }
\ No newline at end of file
@@ -0,0 +1,32 @@
+# Turns a SPIR-V binary into a header holding it as a constexpr uint32_t array.
+#
+# Usage: cmake -DSPIRV_FILE=<in.spv> -DHEADER_FILE=<out.hpp> -DSYMBOL=<name> -P embedSpirv.cmake
+
+file(READ "${SPIRV_FILE}" _spirv_hex HEX)
+string(LENGTH "${_spirv_hex}" _spirv_hex_length)
+math(EXPR _spirv_remainder "${_spirv_hex_length} % 8")
+if(_spirv_hex_length EQUAL 0 OR NOT _spirv_remainder EQUAL 0)
+    message(FATAL_ERROR "${SPIRV_FILE} is not a SPIR-V binary (size must be a non-zero multiple of 4 bytes)")
+endif()
+
+# SPIR-V words are little endian, swap each group of 4 bytes into a 0x literal
+string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "0x\\4\\3\\2\\1," _spirv_words "${_spirv_hex}")
+# 8 words per line (CMake regexes have no {n} repetition)
+set(_word "0x[0-9a-f]+,")
+string(REGEX REPLACE "(${_word}${_word}${_word}${_word}${_word}${_word}${_word}${_word})" "\\1\n\t\t" _spirv_words "${_spirv_words}")
+
+file(WRITE "${HEADER_FILE}.tmp"
+"// generated from ${SPIRV_FILE} by embedSpirv.cmake, do not edit
+#pragma once
+
+#include <cstdint>
+
+namespace EmbeddedShaders {
+	alignas(4) inline constexpr uint32_t ${SYMBOL}[] = {
+		${_spirv_words}
+	};
+}
+")
+# only touch the header when the SPIR-V changed, so unchanged shaders don't trigger rebuilds
+execute_process(COMMAND "${CMAKE_COMMAND}" -E copy_if_different "${HEADER_FILE}.tmp" "${HEADER_FILE}")
+file(REMOVE "${HEADER_FILE}.tmp")